@@ -0,0 +1,305 @@
+#include <skygfx/skygfx.h>
+#include <skygfx/shader_cache.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// cpu microbenchmarks of shader startup and per-draw overhead, no gpu is needed.
+// usage: skygfx-bench [--filter <substring>] [--min-time <seconds>]
+// results are written to stdout as json
+
+static std::string vertex_shader_code = R"(
+#version 450 core
+
+layout(location = POSITION_LOCATION) in vec3 aPosition;
+layout(location = TEXCOORD_LOCATION) in vec2 aTexCoord;
+
+layout(binding = 1) uniform _ubo
+{
+	mat4 projection;
+	mat4 view;
+	mat4 model;
+} ubo;
+
+layout(location = 0) out struct { vec2 TexCoord; } Out;
+out gl_PerVertex { vec4 gl_Position; };
+
+void main()
+{
+	Out.TexCoord = aTexCoord;
+#ifdef FLIP_TEXCOORD_Y
+	Out.TexCoord.y = 1.0 - Out.TexCoord.y;
+#endif
+	gl_Position = ubo.projection * ubo.view * ubo.model * vec4(aPosition, 1.0);
+})";
+
+static std::string fragment_shader_code = R"(
+#version 450 core
+
+layout(location = 0) out vec4 result;
+layout(location = 0) in struct { vec2 TexCoord; } In;
+layout(binding = 0) uniform sampler2D sTexture;
+
+void main()
+{
+	result = texture(sTexture, In.TexCoord);
+})";
+
+struct BenchResult
+{
+	std::string name;
+	uint64_t iterations;
+	double ns_per_op;
+};
+
+static std::string gFilter;
+static double gMinTime = 0.25; // seconds
+static std::vector<BenchResult> gResults;
+static volatile size_t gSink = 0;
+
+static void Consume(size_t value)
+{
+	gSink = gSink + value; // keeps results of benchmarked calls alive
+}
+
+static void Bench(const std::string& name, const std::function<void()>& func)
+{
+	if (!gFilter.empty() && name.find(gFilter) == std::string::npos)
+		return;
+
+	func(); // warm up
+
+	uint64_t iterations = 1;
+
+	while (true)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			func();
+		}
+
+		auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (seconds >= gMinTime)
+		{
+			gResults.push_back({ name, iterations, seconds * 1e9 / (double)iterations });
+			std::cerr << name << ": " << gResults.back().ns_per_op << " ns/op" << std::endl;
+			return;
+		}
+
+		iterations *= 2;
+	}
+}
+
+static void WriteResults(std::ostream& stream)
+{
+	stream << "{\n\t\"min_time\": " << gMinTime << ",\n\t\"benchmarks\": [";
+
+	for (size_t i = 0; i < gResults.size(); i++)
+	{
+		const auto& result = gResults.at(i);
+
+		if (i > 0)
+			stream << ",";
+
+		stream << "\n\t\t{ \"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+			<< ", \"ns_per_op\": " << result.ns_per_op << " }";
+	}
+
+	stream << "\n\t]\n}\n";
+}
+
+static void BenchShaderCompiler()
+{
+	using namespace skygfx;
+
+	const auto& layout = Vertex::PositionTexture::Layout;
+
+	std::vector<std::string> location_defines;
+	AddShaderLocationDefines(layout, location_defines);
+
+	auto defines = location_defines;
+	defines.push_back("FLIP_TEXCOORD_Y");
+
+	auto vertex_spirv = CompileGlslToSpirv(ShaderStage::Vertex, vertex_shader_code, defines);
+	auto fragment_spirv = CompileGlslToSpirv(ShaderStage::Fragment, fragment_shader_code);
+
+	Bench("CompileGlslToSpirv/fragment", [&] {
+		Consume(CompileGlslToSpirv(ShaderStage::Fragment, fragment_shader_code).size());
+	});
+
+	Bench("CompileGlslToSpirv/vertex", [&] {
+		Consume(CompileGlslToSpirv(ShaderStage::Vertex, vertex_shader_code, location_defines).size());
+	});
+
+	Bench("CompileGlslToSpirv/vertex_defines", [&] {
+		Consume(CompileGlslToSpirv(ShaderStage::Vertex, vertex_shader_code, defines).size());
+	});
+
+	Bench("OptimizeSpirv/vertex", [&] {
+		Consume(OptimizeSpirv(vertex_spirv, {}).size());
+	});
+
+	Bench("OptimizeSpirv/vertex_strip_remap", [&] {
+		Consume(OptimizeSpirv(vertex_spirv, { .strip_debug_info = true, .remap_ids = true }).size());
+	});
+
+	Bench("CompileSpirvToHlsl", [&] {
+		Consume(CompileSpirvToHlsl(vertex_spirv).size());
+	});
+
+	Bench("CompileSpirvToGlsl", [&] {
+		Consume(CompileSpirvToGlsl(vertex_spirv).size());
+	});
+
+	Bench("CompileSpirvToMsl", [&] {
+		Consume(CompileSpirvToMsl(vertex_spirv).size());
+	});
+
+	Bench("MakeSpirvReflection/vertex", [&] {
+		Consume(MakeSpirvReflection(vertex_spirv).descriptor_sets.size());
+	});
+
+	Bench("MakeSpirvReflection/fragment", [&] {
+		Consume(MakeSpirvReflection(fragment_spirv).descriptor_sets.size());
+	});
+
+	ClearShaderCache();
+	CompileShader(ShaderStage::Vertex, ShaderTarget::Glsl, vertex_shader_code, defines);
+
+	Bench("CompileShader/memory_hit", [&] {
+		Consume(CompileShader(ShaderStage::Vertex, ShaderTarget::Glsl, vertex_shader_code, defines).source.size());
+	});
+
+	Bench("AddShaderLocationDefines", [&] {
+		std::vector<std::string> location_defines;
+		AddShaderLocationDefines(layout, location_defines);
+		Consume(location_defines.size());
+	});
+}
+
+static void BenchHashes()
+{
+	using namespace skygfx;
+
+	auto blend_mode = BlendStates::NonPremultiplied;
+	auto depth_mode = DepthMode{ ComparisonFunc::LessEqual };
+	auto stencil_mode = StencilMode();
+
+	Bench("hash/BlendMode", [&] {
+		Consume(std::hash<BlendMode>()(blend_mode));
+	});
+
+	Bench("hash/DepthMode", [&] {
+		Consume(std::hash<DepthMode>()(depth_mode));
+	});
+
+	Bench("hash/StencilMode", [&] {
+		Consume(std::hash<StencilMode>()(stencil_mode));
+	});
+}
+
+static void BenchDevice()
+{
+	using namespace skygfx;
+
+	// the null backend does no work, so these measure the cost of the device layer itself
+
+	auto device = Device(BackendType::Null, nullptr, 800, 600);
+
+	using Vertex = Vertex::PositionTexture;
+
+	std::vector<Vertex> vertices(4);
+	std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+	auto pixel = std::vector<uint8_t>{ 255, 255, 255, 255 };
+	auto texture = Texture(1, 1, 4, pixel.data());
+	auto shader = Shader(Vertex::Layout, vertex_shader_code, fragment_shader_code);
+	auto ubo = glm::mat4(1.0f);
+	auto vertex_buffer = VertexBuffer(vertices);
+	auto index_buffer = IndexBuffer(indices);
+
+	Bench("Device/setVertexBuffer", [&] {
+		device.setVertexBuffer(vertices);
+	});
+
+	Bench("Device/setIndexBuffer", [&] {
+		device.setIndexBuffer(indices);
+	});
+
+	Bench("Device/setVertexBuffer_static", [&] {
+		device.setVertexBuffer(vertex_buffer);
+	});
+
+	Bench("Device/setIndexBuffer_static", [&] {
+		device.setIndexBuffer(index_buffer);
+	});
+
+	Bench("Device/setUniformBuffer", [&] {
+		device.setUniformBuffer(1, ubo);
+	});
+
+	Bench("Device/setBlendMode", [&] {
+		device.setBlendMode(BlendStates::AlphaBlend);
+	});
+
+	Bench("Device/setTexture", [&] {
+		device.setTexture(texture);
+	});
+
+	Bench("Device/drawIndexed", [&] {
+		device.drawIndexed((uint32_t)indices.size());
+	});
+
+	Bench("Device/draw_call", [&] {
+		device.setShader(shader);
+		device.setTexture(texture);
+		device.setBlendMode(BlendStates::AlphaBlend);
+		device.setVertexBuffer(vertices);
+		device.setIndexBuffer(indices);
+		device.setUniformBuffer(1, ubo);
+		device.drawIndexed((uint32_t)indices.size());
+	});
+
+	Bench("Device/draw_call_static", [&] {
+		device.setShader(shader);
+		device.setTexture(texture);
+		device.setBlendMode(BlendStates::AlphaBlend);
+		device.setVertexBuffer(vertex_buffer);
+		device.setIndexBuffer(index_buffer);
+		device.setUniformBuffer(1, ubo);
+		device.drawIndexed((uint32_t)indices.size());
+	});
+
+	Bench("Device/present", [&] {
+		device.present();
+	});
+}
+
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			gFilter = argv[++i];
+		else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+			gMinTime = std::stod(argv[++i]);
+		else
+		{
+			std::cerr << "usage: skygfx-bench [--filter <substring>] [--min-time <seconds>]" << std::endl;
+			return 1;
+		}
+	}
+
+	BenchShaderCompiler();
+	BenchHashes();
+	BenchDevice();
+
+	WriteResults(std::cout);
+	return 0;
+}
@@ -0,0 +1,194 @@
+#include <skygfx/shader_bundle.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// compiles shaders of a manifest ahead of time into a bundle for skygfx::ShaderBundle.
+// usage: skygfx-shaderc <manifest> <output> [--backends <list>] [--debug-info]
+// every manifest line is "<name> <attributes> <vertex file> <fragment file> [define...]", where
+// attributes are comma separated position, color, texcoord, normal in layout order.
+// fragment file is "-" for depth-only shaders.
+// files are relative to the manifest, so are names of #include, lines starting with # are comments.
+// spirv is stripped of debug info and remapped for compression unless --debug-info is given
+
+static const char* Usage = "usage: skygfx-shaderc <manifest> <output> [--backends d3d11,opengl,vulkan,metal,software,null] [--debug-info]";
+
+static std::vector<std::string> Split(const std::string& value, char separator)
+{
+	std::vector<std::string> result;
+	std::stringstream stream(value);
+	std::string item;
+
+	while (std::getline(stream, item, separator))
+	{
+		if (!item.empty())
+			result.push_back(item);
+	}
+
+	return result;
+}
+
+static std::string ReadFile(const std::filesystem::path& path)
+{
+	auto stream = std::ifstream(path, std::ios::binary);
+
+	if (!stream)
+		throw std::runtime_error("cannot open " + path.string());
+
+	std::stringstream result;
+	result << stream.rdbuf();
+	return result.str();
+}
+
+static std::vector<skygfx::BackendType> ParseBackends(const std::string& value)
+{
+	using skygfx::BackendType;
+
+	static const std::unordered_map<std::string, BackendType> Names = {
+		{ "d3d11", BackendType::D3D11 },
+		{ "opengl", BackendType::OpenGL44 },
+		{ "vulkan", BackendType::Vulkan },
+		{ "metal", BackendType::Metal },
+		{ "software", BackendType::Software },
+		{ "null", BackendType::Null }
+	};
+
+	std::vector<BackendType> result;
+
+	for (const auto& name : Split(value, ','))
+	{
+		if (!Names.contains(name))
+			throw std::runtime_error("unknown backend " + name);
+
+		result.push_back(Names.at(name));
+	}
+
+	return result;
+}
+
+static std::vector<skygfx::ShaderBundleSource> ReadManifest(const std::filesystem::path& path)
+{
+	using skygfx::Vertex::Attribute;
+
+	static const std::unordered_map<std::string, Attribute::Type> AttributeNames = {
+		{ "position", Attribute::Type::Position },
+		{ "color", Attribute::Type::Color },
+		{ "texcoord", Attribute::Type::TexCoord },
+		{ "normal", Attribute::Type::Normal }
+	};
+
+	auto directory = path.parent_path();
+	auto stream = std::istringstream(ReadFile(path));
+	std::vector<skygfx::ShaderBundleSource> result;
+	std::string line;
+	int line_number = 0;
+
+	while (std::getline(stream, line))
+	{
+		line_number += 1;
+
+		std::replace(line.begin(), line.end(), '\t', ' ');
+		std::replace(line.begin(), line.end(), '\r', ' ');
+
+		auto words = Split(line, ' ');
+
+		if (words.empty() || words.at(0).starts_with("#"))
+			continue;
+
+		auto error_prefix = path.string() + ":" + std::to_string(line_number) + ": ";
+
+		if (words.size() < 4)
+			throw std::runtime_error(error_prefix + "expected <name> <attributes> <vertex file> <fragment file> [define...]");
+
+		auto source = skygfx::ShaderBundleSource();
+		source.name = words.at(0);
+
+		for (const auto& attribute : Split(words.at(1), ','))
+		{
+			if (!AttributeNames.contains(attribute))
+				throw std::runtime_error(error_prefix + "unknown attribute " + attribute);
+
+			source.attributes.push_back(AttributeNames.at(attribute));
+		}
+
+		source.vertex_code = ReadFile(directory / words.at(2));
+
+		if (words.at(3) != "-")
+			source.fragment_code = ReadFile(directory / words.at(3));
+
+		source.defines.assign(words.begin() + 4, words.end());
+
+		result.push_back(std::move(source));
+	}
+
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> paths;
+	std::string backends = "d3d11,opengl,vulkan,metal,software";
+	bool debug_info = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--backends") == 0 && i + 1 < argc)
+			backends = argv[++i];
+		else if (strcmp(argv[i], "--debug-info") == 0)
+			debug_info = true;
+		else
+			paths.push_back(argv[i]);
+	}
+
+	if (paths.size() != 2)
+	{
+		std::cerr << Usage << std::endl;
+		return 1;
+	}
+
+	auto directory = std::filesystem::path(paths.at(0)).parent_path();
+
+	skygfx::SetShaderIncludeLoader([directory](const std::string& name) -> std::optional<std::string> {
+		auto path = directory / name;
+
+		if (!std::filesystem::is_regular_file(path))
+			return std::nullopt;
+
+		return ReadFile(path);
+	});
+
+	auto optimization = skygfx::SpirvOptimizationOptions();
+	optimization.strip_debug_info = !debug_info;
+	optimization.remap_ids = !debug_info;
+	skygfx::SetSpirvOptimizationOptions(optimization);
+
+	try
+	{
+		auto sources = ReadManifest(paths.at(0));
+
+		// written to memory first, so a failed compilation leaves no partial bundle behind
+		std::stringstream bundle;
+		skygfx::WriteShaderBundle(bundle, sources, ParseBackends(backends));
+
+		auto stream = std::ofstream(paths.at(1), std::ios::binary);
+
+		if (!stream)
+			throw std::runtime_error("cannot write " + paths.at(1));
+
+		stream << bundle.rdbuf();
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "skygfx-shaderc: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
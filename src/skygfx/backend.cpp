@@ -1,4 +1,65 @@
 #include "backend.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
 using namespace skygfx;
 
+
+ShaderTarget skygfx::GetShaderTarget(BackendType type)
+{
+	switch (type)
+	{
+	case BackendType::D3D11: return ShaderTarget::Hlsl;
+	case BackendType::OpenGL44: return ShaderTarget::Glsl;
+	case BackendType::Metal: return ShaderTarget::Msl;
+	default: return ShaderTarget::Spirv;
+	}
+}
+
+ShaderReflection skygfx::MergeShaderReflections(const CompiledShaderView& vertex, const CompiledShaderView& fragment)
+{
+	if (fragment.spirv.empty())
+		return MergeShaderReflections({ vertex.reflection });
+
+	return MergeShaderReflections({ vertex.reflection, fragment.reflection });
+}
+
+std::vector<uint32_t> skygfx::GetUsedVertexAttributes(const Vertex::Layout& layout, const ShaderReflection& reflection)
+{
+	std::vector<uint32_t> result;
+
+	for (uint32_t i = 0; i < (uint32_t)layout.attributes.size(); i++)
+	{
+		auto used = std::any_of(reflection.inputs.begin(), reflection.inputs.end(), [i](const auto& input) {
+			return input.location == i;
+		});
+
+		if (used)
+			result.push_back(i);
+	}
+
+	return result;
+}
+
+void skygfx::CheckUniformBufferSize(const ShaderReflection::DescriptorSet& descriptor_set, size_t size)
+{
+	if (size >= descriptor_set.size)
+		return;
+
+	throw std::runtime_error("uniform buffer binding " + std::to_string(descriptor_set.binding) + " has " +
+		std::to_string(size) + " bytes, the shader reads " + std::to_string(descriptor_set.size));
+}
+
+std::vector<std::string> skygfx::MakeShaderDefines(BackendType type, const Vertex::Layout& layout,
+	const std::vector<std::string>& defines)
+{
+	auto result = defines;
+	AddShaderLocationDefines(layout, result);
+
+	if (type == BackendType::OpenGL44)
+		result.push_back("FLIP_TEXCOORD_Y");
+
+	return result;
+}
@@ -20,6 +20,8 @@ namespace skygfx
 		virtual void setShader(ShaderHandle* handle) = 0;
 		virtual void setVertexBuffer(const Buffer& buffer) = 0;
 		virtual void setIndexBuffer(const Buffer& buffer) = 0;
+		virtual void setVertexBuffer(VertexBufferHandle* handle) = 0;
+		virtual void setIndexBuffer(IndexBufferHandle* handle) = 0;
 		virtual void setUniformBuffer(uint32_t slot, void* memory, size_t size) = 0;
 		virtual void setBlendMode(const BlendMode& value) = 0;
 		virtual void setDepthMode(std::optional<DepthMode> depth_mode) = 0;
@@ -37,6 +39,10 @@ namespace skygfx
 
 		virtual void present() = 0;
 
+		virtual void beginTimer(const std::string& name) = 0;
+		virtual void endTimer() = 0;
+		virtual const std::vector<GpuTimer>& getGpuTimers() = 0;
+
 		virtual TextureHandle* createTexture(uint32_t width, uint32_t height, uint32_t channels, 
 			void* memory, bool mipmap) = 0;
 		virtual void destroyTexture(TextureHandle* handle) = 0;
@@ -44,8 +50,54 @@ namespace skygfx
 		virtual RenderTargetHandle* createRenderTarget(uint32_t width, uint32_t height, TextureHandle* texture) = 0;
 		virtual void destroyRenderTarget(RenderTargetHandle* handle) = 0;
 
+		// memory is copied into gpu memory once, the buffer is never written again
+		virtual VertexBufferHandle* createVertexBuffer(void* memory, size_t size, size_t stride) = 0;
+		virtual void destroyVertexBuffer(VertexBufferHandle* handle) = 0;
+		virtual IndexBufferHandle* createIndexBuffer(void* memory, size_t size, size_t stride) = 0;
+		virtual void destroyIndexBuffer(IndexBufferHandle* handle) = 0;
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+		// specialization constants are passed to the pipeline by vulkan, other backends translate
+		// the stages again with them applied. stages are still compiled from glsl once for all values
 		virtual ShaderHandle* createShader(const Vertex::Layout& layout, const std::string& vertex_code, 
-			const std::string& fragment_code, const std::vector<std::string>& defines) = 0;
+			const std::string& fragment_code, const std::vector<std::string>& defines,
+			const SpecializationConstants& specialization_constants) = 0;
+#endif
 		virtual void destroyShader(ShaderHandle* handle) = 0;
+
+		// stages which are already compiled for this backend, for example loaded from a shader bundle
+		virtual ShaderHandle* createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+			const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants) = 0;
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+		// compiles stages on the shader compiler threads exactly as createShader would,
+		// so createShader with the same arguments finds them in the shader cache
+		virtual std::vector<std::shared_future<CompiledShader>> compileShaderAsync(const Vertex::Layout& layout,
+			const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& defines) = 0;
+#endif
 	};
-}
\ No newline at end of file
+
+	// backend of the current device, nullptr when there is no device
+	Backend* GetCurrentBackend();
+	BackendType GetCurrentBackendType();
+
+	// target and defines which backends of the type compile shader stages with, user defines come first.
+	// shared with shader bundles, which are compiled without a device
+	ShaderTarget GetShaderTarget(BackendType type);
+	std::vector<std::string> MakeShaderDefines(BackendType type, const Vertex::Layout& layout,
+		const std::vector<std::string>& defines);
+
+	// reflection of the program of both stages, a missing fragment stage is skipped
+	ShaderReflection MergeShaderReflections(const CompiledShaderView& vertex, const CompiledShaderView& fragment);
+
+	// indices of layout attributes which the vertex stage reads, an index is also the location of the attribute.
+	// backends declare only these in their input descriptions, so unread attributes are not fetched
+	std::vector<uint32_t> GetUsedVertexAttributes(const Vertex::Layout& layout, const ShaderReflection& reflection);
+
+	// throws when a uniform buffer of size bytes is smaller than the block the shader reads from its binding,
+	// backends check bound uniform buffers at draw time in every build type
+	void CheckUniformBufferSize(const ShaderReflection::DescriptorSet& descriptor_set, size_t size);
+
+	// counters of the frame in progress, backends add their native object creations here
+	FrameStats& GetCurrentFrameStats();
+}
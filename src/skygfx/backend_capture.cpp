@@ -0,0 +1,1307 @@
+#include "backend_capture.h"
+#include "shader_cache.h"
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace skygfx;
+
+// stream layout: header, then commands until end of stream.
+// every command is one byte of CaptureCommand followed by its arguments,
+// values are written as raw little endian bytes, blobs are aligned to 16 bytes
+// from the stream start, so replay can pass them to the backend without copying
+
+enum class skygfx::CaptureCommand : uint8_t
+{
+	Resize,
+	SetTopology,
+	SetViewport,
+	SetScissor,
+	SetTexture,
+	SetRenderTarget,
+	SetShader,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	SetUniformBuffer,
+	SetBlendMode,
+	SetDepthMode,
+	SetStencilMode,
+	SetCullMode,
+	SetSampler,
+	SetTextureAddressMode,
+	Clear,
+	Draw,
+	DrawIndexed,
+	ReadPixels,
+	Present,
+	CreateTexture,
+	DestroyTexture,
+	CreateRenderTarget,
+	DestroyRenderTarget,
+	CreateShader,
+	DestroyShader,
+	CreateVertexBuffer,
+	DestroyVertexBuffer,
+	CreateIndexBuffer,
+	DestroyIndexBuffer,
+	BindVertexBuffer,
+	BindIndexBuffer,
+	CreateCompiledShader
+};
+
+static const uint32_t CaptureMagic = 0x43594B53; // "SKYC"
+static const uint32_t CaptureVersion = 2;
+static const size_t CaptureBlobAlignment = 16;
+
+static bool gCaptureEnabled = false;
+static BackendCapture* gCaptureBackend = nullptr;
+
+class skygfx::CaptureWriter
+{
+public:
+	CaptureWriter(std::ostream& stream) : mStream(stream) {}
+
+	template <class T> void write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		writeBytes(&value, sizeof(T));
+	}
+
+	template <class T> void write(const std::optional<T>& value)
+	{
+		write<uint8_t>(value.has_value());
+		if (value.has_value())
+			write(value.value());
+	}
+
+	void write(CaptureCommand command)
+	{
+		write<uint8_t>((uint8_t)command);
+	}
+
+	void writeString(const std::string& value)
+	{
+		write<uint32_t>((uint32_t)value.size());
+		writeBytes(value.data(), value.size());
+	}
+
+	void writeBlob(const void* memory, size_t size)
+	{
+		write<uint64_t>(size);
+
+		static const uint8_t padding[CaptureBlobAlignment] = {};
+		writeBytes(padding, (CaptureBlobAlignment - mOffset % CaptureBlobAlignment) % CaptureBlobAlignment);
+		writeBytes(memory, size);
+	}
+
+	void writeBytes(const void* memory, size_t size)
+	{
+		mStream.write((const char*)memory, size);
+		mOffset += size;
+	}
+
+private:
+	std::ostream& mStream;
+	uint64_t mOffset = 0;
+};
+
+class CaptureReader
+{
+public:
+	CaptureReader(const void* data, size_t size) : mData((const uint8_t*)data), mSize(size) {}
+
+	bool isEnd() const { return mOffset >= mSize; }
+
+	template <class T> T read()
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		std::array<uint8_t, sizeof(T)> bytes;
+		memcpy(bytes.data(), readBytes(sizeof(T)), sizeof(T));
+		return std::bit_cast<T>(bytes);
+	}
+
+	template <class T> std::optional<T> readOptional()
+	{
+		if (read<uint8_t>() == 0)
+			return std::nullopt;
+
+		return read<T>();
+	}
+
+	std::string readString()
+	{
+		auto size = read<uint32_t>();
+		return std::string((const char*)readBytes(size), size);
+	}
+
+	const uint8_t* readBlob(size_t& size)
+	{
+		size = (size_t)read<uint64_t>();
+		readBytes((CaptureBlobAlignment - mOffset % CaptureBlobAlignment) % CaptureBlobAlignment);
+		return readBytes(size);
+	}
+
+	const uint8_t* readBytes(size_t size)
+	{
+		if (size > mSize - mOffset)
+			throw std::runtime_error("capture stream is truncated");
+
+		auto result = mData + mOffset;
+		mOffset += size;
+		return result;
+	}
+
+private:
+	const uint8_t* mData;
+	size_t mSize;
+	size_t mOffset = 0;
+};
+
+void skygfx::SetCaptureEnabled(bool value)
+{
+	gCaptureEnabled = value;
+}
+
+bool skygfx::IsCaptureEnabled()
+{
+	return gCaptureEnabled;
+}
+
+void skygfx::BeginCapture(std::ostream& stream)
+{
+	if (gCaptureBackend == nullptr)
+		throw std::runtime_error("capture is not enabled, call SetCaptureEnabled before creating device");
+
+	gCaptureBackend->beginCapture(stream);
+}
+
+void skygfx::EndCapture()
+{
+	if (gCaptureBackend == nullptr)
+		return;
+
+	gCaptureBackend->endCapture();
+}
+
+bool skygfx::IsCapturing()
+{
+	return gCaptureBackend != nullptr && gCaptureBackend->isCapturing();
+}
+
+static Vertex::Layout ReadLayout(CaptureReader& reader)
+{
+	auto layout = Vertex::Layout();
+	layout.stride = (size_t)reader.read<uint64_t>();
+	auto attribute_count = reader.read<uint32_t>();
+	for (uint32_t i = 0; i < attribute_count; i++)
+	{
+		auto attribute = Vertex::Attribute();
+		attribute.type = reader.read<Vertex::Attribute::Type>();
+		attribute.format = reader.read<Vertex::Attribute::Format>();
+		attribute.offset = (size_t)reader.read<uint64_t>();
+		layout.attributes.push_back(attribute);
+	}
+	return layout;
+}
+
+static SpecializationConstants ReadSpecializationConstants(CaptureReader& reader)
+{
+	auto specialization_constant_count = reader.read<uint32_t>();
+	SpecializationConstants specialization_constants;
+	for (uint32_t i = 0; i < specialization_constant_count; i++)
+	{
+		auto constant_id = reader.read<uint32_t>();
+		specialization_constants[constant_id] = reader.read<uint32_t>();
+	}
+	return specialization_constants;
+}
+
+// spirv points into the capture data, source is kept in the given string, so the view is null terminated
+static CompiledShaderView ReadCompiledStage(CaptureReader& reader, std::string& source)
+{
+	size_t spirv_size = 0;
+	auto spirv = reader.readBlob(spirv_size);
+	source = reader.readString();
+	size_t reflection_size = 0;
+	auto reflection = reader.readBlob(reflection_size);
+
+	auto result = CompiledShaderView();
+
+	if (spirv_size == 0)
+		return result;
+
+	result.spirv = { (const uint32_t*)spirv, spirv_size / sizeof(uint32_t) };
+	result.source = source;
+	result.reflection = ReadShaderReflection(reflection, reflection_size);
+	return result;
+}
+
+uint32_t skygfx::ReplayCapture(const void* data, size_t size)
+{
+	auto backend = GetCurrentBackend();
+
+	if (backend == nullptr)
+		throw std::runtime_error("replay needs a device");
+
+	if (((size_t)data % CaptureBlobAlignment) != 0)
+		throw std::runtime_error("capture data must be aligned to 16 bytes");
+
+	auto reader = CaptureReader(data, size);
+
+	if (reader.read<uint32_t>() != CaptureMagic)
+		throw std::runtime_error("not a capture stream");
+
+	if (reader.read<uint32_t>() != CaptureVersion)
+		throw std::runtime_error("unsupported capture version");
+
+	std::unordered_map<uint32_t, TextureHandle*> textures;
+	std::unordered_map<uint32_t, RenderTargetHandle*> render_targets;
+	std::unordered_map<uint32_t, ShaderHandle*> shaders;
+	std::unordered_map<uint32_t, VertexBufferHandle*> vertex_buffers;
+	std::unordered_map<uint32_t, IndexBufferHandle*> index_buffers;
+
+	uint32_t frames = 0;
+
+	while (!reader.isEnd())
+	{
+		auto command = (CaptureCommand)reader.read<uint8_t>();
+
+		switch (command)
+		{
+		case CaptureCommand::Resize:
+		{
+			auto width = reader.read<uint32_t>();
+			auto height = reader.read<uint32_t>();
+			backend->resize(width, height);
+			break;
+		}
+		case CaptureCommand::SetTopology:
+			backend->setTopology(reader.read<Topology>());
+			break;
+		case CaptureCommand::SetViewport:
+			backend->setViewport(reader.readOptional<Viewport>());
+			break;
+		case CaptureCommand::SetScissor:
+			backend->setScissor(reader.readOptional<Scissor>());
+			break;
+		case CaptureCommand::SetTexture:
+		{
+			auto id = reader.read<uint32_t>();
+			auto slot = reader.read<uint32_t>();
+			backend->setTexture(textures.at(id), slot);
+			break;
+		}
+		case CaptureCommand::SetRenderTarget:
+		{
+			auto id = reader.read<uint32_t>();
+			if (id == 0)
+				backend->setRenderTarget(nullptr);
+			else
+				backend->setRenderTarget(render_targets.at(id));
+			break;
+		}
+		case CaptureCommand::SetShader:
+			backend->setShader(shaders.at(reader.read<uint32_t>()));
+			break;
+		case CaptureCommand::SetVertexBuffer:
+		case CaptureCommand::SetIndexBuffer:
+		{
+			auto buffer = Buffer();
+			buffer.stride = (size_t)reader.read<uint64_t>();
+			buffer.data = (void*)reader.readBlob(buffer.size);
+
+			if (command == CaptureCommand::SetVertexBuffer)
+				backend->setVertexBuffer(buffer);
+			else
+				backend->setIndexBuffer(buffer);
+			break;
+		}
+		case CaptureCommand::BindVertexBuffer:
+			backend->setVertexBuffer(vertex_buffers.at(reader.read<uint32_t>()));
+			break;
+		case CaptureCommand::BindIndexBuffer:
+			backend->setIndexBuffer(index_buffers.at(reader.read<uint32_t>()));
+			break;
+		case CaptureCommand::SetUniformBuffer:
+		{
+			auto slot = reader.read<uint32_t>();
+			size_t size;
+			auto memory = reader.readBlob(size);
+			backend->setUniformBuffer(slot, (void*)memory, size);
+			break;
+		}
+		case CaptureCommand::SetBlendMode:
+			backend->setBlendMode(reader.read<BlendMode>());
+			break;
+		case CaptureCommand::SetDepthMode:
+			backend->setDepthMode(reader.readOptional<DepthMode>());
+			break;
+		case CaptureCommand::SetStencilMode:
+			backend->setStencilMode(reader.readOptional<StencilMode>());
+			break;
+		case CaptureCommand::SetCullMode:
+			backend->setCullMode(reader.read<CullMode>());
+			break;
+		case CaptureCommand::SetSampler:
+			backend->setSampler(reader.read<Sampler>());
+			break;
+		case CaptureCommand::SetTextureAddressMode:
+			backend->setTextureAddressMode(reader.read<TextureAddress>());
+			break;
+		case CaptureCommand::Clear:
+		{
+			auto color = reader.readOptional<glm::vec4>();
+			auto depth = reader.readOptional<float>();
+			auto stencil = reader.readOptional<uint8_t>();
+			backend->clear(color, depth, stencil);
+			break;
+		}
+		case CaptureCommand::Draw:
+		{
+			auto vertex_count = reader.read<uint32_t>();
+			auto vertex_offset = reader.read<uint32_t>();
+			backend->draw(vertex_count, vertex_offset);
+			break;
+		}
+		case CaptureCommand::DrawIndexed:
+		{
+			auto index_count = reader.read<uint32_t>();
+			auto index_offset = reader.read<uint32_t>();
+			backend->drawIndexed(index_count, index_offset);
+			break;
+		}
+		case CaptureCommand::ReadPixels:
+		{
+			auto pos = reader.read<glm::ivec2>();
+			auto size = reader.read<glm::ivec2>();
+			auto id = reader.read<uint32_t>();
+			backend->readPixels(pos, size, textures.at(id));
+			break;
+		}
+		case CaptureCommand::Present:
+			backend->present();
+			frames += 1;
+			break;
+		case CaptureCommand::CreateTexture:
+		{
+			auto id = reader.read<uint32_t>();
+			auto width = reader.read<uint32_t>();
+			auto height = reader.read<uint32_t>();
+			auto channels = reader.read<uint32_t>();
+			auto mipmap = reader.read<uint8_t>() != 0;
+			size_t size;
+			auto memory = reader.readBlob(size);
+			textures[id] = backend->createTexture(width, height, channels, size > 0 ? (void*)memory : nullptr, mipmap);
+			break;
+		}
+		case CaptureCommand::DestroyTexture:
+		{
+			auto id = reader.read<uint32_t>();
+			backend->destroyTexture(textures.at(id));
+			textures.erase(id);
+			break;
+		}
+		case CaptureCommand::CreateRenderTarget:
+		{
+			auto id = reader.read<uint32_t>();
+			auto width = reader.read<uint32_t>();
+			auto height = reader.read<uint32_t>();
+			auto texture_id = reader.read<uint32_t>();
+			render_targets[id] = backend->createRenderTarget(width, height, textures.at(texture_id));
+			break;
+		}
+		case CaptureCommand::DestroyRenderTarget:
+		{
+			auto id = reader.read<uint32_t>();
+			backend->destroyRenderTarget(render_targets.at(id));
+			render_targets.erase(id);
+			break;
+		}
+		case CaptureCommand::CreateShader:
+		{
+			auto id = reader.read<uint32_t>();
+			auto layout = ReadLayout(reader);
+			auto vertex_code = reader.readString();
+			auto fragment_code = reader.readString();
+			auto define_count = reader.read<uint32_t>();
+			std::vector<std::string> defines;
+			for (uint32_t i = 0; i < define_count; i++)
+			{
+				defines.push_back(reader.readString());
+			}
+			auto specialization_constants = ReadSpecializationConstants(reader);
+#ifdef SKYGFX_RUNTIME_COMPILER
+			shaders[id] = backend->createShader(layout, vertex_code, fragment_code, defines, specialization_constants);
+			break;
+#else
+			throw std::runtime_error("capture has glsl shaders, they can not be replayed without SKYGFX_RUNTIME_COMPILER");
+#endif
+		}
+		case CaptureCommand::CreateCompiledShader:
+		{
+			auto id = reader.read<uint32_t>();
+			auto target = reader.read<ShaderTarget>();
+			auto layout = ReadLayout(reader);
+			auto specialization_constants = ReadSpecializationConstants(reader);
+			std::string vertex_source;
+			std::string fragment_source;
+			auto vertex = ReadCompiledStage(reader, vertex_source);
+			auto fragment = ReadCompiledStage(reader, fragment_source);
+
+			// stages of another backend type are translated again from their spirv. they keep the defines
+			// they were compiled with, such as FLIP_TEXCOORD_Y of OpenGL
+			auto replay_target = GetShaderTarget(GetCurrentBackendType());
+
+			if (target != replay_target)
+			{
+				auto vertex_shader = SpecializeShader(vertex, replay_target, {});
+				auto fragment_shader = fragment.spirv.empty() ? CompiledShader() :
+					SpecializeShader(fragment, replay_target, {});
+
+				shaders[id] = backend->createShader(layout, vertex_shader, fragment_shader, specialization_constants);
+				break;
+			}
+
+			shaders[id] = backend->createShader(layout, vertex, fragment, specialization_constants);
+			break;
+		}
+		case CaptureCommand::DestroyShader:
+		{
+			auto id = reader.read<uint32_t>();
+			backend->destroyShader(shaders.at(id));
+			shaders.erase(id);
+			break;
+		}
+		case CaptureCommand::CreateVertexBuffer:
+		case CaptureCommand::CreateIndexBuffer:
+		{
+			auto id = reader.read<uint32_t>();
+			auto stride = (size_t)reader.read<uint64_t>();
+			size_t size;
+			auto memory = (void*)reader.readBlob(size);
+			if (command == CaptureCommand::CreateVertexBuffer)
+				vertex_buffers[id] = backend->createVertexBuffer(memory, size, stride);
+			else
+				index_buffers[id] = backend->createIndexBuffer(memory, size, stride);
+			break;
+		}
+		case CaptureCommand::DestroyVertexBuffer:
+		{
+			auto id = reader.read<uint32_t>();
+			backend->destroyVertexBuffer(vertex_buffers.at(id));
+			vertex_buffers.erase(id);
+			break;
+		}
+		case CaptureCommand::DestroyIndexBuffer:
+		{
+			auto id = reader.read<uint32_t>();
+			backend->destroyIndexBuffer(index_buffers.at(id));
+			index_buffers.erase(id);
+			break;
+		}
+		default:
+			throw std::runtime_error("unknown capture command");
+		}
+	}
+
+	backend->setRenderTarget(nullptr);
+
+	for (auto [id, render_target] : render_targets)
+	{
+		backend->destroyRenderTarget(render_target);
+	}
+
+	for (auto [id, texture] : textures)
+	{
+		backend->destroyTexture(texture);
+	}
+
+	for (auto [id, shader] : shaders)
+	{
+		backend->destroyShader(shader);
+	}
+
+	for (auto [id, buffer] : vertex_buffers)
+	{
+		backend->destroyVertexBuffer(buffer);
+	}
+
+	for (auto [id, buffer] : index_buffers)
+	{
+		backend->destroyIndexBuffer(buffer);
+	}
+
+	return frames;
+}
+
+uint32_t skygfx::ReplayCapture(std::istream& stream)
+{
+	std::vector<uint8_t> data(std::istreambuf_iterator<char>(stream), {});
+	return ReplayCapture(data.data(), data.size());
+}
+
+BackendCapture::BackendCapture(Backend* backend, uint32_t width, uint32_t height) :
+	mBackend(backend),
+	mWidth(width),
+	mHeight(height)
+{
+	assert(gCaptureBackend == nullptr);
+	gCaptureBackend = this;
+}
+
+BackendCapture::~BackendCapture()
+{
+	endCapture();
+	delete mBackend;
+	gCaptureBackend = nullptr;
+}
+
+void BackendCapture::beginCapture(std::ostream& stream)
+{
+	if (mWriter != nullptr)
+		throw std::runtime_error("capture is already running");
+
+	mWriter = std::make_unique<CaptureWriter>(stream);
+	mWriter->write(CaptureMagic);
+	mWriter->write(CaptureVersion);
+
+	mWriter->write(CaptureCommand::Resize);
+	mWriter->write(mWidth);
+	mWriter->write(mHeight);
+
+	for (const auto& [handle, texture] : mTextures)
+	{
+		writeTexture(texture);
+	}
+
+	for (const auto& [handle, render_target] : mRenderTargets)
+	{
+		writeRenderTarget(render_target);
+	}
+
+	for (const auto& [handle, shader] : mShaders)
+	{
+		writeShader(shader);
+	}
+
+	for (const auto& [handle, buffer] : mVertexBuffers)
+	{
+		writeBuffer(CaptureCommand::CreateVertexBuffer, buffer);
+	}
+
+	for (const auto& [handle, buffer] : mIndexBuffers)
+	{
+		writeBuffer(CaptureCommand::CreateIndexBuffer, buffer);
+	}
+
+	writeState();
+}
+
+void BackendCapture::endCapture()
+{
+	mWriter.reset();
+}
+
+void BackendCapture::writeTexture(const TextureRecord& texture)
+{
+	mWriter->write(CaptureCommand::CreateTexture);
+	mWriter->write(texture.id);
+	mWriter->write(texture.width);
+	mWriter->write(texture.height);
+	mWriter->write(texture.channels);
+	mWriter->write<uint8_t>(texture.mipmap);
+	mWriter->writeBlob(texture.memory.data(), texture.memory.size());
+}
+
+void BackendCapture::writeRenderTarget(const RenderTargetRecord& render_target)
+{
+	mWriter->write(CaptureCommand::CreateRenderTarget);
+	mWriter->write(render_target.id);
+	mWriter->write(render_target.width);
+	mWriter->write(render_target.height);
+	mWriter->write(mTextures.at(render_target.texture).id);
+}
+
+void BackendCapture::writeBuffer(CaptureCommand command, const BufferRecord& buffer)
+{
+	mWriter->write(command);
+	mWriter->write(buffer.id);
+	mWriter->write<uint64_t>(buffer.stride);
+	mWriter->writeBlob(buffer.memory.data(), buffer.memory.size());
+}
+
+static void WriteLayout(CaptureWriter& writer, const Vertex::Layout& layout)
+{
+	writer.write<uint64_t>(layout.stride);
+	writer.write<uint32_t>((uint32_t)layout.attributes.size());
+	for (const auto& attribute : layout.attributes)
+	{
+		writer.write(attribute.type);
+		writer.write(attribute.format);
+		writer.write<uint64_t>(attribute.offset);
+	}
+}
+
+static void WriteSpecializationConstants(CaptureWriter& writer, const SpecializationConstants& specialization_constants)
+{
+	writer.write<uint32_t>((uint32_t)specialization_constants.size());
+	for (const auto& [constant_id, value] : specialization_constants)
+	{
+		writer.write(constant_id);
+		writer.write(value);
+	}
+}
+
+void BackendCapture::writeShader(const ShaderRecord& shader)
+{
+	if (shader.compiled)
+	{
+		mWriter->write(CaptureCommand::CreateCompiledShader);
+		mWriter->write(shader.id);
+		mWriter->write(GetShaderTarget(GetCurrentBackendType()));
+		WriteLayout(*mWriter, shader.layout);
+		WriteSpecializationConstants(*mWriter, shader.specialization_constants);
+		for (const auto& stage : { &shader.vertex, &shader.fragment })
+		{
+			mWriter->writeBlob(stage->spirv.data(), stage->spirv.size() * sizeof(uint32_t));
+			mWriter->writeString(stage->source);
+			mWriter->writeBlob(stage->reflection.data(), stage->reflection.size());
+		}
+		return;
+	}
+
+	mWriter->write(CaptureCommand::CreateShader);
+	mWriter->write(shader.id);
+	WriteLayout(*mWriter, shader.layout);
+	mWriter->writeString(shader.vertex_code);
+	mWriter->writeString(shader.fragment_code);
+	mWriter->write<uint32_t>((uint32_t)shader.defines.size());
+	for (const auto& define : shader.defines)
+	{
+		mWriter->writeString(define);
+	}
+	WriteSpecializationConstants(*mWriter, shader.specialization_constants);
+}
+
+void BackendCapture::writeState()
+{
+	if (mTopology.has_value())
+	{
+		mWriter->write(CaptureCommand::SetTopology);
+		mWriter->write(mTopology.value());
+	}
+
+	mWriter->write(CaptureCommand::SetViewport);
+	mWriter->write(mViewport);
+
+	mWriter->write(CaptureCommand::SetScissor);
+	mWriter->write(mScissor);
+
+	for (auto [slot, texture] : mCurrentTextures)
+	{
+		mWriter->write(CaptureCommand::SetTexture);
+		mWriter->write(mTextures.at(texture).id);
+		mWriter->write(slot);
+	}
+
+	mWriter->write(CaptureCommand::SetRenderTarget);
+	mWriter->write<uint32_t>(mRenderTarget != nullptr ? mRenderTargets.at(mRenderTarget).id : 0);
+
+	if (mShader != nullptr)
+	{
+		mWriter->write(CaptureCommand::SetShader);
+		mWriter->write(mShaders.at(mShader).id);
+	}
+
+	if (mCurrentVertexBuffer != nullptr)
+	{
+		mWriter->write(CaptureCommand::BindVertexBuffer);
+		mWriter->write(mVertexBuffers.at(mCurrentVertexBuffer).id);
+	}
+	else if (mVertexBufferStride != 0)
+	{
+		mWriter->write(CaptureCommand::SetVertexBuffer);
+		mWriter->write<uint64_t>(mVertexBufferStride);
+		mWriter->writeBlob(mVertexBuffer.data(), mVertexBuffer.size());
+	}
+
+	if (mCurrentIndexBuffer != nullptr)
+	{
+		mWriter->write(CaptureCommand::BindIndexBuffer);
+		mWriter->write(mIndexBuffers.at(mCurrentIndexBuffer).id);
+	}
+	else if (mIndexBufferStride != 0)
+	{
+		mWriter->write(CaptureCommand::SetIndexBuffer);
+		mWriter->write<uint64_t>(mIndexBufferStride);
+		mWriter->writeBlob(mIndexBuffer.data(), mIndexBuffer.size());
+	}
+
+	for (const auto& [slot, memory] : mUniformBuffers)
+	{
+		mWriter->write(CaptureCommand::SetUniformBuffer);
+		mWriter->write(slot);
+		mWriter->writeBlob(memory.data(), memory.size());
+	}
+
+	if (mBlendMode.has_value())
+	{
+		mWriter->write(CaptureCommand::SetBlendMode);
+		mWriter->write(mBlendMode.value());
+	}
+
+	mWriter->write(CaptureCommand::SetDepthMode);
+	mWriter->write(mDepthMode);
+
+	mWriter->write(CaptureCommand::SetStencilMode);
+	mWriter->write(mStencilMode);
+
+	if (mCullMode.has_value())
+	{
+		mWriter->write(CaptureCommand::SetCullMode);
+		mWriter->write(mCullMode.value());
+	}
+
+	if (mSampler.has_value())
+	{
+		mWriter->write(CaptureCommand::SetSampler);
+		mWriter->write(mSampler.value());
+	}
+
+	if (mTextureAddress.has_value())
+	{
+		mWriter->write(CaptureCommand::SetTextureAddressMode);
+		mWriter->write(mTextureAddress.value());
+	}
+}
+
+void BackendCapture::resize(uint32_t width, uint32_t height)
+{
+	mWidth = width;
+	mHeight = height;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::Resize);
+		mWriter->write(width);
+		mWriter->write(height);
+	}
+
+	mBackend->resize(width, height);
+}
+
+void BackendCapture::setTopology(Topology topology)
+{
+	mTopology = topology;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetTopology);
+		mWriter->write(topology);
+	}
+
+	mBackend->setTopology(topology);
+}
+
+void BackendCapture::setViewport(std::optional<Viewport> viewport)
+{
+	mViewport = viewport;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetViewport);
+		mWriter->write(viewport);
+	}
+
+	mBackend->setViewport(viewport);
+}
+
+void BackendCapture::setScissor(std::optional<Scissor> scissor)
+{
+	mScissor = scissor;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetScissor);
+		mWriter->write(scissor);
+	}
+
+	mBackend->setScissor(scissor);
+}
+
+void BackendCapture::setTexture(TextureHandle* handle, uint32_t slot)
+{
+	mCurrentTextures[slot] = handle;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetTexture);
+		mWriter->write(mTextures.at(handle).id);
+		mWriter->write(slot);
+	}
+
+	mBackend->setTexture(handle, slot);
+}
+
+void BackendCapture::setRenderTarget(RenderTargetHandle* handle)
+{
+	mRenderTarget = handle;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetRenderTarget);
+		mWriter->write(mRenderTargets.at(handle).id);
+	}
+
+	mBackend->setRenderTarget(handle);
+}
+
+void BackendCapture::setRenderTarget(std::nullptr_t value)
+{
+	mRenderTarget = nullptr;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetRenderTarget);
+		mWriter->write<uint32_t>(0);
+	}
+
+	mBackend->setRenderTarget(value);
+}
+
+void BackendCapture::setShader(ShaderHandle* handle)
+{
+	mShader = handle;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetShader);
+		mWriter->write(mShaders.at(handle).id);
+	}
+
+	mBackend->setShader(handle);
+}
+
+void BackendCapture::setVertexBuffer(const Buffer& buffer)
+{
+	mVertexBuffer.assign((uint8_t*)buffer.data, (uint8_t*)buffer.data + buffer.size);
+	mVertexBufferStride = buffer.stride;
+	mCurrentVertexBuffer = nullptr;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetVertexBuffer);
+		mWriter->write<uint64_t>(buffer.stride);
+		mWriter->writeBlob(buffer.data, buffer.size);
+	}
+
+	mBackend->setVertexBuffer(buffer);
+}
+
+void BackendCapture::setIndexBuffer(const Buffer& buffer)
+{
+	mIndexBuffer.assign((uint8_t*)buffer.data, (uint8_t*)buffer.data + buffer.size);
+	mIndexBufferStride = buffer.stride;
+	mCurrentIndexBuffer = nullptr;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetIndexBuffer);
+		mWriter->write<uint64_t>(buffer.stride);
+		mWriter->writeBlob(buffer.data, buffer.size);
+	}
+
+	mBackend->setIndexBuffer(buffer);
+}
+
+void BackendCapture::setVertexBuffer(VertexBufferHandle* handle)
+{
+	mCurrentVertexBuffer = handle;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::BindVertexBuffer);
+		mWriter->write(mVertexBuffers.at(handle).id);
+	}
+
+	mBackend->setVertexBuffer(handle);
+}
+
+void BackendCapture::setIndexBuffer(IndexBufferHandle* handle)
+{
+	mCurrentIndexBuffer = handle;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::BindIndexBuffer);
+		mWriter->write(mIndexBuffers.at(handle).id);
+	}
+
+	mBackend->setIndexBuffer(handle);
+}
+
+void BackendCapture::setUniformBuffer(uint32_t slot, void* memory, size_t size)
+{
+	mUniformBuffers[slot].assign((uint8_t*)memory, (uint8_t*)memory + size);
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetUniformBuffer);
+		mWriter->write(slot);
+		mWriter->writeBlob(memory, size);
+	}
+
+	mBackend->setUniformBuffer(slot, memory, size);
+}
+
+void BackendCapture::setBlendMode(const BlendMode& value)
+{
+	mBlendMode = value;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetBlendMode);
+		mWriter->write(value);
+	}
+
+	mBackend->setBlendMode(value);
+}
+
+void BackendCapture::setDepthMode(std::optional<DepthMode> depth_mode)
+{
+	mDepthMode = depth_mode;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetDepthMode);
+		mWriter->write(depth_mode);
+	}
+
+	mBackend->setDepthMode(depth_mode);
+}
+
+void BackendCapture::setStencilMode(std::optional<StencilMode> stencil_mode)
+{
+	mStencilMode = stencil_mode;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetStencilMode);
+		mWriter->write(stencil_mode);
+	}
+
+	mBackend->setStencilMode(stencil_mode);
+}
+
+void BackendCapture::setCullMode(CullMode cull_mode)
+{
+	mCullMode = cull_mode;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetCullMode);
+		mWriter->write(cull_mode);
+	}
+
+	mBackend->setCullMode(cull_mode);
+}
+
+void BackendCapture::setSampler(const Sampler& value)
+{
+	mSampler = value;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetSampler);
+		mWriter->write(value);
+	}
+
+	mBackend->setSampler(value);
+}
+
+void BackendCapture::setTextureAddressMode(const TextureAddress& value)
+{
+	mTextureAddress = value;
+
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::SetTextureAddressMode);
+		mWriter->write(value);
+	}
+
+	mBackend->setTextureAddressMode(value);
+}
+
+void BackendCapture::clear(const std::optional<glm::vec4>& color, const std::optional<float>& depth,
+	const std::optional<uint8_t>& stencil)
+{
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::Clear);
+		mWriter->write(color);
+		mWriter->write(depth);
+		mWriter->write(stencil);
+	}
+
+	mBackend->clear(color, depth, stencil);
+}
+
+void BackendCapture::draw(uint32_t vertex_count, uint32_t vertex_offset)
+{
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::Draw);
+		mWriter->write(vertex_count);
+		mWriter->write(vertex_offset);
+	}
+
+	mBackend->draw(vertex_count, vertex_offset);
+}
+
+void BackendCapture::drawIndexed(uint32_t index_count, uint32_t index_offset)
+{
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::DrawIndexed);
+		mWriter->write(index_count);
+		mWriter->write(index_offset);
+	}
+
+	mBackend->drawIndexed(index_count, index_offset);
+}
+
+void BackendCapture::readPixels(const glm::ivec2& pos, const glm::ivec2& size, TextureHandle* dst_texture)
+{
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::ReadPixels);
+		mWriter->write(pos);
+		mWriter->write(size);
+		mWriter->write(mTextures.at(dst_texture).id);
+	}
+
+	mBackend->readPixels(pos, size, dst_texture);
+}
+
+void BackendCapture::present()
+{
+	if (mWriter)
+		mWriter->write(CaptureCommand::Present);
+
+	mBackend->present();
+}
+
+void BackendCapture::beginTimer(const std::string& name)
+{
+	mBackend->beginTimer(name);
+}
+
+void BackendCapture::endTimer()
+{
+	mBackend->endTimer();
+}
+
+const std::vector<GpuTimer>& BackendCapture::getGpuTimers()
+{
+	return mBackend->getGpuTimers();
+}
+
+TextureHandle* BackendCapture::createTexture(uint32_t width, uint32_t height, uint32_t channels,
+	void* memory, bool mipmap)
+{
+	auto handle = mBackend->createTexture(width, height, channels, memory, mipmap);
+
+	auto texture = TextureRecord{ mNextId++, width, height, channels, mipmap };
+
+	if (memory != nullptr)
+		texture.memory.assign((uint8_t*)memory, (uint8_t*)memory + (size_t)width * height * channels);
+
+	if (mWriter)
+		writeTexture(texture);
+
+	mTextures.insert({ handle, std::move(texture) });
+	return handle;
+}
+
+void BackendCapture::destroyTexture(TextureHandle* handle)
+{
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::DestroyTexture);
+		mWriter->write(mTextures.at(handle).id);
+	}
+
+	for (auto it = mCurrentTextures.begin(); it != mCurrentTextures.end();)
+	{
+		if (it->second == handle)
+			it = mCurrentTextures.erase(it);
+		else
+			++it;
+	}
+
+	mTextures.erase(handle);
+	mBackend->destroyTexture(handle);
+}
+
+RenderTargetHandle* BackendCapture::createRenderTarget(uint32_t width, uint32_t height, TextureHandle* texture)
+{
+	auto handle = mBackend->createRenderTarget(width, height, texture);
+
+	auto render_target = RenderTargetRecord{ mNextId++, width, height, texture };
+
+	if (mWriter)
+		writeRenderTarget(render_target);
+
+	mRenderTargets.insert({ handle, render_target });
+	return handle;
+}
+
+void BackendCapture::destroyRenderTarget(RenderTargetHandle* handle)
+{
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::DestroyRenderTarget);
+		mWriter->write(mRenderTargets.at(handle).id);
+	}
+
+	if (mRenderTarget == handle)
+		mRenderTarget = nullptr;
+
+	mRenderTargets.erase(handle);
+	mBackend->destroyRenderTarget(handle);
+}
+
+VertexBufferHandle* BackendCapture::createVertexBuffer(void* memory, size_t size, size_t stride)
+{
+	auto handle = mBackend->createVertexBuffer(memory, size, stride);
+
+	auto buffer = BufferRecord{ mNextId++, stride };
+	buffer.memory.assign((uint8_t*)memory, (uint8_t*)memory + size);
+
+	if (mWriter)
+		writeBuffer(CaptureCommand::CreateVertexBuffer, buffer);
+
+	mVertexBuffers.insert({ handle, std::move(buffer) });
+	return handle;
+}
+
+void BackendCapture::destroyVertexBuffer(VertexBufferHandle* handle)
+{
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::DestroyVertexBuffer);
+		mWriter->write(mVertexBuffers.at(handle).id);
+	}
+
+	if (mCurrentVertexBuffer == handle)
+		mCurrentVertexBuffer = nullptr;
+
+	mVertexBuffers.erase(handle);
+	mBackend->destroyVertexBuffer(handle);
+}
+
+IndexBufferHandle* BackendCapture::createIndexBuffer(void* memory, size_t size, size_t stride)
+{
+	auto handle = mBackend->createIndexBuffer(memory, size, stride);
+
+	auto buffer = BufferRecord{ mNextId++, stride };
+	buffer.memory.assign((uint8_t*)memory, (uint8_t*)memory + size);
+
+	if (mWriter)
+		writeBuffer(CaptureCommand::CreateIndexBuffer, buffer);
+
+	mIndexBuffers.insert({ handle, std::move(buffer) });
+	return handle;
+}
+
+void BackendCapture::destroyIndexBuffer(IndexBufferHandle* handle)
+{
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::DestroyIndexBuffer);
+		mWriter->write(mIndexBuffers.at(handle).id);
+	}
+
+	if (mCurrentIndexBuffer == handle)
+		mCurrentIndexBuffer = nullptr;
+
+	mIndexBuffers.erase(handle);
+	mBackend->destroyIndexBuffer(handle);
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+ShaderHandle* BackendCapture::createShader(const Vertex::Layout& layout, const std::string& vertex_code,
+	const std::string& fragment_code, const std::vector<std::string>& defines,
+	const SpecializationConstants& specialization_constants)
+{
+	auto handle = mBackend->createShader(layout, vertex_code, fragment_code, defines, specialization_constants);
+
+	auto shader = ShaderRecord{ mNextId++, layout, vertex_code, fragment_code, defines, specialization_constants };
+
+	if (mWriter)
+		writeShader(shader);
+
+	mShaders.insert({ handle, std::move(shader) });
+	return handle;
+}
+#endif
+
+ShaderHandle* BackendCapture::createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+	const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants)
+{
+	auto handle = mBackend->createShader(layout, vertex, fragment, specialization_constants);
+
+	auto makeStageRecord = [](const CompiledShaderView& stage) {
+		auto result = CompiledStageRecord();
+
+		if (stage.spirv.empty())
+			return result;
+
+		result.spirv.assign(stage.spirv.begin(), stage.spirv.end());
+		result.source = stage.source;
+		result.reflection = WriteShaderReflection(stage.reflection);
+		return result;
+	};
+
+	auto shader = ShaderRecord{ mNextId++, layout };
+	shader.specialization_constants = specialization_constants;
+	shader.compiled = true;
+	shader.vertex = makeStageRecord(vertex);
+	shader.fragment = makeStageRecord(fragment);
+
+	if (mWriter)
+		writeShader(shader);
+
+	mShaders.insert({ handle, std::move(shader) });
+	return handle;
+}
+
+void BackendCapture::destroyShader(ShaderHandle* handle)
+{
+	if (mWriter)
+	{
+		mWriter->write(CaptureCommand::DestroyShader);
+		mWriter->write(mShaders.at(handle).id);
+	}
+
+	if (mShader == handle)
+		mShader = nullptr;
+
+	mShaders.erase(handle);
+	mBackend->destroyShader(handle);
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+std::vector<std::shared_future<CompiledShader>> BackendCapture::compileShaderAsync(const Vertex::Layout& layout,
+	const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& defines)
+{
+	return mBackend->compileShaderAsync(layout, vertex_code, fragment_code, defines);
+}
+#endif
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "backend.h"
+#include <iosfwd>
+#include <memory>
+#include <unordered_map>
+
+namespace skygfx
+{
+	// capture has to be enabled before the device is created. while enabled, the device keeps copies of
+	// texture bytes, shader sources and current state, so capture can begin on any frame
+	void SetCaptureEnabled(bool value);
+	bool IsCaptureEnabled();
+
+	// every device call is written to the stream until EndCapture.
+	// resources and state which are alive when capture begins are written first
+	void BeginCapture(std::ostream& stream);
+	void EndCapture();
+	bool IsCapturing();
+
+	// re-issues captured calls against the current device as fast as possible,
+	// resources created by the capture are destroyed at the end, returns number of replayed frames
+	uint32_t ReplayCapture(const void* data, size_t size);
+	uint32_t ReplayCapture(std::istream& stream);
+
+	class CaptureWriter;
+	enum class CaptureCommand : uint8_t;
+
+	// forwards every call to the wrapped backend and records it when capturing
+	class BackendCapture : public Backend
+	{
+	public:
+		BackendCapture(Backend* backend, uint32_t width, uint32_t height);
+		~BackendCapture();
+
+		void beginCapture(std::ostream& stream);
+		void endCapture();
+		bool isCapturing() const { return mWriter != nullptr; }
+
+		void resize(uint32_t width, uint32_t height) override;
+
+		void setTopology(Topology topology) override;
+		void setViewport(std::optional<Viewport> viewport) override;
+		void setScissor(std::optional<Scissor> scissor) override;
+		void setTexture(TextureHandle* handle, uint32_t slot) override;
+		void setRenderTarget(RenderTargetHandle* handle) override;
+		void setRenderTarget(std::nullptr_t value) override;
+		void setShader(ShaderHandle* handle) override;
+		void setVertexBuffer(const Buffer& buffer) override;
+		void setIndexBuffer(const Buffer& buffer) override;
+		void setVertexBuffer(VertexBufferHandle* handle) override;
+		void setIndexBuffer(IndexBufferHandle* handle) override;
+		void setUniformBuffer(uint32_t slot, void* memory, size_t size) override;
+		void setBlendMode(const BlendMode& value) override;
+		void setDepthMode(std::optional<DepthMode> depth_mode) override;
+		void setStencilMode(std::optional<StencilMode> stencil_mode) override;
+		void setCullMode(CullMode cull_mode) override;
+		void setSampler(const Sampler& value) override;
+		void setTextureAddressMode(const TextureAddress& value) override;
+
+		void clear(const std::optional<glm::vec4>& color, const std::optional<float>& depth,
+			const std::optional<uint8_t>& stencil) override;
+		void draw(uint32_t vertex_count, uint32_t vertex_offset) override;
+		void drawIndexed(uint32_t index_count, uint32_t index_offset) override;
+
+		void readPixels(const glm::ivec2& pos, const glm::ivec2& size, TextureHandle* dst_texture) override;
+
+		void present() override;
+
+		void beginTimer(const std::string& name) override;
+		void endTimer() override;
+		const std::vector<GpuTimer>& getGpuTimers() override;
+
+		TextureHandle* createTexture(uint32_t width, uint32_t height, uint32_t channels,
+			void* memory, bool mipmap) override;
+		void destroyTexture(TextureHandle* handle) override;
+
+		RenderTargetHandle* createRenderTarget(uint32_t width, uint32_t height, TextureHandle* texture) override;
+		void destroyRenderTarget(RenderTargetHandle* handle) override;
+
+		VertexBufferHandle* createVertexBuffer(void* memory, size_t size, size_t stride) override;
+		void destroyVertexBuffer(VertexBufferHandle* handle) override;
+		IndexBufferHandle* createIndexBuffer(void* memory, size_t size, size_t stride) override;
+		void destroyIndexBuffer(IndexBufferHandle* handle) override;
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+		ShaderHandle* createShader(const Vertex::Layout& layout, const std::string& vertex_code,
+			const std::string& fragment_code, const std::vector<std::string>& defines,
+			const SpecializationConstants& specialization_constants) override;
+#endif
+		ShaderHandle* createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+			const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants) override;
+		void destroyShader(ShaderHandle* handle) override;
+#ifdef SKYGFX_RUNTIME_COMPILER
+		std::vector<std::shared_future<CompiledShader>> compileShaderAsync(const Vertex::Layout& layout,
+			const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& defines) override;
+#endif
+
+	private:
+		struct TextureRecord
+		{
+			uint32_t id;
+			uint32_t width;
+			uint32_t height;
+			uint32_t channels;
+			bool mipmap;
+			std::vector<uint8_t> memory;
+		};
+
+		struct RenderTargetRecord
+		{
+			uint32_t id;
+			uint32_t width;
+			uint32_t height;
+			TextureHandle* texture;
+		};
+
+		struct BufferRecord
+		{
+			uint32_t id;
+			size_t stride;
+			std::vector<uint8_t> memory;
+		};
+
+		struct CompiledStageRecord
+		{
+			std::vector<uint32_t> spirv; // empty for a missing stage
+			std::string source;
+			std::vector<uint8_t> reflection; // in the form of WriteShaderReflection
+		};
+
+		struct ShaderRecord
+		{
+			uint32_t id;
+			Vertex::Layout layout;
+			std::string vertex_code;
+			std::string fragment_code;
+			std::vector<std::string> defines;
+			SpecializationConstants specialization_constants;
+			bool compiled = false; // created from CompiledShaderView, such as a shader bundle entry
+			CompiledStageRecord vertex;
+			CompiledStageRecord fragment;
+		};
+
+		void writeTexture(const TextureRecord& texture);
+		void writeRenderTarget(const RenderTargetRecord& render_target);
+		void writeBuffer(CaptureCommand command, const BufferRecord& buffer);
+		void writeShader(const ShaderRecord& shader);
+		void writeState();
+
+	private:
+		Backend* mBackend;
+		std::unique_ptr<CaptureWriter> mWriter;
+		uint32_t mNextId = 1;
+		uint32_t mWidth;
+		uint32_t mHeight;
+
+		std::unordered_map<TextureHandle*, TextureRecord> mTextures;
+		std::unordered_map<RenderTargetHandle*, RenderTargetRecord> mRenderTargets;
+		std::unordered_map<VertexBufferHandle*, BufferRecord> mVertexBuffers;
+		std::unordered_map<IndexBufferHandle*, BufferRecord> mIndexBuffers;
+		std::unordered_map<ShaderHandle*, ShaderRecord> mShaders;
+
+		// current state, written when capture begins. states which were never set are left to backend defaults
+		std::optional<Topology> mTopology;
+		std::optional<Viewport> mViewport;
+		std::optional<Scissor> mScissor;
+		std::unordered_map<uint32_t, TextureHandle*> mCurrentTextures;
+		RenderTargetHandle* mRenderTarget = nullptr;
+		ShaderHandle* mShader = nullptr;
+		std::vector<uint8_t> mVertexBuffer;
+		size_t mVertexBufferStride = 0;
+		std::vector<uint8_t> mIndexBuffer;
+		size_t mIndexBufferStride = 0;
+		VertexBufferHandle* mCurrentVertexBuffer = nullptr; // when set, mVertexBuffer is not used
+		IndexBufferHandle* mCurrentIndexBuffer = nullptr; // when set, mIndexBuffer is not used
+		std::unordered_map<uint32_t, std::vector<uint8_t>> mUniformBuffers;
+		std::optional<BlendMode> mBlendMode;
+		std::optional<DepthMode> mDepthMode;
+		std::optional<StencilMode> mStencilMode;
+		std::optional<CullMode> mCullMode;
+		std::optional<Sampler> mSampler;
+		std::optional<TextureAddress> mTextureAddress;
+	};
+}
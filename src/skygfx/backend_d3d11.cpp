@@ -1,10 +1,16 @@
 #include "backend_d3d11.h"
+#include "ring_allocator.h"
+#include "shader_cache.h"
+#include "trace.h"
 
 #ifdef SKYGFX_HAS_D3D11
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <unordered_map>
+#include <deque>
+#include <cassert>
 
 #include <d3dcompiler.h>
 #include <d3d11.h>
@@ -23,9 +29,23 @@ static struct
 	ID3D11DepthStencilView* depth_stencil_view;
 } MainRenderTarget;
 
-static ID3D11Buffer* D3D11VertexBuffer = nullptr;
-static ID3D11Buffer* D3D11IndexBuffer = nullptr;
+// every setVertexBuffer and setIndexBuffer with Buffer appends data to the transient buffer of its kind
+// with D3D11_MAP_WRITE_NO_OVERWRITE. a full buffer is discarded, so the driver renames it instead of
+// waiting for gpu. kinds have own buffers, since discarding drops data which is still bound
+
+struct TransientBufferD3D11
+{
+	ID3D11Buffer* buffer = nullptr;
+	RingAllocator allocator;
+	bool discard = true; // next map discards the buffer
+};
+
+static const size_t TransientBufferCapacity = 1024 * 1024;
+static const size_t TransientDataAlignment = 16;
+static TransientBufferD3D11 D3D11TransientVertexBuffer;
+static TransientBufferD3D11 D3D11TransientIndexBuffer;
 static std::unordered_map<uint32_t, ID3D11Buffer*> D3D11ConstantBuffers;
+static std::unordered_map<uint32_t, size_t> D3D11ConstantBufferSizes;
 
 using namespace skygfx;
 
@@ -94,29 +114,29 @@ class ShaderDataD3D11
 {
 private:
 	ID3D11VertexShader* vertex_shader = nullptr;
-	ID3D11PixelShader* pixel_shader = nullptr;
+	ID3D11PixelShader* pixel_shader = nullptr; // null without fragment stage, no color is written then
 	ID3D11InputLayout* input_layout = nullptr;
+	ShaderReflection reflection;
 
 public:
-	ShaderDataD3D11(const Vertex::Layout& layout, const std::string& vertex_code, const std::string& fragment_code, 
-		std::vector<std::string> defines)
+	ShaderDataD3D11(const Vertex::Layout& layout, const CompiledShaderView& vertex, const CompiledShaderView& fragment) :
+		reflection(MergeShaderReflections(vertex, fragment))
 	{
+		auto hlsl_vert = vertex.source;
+		auto hlsl_frag = fragment.source;
+
+		bool has_fragment_stage = !fragment.spirv.empty();
+
 		ID3DBlob* vertexShaderBlob;
-		ID3DBlob* pixelShaderBlob;
+		ID3DBlob* pixelShaderBlob = nullptr;
 
 		ID3DBlob* vertex_shader_error;
-		ID3DBlob* pixel_shader_error;
-		
-		AddShaderLocationDefines(layout, defines);
-
-		auto vertex_shader_spirv = CompileGlslToSpirv(ShaderStage::Vertex, vertex_code, defines);
-		auto fragment_shader_spirv = CompileGlslToSpirv(ShaderStage::Fragment, fragment_code, defines);
+		ID3DBlob* pixel_shader_error = nullptr;
 
-		auto hlsl_vert = CompileSpirvToHlsl(vertex_shader_spirv);
-		auto hlsl_frag = CompileSpirvToHlsl(fragment_shader_spirv);
+		D3DCompile(hlsl_vert.data(), hlsl_vert.size(), NULL, NULL, NULL, "main", "vs_4_0", 0, 0, &vertexShaderBlob, &vertex_shader_error);
 
-		D3DCompile(hlsl_vert.c_str(), hlsl_vert.size(), NULL, NULL, NULL, "main", "vs_4_0", 0, 0, &vertexShaderBlob, &vertex_shader_error);
-		D3DCompile(hlsl_frag.c_str(), hlsl_frag.size(), NULL, NULL, NULL, "main", "ps_4_0", 0, 0, &pixelShaderBlob, &pixel_shader_error);
+		if (has_fragment_stage)
+			D3DCompile(hlsl_frag.data(), hlsl_frag.size(), NULL, NULL, NULL, "main", "ps_4_0", 0, 0, &pixelShaderBlob, &pixel_shader_error);
 
 		std::string vertex_shader_error_string = "";
 		std::string pixel_shader_error_string = "";
@@ -130,11 +150,13 @@ public:
 		if (vertexShaderBlob == nullptr)
 			throw std::runtime_error(vertex_shader_error_string);
 
-		if (pixelShaderBlob == nullptr)
+		if (has_fragment_stage && pixelShaderBlob == nullptr)
 			throw std::runtime_error(pixel_shader_error_string);
 
 		D3D11Device->CreateVertexShader(vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize(), nullptr, &vertex_shader);
-		D3D11Device->CreatePixelShader(pixelShaderBlob->GetBufferPointer(), pixelShaderBlob->GetBufferSize(), nullptr, &pixel_shader);
+
+		if (has_fragment_stage)
+			D3D11Device->CreatePixelShader(pixelShaderBlob->GetBufferPointer(), pixelShaderBlob->GetBufferSize(), nullptr, &pixel_shader);
 
 		static const std::unordered_map<Vertex::Attribute::Format, DXGI_FORMAT> Format = {
 			{ Vertex::Attribute::Format::R32F, DXGI_FORMAT_R32_FLOAT },
@@ -149,13 +171,12 @@ public:
 
 		std::vector<D3D11_INPUT_ELEMENT_DESC> input;
 
-		UINT i = 0;
-
-		for (auto& attrib : layout.attributes)
+		for (auto i : GetUsedVertexAttributes(layout, reflection))
 		{
+			const auto& attrib = layout.attributes.at(i);
+
 			input.push_back({ "TEXCOORD", i, Format.at(attrib.format), 0,
 				static_cast<UINT>(attrib.offset), D3D11_INPUT_PER_VERTEX_DATA, 0 });
-			i++;
 		}
 
 		D3D11Device->CreateInputLayout(input.data(), static_cast<UINT>(input.size()), vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize(), &input_layout);
@@ -164,7 +185,9 @@ public:
 	~ShaderDataD3D11()
 	{
 		vertex_shader->Release();
-		pixel_shader->Release();
+
+		if (pixel_shader != nullptr)
+			pixel_shader->Release();
 		input_layout->Release();
 	}
 
@@ -174,6 +197,77 @@ public:
 		D3D11Context->VSSetShader(vertex_shader, nullptr, 0);
 		D3D11Context->PSSetShader(pixel_shader, nullptr, 0);
 	}
+
+	const auto& getReflection() const { return reflection; }
+};
+
+static ShaderDataD3D11* D3D11CurrentShader = nullptr;
+
+static UINT WriteTransientData(TransientBufferD3D11& transient_buffer, UINT bind_flags, const Buffer& value)
+{
+	auto offset = transient_buffer.allocator.allocate(value.size, TransientDataAlignment);
+
+	if (!offset.has_value())
+	{
+		auto capacity = std::max(transient_buffer.allocator.getCapacity(), value.size);
+		capacity = std::max(capacity, TransientBufferCapacity);
+
+		if (transient_buffer.buffer == nullptr || transient_buffer.allocator.getCapacity() < capacity)
+		{
+			if (transient_buffer.buffer)
+				transient_buffer.buffer->Release();
+
+			D3D11_BUFFER_DESC desc = {};
+			desc.ByteWidth = static_cast<UINT>(capacity);
+			desc.Usage = D3D11_USAGE_DYNAMIC;
+			desc.BindFlags = bind_flags;
+			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			D3D11Device->CreateBuffer(&desc, nullptr, &transient_buffer.buffer);
+		}
+
+		transient_buffer.allocator.reset(capacity);
+		transient_buffer.discard = true;
+		offset = transient_buffer.allocator.allocate(value.size, TransientDataAlignment);
+	}
+
+	auto map_type = transient_buffer.discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+	transient_buffer.discard = false;
+
+	D3D11_MAPPED_SUBRESOURCE resource;
+	D3D11Context->Map(transient_buffer.buffer, 0, map_type, 0, &resource);
+	memcpy((uint8_t*)resource.pData + offset.value(), value.data, value.size);
+	D3D11Context->Unmap(transient_buffer.buffer, 0);
+
+	return static_cast<UINT>(offset.value());
+}
+
+class BufferDataD3D11
+{
+	friend class BackendD3D11;
+
+private:
+	ID3D11Buffer* buffer = nullptr;
+	size_t stride;
+
+public:
+	BufferDataD3D11(void* memory, size_t size, size_t _stride, UINT bind_flags) :
+		stride(_stride)
+	{
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = static_cast<UINT>(size);
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = bind_flags;
+
+		D3D11_SUBRESOURCE_DATA data = {};
+		data.pSysMem = memory;
+
+		D3D11Device->CreateBuffer(&desc, &data, &buffer);
+	}
+
+	~BufferDataD3D11()
+	{
+		buffer->Release();
+	}
 };
 
 class TextureDataD3D11
@@ -290,6 +384,161 @@ public:
 
 static RenderTargetDataD3D11* D3D11CurrentRenderTarget = nullptr;
 
+// timer queries are resolved a few frames later, frames which gpu has not finished
+// in GpuTimerFramesInFlight presents are dropped instead of stalling
+
+struct GpuTimerQueriesD3D11
+{
+	std::string name;
+	ID3D11Query* begin_timestamp;
+	ID3D11Query* end_timestamp;
+	ID3D11Query* statistics;
+};
+
+struct GpuTimerFrameD3D11
+{
+	ID3D11Query* disjoint = nullptr;
+	std::vector<GpuTimerQueriesD3D11> timers;
+};
+
+static const size_t GpuTimerFramesInFlight = 4;
+static GpuTimerFrameD3D11 D3D11FrameTimerQueries;
+static std::deque<GpuTimerFrameD3D11> D3D11PendingTimerQueries;
+static std::vector<GpuTimerQueriesD3D11> D3D11FreeTimerQueries; // queries are reused by next frames
+static std::vector<ID3D11Query*> D3D11FreeDisjointQueries;
+static std::vector<GpuTimer> D3D11GpuTimers;
+static bool D3D11TimerActive = false;
+
+static ID3D11Query* CreateQuery(D3D11_QUERY type)
+{
+	D3D11_QUERY_DESC desc = {};
+	desc.Query = type;
+
+	ID3D11Query* query = nullptr;
+	D3D11Device->CreateQuery(&desc, &query);
+	return query;
+}
+
+static GpuTimerQueriesD3D11 AcquireTimerQueries()
+{
+	if (!D3D11FreeTimerQueries.empty())
+	{
+		auto timer = std::move(D3D11FreeTimerQueries.back());
+		D3D11FreeTimerQueries.pop_back();
+		return timer;
+	}
+
+	auto timer = GpuTimerQueriesD3D11();
+	timer.begin_timestamp = CreateQuery(D3D11_QUERY_TIMESTAMP);
+	timer.end_timestamp = CreateQuery(D3D11_QUERY_TIMESTAMP);
+	timer.statistics = CreateQuery(D3D11_QUERY_PIPELINE_STATISTICS);
+	return timer;
+}
+
+static ID3D11Query* AcquireDisjointQuery()
+{
+	if (D3D11FreeDisjointQueries.empty())
+		return CreateQuery(D3D11_QUERY_TIMESTAMP_DISJOINT);
+
+	auto query = D3D11FreeDisjointQueries.back();
+	D3D11FreeDisjointQueries.pop_back();
+	return query;
+}
+
+static void ReleaseTimerQueries(GpuTimerFrameD3D11& frame)
+{
+	if (frame.disjoint != nullptr)
+		D3D11FreeDisjointQueries.push_back(frame.disjoint);
+
+	D3D11FreeTimerQueries.insert(D3D11FreeTimerQueries.end(), frame.timers.begin(), frame.timers.end());
+
+	frame.disjoint = nullptr;
+	frame.timers.clear();
+}
+
+static void DeleteTimerQueries()
+{
+	for (const auto& timer : D3D11FreeTimerQueries)
+	{
+		timer.begin_timestamp->Release();
+		timer.end_timestamp->Release();
+		timer.statistics->Release();
+	}
+
+	for (auto query : D3D11FreeDisjointQueries)
+	{
+		query->Release();
+	}
+
+	D3D11FreeTimerQueries.clear();
+	D3D11FreeDisjointQueries.clear();
+}
+
+static void ResolveGpuTimers()
+{
+	if (D3D11FrameTimerQueries.disjoint != nullptr)
+		D3D11Context->End(D3D11FrameTimerQueries.disjoint);
+
+	D3D11PendingTimerQueries.push_back(std::move(D3D11FrameTimerQueries));
+	D3D11FrameTimerQueries = {};
+
+	while (!D3D11PendingTimerQueries.empty())
+	{
+		auto& frame = D3D11PendingTimerQueries.front();
+
+		if (frame.disjoint == nullptr)
+		{
+			D3D11GpuTimers.clear();
+			D3D11PendingTimerQueries.pop_front();
+			continue;
+		}
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+
+		if (D3D11Context->GetData(frame.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			if (D3D11PendingTimerQueries.size() <= GpuTimerFramesInFlight)
+				break;
+
+			ReleaseTimerQueries(frame);
+			D3D11PendingTimerQueries.pop_front();
+			continue;
+		}
+
+		// every query of the frame ends before the disjoint query, so their data is available too
+
+		D3D11GpuTimers.clear();
+
+		for (const auto& timer : frame.timers)
+		{
+			UINT64 begin = 0;
+			UINT64 end = 0;
+			D3D11_QUERY_DATA_PIPELINE_STATISTICS statistics = {};
+
+			D3D11Context->GetData(timer.begin_timestamp, &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+			D3D11Context->GetData(timer.end_timestamp, &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+			D3D11Context->GetData(timer.statistics, &statistics, sizeof(statistics), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+
+			auto gpu_timer = GpuTimer();
+			gpu_timer.name = timer.name;
+
+			if (!disjoint.Disjoint)
+				gpu_timer.milliseconds = (double)(end - begin) * 1000.0 / (double)disjoint.Frequency;
+
+			gpu_timer.statistics = PipelineStatistics{
+				.vertices = statistics.IAVertices,
+				.primitives = statistics.IAPrimitives,
+				.fragment_invocations = statistics.PSInvocations
+			};
+
+			D3D11GpuTimers.push_back(gpu_timer);
+		}
+
+		ReleaseTimerQueries(frame);
+		D3D11PendingTimerQueries.pop_front();
+	}
+}
+
 BackendD3D11::BackendD3D11(void* window, uint32_t width, uint32_t height)
 {
 	DXGI_SWAP_CHAIN_DESC sd = {};
@@ -326,18 +575,38 @@ BackendD3D11::~BackendD3D11()
 	D3D11Context->Release();
 	D3D11Device->Release();
 
-	D3D11VertexBuffer->Release();
-	D3D11IndexBuffer->Release();
+	for (auto transient_buffer : { &D3D11TransientVertexBuffer, &D3D11TransientIndexBuffer })
+	{
+		if (transient_buffer->buffer)
+			transient_buffer->buffer->Release();
+
+		transient_buffer->buffer = nullptr;
+		transient_buffer->allocator.reset(0);
+	}
 	
 	for (auto [slot, buffer] : D3D11ConstantBuffers)
 	{
 		buffer->Release();
 	}
 
+	D3D11ConstantBuffers.clear();
+	D3D11ConstantBufferSizes.clear();
+	D3D11CurrentShader = nullptr;
+
 	for (const auto& [_, blend_state] : D3D11BlendModes)
 	{
 		blend_state->Release();
 	}
+
+	for (auto& frame : D3D11PendingTimerQueries)
+	{
+		ReleaseTimerQueries(frame);
+	}
+
+	ReleaseTimerQueries(D3D11FrameTimerQueries);
+	DeleteTimerQueries();
+	D3D11PendingTimerQueries.clear();
+	D3D11GpuTimers.clear();
 }
 
 void BackendD3D11::resize(uint32_t width, uint32_t height)
@@ -433,80 +702,56 @@ void BackendD3D11::setShader(ShaderHandle* handle)
 {
 	auto shader = (ShaderDataD3D11*)handle;
 	shader->apply();
+	D3D11CurrentShader = shader;
 }
 
 void BackendD3D11::setVertexBuffer(const Buffer& buffer)
 {
-	D3D11_BUFFER_DESC desc = {};
-
-	if (D3D11VertexBuffer)
-		D3D11VertexBuffer->GetDesc(&desc);
-
-	if (desc.ByteWidth < buffer.size)
-	{
-		if (D3D11VertexBuffer)
-			D3D11VertexBuffer->Release();
-
-		desc.ByteWidth = static_cast<UINT>(buffer.size);
-		desc.Usage = D3D11_USAGE_DYNAMIC;
-		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-		D3D11Device->CreateBuffer(&desc, nullptr, &D3D11VertexBuffer);
-	}
-
-	D3D11_MAPPED_SUBRESOURCE resource;
-	D3D11Context->Map(D3D11VertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
-	memcpy(resource.pData, buffer.data, buffer.size);
-	D3D11Context->Unmap(D3D11VertexBuffer, 0);
-
+	auto offset = WriteTransientData(D3D11TransientVertexBuffer, D3D11_BIND_VERTEX_BUFFER, buffer);
 	auto stride = static_cast<UINT>(buffer.stride);
-	auto offset = static_cast<UINT>(0);
 
-	D3D11Context->IASetVertexBuffers(0, 1, &D3D11VertexBuffer, &stride, &offset);
+	D3D11Context->IASetVertexBuffers(0, 1, &D3D11TransientVertexBuffer.buffer, &stride, &offset);
 }
 
 void BackendD3D11::setIndexBuffer(const Buffer& buffer)
 {
-	D3D11_BUFFER_DESC desc = {};
-
-	if (D3D11IndexBuffer)
-		D3D11IndexBuffer->GetDesc(&desc);
-
-	if (desc.ByteWidth < buffer.size)
-	{
-		if (D3D11IndexBuffer)
-			D3D11IndexBuffer->Release();
+	auto offset = WriteTransientData(D3D11TransientIndexBuffer, D3D11_BIND_INDEX_BUFFER, buffer);
+	D3D11Context->IASetIndexBuffer(D3D11TransientIndexBuffer.buffer, buffer.stride == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, offset);
+}
 
-		desc.ByteWidth = static_cast<UINT>(buffer.size);
-		desc.Usage = D3D11_USAGE_DYNAMIC;
-		desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-		D3D11Device->CreateBuffer(&desc, nullptr, &D3D11IndexBuffer);
-	}
+void BackendD3D11::setVertexBuffer(VertexBufferHandle* handle)
+{
+	auto buffer = (BufferDataD3D11*)handle;
+	auto stride = static_cast<UINT>(buffer->stride);
+	auto offset = static_cast<UINT>(0);
 
-	D3D11_MAPPED_SUBRESOURCE resource;
-	D3D11Context->Map(D3D11IndexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
-	memcpy(resource.pData, buffer.data, buffer.size);
-	D3D11Context->Unmap(D3D11IndexBuffer, 0);
+	D3D11Context->IASetVertexBuffers(0, 1, &buffer->buffer, &stride, &offset);
+}
 
-	D3D11Context->IASetIndexBuffer(D3D11IndexBuffer, buffer.stride == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+void BackendD3D11::setIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataD3D11*)handle;
+	D3D11Context->IASetIndexBuffer(buffer->buffer, buffer->stride == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
 }
 
 void BackendD3D11::setUniformBuffer(uint32_t slot, void* memory, size_t size)
 {
-	assert(size % 16 == 0);
+	D3D11ConstantBufferSizes[slot] = size;
+
+	// constant buffers are sized in multiples of 16 bytes, the tail of the last one is left undefined
+	auto byte_width = (size + 15) / 16 * 16;
 
 	D3D11_BUFFER_DESC desc = {};
 
 	if (D3D11ConstantBuffers.contains(slot))
 		D3D11ConstantBuffers.at(slot)->GetDesc(&desc);
 
-	if (desc.ByteWidth < size)
+	if (desc.ByteWidth < byte_width)
 	{
 		if (D3D11ConstantBuffers.contains(slot))
 			D3D11ConstantBuffers.at(slot)->Release();
 
-		desc.ByteWidth = static_cast<UINT>(size);
+		desc.ByteWidth = static_cast<UINT>(byte_width);
 		desc.Usage = D3D11_USAGE_DYNAMIC;
 		desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
@@ -577,6 +822,7 @@ void BackendD3D11::setBlendMode(const BlendMode& value)
 		blend.BlendOpAlpha = BlendOpMap.at(value.alphaBlendFunction);
 
 		D3D11Device->CreateBlendState(&desc, &D3D11BlendModes[value]);
+		GetCurrentFrameStats().state_objects_created += 1;
 	}
 
 	const float blend_factor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
@@ -735,10 +981,49 @@ void BackendD3D11::present()
 {
 	bool vsync = false; // TODO: globalize this var
 	D3D11SwapChain->Present(vsync ? 1 : 0, 0);
+	ResolveGpuTimers();
+}
+
+void BackendD3D11::beginTimer(const std::string& name)
+{
+	assert(!D3D11TimerActive);
+	D3D11TimerActive = true;
+
+	if (D3D11FrameTimerQueries.disjoint == nullptr)
+	{
+		D3D11FrameTimerQueries.disjoint = AcquireDisjointQuery();
+		D3D11Context->Begin(D3D11FrameTimerQueries.disjoint);
+	}
+
+	auto timer = AcquireTimerQueries();
+	timer.name = name;
+
+	D3D11Context->End(timer.begin_timestamp);
+	D3D11Context->Begin(timer.statistics);
+
+	D3D11FrameTimerQueries.timers.push_back(timer);
+}
+
+void BackendD3D11::endTimer()
+{
+	assert(D3D11TimerActive);
+	D3D11TimerActive = false;
+
+	const auto& timer = D3D11FrameTimerQueries.timers.back();
+
+	D3D11Context->End(timer.statistics);
+	D3D11Context->End(timer.end_timestamp);
+}
+
+const std::vector<GpuTimer>& BackendD3D11::getGpuTimers()
+{
+	return D3D11GpuTimers;
 }
 
 TextureHandle* BackendD3D11::createTexture(uint32_t width, uint32_t height, uint32_t channels, void* memory, bool mipmap)
 {
+	SKYGFX_TRACE_SCOPE("BackendD3D11::createTexture");
+
 	auto texture = new TextureDataD3D11(width, height, channels, memory, mipmap);
 	return (TextureHandle*)texture;
 }
@@ -762,19 +1047,89 @@ void BackendD3D11::destroyRenderTarget(RenderTargetHandle* handle)
 	delete render_target;
 }
 
+VertexBufferHandle* BackendD3D11::createVertexBuffer(void* memory, size_t size, size_t stride)
+{
+	auto buffer = new BufferDataD3D11(memory, size, stride, D3D11_BIND_VERTEX_BUFFER);
+	return (VertexBufferHandle*)buffer;
+}
+
+void BackendD3D11::destroyVertexBuffer(VertexBufferHandle* handle)
+{
+	auto buffer = (BufferDataD3D11*)handle;
+	delete buffer;
+}
+
+IndexBufferHandle* BackendD3D11::createIndexBuffer(void* memory, size_t size, size_t stride)
+{
+	auto buffer = new BufferDataD3D11(memory, size, stride, D3D11_BIND_INDEX_BUFFER);
+	return (IndexBufferHandle*)buffer;
+}
+
+void BackendD3D11::destroyIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataD3D11*)handle;
+	delete buffer;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
 ShaderHandle* BackendD3D11::createShader(const Vertex::Layout& layout, const std::string& vertex_code, 
-	const std::string& fragment_code, const std::vector<std::string>& defines)
+	const std::string& fragment_code, const std::vector<std::string>& defines,
+	const SpecializationConstants& specialization_constants)
 {
-	auto shader = new ShaderDataD3D11(layout, vertex_code, fragment_code, defines);
+	SKYGFX_TRACE_SCOPE("BackendD3D11::createShader");
+
+	auto shader_defines = MakeShaderDefines(BackendType::D3D11, layout, defines);
+	auto vertex_shader = CompileShader(ShaderStage::Vertex, ShaderTarget::Hlsl, vertex_code, shader_defines);
+	auto fragment_shader = fragment_code.empty() ? CompiledShader() :
+		CompileShader(ShaderStage::Fragment, ShaderTarget::Hlsl, fragment_code, shader_defines);
+
+	return createShader(layout, vertex_shader, fragment_shader, specialization_constants);
+}
+#endif
+
+ShaderHandle* BackendD3D11::createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+	const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants)
+{
+	if (!specialization_constants.empty())
+	{
+		auto vertex_shader = SpecializeShader(vertex, ShaderTarget::Hlsl, specialization_constants);
+		auto fragment_shader = fragment.spirv.empty() ? CompiledShader() :
+			SpecializeShader(fragment, ShaderTarget::Hlsl, specialization_constants);
+
+		return createShader(layout, vertex_shader, fragment_shader, {});
+	}
+
+	auto shader = new ShaderDataD3D11(layout, vertex, fragment);
 	return (ShaderHandle*)shader;
 }
 
 void BackendD3D11::destroyShader(ShaderHandle* handle)
 {
 	auto shader = (ShaderDataD3D11*)handle;
+
+	if (D3D11CurrentShader == shader)
+		D3D11CurrentShader = nullptr;
+
 	delete shader;
 }
 
+#ifdef SKYGFX_RUNTIME_COMPILER
+std::vector<std::shared_future<CompiledShader>> BackendD3D11::compileShaderAsync(const Vertex::Layout& layout,
+	const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& _defines)
+{
+	auto defines = MakeShaderDefines(BackendType::D3D11, layout, _defines);
+
+	std::vector<std::shared_future<CompiledShader>> result = {
+		CompileShaderAsync(ShaderStage::Vertex, ShaderTarget::Hlsl, vertex_code, defines)
+	};
+
+	if (!fragment_code.empty())
+		result.push_back(CompileShaderAsync(ShaderStage::Fragment, ShaderTarget::Hlsl, fragment_code, defines));
+
+	return result;
+}
+#endif
+
 void BackendD3D11::createMainRenderTarget(uint32_t width, uint32_t height)
 {
 	D3D11_TEXTURE2D_DESC desc = {};
@@ -867,6 +1222,7 @@ void BackendD3D11::prepareForDrawing()
 			desc.BackFace = desc.FrontFace;
 
 			D3D11Device->CreateDepthStencilState(&desc, &D3D11DepthStencilStates[depth_stencil_state]);
+			GetCurrentFrameStats().state_objects_created += 1;
 		}
 
 		D3D11Context->OMSetDepthStencilState(D3D11DepthStencilStates.at(depth_stencil_state), stencil_mode.reference);
@@ -894,6 +1250,7 @@ void BackendD3D11::prepareForDrawing()
 			desc.ScissorEnable = value.scissor_enabled;
 			desc.DepthClipEnable = true;
 			D3D11Device->CreateRasterizerState(&desc, &D3D11RasterizerStates[value]);
+			GetCurrentFrameStats().state_objects_created += 1;
 		}
 
 		D3D11Context->RSSetState(D3D11RasterizerStates.at(value));
@@ -933,6 +1290,7 @@ void BackendD3D11::prepareForDrawing()
 			desc.MinLOD = 0.0f;
 			desc.MaxLOD = FLT_MAX;
 			D3D11Device->CreateSamplerState(&desc, &D3D11SamplerStates[value]);
+			GetCurrentFrameStats().state_objects_created += 1;
 		}
 
 		D3D11Context->PSSetSamplers(0, 1, &D3D11SamplerStates.at(value));
@@ -969,6 +1327,18 @@ void BackendD3D11::prepareForDrawing()
 
 		mViewportDirty = false;
 	}
+
+	if (D3D11CurrentShader != nullptr)
+	{
+		for (const auto& descriptor_set : D3D11CurrentShader->getReflection().descriptor_sets)
+		{
+			if (descriptor_set.type != ShaderReflection::DescriptorSet::Type::UniformBuffer)
+				continue;
+
+			if (D3D11ConstantBufferSizes.contains(descriptor_set.binding))
+				CheckUniformBufferSize(descriptor_set, D3D11ConstantBufferSizes.at(descriptor_set.binding));
+		}
+	}
 }
 
 #endif
\ No newline at end of file
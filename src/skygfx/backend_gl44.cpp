@@ -1,18 +1,32 @@
 #include "backend_gl44.h"
+#include "ring_allocator.h"
+#include "shader_cache.h"
+#include "trace.h"
 
 #ifdef SKYGFX_HAS_OPENGL
 
+#include <algorithm>
 #include <unordered_map>
 #include <stdexcept>
 #include <iostream>
+#include <array>
+#include <deque>
+#include <limits>
 
 #define GLEW_STATIC
 #include <GL/glew.h>
+
+#ifdef _WIN32
 #include <GL/GL.h>
 #include <GL/wglew.h>
 
 #pragma comment(lib, "opengl32")
 #pragma comment(lib, "glu32")
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#endif
 
 using namespace skygfx;
 
@@ -114,71 +128,162 @@ static const std::unordered_map<ComparisonFunc, GLenum> ComparisonFuncMap = {
 	{ ComparisonFunc::GreaterEqual, GL_GEQUAL }
 };
 
+static bool GLSpirvSupported = false; // GL_ARB_gl_spirv
+
+static std::string GetShaderInfoLog(GLuint shader)
+{
+	GLint maxLength = 0;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
+	std::string errorLog;
+	errorLog.resize(maxLength);
+	glGetShaderInfoLog(shader, maxLength, &maxLength, errorLog.data());
+	return errorLog;
+}
+
+static GLuint CreateShaderFromSource(GLenum type, std::string_view source)
+{
+	auto shader = glCreateShader(type);
+	auto s = source.data();
+	auto s_length = (GLint)source.size();
+	glShaderSource(shader, 1, &s, &s_length);
+	glCompileShader(shader);
+
+	GLint isCompiled = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
+	if (isCompiled == GL_FALSE)
+	{
+		auto errorLog = GetShaderInfoLog(shader);
+		glDeleteShader(shader);
+		throw std::runtime_error(errorLog);
+	}
+
+	return shader;
+}
+
+// returns 0 when the driver does not accept the module, the caller falls back to glsl then
+static GLuint CreateShaderFromSpirv(GLenum type, std::span<const uint32_t> spirv,
+	const SpecializationConstants& specialization_constants)
+{
+	std::vector<GLuint> constant_ids;
+	std::vector<GLuint> constant_values;
+
+	// the driver rejects constants which the module does not declare
+	for (auto constant_id : GetSpirvSpecializationConstantIds(spirv))
+	{
+		if (!specialization_constants.contains(constant_id))
+			continue;
+
+		constant_ids.push_back(constant_id);
+		constant_values.push_back(specialization_constants.at(constant_id));
+	}
+
+	auto shader = glCreateShader(type);
+	glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, spirv.data(), (GLsizei)spirv.size_bytes());
+	glSpecializeShaderARB(shader, "main", (GLuint)constant_ids.size(), constant_ids.data(), constant_values.data());
+
+	GLint isCompiled = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
+	if (isCompiled == GL_FALSE)
+	{
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+// fragmentShader is 0 for depth-only programs
+static GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader)
+{
+	auto program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	if (fragmentShader != 0)
+		glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	glDeleteShader(vertexShader);
+	if (fragmentShader != 0)
+		glDeleteShader(fragmentShader);
+
+	GLint isLinked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+	if (isLinked == GL_FALSE)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
 class ShaderDataGL44
 {
 private:
 	Vertex::Layout layout;
-	GLuint program;
+	GLuint program = 0;
 	GLuint vao;
+	ShaderReflection reflection;
+	bool has_fragment_stage;
 
 public:
-	ShaderDataGL44(const Vertex::Layout& layout, const std::string& vertex_code, const std::string& fragment_code,
-		std::vector<std::string> defines)
+	ShaderDataGL44(const Vertex::Layout& layout, const CompiledShaderView& vertex, const CompiledShaderView& fragment,
+		const SpecializationConstants& specialization_constants) :
+		reflection(MergeShaderReflections(vertex, fragment)),
+		has_fragment_stage(!fragment.spirv.empty())
 	{
-		AddShaderLocationDefines(layout, defines);
-		defines.push_back("FLIP_TEXCOORD_Y");
+		// spirv is handed to the driver as is, so it does not parse glsl translated from it once again
+		if (GLSpirvSupported)
+		{
+			auto vertexShader = CreateShaderFromSpirv(GL_VERTEX_SHADER, vertex.spirv, specialization_constants);
+			GLuint fragmentShader = 0;
+
+			if (has_fragment_stage)
+				fragmentShader = CreateShaderFromSpirv(GL_FRAGMENT_SHADER, fragment.spirv, specialization_constants);
+
+			if (vertexShader != 0 && (fragmentShader != 0 || !has_fragment_stage))
+				program = LinkProgram(vertexShader, fragmentShader);
+			else if (vertexShader != 0)
+				glDeleteShader(vertexShader);
+			else if (fragmentShader != 0)
+				glDeleteShader(fragmentShader);
+		}
 
-		auto vertex_shader_spirv = CompileGlslToSpirv(ShaderStage::Vertex, vertex_code, defines);
-		auto fragment_shader_spirv = CompileGlslToSpirv(ShaderStage::Fragment, fragment_code, defines);
+		if (program == 0)
+		{
+			auto glsl_vert = std::string(vertex.source);
+			auto glsl_frag = std::string(fragment.source);
 
-		auto glsl_vert = CompileSpirvToGlsl(vertex_shader_spirv);
-		auto glsl_frag = CompileSpirvToGlsl(fragment_shader_spirv);
+			if (!specialization_constants.empty())
+			{
+				glsl_vert = SpecializeShader(vertex, ShaderTarget::Glsl, specialization_constants).source;
 
-		auto vertexShader = glCreateShader(GL_VERTEX_SHADER);
-		auto v = glsl_vert.c_str();
-		glShaderSource(vertexShader, 1, &v, NULL);
-		glCompileShader(vertexShader);
+				if (has_fragment_stage)
+					glsl_frag = SpecializeShader(fragment, ShaderTarget::Glsl, specialization_constants).source;
+			}
 
-		GLint isCompiled = 0;
-		glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &isCompiled);
-		if (isCompiled == GL_FALSE)
-		{
-			GLint maxLength = 0;
-			glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &maxLength);
-			std::string errorLog;
-			errorLog.resize(maxLength);
-			glGetShaderInfoLog(vertexShader, maxLength, &maxLength, &errorLog[0]);
-			throw std::runtime_error(errorLog);
-		}
+			auto vertexShader = CreateShaderFromSource(GL_VERTEX_SHADER, glsl_vert);
+			GLuint fragmentShader = 0;
+
+			try
+			{
+				if (has_fragment_stage)
+					fragmentShader = CreateShaderFromSource(GL_FRAGMENT_SHADER, glsl_frag);
+			}
+			catch (...)
+			{
+				glDeleteShader(vertexShader);
+				throw;
+			}
 
-		auto fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-		auto f = glsl_frag.c_str();
-		glShaderSource(fragmentShader, 1, &f, NULL);
-		glCompileShader(fragmentShader);
+			program = LinkProgram(vertexShader, fragmentShader);
 
-		isCompiled = 0;
-		glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &isCompiled);
-		if (isCompiled == GL_FALSE)
-		{
-			GLint maxLength = 0;
-			glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &maxLength);
-			std::string errorLog;
-			errorLog.resize(maxLength);
-			glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, &errorLog[0]);
-			throw std::runtime_error(errorLog);
+			if (program == 0)
+				throw std::runtime_error("glLinkProgram failed");
 		}
 
-		program = glCreateProgram();
-		glAttachShader(program, vertexShader);
-		glAttachShader(program, fragmentShader);
-		glLinkProgram(program);
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
-
 		glGenVertexArrays(1, &vao);
 		glBindVertexArray(vao);
 
-		for (int i = 0; i < layout.attributes.size(); i++)
+		for (auto i : GetUsedVertexAttributes(layout, reflection))
 		{
 			const auto& attrib = layout.attributes.at(i);
 
@@ -200,12 +305,41 @@ public:
 		glUseProgram(program);
 		glBindVertexArray(vao);
 	}
+
+	const auto& getReflection() const { return reflection; }
+	bool hasFragmentStage() const { return has_fragment_stage; }
+};
+
+class BufferDataGL44
+{
+	friend class skygfx::BackendGL44;
+
+private:
+	GLuint buffer;
+	size_t stride;
+
+public:
+	BufferDataGL44(void* memory, size_t size, size_t _stride) :
+		stride(_stride)
+	{
+		// immutable storage without map flags, so the driver is free to keep it in video memory.
+		// copy write target is used as it is not a part of vao state
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, memory, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	~BufferDataGL44()
+	{
+		glDeleteBuffers(1, &buffer);
+	}
 };
 
 class TextureDataGL44
 {
 	friend class RenderTargetDataGL44;
-	friend class BackendGL44;
+	friend class skygfx::BackendGL44;
 
 private:
 	GLuint texture;
@@ -263,7 +397,7 @@ public:
 
 class RenderTargetDataGL44
 {
-	friend class BackendGL44;
+	friend class skygfx::BackendGL44;
 
 private:
 	GLuint framebuffer;
@@ -306,19 +440,361 @@ public:
 	}
 };
 
+#ifdef _WIN32
 static HGLRC WglContext;
 static HDC gHDC;
+#else
+static EGLDisplay gEGLDisplay = EGL_NO_DISPLAY;
+static EGLContext gEGLContext = EGL_NO_CONTEXT;
+static EGLSurface gEGLSurface = EGL_NO_SURFACE;
+#endif
+
+// there is no default framebuffer when the device is created without window,
+// backbuffer is emulated with framebuffer object of the same size
+
+static GLuint GLBackbufferFramebuffer = 0;
+static GLuint GLBackbufferColorRenderbuffer = 0;
+static GLuint GLBackbufferDepthStencilRenderbuffer = 0;
 
 static GLenum GLTopology;
 static GLenum GLIndexType;
-static GLuint GLVertexBuffer;
-static GLuint GLIndexBuffer;
-static std::unordered_map<uint32_t, GLuint> GLUniformBuffers;
+static GLuint GLBoundVertexBuffer = 0; // transient buffer or a buffer of BufferDataGL44
+static GLintptr GLBoundVertexOffset = 0;
+static GLsizei GLBoundVertexStride = 0;
+static GLuint GLBoundIndexBuffer = 0;
+static size_t GLBoundIndexOffset = 0;
+static ShaderDataGL44* GLCurrentShader = nullptr;
+static ColorMask GLColorMask; // of the blend mode
+static bool GLColorWritesDisabled = false; // by a shader without fragment stage
 static GLuint GLPixelBuffer;
 static RenderTargetDataGL44* GLCurrentRenderTarget = nullptr;
 
+// vertex, index and uniform data of Buffer and setUniformBuffer is appended to a stream buffer which is
+// persistently and coherently mapped, so writing is a memcpy without any driver call. every present closes
+// a frame of the ring with a fence, space of the frame is reused only after the fence is signaled, which
+// replaces orphaning and implicit synchronization of the driver. there are up to StreamFramesInFlight frames
+// in the ring, a full ring waits for the oldest one and the buffer is replaced by a bigger one only when
+// the frame in progress does not fit. stream data is valid until the end of the frame it was written in,
+// so vertex, index and uniform data which is still bound is written again by the first draw of the next
+// frame. uniform data is written at draw time, only the range the current shader reads
+
+struct StreamBufferGL44
+{
+	GLuint buffer = 0;
+	void* memory = nullptr;
+	RingAllocator allocator;
+	std::deque<std::pair<uint64_t, GLsync>> fences; // of closed frames
+	std::deque<std::pair<uint64_t, GLuint>> replaced_buffers; // deleted when the frame is retired
+};
+
+static const size_t StreamBufferCapacity = 4 * 1024 * 1024;
+static const size_t StreamDataAlignment = 16;
+static const size_t StreamFramesInFlight = 3;
+static StreamBufferGL44 GLStreamBuffer;
+static size_t GLUniformBufferAlignment = 256;
+
+struct UniformBufferGL44
+{
+	std::vector<uint8_t> data;
+	size_t written_size = 0; // bytes bound from the stream buffer, 0 when data has to be written again
+};
+
+static std::unordered_map<uint32_t, UniformBufferGL44> GLUniformBuffers;
+
+static void CreateStreamBuffer(size_t capacity)
+{
+	if (GLStreamBuffer.buffer != 0)
+		GLStreamBuffer.replaced_buffers.push_back({ GLStreamBuffer.allocator.getFrame(), GLStreamBuffer.buffer });
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &GLStreamBuffer.buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, GLStreamBuffer.buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, nullptr, flags);
+	GLStreamBuffer.memory = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, flags);
+	GLStreamBuffer.allocator.reset(capacity);
+}
+
+static void DestroyStreamBuffer()
+{
+	for (auto [frame, fence] : GLStreamBuffer.fences)
+	{
+		glDeleteSync(fence);
+	}
+
+	for (auto [frame, buffer] : GLStreamBuffer.replaced_buffers)
+	{
+		glDeleteBuffers(1, &buffer);
+	}
+
+	glDeleteBuffers(1, &GLStreamBuffer.buffer); // unmaps the buffer
+	GLStreamBuffer = StreamBufferGL44();
+}
+
+// retires closed frames which gpu has finished, wait blocks until the oldest one is finished
+static void RetireStreamFrames(bool wait)
+{
+	SKYGFX_TRACE_SCOPE("BackendGL44::retireStreamFrames");
+
+	while (!GLStreamBuffer.fences.empty())
+	{
+		auto [frame, fence] = GLStreamBuffer.fences.front();
+		auto timeout = wait ? std::numeric_limits<GLuint64>::max() : 0;
+		auto result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+
+		if (result == GL_TIMEOUT_EXPIRED)
+			break;
+
+		glDeleteSync(fence);
+		GLStreamBuffer.fences.pop_front();
+		GLStreamBuffer.allocator.retire(frame);
+
+		while (!GLStreamBuffer.replaced_buffers.empty() && GLStreamBuffer.replaced_buffers.front().first <= frame)
+		{
+			glDeleteBuffers(1, &GLStreamBuffer.replaced_buffers.front().second);
+			GLStreamBuffer.replaced_buffers.pop_front();
+		}
+
+		wait = false;
+	}
+}
+
+static void EndStreamFrame()
+{
+	auto frame = GLStreamBuffer.allocator.endFrame();
+	GLStreamBuffer.fences.push_back({ frame, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+
+	RetireStreamFrames(GLStreamBuffer.fences.size() > StreamFramesInFlight);
+}
+
+// offset of the data in GLStreamBuffer.buffer, which can be replaced by the call
+static size_t WriteStreamData(const void* data, size_t size, size_t alignment)
+{
+	auto offset = GLStreamBuffer.allocator.allocate(size, alignment);
+
+	while (!offset.has_value() && !GLStreamBuffer.fences.empty())
+	{
+		RetireStreamFrames(true);
+		offset = GLStreamBuffer.allocator.allocate(size, alignment);
+	}
+
+	if (!offset.has_value())
+	{
+		CreateStreamBuffer(std::max(GLStreamBuffer.allocator.getCapacity() * 2, size));
+		offset = GLStreamBuffer.allocator.allocate(size, alignment);
+	}
+
+	memcpy((uint8_t*)GLStreamBuffer.memory + offset.value(), data, size);
+
+	return offset.value();
+}
+
+static void WriteUniformBuffer(uint32_t slot, UniformBufferGL44& uniform_buffer, size_t size)
+{
+	auto offset = WriteStreamData(uniform_buffer.data.data(), size, GLUniformBufferAlignment);
+	glBindBufferRange(GL_UNIFORM_BUFFER, slot, GLStreamBuffer.buffer, offset, size);
+	uniform_buffer.written_size = size;
+}
+
+// timer queries are resolved a few frames later, frames which gpu has not finished
+// in GpuTimerFramesInFlight presents are dropped instead of stalling
+
+struct GpuTimerQueriesGL44
+{
+	std::string name;
+	GLuint begin_timestamp;
+	GLuint end_timestamp;
+	std::optional<std::array<GLuint, 3>> statistics; // vertices, primitives, fragment invocations
+};
+
+static const size_t GpuTimerFramesInFlight = 4;
+static std::vector<GpuTimerQueriesGL44> GLFrameTimerQueries;
+static std::deque<std::vector<GpuTimerQueriesGL44>> GLPendingTimerQueries;
+static std::vector<GpuTimerQueriesGL44> GLFreeTimerQueries; // queries keep their targets, so they are reused by sets
+static std::vector<GpuTimer> GLGpuTimers;
+static bool GLTimerActive = false;
+
+static GpuTimerQueriesGL44 AcquireTimerQueries()
+{
+	if (!GLFreeTimerQueries.empty())
+	{
+		auto timer = std::move(GLFreeTimerQueries.back());
+		GLFreeTimerQueries.pop_back();
+		return timer;
+	}
+
+	auto timer = GpuTimerQueriesGL44();
+	glGenQueries(1, &timer.begin_timestamp);
+	glGenQueries(1, &timer.end_timestamp);
+
+	if (GLEW_ARB_pipeline_statistics_query)
+	{
+		timer.statistics.emplace();
+		glGenQueries(3, timer.statistics->data());
+	}
+
+	return timer;
+}
+
+static void ReleaseTimerQueries(std::vector<GpuTimerQueriesGL44>& timers)
+{
+	GLFreeTimerQueries.insert(GLFreeTimerQueries.end(), timers.begin(), timers.end());
+	timers.clear();
+}
+
+static void DeleteTimerQueries(const GpuTimerQueriesGL44& timer)
+{
+	glDeleteQueries(1, &timer.begin_timestamp);
+	glDeleteQueries(1, &timer.end_timestamp);
+
+	if (timer.statistics.has_value())
+		glDeleteQueries(3, timer.statistics->data());
+}
+
+static bool IsQueryAvailable(GLuint query)
+{
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	return available == GL_TRUE;
+}
+
+static uint64_t GetQueryResult(GLuint query)
+{
+	GLuint64 result = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+	return result;
+}
+
+static void ResolveGpuTimers()
+{
+	GLPendingTimerQueries.push_back(std::move(GLFrameTimerQueries));
+	GLFrameTimerQueries = {};
+
+	while (!GLPendingTimerQueries.empty())
+	{
+		auto& timers = GLPendingTimerQueries.front();
+
+		// the end timestamp of the last timer is written last
+
+		if (!timers.empty() && !IsQueryAvailable(timers.back().end_timestamp))
+		{
+			if (GLPendingTimerQueries.size() <= GpuTimerFramesInFlight)
+				break;
+
+			ReleaseTimerQueries(timers);
+			GLPendingTimerQueries.pop_front();
+			continue;
+		}
+
+		GLGpuTimers.clear();
+
+		for (const auto& timer : timers)
+		{
+			auto gpu_timer = GpuTimer();
+			gpu_timer.name = timer.name;
+			gpu_timer.milliseconds = (double)(GetQueryResult(timer.end_timestamp) - GetQueryResult(timer.begin_timestamp)) / 1000000.0;
+
+			if (timer.statistics.has_value())
+			{
+				gpu_timer.statistics = PipelineStatistics{
+					.vertices = GetQueryResult(timer.statistics->at(0)),
+					.primitives = GetQueryResult(timer.statistics->at(1)),
+					.fragment_invocations = GetQueryResult(timer.statistics->at(2))
+				};
+			}
+
+			GLGpuTimers.push_back(gpu_timer);
+		}
+
+		ReleaseTimerQueries(timers);
+		GLPendingTimerQueries.pop_front();
+	}
+}
+
+static void CreateOffscreenBackbuffer(uint32_t width, uint32_t height)
+{
+	if (GLBackbufferFramebuffer == 0)
+	{
+		glGenFramebuffers(1, &GLBackbufferFramebuffer);
+		glGenRenderbuffers(1, &GLBackbufferColorRenderbuffer);
+		glGenRenderbuffers(1, &GLBackbufferDepthStencilRenderbuffer);
+	}
+
+	glBindRenderbuffer(GL_RENDERBUFFER, GLBackbufferColorRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, GLBackbufferDepthStencilRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint last_fbo;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &last_fbo);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, GLBackbufferFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, GLBackbufferColorRenderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, GLBackbufferDepthStencilRenderbuffer);
+
+	assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, last_fbo);
+}
+
+static void DestroyOffscreenBackbuffer()
+{
+	if (GLBackbufferFramebuffer == 0)
+		return;
+
+	glDeleteFramebuffers(1, &GLBackbufferFramebuffer);
+	glDeleteRenderbuffers(1, &GLBackbufferColorRenderbuffer);
+	glDeleteRenderbuffers(1, &GLBackbufferDepthStencilRenderbuffer);
+
+	GLBackbufferFramebuffer = 0;
+	GLBackbufferColorRenderbuffer = 0;
+	GLBackbufferDepthStencilRenderbuffer = 0;
+}
+
+std::vector<uint8_t> skygfx::ReadGL44BackendOffscreenFrame()
+{
+	if (GLBackbufferFramebuffer == 0)
+		throw std::runtime_error("opengl backend is not in offscreen mode");
+
+	GLint width;
+	GLint height;
+
+	glBindRenderbuffer(GL_RENDERBUFFER, GLBackbufferColorRenderbuffer);
+	glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &width);
+	glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint last_read_fbo;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &last_read_fbo);
+
+	auto row_size = (size_t)width * 4;
+
+	std::vector<uint8_t> pixels(row_size * height);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, GLBackbufferFramebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, last_read_fbo);
+
+	// opengl rows go from bottom to top
+
+	std::vector<uint8_t> result(pixels.size());
+
+	for (GLint y = 0; y < height; y++)
+	{
+		memcpy(result.data() + (height - 1 - y) * row_size, pixels.data() + y * row_size, row_size);
+	}
+
+	return result;
+}
+
 BackendGL44::BackendGL44(void* window, uint32_t width, uint32_t height)
 {
+#ifdef _WIN32
 	gHDC = GetDC((HWND)window);
 
 	PIXELFORMATDESCRIPTOR pfd;
@@ -378,12 +854,92 @@ BackendGL44::BackendGL44(void* window, uint32_t width, uint32_t height)
 	wglDeleteContext(WglContext);
 	WglContext = wglCreateContextAttribsARB(gHDC, 0, attribs);
 	wglMakeCurrent(gHDC, WglContext);
+#else
+	if (window != nullptr)
+		throw std::runtime_error("opengl backend can render only offscreen on this platform, create device without window");
+
+	// EGL_MESA_platform_surfaceless works without any window system or drm device,
+	// default display is used as fallback
+
+	auto client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	if (get_platform_display != nullptr && client_extensions != nullptr &&
+		strstr(client_extensions, "EGL_MESA_platform_surfaceless") != nullptr)
+	{
+		gEGLDisplay = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+
+	if (gEGLDisplay == EGL_NO_DISPLAY)
+		gEGLDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	if (gEGLDisplay == EGL_NO_DISPLAY || !eglInitialize(gEGLDisplay, nullptr, nullptr))
+		throw std::runtime_error("eglInitialize failed");
+
+	auto display_extensions = eglQueryString(gEGLDisplay, EGL_EXTENSIONS);
+	bool surfaceless = display_extensions != nullptr && strstr(display_extensions, "EGL_KHR_surfaceless_context") != nullptr;
+
+	const EGLint config_attribs[] = {
+		EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint num_configs = 0;
+
+	if (!eglChooseConfig(gEGLDisplay, config_attribs, &config, 1, &num_configs) || num_configs == 0)
+		throw std::runtime_error("eglChooseConfig failed");
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+		throw std::runtime_error("eglBindAPI failed");
+
+	const EGLint context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 4,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	gEGLContext = eglCreateContext(gEGLDisplay, config, EGL_NO_CONTEXT, context_attribs);
+
+	if (gEGLContext == EGL_NO_CONTEXT)
+		throw std::runtime_error("eglCreateContext failed, opengl 4.4 core profile is required");
+
+	if (!surfaceless)
+	{
+		const EGLint pbuffer_attribs[] = {
+			EGL_WIDTH, 1,
+			EGL_HEIGHT, 1,
+			EGL_NONE
+		};
+
+		gEGLSurface = eglCreatePbufferSurface(gEGLDisplay, config, pbuffer_attribs);
+	}
+
+	if (!eglMakeCurrent(gEGLDisplay, gEGLSurface, gEGLSurface, gEGLContext))
+		throw std::runtime_error("eglMakeCurrent failed");
+
+	glewInit();
+
+	CreateOffscreenBackbuffer(width, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, GLBackbufferFramebuffer);
+#endif
 
 	glEnable(GL_DEBUG_OUTPUT);
 	glDebugMessageCallback(MessageCallback, 0);
 
-	glGenBuffers(1, &GLVertexBuffer);
-	glGenBuffers(1, &GLIndexBuffer);
+	GLSpirvSupported = GLEW_ARB_gl_spirv && glSpecializeShaderARB != nullptr;
+
+	GLint uniform_buffer_alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_alignment);
+	GLUniformBufferAlignment = std::max((size_t)uniform_buffer_alignment, StreamDataAlignment);
+
+	CreateStreamBuffer(StreamBufferCapacity);
 	glGenBuffers(1, &GLPixelBuffer);
 
 	mBackbufferWidth = width;
@@ -392,22 +948,60 @@ BackendGL44::BackendGL44(void* window, uint32_t width, uint32_t height)
 
 BackendGL44::~BackendGL44()
 {
-	glDeleteBuffers(1, &GLVertexBuffer);
-	glDeleteBuffers(1, &GLIndexBuffer);
+	DestroyStreamBuffer();
 	glDeleteBuffers(1, &GLPixelBuffer);
 
-	for (auto [slot, buffer] : GLUniformBuffers)
+	GLUniformBuffers.clear();
+	GLCurrentShader = nullptr;
+	GLBoundVertexBuffer = 0;
+	GLBoundIndexBuffer = 0;
+	
+	DestroyOffscreenBackbuffer();
+
+	for (auto& timers : GLPendingTimerQueries)
 	{
-		glDeleteBuffers(1, &buffer);
+		ReleaseTimerQueries(timers);
 	}
-	
+
+	ReleaseTimerQueries(GLFrameTimerQueries);
+
+	for (const auto& timer : GLFreeTimerQueries)
+	{
+		DeleteTimerQueries(timer);
+	}
+
+	GLPendingTimerQueries.clear();
+	GLFreeTimerQueries.clear();
+	GLGpuTimers.clear();
+	GLTimerActive = false;
+
+#ifdef _WIN32
 	wglDeleteContext(WglContext);
+#else
+	eglMakeCurrent(gEGLDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (gEGLSurface != EGL_NO_SURFACE)
+		eglDestroySurface(gEGLDisplay, gEGLSurface);
+
+	eglDestroyContext(gEGLDisplay, gEGLContext);
+	eglTerminate(gEGLDisplay);
+
+	gEGLSurface = EGL_NO_SURFACE;
+	gEGLContext = EGL_NO_CONTEXT;
+	gEGLDisplay = EGL_NO_DISPLAY;
+#endif
 }
 
 void BackendGL44::resize(uint32_t width, uint32_t height)
 {
 	mBackbufferWidth = width;
 	mBackbufferHeight = height;
+
+	if (GLBackbufferFramebuffer != 0)
+		CreateOffscreenBackbuffer(width, height);
+
+	if (!mViewport.has_value())
+		mViewportDirty = true;
 }
 
 void BackendGL44::setTopology(Topology topology)
@@ -476,7 +1070,7 @@ void BackendGL44::setRenderTarget(RenderTargetHandle* handle)
 
 void BackendGL44::setRenderTarget(std::nullptr_t value)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, GLBackbufferFramebuffer);
 	GLCurrentRenderTarget = nullptr;
 
 	if (!mViewport.has_value())
@@ -487,29 +1081,55 @@ void BackendGL44::setShader(ShaderHandle* handle)
 {
 	auto shader = (ShaderDataGL44*)handle;
 	shader->apply();
+	GLCurrentShader = shader;
+	mBufferBindingsDirty = true; // vertex and index buffer bindings are a part of vao
 }
 
+// stream data does not outlive the frame, so buffers are copied and streamed again after present
+
 void BackendGL44::setVertexBuffer(const Buffer& buffer)
 {
 	mVertexBufferDirty = true;
+	mVertexBufferData.assign((uint8_t*)buffer.data, (uint8_t*)buffer.data + buffer.size);
 	mVertexBuffer = buffer;
+	mVertexBuffer.data = mVertexBufferData.data();
 }
 
 void BackendGL44::setIndexBuffer(const Buffer& buffer)
 {
 	mIndexBufferDirty = true;
+	mIndexBufferData.assign((uint8_t*)buffer.data, (uint8_t*)buffer.data + buffer.size);
 	mIndexBuffer = buffer;
+	mIndexBuffer.data = mIndexBufferData.data();
 }
 
-void BackendGL44::setUniformBuffer(uint32_t slot, void* memory, size_t size)
+void BackendGL44::setVertexBuffer(VertexBufferHandle* handle)
 {
-	assert(size % 16 == 0);
+	auto buffer = (BufferDataGL44*)handle;
+	mVertexBufferDirty = false;
+	mVertexBufferData.clear();
+	GLBoundVertexBuffer = buffer->buffer;
+	GLBoundVertexOffset = 0;
+	GLBoundVertexStride = (GLsizei)buffer->stride;
+	mBufferBindingsDirty = true;
+}
 
-	if (!GLUniformBuffers.contains(slot))
-		glGenBuffers(1, &GLUniformBuffers[slot]);
-	
-	glBindBufferBase(GL_UNIFORM_BUFFER, slot, GLUniformBuffers.at(slot));
-	glBufferData(GL_UNIFORM_BUFFER, size, memory, GL_DYNAMIC_DRAW);
+void BackendGL44::setIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataGL44*)handle;
+	mIndexBufferDirty = false;
+	mIndexBufferData.clear();
+	GLBoundIndexBuffer = buffer->buffer;
+	GLBoundIndexOffset = 0;
+	GLIndexType = buffer->stride == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	mBufferBindingsDirty = true;
+}
+
+void BackendGL44::setUniformBuffer(uint32_t slot, void* memory, size_t size)
+{
+	auto& uniform_buffer = GLUniformBuffers[slot];
+	uniform_buffer.data.assign((uint8_t*)memory, (uint8_t*)memory + size);
+	uniform_buffer.written_size = 0;
 }
 
 void BackendGL44::setBlendMode(const BlendMode& value)
@@ -538,7 +1158,10 @@ void BackendGL44::setBlendMode(const BlendMode& value)
 	glEnable(GL_BLEND);
 	glBlendEquationSeparate(BlendOpMap.at(value.colorBlendFunction), BlendOpMap.at(value.alphaBlendFunction));
 	glBlendFuncSeparate(BlendMap.at(value.colorSrcBlend), BlendMap.at(value.colorDstBlend), BlendMap.at(value.alphaSrcBlend), BlendMap.at(value.alphaDstBlend));
-	glColorMask(value.colorMask.red, value.colorMask.green, value.colorMask.blue, value.colorMask.alpha);
+	GLColorMask = value.colorMask;
+
+	if (!GLColorWritesDisabled)
+		glColorMask(GLColorMask.red, GLColorMask.green, GLColorMask.blue, GLColorMask.alpha);
 }
 
 void BackendGL44::setDepthMode(std::optional<DepthMode> depth_mode)
@@ -614,6 +1237,13 @@ void BackendGL44::setTextureAddressMode(const TextureAddress& value)
 void BackendGL44::clear(const std::optional<glm::vec4>& color, const std::optional<float>& depth,
 	const std::optional<uint8_t>& stencil)
 {
+	// clears write color even after a depth-only shader
+	if (GLColorWritesDisabled)
+	{
+		glColorMask(GLColorMask.red, GLColorMask.green, GLColorMask.blue, GLColorMask.alpha);
+		GLColorWritesDisabled = false;
+	}
+
 	auto scissor_was_enabled = glIsEnabled(GL_SCISSOR_TEST);
 
 	if (scissor_was_enabled)
@@ -660,7 +1290,7 @@ void BackendGL44::drawIndexed(uint32_t index_count, uint32_t index_offset)
 {
 	prepareForDrawing();
 	uint32_t index_size = GLIndexType == GL_UNSIGNED_INT ? 4 : 2;
-	glDrawElements(GLTopology, (GLsizei)index_count, GLIndexType, (void*)(size_t)(index_offset * index_size));
+	glDrawElements(GLTopology, (GLsizei)index_count, GLIndexType, (void*)(GLBoundIndexOffset + index_offset * index_size));
 }
 
 void BackendGL44::readPixels(const glm::ivec2& pos, const glm::ivec2& size, TextureHandle* dst_texture_handle)
@@ -696,11 +1326,73 @@ void BackendGL44::readPixels(const glm::ivec2& pos, const glm::ivec2& size, Text
 
 void BackendGL44::present()
 {
+#ifdef _WIN32
 	SwapBuffers(gHDC);
+#else
+	glFlush();
+#endif
+	EndStreamFrame();
+
+	for (auto& [slot, uniform_buffer] : GLUniformBuffers)
+	{
+		uniform_buffer.written_size = 0;
+	}
+
+	if (!mVertexBufferData.empty())
+		mVertexBufferDirty = true;
+
+	if (!mIndexBufferData.empty())
+		mIndexBufferDirty = true;
+
+	ResolveGpuTimers();
+}
+
+void BackendGL44::beginTimer(const std::string& name)
+{
+	assert(!GLTimerActive);
+	GLTimerActive = true;
+
+	auto timer = AcquireTimerQueries();
+	timer.name = name;
+
+	glQueryCounter(timer.begin_timestamp, GL_TIMESTAMP);
+
+	if (timer.statistics.has_value())
+	{
+		glBeginQuery(GL_VERTICES_SUBMITTED_ARB, timer.statistics->at(0));
+		glBeginQuery(GL_PRIMITIVES_SUBMITTED_ARB, timer.statistics->at(1));
+		glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, timer.statistics->at(2));
+	}
+
+	GLFrameTimerQueries.push_back(timer);
+}
+
+void BackendGL44::endTimer()
+{
+	assert(GLTimerActive);
+	GLTimerActive = false;
+
+	const auto& timer = GLFrameTimerQueries.back();
+
+	if (timer.statistics.has_value())
+	{
+		glEndQuery(GL_VERTICES_SUBMITTED_ARB);
+		glEndQuery(GL_PRIMITIVES_SUBMITTED_ARB);
+		glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+	}
+
+	glQueryCounter(timer.end_timestamp, GL_TIMESTAMP);
+}
+
+const std::vector<GpuTimer>& BackendGL44::getGpuTimers()
+{
+	return GLGpuTimers;
 }
 
 TextureHandle* BackendGL44::createTexture(uint32_t width, uint32_t height, uint32_t channels, void* memory, bool mipmap)
 {
+	SKYGFX_TRACE_SCOPE("BackendGL44::createTexture");
+
 	auto texture = new TextureDataGL44(width, height, channels, memory, mipmap);
 	return (TextureHandle*)texture;
 }
@@ -724,19 +1416,88 @@ void BackendGL44::destroyRenderTarget(RenderTargetHandle* handle)
 	delete render_target;
 }
 
+VertexBufferHandle* BackendGL44::createVertexBuffer(void* memory, size_t size, size_t stride)
+{
+	auto buffer = new BufferDataGL44(memory, size, stride);
+	return (VertexBufferHandle*)buffer;
+}
+
+void BackendGL44::destroyVertexBuffer(VertexBufferHandle* handle)
+{
+	auto buffer = (BufferDataGL44*)handle;
+
+	if (GLBoundVertexBuffer == buffer->buffer)
+		GLBoundVertexBuffer = 0;
+
+	delete buffer;
+}
+
+IndexBufferHandle* BackendGL44::createIndexBuffer(void* memory, size_t size, size_t stride)
+{
+	auto buffer = new BufferDataGL44(memory, size, stride);
+	return (IndexBufferHandle*)buffer;
+}
+
+void BackendGL44::destroyIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataGL44*)handle;
+
+	if (GLBoundIndexBuffer == buffer->buffer)
+		GLBoundIndexBuffer = 0;
+
+	delete buffer;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
 ShaderHandle* BackendGL44::createShader(const Vertex::Layout& layout, const std::string& vertex_code, 
-	const std::string& fragment_code, const std::vector<std::string>& defines)
+	const std::string& fragment_code, const std::vector<std::string>& defines,
+	const SpecializationConstants& specialization_constants)
 {
-	auto shader = new ShaderDataGL44(layout, vertex_code, fragment_code, defines);
+	SKYGFX_TRACE_SCOPE("BackendGL44::createShader");
+
+	auto shader_defines = MakeShaderDefines(BackendType::OpenGL44, layout, defines);
+	auto vertex_shader = CompileShader(ShaderStage::Vertex, ShaderTarget::Glsl, vertex_code, shader_defines);
+	auto fragment_shader = fragment_code.empty() ? CompiledShader() :
+		CompileShader(ShaderStage::Fragment, ShaderTarget::Glsl, fragment_code, shader_defines);
+
+	return createShader(layout, vertex_shader, fragment_shader, specialization_constants);
+}
+#endif
+
+ShaderHandle* BackendGL44::createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+	const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants)
+{
+	auto shader = new ShaderDataGL44(layout, vertex, fragment, specialization_constants);
 	return (ShaderHandle*)shader;
 }
 
 void BackendGL44::destroyShader(ShaderHandle* handle)
 {
 	auto shader = (ShaderDataGL44*)handle;
+
+	if (GLCurrentShader == shader)
+		GLCurrentShader = nullptr;
+
 	delete shader;
 }
 
+#ifdef SKYGFX_RUNTIME_COMPILER
+std::vector<std::shared_future<CompiledShader>> BackendGL44::compileShaderAsync(const Vertex::Layout& layout,
+	const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& _defines)
+{
+	auto defines = MakeShaderDefines(BackendType::OpenGL44, layout, _defines);
+
+	std::vector<std::shared_future<CompiledShader>> result = {
+		CompileShaderAsync(ShaderStage::Vertex, ShaderTarget::Glsl, vertex_code, defines)
+	};
+
+	if (!fragment_code.empty())
+		result.push_back(CompileShaderAsync(ShaderStage::Fragment, ShaderTarget::Glsl, fragment_code, defines));
+
+	return result;
+}
+#endif
+
 void BackendGL44::prepareForDrawing()
 {
 	// opengl crashes when index or vertex buffers are binded before VAO from shader classes 
@@ -753,6 +1514,13 @@ void BackendGL44::prepareForDrawing()
 		mVertexBufferDirty = false;
 	}
 
+	if (mBufferBindingsDirty)
+	{
+		glBindVertexBuffer(0, GLBoundVertexBuffer, GLBoundVertexOffset, GLBoundVertexStride);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GLBoundIndexBuffer);
+		mBufferBindingsDirty = false;
+	}
+
 	if (mTexParametersDirty)
 	{
 		refreshTexParameters();
@@ -784,51 +1552,59 @@ void BackendGL44::prepareForDrawing()
 			(GLint)viewport.size.y);
 
 		glDepthRange((GLclampd)viewport.min_depth, (GLclampd)viewport.max_depth);
-
 	}
-}
-
-void BackendGL44::setInternalVertexBuffer(const Buffer& value)
-{
-	glBindBuffer(GL_ARRAY_BUFFER, GLVertexBuffer);
 
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+	// without fragment stage colors are undefined, so they are not written at all
+	bool disable_color_writes = GLCurrentShader != nullptr && !GLCurrentShader->hasFragmentStage();
 
-	if ((size_t)size < value.size)
+	if (disable_color_writes != GLColorWritesDisabled)
 	{
-		glBufferData(GL_ARRAY_BUFFER, value.size, value.data, GL_DYNAMIC_DRAW);
+		if (disable_color_writes)
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		else
+			glColorMask(GLColorMask.red, GLColorMask.green, GLColorMask.blue, GLColorMask.alpha);
+
+		GLColorWritesDisabled = disable_color_writes;
 	}
-	else
+
+	if (GLCurrentShader != nullptr)
 	{
-		auto ptr = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-		memcpy(ptr, value.data, value.size);
-		glUnmapBuffer(GL_ARRAY_BUFFER);
-	}
+		for (const auto& descriptor_set : GLCurrentShader->getReflection().descriptor_sets)
+		{
+			if (descriptor_set.type != ShaderReflection::DescriptorSet::Type::UniformBuffer)
+				continue;
 
-	glBindVertexBuffer(0, GLVertexBuffer, 0, (GLsizei)value.stride);
-}
+			auto it = GLUniformBuffers.find((uint32_t)descriptor_set.binding);
 
-void BackendGL44::setInternalIndexBuffer(const Buffer& value)
-{
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GLIndexBuffer);
+			if (it == GLUniformBuffers.end())
+				continue;
 
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+			auto& uniform_buffer = it->second;
 
-	if ((size_t)size < value.size)
-	{
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, value.size, value.data, GL_DYNAMIC_DRAW);
-	}
-	else
-	{
-		auto ptr = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-		memcpy(ptr, value.data, value.size);
-		glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+			CheckUniformBufferSize(descriptor_set, uniform_buffer.data.size());
 
+			auto size = (size_t)descriptor_set.size;
+
+			if (uniform_buffer.written_size < size)
+				WriteUniformBuffer(it->first, uniform_buffer, size);
+		}
 	}
+}
 
+void BackendGL44::setInternalVertexBuffer(const Buffer& value)
+{
+	GLBoundVertexOffset = (GLintptr)WriteStreamData(value.data, value.size, StreamDataAlignment);
+	GLBoundVertexBuffer = GLStreamBuffer.buffer;
+	GLBoundVertexStride = (GLsizei)value.stride;
+	mBufferBindingsDirty = true;
+}
+
+void BackendGL44::setInternalIndexBuffer(const Buffer& value)
+{
+	GLBoundIndexOffset = WriteStreamData(value.data, value.size, StreamDataAlignment);
+	GLBoundIndexBuffer = GLStreamBuffer.buffer;
 	GLIndexType = value.stride == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	mBufferBindingsDirty = true;
 }
 
 void BackendGL44::refreshTexParameters()
@@ -868,4 +1644,13 @@ void BackendGL44::refreshTexParameters()
 	}
 }
 
+#else
+
+#include <stdexcept>
+
+std::vector<uint8_t> skygfx::ReadGL44BackendOffscreenFrame()
+{
+	throw std::runtime_error("opengl backend is not built");
+}
+
 #endif
\ No newline at end of file
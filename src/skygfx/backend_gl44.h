@@ -1,9 +1,16 @@
 #pragma once
 
-#ifdef SKYGFX_HAS_OPENGL
-
 #include "backend.h"
 
+namespace skygfx
+{
+	// rgba8, top row first, available when the device was created without window.
+	// throws when the library is built without the opengl backend
+	std::vector<uint8_t> ReadGL44BackendOffscreenFrame();
+}
+
+#ifdef SKYGFX_HAS_OPENGL
+
 namespace skygfx
 {
 	class BackendGL44 : public Backend
@@ -23,6 +30,8 @@ namespace skygfx
 		void setShader(ShaderHandle* handle) override;
 		void setVertexBuffer(const Buffer& buffer) override;
 		void setIndexBuffer(const Buffer& buffer) override;
+		void setVertexBuffer(VertexBufferHandle* handle) override;
+		void setIndexBuffer(IndexBufferHandle* handle) override;
 		void setUniformBuffer(uint32_t slot, void* memory, size_t size) override;
 		void setBlendMode(const BlendMode& value) override;
 		void setDepthMode(std::optional<DepthMode> depth_mode) override;
@@ -40,6 +49,10 @@ namespace skygfx
 
 		void present() override;
 
+		void beginTimer(const std::string& name) override;
+		void endTimer() override;
+		const std::vector<GpuTimer>& getGpuTimers() override;
+
 		TextureHandle* createTexture(uint32_t width, uint32_t height, uint32_t channels, 
 			void* memory, bool mipmap) override;
 		void destroyTexture(TextureHandle* handle) override;
@@ -47,9 +60,23 @@ namespace skygfx
 		RenderTargetHandle* createRenderTarget(uint32_t width, uint32_t height, TextureHandle* texture) override;
 		void destroyRenderTarget(RenderTargetHandle* handle) override;
 
+		VertexBufferHandle* createVertexBuffer(void* memory, size_t size, size_t stride) override;
+		void destroyVertexBuffer(VertexBufferHandle* handle) override;
+		IndexBufferHandle* createIndexBuffer(void* memory, size_t size, size_t stride) override;
+		void destroyIndexBuffer(IndexBufferHandle* handle) override;
+
+#ifdef SKYGFX_RUNTIME_COMPILER
 		ShaderHandle* createShader(const Vertex::Layout& layout, const std::string& vertex_code, 
-			const std::string& fragment_code, const std::vector<std::string>& defines) override;
+			const std::string& fragment_code, const std::vector<std::string>& defines,
+			const SpecializationConstants& specialization_constants) override;
+#endif
+		ShaderHandle* createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+			const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants) override;
 		void destroyShader(ShaderHandle* handle) override;
+#ifdef SKYGFX_RUNTIME_COMPILER
+		std::vector<std::shared_future<CompiledShader>> compileShaderAsync(const Vertex::Layout& layout,
+			const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& defines) override;
+#endif
 
 	private:
 		void prepareForDrawing();
@@ -61,10 +88,13 @@ namespace skygfx
 	private:
 		bool mVertexBufferDirty = false;
 		bool mIndexBufferDirty = false;
+		bool mBufferBindingsDirty = false;
 		bool mTexParametersDirty = true;
 		bool mViewportDirty = true;
-		Buffer mVertexBuffer;
-		Buffer mIndexBuffer;
+		Buffer mVertexBuffer; // points to mVertexBufferData
+		Buffer mIndexBuffer; // points to mIndexBufferData
+		std::vector<uint8_t> mVertexBufferData; // empty when a vertex buffer handle is set
+		std::vector<uint8_t> mIndexBufferData; // empty when an index buffer handle is set
 		Sampler mSampler = Sampler::Linear;
 		TextureAddress mTextureAddress = TextureAddress::Wrap;
 		std::unordered_map<uint32_t, TextureHandle*> mCurrentTextures;
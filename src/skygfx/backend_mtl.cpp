@@ -1,4 +1,6 @@
 #include "backend_mtl.h"
+#include "shader_cache.h"
+#include "trace.h"
 
 #ifdef SKYGFX_HAS_METAL
 
@@ -24,11 +26,14 @@ static MTL::RenderPassDescriptor* gRenderPassDescriptor = nullptr;
 static MTL::RenderCommandEncoder* gRenderCommandEncoder = nullptr;
 static MTL::PrimitiveType gPrimitiveType = MTL::PrimitiveType::PrimitiveTypeTriangle;
 static MTL::IndexType gIndexType = MTL::IndexType::IndexTypeUInt16;
-static MTL::Buffer* gIndexBuffer = nullptr;
+static MTL::Buffer* gIndexBuffer = nullptr; // dynamic or one of IndexBufferHandle
+static MTL::Buffer* gDynamicIndexBuffer = nullptr;
 static Buffer gVertexBuffer;
+static MTL::Buffer* gStaticVertexBuffer = nullptr; // when set, gVertexBuffer is not used
 static MTL::Texture* gTexture = nullptr;
 static MTL::SamplerState* gSamplerState = nullptr;
 static std::unordered_map<int, MTL::Buffer*> gUniformBuffers;
+static std::unordered_map<int, size_t> gUniformBufferSizes; // buffers can be longer than the data
 static CullMode gCullMode = CullMode::None;
 static const uint32_t gVertexBufferStageBinding = 30;
 
@@ -42,39 +47,39 @@ class ShaderDataMetal
 	
 private:
 	MTL::Library* vert_library = nullptr;
-	MTL::Library* frag_library = nullptr;
+	MTL::Library* frag_library = nullptr; // null without fragment stage
 	MTL::RenderPipelineState* pso = nullptr;
+	ShaderReflection reflection;
 	
 public:
-	ShaderDataMetal(const Vertex::Layout& layout, const std::string& vertex_code, const std::string& fragment_code,
-		std::vector<std::string> defines)
+	// empty msl_frag makes a depth-only pipeline
+	ShaderDataMetal(const Vertex::Layout& layout, std::string_view msl_vert, std::string_view msl_frag,
+		const ShaderReflection& _reflection) : reflection(_reflection)
 	{
-		AddShaderLocationDefines(layout, defines);
-
-		auto vertex_shader_spirv = CompileGlslToSpirv(ShaderStage::Vertex, vertex_code, defines);
-		auto fragment_shader_spirv = CompileGlslToSpirv(ShaderStage::Fragment, fragment_code, defines);
-
-		auto msl_vert = CompileSpirvToMsl(vertex_shader_spirv);
-		auto msl_frag = CompileSpirvToMsl(fragment_shader_spirv);
-		
 		NS::Error* error = nullptr;
 		
-		vert_library = gDevice->newLibrary(NS::String::string(msl_vert.c_str(), NS::StringEncoding::UTF8StringEncoding), nullptr, &error);
+		vert_library = gDevice->newLibrary(NS::String::string(msl_vert.data(), NS::StringEncoding::UTF8StringEncoding), nullptr, &error);
 		if (!vert_library)
 		{
 			auto reason = error->localizedDescription()->utf8String();
 			throw std::runtime_error(reason);
 		}
 
-		frag_library = gDevice->newLibrary(NS::String::string(msl_frag.c_str(), NS::StringEncoding::UTF8StringEncoding), nullptr, &error);
-		if (!frag_library)
+		if (!msl_frag.empty())
 		{
-			auto reason = error->localizedDescription()->utf8String();
-			throw std::runtime_error(reason);
+			frag_library = gDevice->newLibrary(NS::String::string(msl_frag.data(), NS::StringEncoding::UTF8StringEncoding), nullptr, &error);
+			if (!frag_library)
+			{
+				auto reason = error->localizedDescription()->utf8String();
+				throw std::runtime_error(reason);
+			}
 		}
 
 		auto vert_fn = vert_library->newFunction(NS::String::string("main0", NS::StringEncoding::UTF8StringEncoding));
-		auto frag_fn = frag_library->newFunction(NS::String::string("main0", NS::StringEncoding::UTF8StringEncoding));
+		MTL::Function* frag_fn = nullptr;
+
+		if (frag_library)
+			frag_fn = frag_library->newFunction(NS::String::string("main0", NS::StringEncoding::UTF8StringEncoding));
 
 		static const std::unordered_map<Vertex::Attribute::Format, MTL::VertexFormat> Format = {
 			{ Vertex::Attribute::Format::R32F, MTL::VertexFormat::VertexFormatFloat },
@@ -89,7 +94,7 @@ public:
 
 		auto vertex_descriptor = MTL::VertexDescriptor::alloc()->init();
 		
-		for (int i = 0; i < layout.attributes.size(); i++)
+		for (auto i : GetUsedVertexAttributes(layout, reflection))
 		{
 			const auto& attrib = layout.attributes.at(i);
 			auto desc = vertex_descriptor->attributes()->object(i);
@@ -108,6 +113,9 @@ public:
 		desc->setFragmentFunction(frag_fn);
 		desc->setVertexDescriptor(vertex_descriptor);
 		desc->colorAttachments()->object(0)->setPixelFormat(MTL::PixelFormat::PixelFormatBGRA8Unorm_sRGB);
+
+		if (!frag_fn)
+			desc->colorAttachments()->object(0)->setWriteMask(MTL::ColorWriteMaskNone);
 		//desc->setDepthAttachmentPixelFormat(MTL::PixelFormat::PixelFormatDepth16Unorm);
 		desc->setVertexDescriptor(vertex_descriptor);
 		
@@ -120,7 +128,9 @@ public:
 
 		vertex_descriptor->release();
 		vert_fn->release();
-		frag_fn->release();
+
+		if (frag_fn)
+			frag_fn->release();
 		desc->release();
 	}
 
@@ -128,7 +138,9 @@ public:
 	{
 		pso->release();
 		vert_library->release();
-		frag_library->release();
+
+		if (frag_library)
+			frag_library->release();
 	}
 };
 
@@ -180,6 +192,27 @@ public:
 	}
 };
 
+class BufferDataMetal
+{
+	friend class BackendMetal;
+
+private:
+	MTL::Buffer* buffer = nullptr;
+	size_t stride;
+
+public:
+	BufferDataMetal(void* memory, size_t size, size_t _stride) :
+		stride(_stride)
+	{
+		buffer = gDevice->newBuffer(memory, size, MTL::ResourceStorageModeManaged);
+	}
+
+	~BufferDataMetal()
+	{
+		buffer->release();
+	}
+};
+
 class RenderTargetDataMetal
 {
 public:
@@ -246,6 +279,9 @@ BackendMetal::~BackendMetal()
 	{
 		buffer->release();
 	}
+
+	gUniformBuffers.clear();
+	gUniformBufferSizes.clear();
 	
 	gSamplerState->release();
 	gCommandQueue->release();
@@ -306,27 +342,42 @@ void BackendMetal::setShader(ShaderHandle* handle)
 void BackendMetal::setVertexBuffer(const Buffer& buffer)
 {
 	gVertexBuffer = buffer;
+	gStaticVertexBuffer = nullptr;
 }
 
 void BackendMetal::setIndexBuffer(const Buffer& buffer)
 {
-	if (gIndexBuffer == nullptr)
+	if (gDynamicIndexBuffer == nullptr)
 	{
-		gIndexBuffer = gDevice->newBuffer(buffer.size, MTL::ResourceStorageModeManaged);
+		gDynamicIndexBuffer = gDevice->newBuffer(buffer.size, MTL::ResourceStorageModeManaged);
 	}
 	
-	if (gIndexBuffer->length() < buffer.size)
+	if (gDynamicIndexBuffer->length() < buffer.size)
 	{
-		gIndexBuffer->release();
-		gIndexBuffer = gDevice->newBuffer(buffer.size, MTL::ResourceStorageModeManaged);
+		gDynamicIndexBuffer->release();
+		gDynamicIndexBuffer = gDevice->newBuffer(buffer.size, MTL::ResourceStorageModeManaged);
 	}
 
-	memcpy(gIndexBuffer->contents(), buffer.data, buffer.size);
-	gIndexBuffer->didModifyRange(NS::Range::Make(0, buffer.size));
+	memcpy(gDynamicIndexBuffer->contents(), buffer.data, buffer.size);
+	gDynamicIndexBuffer->didModifyRange(NS::Range::Make(0, buffer.size));
 
+	gIndexBuffer = gDynamicIndexBuffer;
 	gIndexType = buffer.stride == 2 ? MTL::IndexType::IndexTypeUInt16 : MTL::IndexType::IndexTypeUInt32;
 }
 
+void BackendMetal::setVertexBuffer(VertexBufferHandle* handle)
+{
+	auto buffer = (BufferDataMetal*)handle;
+	gStaticVertexBuffer = buffer->buffer;
+}
+
+void BackendMetal::setIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataMetal*)handle;
+	gIndexBuffer = buffer->buffer;
+	gIndexType = buffer->stride == 2 ? MTL::IndexType::IndexTypeUInt16 : MTL::IndexType::IndexTypeUInt32;
+}
+
 void BackendMetal::setUniformBuffer(int slot, void* memory, size_t size)
 {
 	auto createBuffer = [&] {
@@ -347,6 +398,8 @@ void BackendMetal::setUniformBuffer(int slot, void* memory, size_t size)
 		gUniformBuffers[slot] = uniform_buffer;
 	}
 
+	gUniformBufferSizes[slot] = size;
+
 	memcpy(uniform_buffer->contents(), memory, size);
 	uniform_buffer->didModifyRange(NS::Range::Make(0, size));
 }
@@ -409,8 +462,25 @@ void BackendMetal::present()
 	begin();
 }
 
+void BackendMetal::beginTimer(const std::string& name)
+{
+	// TODO: MTLCounterSampleBuffer
+}
+
+void BackendMetal::endTimer()
+{
+}
+
+const std::vector<GpuTimer>& BackendMetal::getGpuTimers()
+{
+	static const std::vector<GpuTimer> timers;
+	return timers;
+}
+
 TextureHandle* BackendMetal::createTexture(uint32_t width, uint32_t height, uint32_t channels, void* memory, bool mipmap)
 {
+	SKYGFX_TRACE_SCOPE("BackendMetal::createTexture");
+
 	auto texture = new TextureDataMetal(width, height, channels, memory, mipmap);
 	return (TextureHandle*)texture;
 }
@@ -434,10 +504,67 @@ void BackendMetal::destroyRenderTarget(RenderTargetHandle* handle)
 	delete render_target;
 }
 
+VertexBufferHandle* BackendMetal::createVertexBuffer(void* memory, size_t size, size_t stride)
+{
+	auto buffer = new BufferDataMetal(memory, size, stride);
+	return (VertexBufferHandle*)buffer;
+}
+
+void BackendMetal::destroyVertexBuffer(VertexBufferHandle* handle)
+{
+	auto buffer = (BufferDataMetal*)handle;
+
+	if (gStaticVertexBuffer == buffer->buffer)
+		gStaticVertexBuffer = nullptr;
+
+	delete buffer;
+}
+
+IndexBufferHandle* BackendMetal::createIndexBuffer(void* memory, size_t size, size_t stride)
+{
+	auto buffer = new BufferDataMetal(memory, size, stride);
+	return (IndexBufferHandle*)buffer;
+}
+
+void BackendMetal::destroyIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataMetal*)handle;
+
+	if (gIndexBuffer == buffer->buffer)
+		gIndexBuffer = nullptr;
+
+	delete buffer;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
 ShaderHandle* BackendMetal::createShader(const Vertex::Layout& layout, const std::string& vertex_code,
-	const std::string& fragment_code, const std::vector<std::string>& defines)
+	const std::string& fragment_code, const std::vector<std::string>& defines,
+	const SpecializationConstants& specialization_constants)
 {
-	auto shader = new ShaderDataMetal(layout, vertex_code, fragment_code, defines);
+	SKYGFX_TRACE_SCOPE("BackendMetal::createShader");
+
+	auto shader_defines = MakeShaderDefines(BackendType::Metal, layout, defines);
+	auto vertex_shader = CompileShader(ShaderStage::Vertex, ShaderTarget::Msl, vertex_code, shader_defines);
+	auto fragment_shader = fragment_code.empty() ? CompiledShader() :
+		CompileShader(ShaderStage::Fragment, ShaderTarget::Msl, fragment_code, shader_defines);
+
+	return createShader(layout, vertex_shader, fragment_shader, specialization_constants);
+}
+#endif
+
+ShaderHandle* BackendMetal::createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+	const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants)
+{
+	if (!specialization_constants.empty())
+	{
+		auto vertex_shader = SpecializeShader(vertex, ShaderTarget::Msl, specialization_constants);
+		auto fragment_shader = fragment.spirv.empty() ? CompiledShader() :
+			SpecializeShader(fragment, ShaderTarget::Msl, specialization_constants);
+
+		return createShader(layout, vertex_shader, fragment_shader, {});
+	}
+
+	auto shader = new ShaderDataMetal(layout, vertex.source, fragment.source, MergeShaderReflections(vertex, fragment));
 	return (ShaderHandle*)shader;
 }
 
@@ -447,6 +574,23 @@ void BackendMetal::destroyShader(ShaderHandle* handle)
 	delete shader;
 }
 
+#ifdef SKYGFX_RUNTIME_COMPILER
+std::vector<std::shared_future<CompiledShader>> BackendMetal::compileShaderAsync(const Vertex::Layout& layout,
+	const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& _defines)
+{
+	auto defines = MakeShaderDefines(BackendType::Metal, layout, _defines);
+
+	std::vector<std::shared_future<CompiledShader>> result = {
+		CompileShaderAsync(ShaderStage::Vertex, ShaderTarget::Msl, vertex_code, defines)
+	};
+
+	if (!fragment_code.empty())
+		result.push_back(CompileShaderAsync(ShaderStage::Fragment, ShaderTarget::Msl, fragment_code, defines));
+
+	return result;
+}
+#endif
+
 void BackendMetal::prepareForDrawing()
 {
 	if (gTexture)
@@ -459,9 +603,21 @@ void BackendMetal::prepareForDrawing()
 		gRenderCommandEncoder->setFragmentSamplerState(gSamplerState, 0);
 	}
 	
-	gRenderCommandEncoder->setVertexBytes(gVertexBuffer.data, gVertexBuffer.size, gVertexBufferStageBinding);
+	if (gStaticVertexBuffer)
+		gRenderCommandEncoder->setVertexBuffer(gStaticVertexBuffer, 0, gVertexBufferStageBinding);
+	else
+		gRenderCommandEncoder->setVertexBytes(gVertexBuffer.data, gVertexBuffer.size, gVertexBufferStageBinding);
 	gRenderCommandEncoder->setRenderPipelineState(gShader->pso);
 
+	for (const auto& descriptor_set : gShader->reflection.descriptor_sets)
+	{
+		if (descriptor_set.type != ShaderReflection::DescriptorSet::Type::UniformBuffer)
+			continue;
+
+		if (gUniformBufferSizes.contains(descriptor_set.binding))
+			CheckUniformBufferSize(descriptor_set, gUniformBufferSizes.at(descriptor_set.binding));
+	}
+
 	for (auto [slot, buffer] : gUniformBuffers)
 	{
 		gRenderCommandEncoder->setVertexBuffer(buffer, 0, slot);
@@ -24,6 +24,8 @@ namespace skygfx
 		void setShader(ShaderHandle* handle) override;
 		void setVertexBuffer(const Buffer& buffer) override;
 		void setIndexBuffer(const Buffer& buffer) override;
+		void setVertexBuffer(VertexBufferHandle* handle) override;
+		void setIndexBuffer(IndexBufferHandle* handle) override;
 		void setUniformBuffer(int slot, void* memory, size_t size) override;
 		void setBlendMode(const BlendMode& value) override;
 		void setDepthMode(const DepthMode& value) override;
@@ -41,6 +43,10 @@ namespace skygfx
 
 		void present() override;
 
+		void beginTimer(const std::string& name) override;
+		void endTimer() override;
+		const std::vector<GpuTimer>& getGpuTimers() override;
+
 		TextureHandle* createTexture(uint32_t width, uint32_t height, uint32_t channels, 
 			void* memory, bool mipmap) override;
 		void destroyTexture(TextureHandle* handle) override;
@@ -48,9 +54,23 @@ namespace skygfx
 		RenderTargetHandle* createRenderTarget(uint32_t width, uint32_t height, TextureHandle* texture) override;
 		void destroyRenderTarget(RenderTargetHandle* handle) override;
 
+		VertexBufferHandle* createVertexBuffer(void* memory, size_t size, size_t stride) override;
+		void destroyVertexBuffer(VertexBufferHandle* handle) override;
+		IndexBufferHandle* createIndexBuffer(void* memory, size_t size, size_t stride) override;
+		void destroyIndexBuffer(IndexBufferHandle* handle) override;
+
+#ifdef SKYGFX_RUNTIME_COMPILER
 		ShaderHandle* createShader(const Vertex::Layout& layout, const std::string& vertex_code, 
-			const std::string& fragment_code, const std::vector<std::string>& defines) override;
+			const std::string& fragment_code, const std::vector<std::string>& defines,
+			const SpecializationConstants& specialization_constants) override;
+#endif
+		ShaderHandle* createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+			const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants) override;
 		void destroyShader(ShaderHandle* handle) override;
+#ifdef SKYGFX_RUNTIME_COMPILER
+		std::vector<std::shared_future<CompiledShader>> compileShaderAsync(const Vertex::Layout& layout,
+			const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& defines) override;
+#endif
 		
 	private:
 		void prepareForDrawing();
@@ -0,0 +1,353 @@
+#include "backend_null.h"
+
+using namespace skygfx;
+
+struct TextureDataNull
+{
+	uint32_t width;
+	uint32_t height;
+};
+
+struct RenderTargetDataNull
+{
+	uint32_t width;
+	uint32_t height;
+};
+
+struct ShaderDataNull
+{
+	Vertex::Layout layout;
+};
+
+struct BufferDataNull
+{
+	size_t size;
+	size_t stride;
+};
+
+static NullBackendCounters gCounters;
+static NullBackendCounters gLastFrameCounters;
+static bool gCommandLogEnabled = false;
+static std::vector<NullBackendCommand> gCommandLog;
+static std::vector<NullBackendCommand> gLastFrameCommandLog;
+static std::vector<GpuTimer> gFrameTimers;
+static std::vector<GpuTimer> gGpuTimers;
+
+static void Log(NullBackendCommandType type, uint64_t arg0 = 0, uint64_t arg1 = 0)
+{
+	if (!gCommandLogEnabled)
+		return;
+
+	gCommandLog.push_back({ type, arg0, arg1 });
+}
+
+const NullBackendCounters& skygfx::GetNullBackendCounters()
+{
+	return gLastFrameCounters;
+}
+
+void skygfx::SetNullBackendCommandLogEnabled(bool value)
+{
+	gCommandLogEnabled = value;
+	gCommandLog.clear();
+	gLastFrameCommandLog.clear();
+}
+
+const std::vector<NullBackendCommand>& skygfx::GetNullBackendCommandLog()
+{
+	return gLastFrameCommandLog;
+}
+
+BackendNull::BackendNull(void* window, uint32_t width, uint32_t height)
+{
+	gCounters = NullBackendCounters();
+	gLastFrameCounters = NullBackendCounters();
+	gCommandLog.clear();
+	gLastFrameCommandLog.clear();
+	gFrameTimers.clear();
+	gGpuTimers.clear();
+}
+
+BackendNull::~BackendNull()
+{
+}
+
+void BackendNull::resize(uint32_t width, uint32_t height)
+{
+	Log(NullBackendCommandType::Resize, width, height);
+}
+
+void BackendNull::setTopology(Topology topology)
+{
+	gCounters.state_changes += 1;
+	Log(NullBackendCommandType::SetTopology, (uint64_t)topology);
+}
+
+void BackendNull::setViewport(std::optional<Viewport> viewport)
+{
+	gCounters.state_changes += 1;
+	Log(NullBackendCommandType::SetViewport, viewport.has_value());
+}
+
+void BackendNull::setScissor(std::optional<Scissor> scissor)
+{
+	gCounters.state_changes += 1;
+	Log(NullBackendCommandType::SetScissor, scissor.has_value());
+}
+
+void BackendNull::setTexture(TextureHandle* handle, uint32_t slot)
+{
+	gCounters.texture_changes += 1;
+	Log(NullBackendCommandType::SetTexture, slot);
+}
+
+void BackendNull::setRenderTarget(RenderTargetHandle* handle)
+{
+	gCounters.render_target_changes += 1;
+	Log(NullBackendCommandType::SetRenderTarget, 1);
+}
+
+void BackendNull::setRenderTarget(std::nullptr_t value)
+{
+	gCounters.render_target_changes += 1;
+	Log(NullBackendCommandType::SetRenderTarget, 0);
+}
+
+void BackendNull::setShader(ShaderHandle* handle)
+{
+	gCounters.shader_changes += 1;
+	Log(NullBackendCommandType::SetShader);
+}
+
+void BackendNull::setVertexBuffer(const Buffer& buffer)
+{
+	gCounters.vertex_buffer_uploads += 1;
+	gCounters.vertex_buffer_bytes += buffer.size;
+	Log(NullBackendCommandType::SetVertexBuffer, buffer.size, buffer.stride);
+}
+
+void BackendNull::setIndexBuffer(const Buffer& buffer)
+{
+	gCounters.index_buffer_uploads += 1;
+	gCounters.index_buffer_bytes += buffer.size;
+	Log(NullBackendCommandType::SetIndexBuffer, buffer.size, buffer.stride);
+}
+
+void BackendNull::setVertexBuffer(VertexBufferHandle* handle)
+{
+	auto buffer = (BufferDataNull*)handle;
+	Log(NullBackendCommandType::SetVertexBuffer, 0, buffer->stride); // nothing is uploaded
+}
+
+void BackendNull::setIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataNull*)handle;
+	Log(NullBackendCommandType::SetIndexBuffer, 0, buffer->stride);
+}
+
+void BackendNull::setUniformBuffer(uint32_t slot, void* memory, size_t size)
+{
+	gCounters.uniform_buffer_uploads += 1;
+	gCounters.uniform_buffer_bytes += size;
+	Log(NullBackendCommandType::SetUniformBuffer, slot, size);
+}
+
+void BackendNull::setBlendMode(const BlendMode& value)
+{
+	gCounters.state_changes += 1;
+	Log(NullBackendCommandType::SetBlendMode);
+}
+
+void BackendNull::setDepthMode(std::optional<DepthMode> depth_mode)
+{
+	gCounters.state_changes += 1;
+	Log(NullBackendCommandType::SetDepthMode, depth_mode.has_value());
+}
+
+void BackendNull::setStencilMode(std::optional<StencilMode> stencil_mode)
+{
+	gCounters.state_changes += 1;
+	Log(NullBackendCommandType::SetStencilMode, stencil_mode.has_value());
+}
+
+void BackendNull::setCullMode(CullMode cull_mode)
+{
+	gCounters.state_changes += 1;
+	Log(NullBackendCommandType::SetCullMode, (uint64_t)cull_mode);
+}
+
+void BackendNull::setSampler(const Sampler& value)
+{
+	gCounters.state_changes += 1;
+	Log(NullBackendCommandType::SetSampler, (uint64_t)value);
+}
+
+void BackendNull::setTextureAddressMode(const TextureAddress& value)
+{
+	gCounters.state_changes += 1;
+	Log(NullBackendCommandType::SetTextureAddressMode, (uint64_t)value);
+}
+
+void BackendNull::clear(const std::optional<glm::vec4>& color, const std::optional<float>& depth,
+	const std::optional<uint8_t>& stencil)
+{
+	gCounters.clears += 1;
+	Log(NullBackendCommandType::Clear);
+}
+
+void BackendNull::draw(uint32_t vertex_count, uint32_t vertex_offset)
+{
+	gCounters.draw_calls += 1;
+	gCounters.vertices += vertex_count;
+	Log(NullBackendCommandType::Draw, vertex_count, vertex_offset);
+}
+
+void BackendNull::drawIndexed(uint32_t index_count, uint32_t index_offset)
+{
+	gCounters.draw_indexed_calls += 1;
+	gCounters.indices += index_count;
+	Log(NullBackendCommandType::DrawIndexed, index_count, index_offset);
+}
+
+void BackendNull::readPixels(const glm::ivec2& pos, const glm::ivec2& size, TextureHandle* dst_texture_handle)
+{
+	Log(NullBackendCommandType::ReadPixels, size.x, size.y);
+}
+
+void BackendNull::present()
+{
+	Log(NullBackendCommandType::Present);
+
+	gCounters.frame += 1;
+	gLastFrameCounters = gCounters;
+	gCounters = NullBackendCounters();
+	gCounters.frame = gLastFrameCounters.frame;
+
+	std::swap(gLastFrameCommandLog, gCommandLog);
+	gCommandLog.clear();
+
+	std::swap(gGpuTimers, gFrameTimers);
+	gFrameTimers.clear();
+}
+
+void BackendNull::beginTimer(const std::string& name)
+{
+	// there is no gpu, timers are reported with zero time so the calling code can be exercised
+	gFrameTimers.push_back({ name });
+}
+
+void BackendNull::endTimer()
+{
+}
+
+const std::vector<GpuTimer>& BackendNull::getGpuTimers()
+{
+	return gGpuTimers;
+}
+
+TextureHandle* BackendNull::createTexture(uint32_t width, uint32_t height, uint32_t channels, void* memory, bool mipmap)
+{
+	gCounters.textures_created += 1;
+	Log(NullBackendCommandType::CreateTexture, width, height);
+
+	auto texture = new TextureDataNull{ width, height };
+	return (TextureHandle*)texture;
+}
+
+void BackendNull::destroyTexture(TextureHandle* handle)
+{
+	Log(NullBackendCommandType::DestroyTexture);
+
+	auto texture = (TextureDataNull*)handle;
+	delete texture;
+}
+
+RenderTargetHandle* BackendNull::createRenderTarget(uint32_t width, uint32_t height, TextureHandle* texture_handle)
+{
+	gCounters.render_targets_created += 1;
+	Log(NullBackendCommandType::CreateRenderTarget, width, height);
+
+	auto render_target = new RenderTargetDataNull{ width, height };
+	return (RenderTargetHandle*)render_target;
+}
+
+void BackendNull::destroyRenderTarget(RenderTargetHandle* handle)
+{
+	Log(NullBackendCommandType::DestroyRenderTarget);
+
+	auto render_target = (RenderTargetDataNull*)handle;
+	delete render_target;
+}
+
+VertexBufferHandle* BackendNull::createVertexBuffer(void* memory, size_t size, size_t stride)
+{
+	gCounters.buffers_created += 1;
+	Log(NullBackendCommandType::CreateVertexBuffer, size, stride);
+
+	auto buffer = new BufferDataNull{ size, stride };
+	return (VertexBufferHandle*)buffer;
+}
+
+void BackendNull::destroyVertexBuffer(VertexBufferHandle* handle)
+{
+	Log(NullBackendCommandType::DestroyVertexBuffer);
+
+	auto buffer = (BufferDataNull*)handle;
+	delete buffer;
+}
+
+IndexBufferHandle* BackendNull::createIndexBuffer(void* memory, size_t size, size_t stride)
+{
+	gCounters.buffers_created += 1;
+	Log(NullBackendCommandType::CreateIndexBuffer, size, stride);
+
+	auto buffer = new BufferDataNull{ size, stride };
+	return (IndexBufferHandle*)buffer;
+}
+
+void BackendNull::destroyIndexBuffer(IndexBufferHandle* handle)
+{
+	Log(NullBackendCommandType::DestroyIndexBuffer);
+
+	auto buffer = (BufferDataNull*)handle;
+	delete buffer;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+ShaderHandle* BackendNull::createShader(const Vertex::Layout& layout, const std::string& vertex_code,
+	const std::string& fragment_code, const std::vector<std::string>& defines,
+	const SpecializationConstants& specialization_constants)
+{
+	gCounters.shaders_created += 1;
+	Log(NullBackendCommandType::CreateShader, vertex_code.size(), fragment_code.size());
+
+	auto shader = new ShaderDataNull{ layout };
+	return (ShaderHandle*)shader;
+}
+#endif
+
+ShaderHandle* BackendNull::createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+	const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants)
+{
+	gCounters.shaders_created += 1;
+	Log(NullBackendCommandType::CreateShader, vertex.spirv.size_bytes(), fragment.spirv.size_bytes());
+
+	auto shader = new ShaderDataNull{ layout };
+	return (ShaderHandle*)shader;
+}
+
+void BackendNull::destroyShader(ShaderHandle* handle)
+{
+	Log(NullBackendCommandType::DestroyShader);
+
+	auto shader = (ShaderDataNull*)handle;
+	delete shader;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+std::vector<std::shared_future<CompiledShader>> BackendNull::compileShaderAsync(const Vertex::Layout& layout,
+	const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& defines)
+{
+	return {}; // nothing is compiled
+}
+#endif
@@ -0,0 +1,2281 @@
+#include "backend_sw.h"
+#include "shader_cache.h"
+#include "shader_interpreter.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SKYGFX_SOFTWARE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SKYGFX_SOFTWARE_SSE2
+#endif
+
+using namespace skygfx;
+
+// the frame is split into tiles, triangles are binned into the tiles they touch and tiles are
+// rasterized in parallel. every tile processes its triangles in submission order, so the result
+// does not depend on the number of threads. pixels are shaded in 4x2 blocks, one block is one
+// batch of ShaderInterpreter lanes, made of two 2x2 quads for derivatives.
+
+static constexpr int TileSize = 64;
+static constexpr int BlockWidth = 4;
+static constexpr int BlockHeight = 2;
+static constexpr int SubpixelBits = 8;
+static constexpr int SubpixelScale = 1 << SubpixelBits;
+static constexpr uint32_t Lanes = ShaderInterpreter::Lanes;
+static constexpr uint32_t AllLanes = ShaderInterpreter::AllLanes;
+static constexpr uint32_t VertexHeader = 5; // clip position and point size, followed by fragment shader inputs
+static constexpr uint32_t VertexBatchesPerJob = 16;
+static constexpr uint32_t PrimitivesPerJob = 1024;
+
+static_assert(BlockWidth * BlockHeight == Lanes);
+
+// position of every lane inside a block, see ShaderInterpreter quad layout
+static const int32_t LaneX[Lanes] = { 0, 1, 0, 1, 2, 3, 2, 3 };
+static const int32_t LaneY[Lanes] = { 0, 0, 1, 1, 0, 0, 1, 1 };
+
+class WorkerPool
+{
+public:
+	WorkerPool()
+	{
+		auto count = std::max(std::thread::hardware_concurrency(), 1u);
+
+		for (uint32_t i = 1; i < count; i++)
+		{
+			mThreads.emplace_back([this, i] { work(i); });
+		}
+	}
+
+	~WorkerPool()
+	{
+		{
+			std::lock_guard lock(mMutex);
+			mShutdown = true;
+		}
+		mWakeCondition.notify_all();
+
+		for (auto& thread : mThreads)
+		{
+			thread.join();
+		}
+	}
+
+	uint32_t getWorkerCount() const { return (uint32_t)mThreads.size() + 1; }
+
+	// calls func(index, worker) for every index in [0, count), the calling thread is worker 0
+	void run(uint32_t count, const std::function<void(uint32_t, uint32_t)>& func)
+	{
+		if (count == 0)
+			return;
+
+		if (count == 1 || mThreads.empty())
+		{
+			for (uint32_t i = 0; i < count; i++)
+				func(i, 0);
+
+			return;
+		}
+
+		{
+			std::lock_guard lock(mMutex);
+			mFunc = &func;
+			mCount = count;
+			mNext = 0;
+			mBusy = (uint32_t)mThreads.size();
+			mGeneration += 1;
+		}
+		mWakeCondition.notify_all();
+
+		process(0);
+
+		std::unique_lock lock(mMutex);
+		mDoneCondition.wait(lock, [this] { return mBusy == 0; });
+		mFunc = nullptr;
+
+		if (mException)
+			std::rethrow_exception(std::exchange(mException, nullptr));
+	}
+
+private:
+	void work(uint32_t worker)
+	{
+		uint64_t generation = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock lock(mMutex);
+				mWakeCondition.wait(lock, [&] { return mShutdown || mGeneration != generation; });
+
+				if (mShutdown)
+					return;
+
+				generation = mGeneration;
+			}
+
+			process(worker);
+
+			{
+				std::lock_guard lock(mMutex);
+				mBusy -= 1;
+			}
+			mDoneCondition.notify_one();
+		}
+	}
+
+	void process(uint32_t worker)
+	{
+		while (true)
+		{
+			auto index = mNext.fetch_add(1);
+
+			if (index >= mCount)
+				break;
+
+			try
+			{
+				(*mFunc)(index, worker);
+			}
+			catch (...)
+			{
+				std::lock_guard lock(mMutex);
+				mException = std::current_exception();
+				mNext = mCount;
+			}
+		}
+	}
+
+private:
+	std::vector<std::thread> mThreads;
+	std::mutex mMutex;
+	std::condition_variable mWakeCondition;
+	std::condition_variable mDoneCondition;
+	const std::function<void(uint32_t, uint32_t)>* mFunc = nullptr;
+	std::atomic<uint32_t> mNext = 0;
+	uint32_t mCount = 0;
+	uint32_t mBusy = 0;
+	uint64_t mGeneration = 0;
+	bool mShutdown = false;
+	std::exception_ptr mException;
+};
+
+struct TextureDataSoftware
+{
+	struct Level
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<uint32_t> pixels; // rgba8
+	};
+
+	uint32_t width;
+	uint32_t height;
+	bool mipmap;
+	std::vector<Level> levels;
+
+	TextureDataSoftware(uint32_t _width, uint32_t _height, uint32_t channels, void* memory, bool _mipmap) :
+		width(_width),
+		height(_height),
+		mipmap(_mipmap)
+	{
+		auto& level = levels.emplace_back();
+		level.width = width;
+		level.height = height;
+		level.pixels.resize(width * height, 0);
+
+		if (memory == nullptr)
+			return;
+
+		auto src = (const uint8_t*)memory;
+
+		for (uint32_t i = 0; i < width * height; i++)
+		{
+			uint8_t rgba[4] = { 0, 0, 0, 255 };
+
+			for (uint32_t c = 0; c < std::min(channels, 4u); c++)
+				rgba[c] = src[(i * channels) + c];
+
+			memcpy(&level.pixels[i], rgba, 4);
+		}
+
+		generateMips();
+	}
+
+	void generateMips()
+	{
+		if (!mipmap)
+			return;
+
+		levels.resize(1);
+
+		while (levels.back().width > 1 || levels.back().height > 1)
+		{
+			const auto& src = levels.back();
+			Level dst;
+			dst.width = std::max(src.width / 2, 1u);
+			dst.height = std::max(src.height / 2, 1u);
+			dst.pixels.resize(dst.width * dst.height);
+
+			for (uint32_t y = 0; y < dst.height; y++)
+			{
+				for (uint32_t x = 0; x < dst.width; x++)
+				{
+					auto x0 = std::min(x * 2, src.width - 1);
+					auto x1 = std::min((x * 2) + 1, src.width - 1);
+					auto y0 = std::min(y * 2, src.height - 1);
+					auto y1 = std::min((y * 2) + 1, src.height - 1);
+
+					const uint8_t* texels[4] = {
+						(const uint8_t*)&src.pixels[(y0 * src.width) + x0],
+						(const uint8_t*)&src.pixels[(y0 * src.width) + x1],
+						(const uint8_t*)&src.pixels[(y1 * src.width) + x0],
+						(const uint8_t*)&src.pixels[(y1 * src.width) + x1]
+					};
+
+					uint8_t result[4];
+
+					for (uint32_t c = 0; c < 4; c++)
+						result[c] = (uint8_t)((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+
+					memcpy(&dst.pixels[(y * dst.width) + x], result, 4);
+				}
+			}
+
+			levels.push_back(std::move(dst));
+		}
+	}
+};
+
+struct RenderTargetDataSoftware
+{
+	uint32_t width;
+	uint32_t height;
+	TextureDataSoftware* texture;
+	std::vector<float> depth;
+	std::vector<uint8_t> stencil;
+};
+
+struct BufferDataSoftware
+{
+	std::vector<uint8_t> memory;
+	size_t stride;
+};
+
+struct ShaderDataSoftware
+{
+	struct Input
+	{
+		uint32_t vertex_reg; // vertex shader output register, ~0u when the vertex shader does not write it
+		uint32_t fragment_reg;
+		bool flat;
+		bool no_perspective;
+	};
+
+	Vertex::Layout layout;
+	std::unique_ptr<ShaderInterpreter> vertex_shader;
+	std::unique_ptr<ShaderInterpreter> fragment_shader; // null without fragment stage
+	std::vector<std::unique_ptr<ShaderInterpreter::Context>> vertex_contexts; // by worker
+	std::vector<std::unique_ptr<ShaderInterpreter::Context>> fragment_contexts; // by worker
+	std::unordered_map<uint32_t, ShaderInterpreter::Varying> attributes; // vertex shader inputs by location
+	std::vector<Input> inputs; // one per fragment shader input component
+	uint32_t vertex_stride; // floats per shaded vertex, VertexHeader + inputs
+	std::optional<uint32_t> position_reg;
+	std::optional<uint32_t> point_size_reg;
+	std::optional<uint32_t> vertex_index_reg;
+	std::optional<uint32_t> frag_coord_reg;
+	std::optional<uint32_t> front_facing_reg;
+	std::optional<uint32_t> frag_depth_reg;
+	std::optional<ShaderInterpreter::Varying> color_output;
+	bool early_depth_stencil;
+	ShaderReflection reflection; // of both stages
+};
+
+struct TriangleSoftware
+{
+	int64_t a[3]; // edge functions in subpixels, e(x, y) = a * x + b * y + c
+	int64_t b[3];
+	int64_t c[3];
+	bool top_left[3];
+	int32_t min_x; // inclusive pixel bounds
+	int32_t min_y;
+	int32_t max_x;
+	int32_t max_y;
+	float x0; // first vertex in pixels, origin of attribute planes
+	float y0;
+	bool front_facing;
+	uint32_t planes; // offset in DrawSoftware::planes
+};
+
+// attribute plane, value(x, y) = value + dx * (x - x0) + dy * (y - y0)
+struct PlaneSoftware
+{
+	float value;
+	float dx;
+	float dy;
+};
+
+struct DrawSoftware
+{
+	ShaderDataSoftware* shader;
+	BlendMode blend_mode = BlendStates::Opaque;
+	bool blend_opaque;
+	std::optional<DepthMode> depth_mode;
+	std::optional<StencilMode> stencil_mode;
+	Sampler sampler;
+	TextureAddress texture_address;
+	float min_depth;
+	float max_depth;
+	std::vector<TextureDataSoftware*> textures; // by binding
+	std::vector<std::shared_ptr<std::vector<uint8_t>>> uniform_buffers; // by binding
+	std::vector<TriangleSoftware> triangles;
+	std::vector<PlaneSoftware> planes; // depth, 1/w, then one per fragment shader input component
+};
+
+struct FramebufferSoftware
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t* color = nullptr;
+	float* depth = nullptr;
+	uint8_t* stencil = nullptr;
+};
+
+static std::unique_ptr<WorkerPool> gWorkerPool;
+
+static std::vector<uint32_t> gBackbufferColor;
+static std::vector<uint32_t> gFrontbufferColor;
+static std::vector<float> gBackbufferDepth;
+static std::vector<uint8_t> gBackbufferStencil;
+static uint32_t gBackbufferWidth = 0;
+static uint32_t gBackbufferHeight = 0;
+static RenderTargetDataSoftware* gRenderTarget = nullptr;
+
+static Topology gTopology = Topology::TriangleList;
+static std::optional<Viewport> gViewport;
+static std::optional<Scissor> gScissor;
+static std::vector<TextureDataSoftware*> gTextures;
+static ShaderDataSoftware* gShader = nullptr;
+static std::vector<uint8_t> gDynamicVertexBuffer;
+static std::vector<uint8_t> gDynamicIndexBuffer;
+static std::span<const uint8_t> gVertexBuffer; // dynamic one or memory of BufferDataSoftware
+static size_t gVertexStride = 0;
+static std::span<const uint8_t> gIndexBuffer;
+static size_t gIndexStride = 0;
+static std::vector<std::shared_ptr<std::vector<uint8_t>>> gUniformBuffers;
+static BlendMode gBlendMode = BlendStates::Opaque;
+static std::optional<DepthMode> gDepthMode;
+static std::optional<StencilMode> gStencilMode;
+static CullMode gCullMode = CullMode::None;
+static Sampler gSampler = Sampler::Linear;
+static TextureAddress gTextureAddress = TextureAddress::Clamp;
+
+static std::vector<std::unique_ptr<DrawSoftware>> gDraws;
+static std::vector<std::vector<uint64_t>> gTileBins; // (draw << 32) | triangle
+static uint32_t gTilesX = 0;
+static uint32_t gTilesY = 0;
+static uint64_t gPendingTriangles = 0;
+
+static constexpr uint64_t MaxPendingTriangles = 1 << 20;
+
+static std::optional<std::chrono::steady_clock::time_point> gTimerStart;
+static std::vector<GpuTimer> gFrameTimers;
+static std::vector<GpuTimer> gGpuTimers;
+
+static uint32_t PackChannel(float value)
+{
+	value = value >= 0.0f ? std::min(value, 1.0f) : 0.0f; // also catches nan
+	return (uint32_t)((value * 255.0f) + 0.5f);
+}
+
+static uint32_t PackColor(const glm::vec4& color)
+{
+	return PackChannel(color.r) | (PackChannel(color.g) << 8) | (PackChannel(color.b) << 16) | (PackChannel(color.a) << 24);
+}
+
+static glm::vec4 UnpackColor(uint32_t color)
+{
+	return glm::vec4(
+		(float)(color & 0xFF),
+		(float)((color >> 8) & 0xFF),
+		(float)((color >> 16) & 0xFF),
+		(float)((color >> 24) & 0xFF)
+	) / 255.0f;
+}
+
+static int64_t FloorDiv(int64_t a, int64_t b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+template <typename T>
+static bool Compare(ComparisonFunc func, T src, T dst)
+{
+	switch (func)
+	{
+	case ComparisonFunc::Always: return true;
+	case ComparisonFunc::Never: return false;
+	case ComparisonFunc::Less: return src < dst;
+	case ComparisonFunc::Equal: return src == dst;
+	case ComparisonFunc::NotEqual: return src != dst;
+	case ComparisonFunc::LessEqual: return src <= dst;
+	case ComparisonFunc::Greater: return src > dst;
+	case ComparisonFunc::GreaterEqual: return src >= dst;
+	}
+
+	return false;
+}
+
+static void ApplyStencilOp(const StencilMode& stencil_mode, StencilOp op, uint8_t* stencil)
+{
+	auto value = *stencil;
+	uint8_t result = value;
+
+	switch (op)
+	{
+	case StencilOp::Keep: return;
+	case StencilOp::Zero: result = 0; break;
+	case StencilOp::Replace: result = stencil_mode.reference; break;
+	case StencilOp::Increment: result = value + 1; break;
+	case StencilOp::Decrement: result = value - 1; break;
+	case StencilOp::IncrementSaturation: result = value == 255 ? 255 : value + 1; break;
+	case StencilOp::DecrementSaturation: result = value == 0 ? 0 : value - 1; break;
+	case StencilOp::Invert: result = ~value; break;
+	}
+
+	*stencil = (value & ~stencil_mode.write_mask) | (result & stencil_mode.write_mask);
+}
+
+// returns true when the fragment passes, updates depth and stencil values like d3d11 does
+static bool DepthStencilTest(const DrawSoftware& draw, float z, float* depth, uint8_t* stencil)
+{
+	if (draw.stencil_mode.has_value())
+	{
+		const auto& stencil_mode = draw.stencil_mode.value();
+		auto reference = (uint8_t)(stencil_mode.reference & stencil_mode.read_mask);
+		auto value = (uint8_t)(*stencil & stencil_mode.read_mask);
+
+		if (!Compare(stencil_mode.func, reference, value))
+		{
+			ApplyStencilOp(stencil_mode, stencil_mode.fail_op, stencil);
+			return false;
+		}
+	}
+
+	auto depth_pass = !draw.depth_mode.has_value() || Compare(draw.depth_mode.value().func, z, *depth);
+
+	if (draw.stencil_mode.has_value())
+	{
+		const auto& stencil_mode = draw.stencil_mode.value();
+		ApplyStencilOp(stencil_mode, depth_pass ? stencil_mode.pass_op : stencil_mode.depth_fail_op, stencil);
+	}
+
+	if (!depth_pass)
+		return false;
+
+	if (draw.depth_mode.has_value())
+		*depth = z;
+
+	return true;
+}
+
+static float GetBlendFactor(Blend blend, const glm::vec4& src, const glm::vec4& dst, int component)
+{
+	switch (blend)
+	{
+	case Blend::One: return 1.0f;
+	case Blend::Zero: return 0.0f;
+	case Blend::SrcColor: return src[component];
+	case Blend::InvSrcColor: return 1.0f - src[component];
+	case Blend::SrcAlpha: return src.a;
+	case Blend::InvSrcAlpha: return 1.0f - src.a;
+	case Blend::DstColor: return dst[component];
+	case Blend::InvDstColor: return 1.0f - dst[component];
+	case Blend::DstAlpha: return dst.a;
+	case Blend::InvDstAlpha: return 1.0f - dst.a;
+	}
+
+	return 0.0f;
+}
+
+static float ApplyBlendFunction(BlendFunction function, float src, float dst, float src_factor, float dst_factor)
+{
+	switch (function)
+	{
+	case BlendFunction::Add: return (src * src_factor) + (dst * dst_factor);
+	case BlendFunction::Subtract: return (src * src_factor) - (dst * dst_factor);
+	case BlendFunction::ReverseSubtract: return (dst * dst_factor) - (src * src_factor);
+	case BlendFunction::Min: return std::min(src, dst); // factors are ignored, as in d3d11
+	case BlendFunction::Max: return std::max(src, dst);
+	}
+
+	return src;
+}
+
+static uint32_t BlendColor(const BlendMode& blend_mode, glm::vec4 src, uint32_t dst_color)
+{
+	src = glm::clamp(src, 0.0f, 1.0f);
+	auto dst = UnpackColor(dst_color);
+
+	glm::vec4 result;
+
+	for (int i = 0; i < 3; i++)
+	{
+		result[i] = ApplyBlendFunction(blend_mode.colorBlendFunction, src[i], dst[i],
+			GetBlendFactor(blend_mode.colorSrcBlend, src, dst, i),
+			GetBlendFactor(blend_mode.colorDstBlend, src, dst, i));
+	}
+
+	result.a = ApplyBlendFunction(blend_mode.alphaBlendFunction, src.a, dst.a,
+		GetBlendFactor(blend_mode.alphaSrcBlend, src, dst, 3),
+		GetBlendFactor(blend_mode.alphaDstBlend, src, dst, 3));
+
+	uint32_t write_mask =
+		(blend_mode.colorMask.red ? 0x000000FFu : 0u) |
+		(blend_mode.colorMask.green ? 0x0000FF00u : 0u) |
+		(blend_mode.colorMask.blue ? 0x00FF0000u : 0u) |
+		(blend_mode.colorMask.alpha ? 0xFF000000u : 0u);
+
+	return (PackColor(result) & write_mask) | (dst_color & ~write_mask);
+}
+
+class TextureProviderSoftware : public ShaderInterpreter::TextureProvider
+{
+public:
+	void setDraw(const DrawSoftware* value) { mDraw = value; }
+
+	void getSize(uint32_t binding, uint32_t lod, uint32_t& width, uint32_t& height) override
+	{
+		width = 0;
+		height = 0;
+
+		auto texture = getTexture(binding);
+
+		if (texture == nullptr || lod >= texture->levels.size())
+			return;
+
+		width = texture->levels.at(lod).width;
+		height = texture->levels.at(lod).height;
+	}
+
+	void sample(uint32_t binding, const ShaderInterpreter::Register& u, const ShaderInterpreter::Register& v,
+		const ShaderInterpreter::Register& lod, uint32_t mask, ShaderInterpreter::Register result[4]) override
+	{
+		auto texture = getTexture(binding);
+
+		for (uint32_t l = 0; l < Lanes; l++)
+		{
+			if ((mask & (1 << l)) == 0)
+				continue;
+
+			glm::vec4 color = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+			if (texture != nullptr)
+				color = sampleLane(*texture, u.f[l], v.f[l], lod.f[l]);
+
+			for (int c = 0; c < 4; c++)
+				result[c].f[l] = color[c];
+		}
+	}
+
+	void fetch(uint32_t binding, const ShaderInterpreter::Register& x, const ShaderInterpreter::Register& y,
+		const ShaderInterpreter::Register& lod, uint32_t mask, ShaderInterpreter::Register result[4]) override
+	{
+		auto texture = getTexture(binding);
+
+		for (uint32_t l = 0; l < Lanes; l++)
+		{
+			if ((mask & (1 << l)) == 0)
+				continue;
+
+			glm::vec4 color = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+			if (texture != nullptr && lod.u[l] < texture->levels.size())
+			{
+				const auto& level = texture->levels.at(lod.u[l]);
+
+				if (x.u[l] < level.width && y.u[l] < level.height)
+					color = UnpackColor(level.pixels[(y.u[l] * level.width) + x.u[l]]);
+			}
+
+			for (int c = 0; c < 4; c++)
+				result[c].f[l] = color[c];
+		}
+	}
+
+private:
+	TextureDataSoftware* getTexture(uint32_t binding) const
+	{
+		if (mDraw == nullptr || binding >= mDraw->textures.size())
+			return nullptr;
+
+		return mDraw->textures[binding];
+	}
+
+	// brings a coordinate into a range where the address mode can be applied to integer texel indices
+	float reduceCoord(float value) const
+	{
+		if (std::isnan(value))
+			return 0.0f;
+
+		switch (mDraw->texture_address)
+		{
+		case TextureAddress::Wrap: return value - std::floor(value);
+		case TextureAddress::MirrorWrap: return value - (2.0f * std::floor(value * 0.5f));
+		case TextureAddress::Clamp: return std::clamp(value, -1.0f, 2.0f);
+		}
+
+		return value;
+	}
+
+	int32_t applyAddress(int32_t value, int32_t size) const
+	{
+		switch (mDraw->texture_address)
+		{
+		case TextureAddress::Wrap:
+			value %= size;
+			return value < 0 ? value + size : value;
+
+		case TextureAddress::MirrorWrap:
+			value %= size * 2;
+			value = value < 0 ? value + (size * 2) : value;
+			return value < size ? value : (size * 2) - 1 - value;
+
+		case TextureAddress::Clamp:
+			return std::clamp(value, 0, size - 1);
+		}
+
+		return value;
+	}
+
+	glm::vec4 getTexel(const TextureDataSoftware::Level& level, int32_t x, int32_t y) const
+	{
+		x = applyAddress(x, (int32_t)level.width);
+		y = applyAddress(y, (int32_t)level.height);
+		return UnpackColor(level.pixels[(y * level.width) + x]);
+	}
+
+	glm::vec4 sampleNearest(const TextureDataSoftware::Level& level, float u, float v) const
+	{
+		auto x = (int32_t)std::floor(u * level.width);
+		auto y = (int32_t)std::floor(v * level.height);
+		return getTexel(level, x, y);
+	}
+
+	glm::vec4 sampleBilinear(const TextureDataSoftware::Level& level, float u, float v) const
+	{
+		auto x = (u * level.width) - 0.5f;
+		auto y = (v * level.height) - 0.5f;
+		auto x0 = std::floor(x);
+		auto y0 = std::floor(y);
+		auto fx = x - x0;
+		auto fy = y - y0;
+		auto ix = (int32_t)x0;
+		auto iy = (int32_t)y0;
+
+		auto top = glm::mix(getTexel(level, ix, iy), getTexel(level, ix + 1, iy), fx);
+		auto bottom = glm::mix(getTexel(level, ix, iy + 1), getTexel(level, ix + 1, iy + 1), fx);
+
+		return glm::mix(top, bottom, fy);
+	}
+
+	glm::vec4 sampleLane(const TextureDataSoftware& texture, float u, float v, float lod) const
+	{
+		u = reduceCoord(u);
+		v = reduceCoord(v);
+
+		auto max_level = (float)(texture.levels.size() - 1);
+		lod = std::isnan(lod) ? 0.0f : std::clamp(lod, 0.0f, max_level);
+
+		if (mDraw->sampler == Sampler::Nearest)
+			return sampleNearest(texture.levels.at((size_t)(lod + 0.5f)), u, v);
+
+		auto level = (size_t)lod;
+		auto fraction = lod - (float)level;
+		auto result = sampleBilinear(texture.levels.at(level), u, v);
+
+		if (fraction > 0.0f && level + 1 < texture.levels.size())
+			result = glm::mix(result, sampleBilinear(texture.levels.at(level + 1), u, v), fraction);
+
+		return result;
+	}
+
+private:
+	const DrawSoftware* mDraw = nullptr;
+};
+
+static std::vector<std::unique_ptr<TextureProviderSoftware>> gTextureProviders; // by worker
+
+static FramebufferSoftware GetFramebuffer()
+{
+	FramebufferSoftware result;
+
+	if (gRenderTarget != nullptr)
+	{
+		result.width = gRenderTarget->width;
+		result.height = gRenderTarget->height;
+		result.color = gRenderTarget->texture->levels.at(0).pixels.data();
+		result.depth = gRenderTarget->depth.data();
+		result.stencil = gRenderTarget->stencil.data();
+	}
+	else
+	{
+		result.width = gBackbufferWidth;
+		result.height = gBackbufferHeight;
+		result.color = gBackbufferColor.data();
+		result.depth = gBackbufferDepth.data();
+		result.stencil = gBackbufferStencil.data();
+	}
+
+	return result;
+}
+
+static void BindDraw(const DrawSoftware& draw, ShaderInterpreter::Context& context, uint32_t worker)
+{
+	for (uint32_t binding = 0; binding < draw.uniform_buffers.size(); binding++)
+	{
+		const auto& buffer = draw.uniform_buffers.at(binding);
+
+		if (buffer == nullptr)
+			continue;
+
+		context.setUniformBuffer(binding, buffer->data(), buffer->size());
+	}
+
+	gTextureProviders.at(worker)->setDraw(&draw);
+}
+
+static uint32_t GetCoverage(const TriangleSoftware& triangle, const double steps[3][Lanes], int32_t x, int32_t y)
+{
+	// edge values are exact integers below 2^53, so double arithmetic gives exact signs
+
+	auto px = ((int64_t)x << SubpixelBits) + (SubpixelScale / 2);
+	auto py = ((int64_t)y << SubpixelBits) + (SubpixelScale / 2);
+
+	uint32_t mask = AllLanes;
+
+	for (int e = 0; e < 3; e++)
+	{
+		auto origin = (double)((triangle.a[e] * px) + (triangle.b[e] * py) + triangle.c[e]);
+
+#if defined(SKYGFX_SOFTWARE_AVX2)
+		auto value = _mm256_set1_pd(origin);
+		auto zero = _mm256_setzero_pd();
+		auto lo = _mm256_cmp_pd(_mm256_add_pd(value, _mm256_load_pd(&steps[e][0])), zero, _CMP_GE_OQ);
+		auto hi = _mm256_cmp_pd(_mm256_add_pd(value, _mm256_load_pd(&steps[e][4])), zero, _CMP_GE_OQ);
+		mask &= (uint32_t)_mm256_movemask_pd(lo) | ((uint32_t)_mm256_movemask_pd(hi) << 4);
+#elif defined(SKYGFX_SOFTWARE_SSE2)
+		auto value = _mm_set1_pd(origin);
+		auto zero = _mm_setzero_pd();
+		uint32_t edge_mask = 0;
+
+		for (int i = 0; i < 4; i++)
+		{
+			auto result = _mm_cmpge_pd(_mm_add_pd(value, _mm_load_pd(&steps[e][i * 2])), zero);
+			edge_mask |= (uint32_t)_mm_movemask_pd(result) << (i * 2);
+		}
+
+		mask &= edge_mask;
+#else
+		uint32_t edge_mask = 0;
+
+		for (uint32_t l = 0; l < Lanes; l++)
+		{
+			if (origin + steps[e][l] >= 0.0)
+				edge_mask |= 1 << l;
+		}
+
+		mask &= edge_mask;
+#endif
+	}
+
+	return mask;
+}
+
+// context is null for shaders without fragment stage, only depth and stencil are written then
+static void RasterizeTriangle(const DrawSoftware& draw, const TriangleSoftware& triangle,
+	ShaderInterpreter::Context* context, const FramebufferSoftware& framebuffer,
+	int32_t min_x, int32_t min_y, int32_t max_x, int32_t max_y)
+{
+	min_x = std::max(min_x, triangle.min_x);
+	min_y = std::max(min_y, triangle.min_y);
+	max_x = std::min(max_x, triangle.max_x);
+	max_y = std::min(max_y, triangle.max_y);
+
+	if (min_x > max_x || min_y > max_y)
+		return;
+
+	const auto& shader = *draw.shader;
+	auto registers = context != nullptr ? context->getRegisters() : nullptr;
+	const auto* planes = &draw.planes[triangle.planes];
+
+	alignas(32) double steps[3][Lanes];
+
+	for (int e = 0; e < 3; e++)
+	{
+		for (uint32_t l = 0; l < Lanes; l++)
+		{
+			steps[e][l] = (double)(((triangle.a[e] * LaneX[l]) + (triangle.b[e] * LaneY[l])) * SubpixelScale);
+		}
+	}
+
+	auto Evaluate = [](const PlaneSoftware& plane, float dx, float dy) {
+		return plane.value + (plane.dx * dx) + (plane.dy * dy);
+	};
+
+	for (int32_t y = min_y - (min_y % BlockHeight); y <= max_y; y += BlockHeight)
+	{
+		for (int32_t x = min_x - (min_x % BlockWidth); x <= max_x; x += BlockWidth)
+		{
+			auto mask = GetCoverage(triangle, steps, x, y);
+
+			if (x < min_x || y < min_y || x + BlockWidth - 1 > max_x || y + BlockHeight - 1 > max_y)
+			{
+				for (uint32_t l = 0; l < Lanes; l++)
+				{
+					auto px = x + LaneX[l];
+					auto py = y + LaneY[l];
+
+					if (px < min_x || px > max_x || py < min_y || py > max_y)
+						mask &= ~(1 << l);
+				}
+			}
+
+			if (mask == 0)
+				continue;
+
+			float dx[Lanes];
+			float dy[Lanes];
+			float z[Lanes];
+			float w[Lanes];
+			float inv_w[Lanes];
+
+			for (uint32_t l = 0; l < Lanes; l++)
+			{
+				dx[l] = (float)(x + LaneX[l]) + 0.5f - triangle.x0;
+				dy[l] = (float)(y + LaneY[l]) + 0.5f - triangle.y0;
+				z[l] = std::clamp(Evaluate(planes[0], dx[l], dy[l]), draw.min_depth, draw.max_depth);
+				inv_w[l] = Evaluate(planes[1], dx[l], dy[l]);
+				w[l] = 1.0f / inv_w[l];
+			}
+
+			if (shader.early_depth_stencil && (draw.depth_mode.has_value() || draw.stencil_mode.has_value()))
+			{
+				for (uint32_t l = 0; l < Lanes; l++)
+				{
+					if ((mask & (1 << l)) == 0)
+						continue;
+
+					auto index = ((y + LaneY[l]) * framebuffer.width) + x + LaneX[l];
+
+					if (!DepthStencilTest(draw, z[l], &framebuffer.depth[index], &framebuffer.stencil[index]))
+						mask &= ~(1 << l);
+				}
+
+				if (mask == 0)
+					continue;
+			}
+
+			if (context == nullptr)
+				continue;
+
+			// uncovered lanes of the block are shaded as helpers, they only feed derivatives
+
+			if (shader.frag_coord_reg.has_value())
+			{
+				auto reg = shader.frag_coord_reg.value();
+
+				for (uint32_t l = 0; l < Lanes; l++)
+				{
+					registers[reg + 0].f[l] = (float)(x + LaneX[l]) + 0.5f;
+					registers[reg + 1].f[l] = (float)(y + LaneY[l]) + 0.5f;
+					registers[reg + 2].f[l] = z[l];
+					registers[reg + 3].f[l] = inv_w[l];
+				}
+			}
+
+			if (shader.front_facing_reg.has_value())
+			{
+				auto reg = shader.front_facing_reg.value();
+
+				for (uint32_t l = 0; l < Lanes; l++)
+					registers[reg].u[l] = triangle.front_facing ? ~0u : 0u;
+			}
+
+			for (size_t i = 0; i < shader.inputs.size(); i++)
+			{
+				const auto& input = shader.inputs[i];
+				const auto& plane = planes[2 + i];
+				auto& reg = registers[input.fragment_reg];
+
+				if (input.flat || input.no_perspective)
+				{
+					for (uint32_t l = 0; l < Lanes; l++)
+						reg.f[l] = Evaluate(plane, dx[l], dy[l]);
+				}
+				else
+				{
+					for (uint32_t l = 0; l < Lanes; l++)
+						reg.f[l] = Evaluate(plane, dx[l], dy[l]) * w[l];
+				}
+			}
+
+			mask &= context->execute(AllLanes);
+
+			if (mask == 0)
+				continue;
+
+			if (!shader.early_depth_stencil && (draw.depth_mode.has_value() || draw.stencil_mode.has_value()))
+			{
+				for (uint32_t l = 0; l < Lanes; l++)
+				{
+					if ((mask & (1 << l)) == 0)
+						continue;
+
+					auto index = ((y + LaneY[l]) * framebuffer.width) + x + LaneX[l];
+					auto depth = z[l];
+
+					if (shader.frag_depth_reg.has_value())
+						depth = std::clamp(registers[shader.frag_depth_reg.value()].f[l], draw.min_depth, draw.max_depth);
+
+					if (!DepthStencilTest(draw, depth, &framebuffer.depth[index], &framebuffer.stencil[index]))
+						mask &= ~(1 << l);
+				}
+			}
+
+			if (!shader.color_output.has_value())
+				continue;
+
+			const auto& output = shader.color_output.value();
+
+			for (uint32_t l = 0; l < Lanes; l++)
+			{
+				if ((mask & (1 << l)) == 0)
+					continue;
+
+				glm::vec4 color = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+				for (uint32_t c = 0; c < std::min(output.components, 4u); c++)
+					color[c] = registers[output.reg + c].f[l];
+
+				auto& dst = framebuffer.color[((y + LaneY[l]) * framebuffer.width) + x + LaneX[l]];
+				dst = draw.blend_opaque ? PackColor(color) : BlendColor(draw.blend_mode, color, dst);
+			}
+		}
+	}
+}
+
+static void RasterizeTile(uint32_t tile, uint32_t worker, const FramebufferSoftware& framebuffer)
+{
+	auto min_x = (int32_t)(tile % gTilesX) * TileSize;
+	auto min_y = (int32_t)(tile / gTilesX) * TileSize;
+	auto max_x = std::min(min_x + TileSize, (int32_t)framebuffer.width) - 1;
+	auto max_y = std::min(min_y + TileSize, (int32_t)framebuffer.height) - 1;
+
+	const DrawSoftware* bound_draw = nullptr;
+	ShaderInterpreter::Context* context = nullptr;
+
+	for (auto entry : gTileBins.at(tile))
+	{
+		const auto& draw = *gDraws[entry >> 32];
+
+		if (&draw != bound_draw)
+		{
+			context = draw.shader->fragment_shader ? draw.shader->fragment_contexts.at(worker).get() : nullptr;
+
+			if (context != nullptr)
+				BindDraw(draw, *context, worker);
+
+			bound_draw = &draw;
+		}
+
+		RasterizeTriangle(draw, draw.triangles[(uint32_t)entry], context, framebuffer, min_x, min_y, max_x, max_y);
+	}
+}
+
+static void FlushDraws()
+{
+	if (gDraws.empty())
+		return;
+
+	auto framebuffer = GetFramebuffer();
+
+	std::vector<uint32_t> tiles;
+
+	for (uint32_t i = 0; i < gTileBins.size(); i++)
+	{
+		if (!gTileBins.at(i).empty())
+			tiles.push_back(i);
+	}
+
+	gWorkerPool->run((uint32_t)tiles.size(), [&](uint32_t index, uint32_t worker) {
+		RasterizeTile(tiles.at(index), worker, framebuffer);
+	});
+
+	for (auto& bin : gTileBins)
+	{
+		bin.clear();
+	}
+
+	gDraws.clear();
+	gPendingTriangles = 0;
+}
+
+struct SetupSoftware
+{
+	const ShaderDataSoftware* shader;
+	uint32_t stride;
+	float viewport_x;
+	float viewport_y;
+	float viewport_width;
+	float viewport_height;
+	float min_depth;
+	float max_depth;
+	int32_t min_x; // inclusive pixel bounds of viewport, scissor and target
+	int32_t min_y;
+	int32_t max_x;
+	int32_t max_y;
+	CullMode cull_mode;
+};
+
+struct SetupOutputSoftware
+{
+	std::vector<TriangleSoftware> triangles;
+	std::vector<PlaneSoftware> planes;
+	std::vector<float> polygon; // clipping scratch
+	std::vector<float> clipped;
+	std::vector<float> expanded; // line and point quads
+};
+
+// signed distances to the clip volume planes, -w <= x <= w, -w <= y <= w, 0 <= z <= w
+static float GetClipDistance(const float* v, int plane)
+{
+	switch (plane)
+	{
+	case 0: return v[3] + v[0];
+	case 1: return v[3] - v[0];
+	case 2: return v[3] + v[1];
+	case 3: return v[3] - v[1];
+	case 4: return v[2];
+	case 5: return v[3] - v[2];
+	}
+
+	return 0.0f;
+}
+
+static uint32_t GetOutcode(const float* v)
+{
+	uint32_t result = 0;
+
+	for (int plane = 0; plane < 6; plane++)
+	{
+		if (GetClipDistance(v, plane) < 0.0f)
+			result |= 1 << plane;
+	}
+
+	return result;
+}
+
+static void SetupTriangle(const SetupSoftware& setup, const float* vertices[3], const float* provoking,
+	std::optional<bool> front_facing, SetupOutputSoftware& output)
+{
+	double x[3];
+	double y[3];
+	float z[3];
+	float inv_w[3];
+	int64_t sx[3];
+	int64_t sy[3];
+
+	for (int i = 0; i < 3; i++)
+	{
+		const auto* v = vertices[i];
+
+		if (!(v[3] > 0.0f))
+			return;
+
+		inv_w[i] = 1.0f / v[3];
+
+		auto window_x = setup.viewport_x + (((v[0] * inv_w[i]) + 1.0f) * 0.5f * setup.viewport_width);
+		auto window_y = setup.viewport_y + ((1.0f - (v[1] * inv_w[i])) * 0.5f * setup.viewport_height);
+
+		window_x = std::clamp(window_x, -16384.0f, 32768.0f);
+		window_y = std::clamp(window_y, -16384.0f, 32768.0f);
+
+		z[i] = setup.min_depth + ((v[2] * inv_w[i]) * (setup.max_depth - setup.min_depth));
+		sx[i] = std::llround(window_x * SubpixelScale);
+		sy[i] = std::llround(window_y * SubpixelScale);
+	}
+
+	auto area = ((sx[1] - sx[0]) * (sy[2] - sy[0])) - ((sx[2] - sx[0]) * (sy[1] - sy[0]));
+
+	if (area == 0)
+		return;
+
+	// clockwise triangles in window space are front facing, as in d3d11
+
+	auto front = front_facing.value_or(area > 0);
+
+	if (!front_facing.has_value())
+	{
+		if (setup.cull_mode == CullMode::Back && !front)
+			return;
+
+		if (setup.cull_mode == CullMode::Front && front)
+			return;
+	}
+
+	int order[3] = { 0, 1, 2 };
+
+	if (area < 0)
+		std::swap(order[1], order[2]);
+
+	TriangleSoftware triangle;
+	triangle.front_facing = front;
+
+	int64_t min_sx = INT64_MAX;
+	int64_t min_sy = INT64_MAX;
+	int64_t max_sx = INT64_MIN;
+	int64_t max_sy = INT64_MIN;
+
+	for (int e = 0; e < 3; e++)
+	{
+		auto a = order[e];
+		auto b = order[(e + 1) % 3];
+		auto dx = sx[b] - sx[a];
+		auto dy = sy[b] - sy[a];
+
+		triangle.a[e] = -dy;
+		triangle.b[e] = dx;
+		triangle.c[e] = (dy * sx[a]) - (dx * sy[a]);
+
+		// top-left fill rule, samples exactly on other edges are left out
+		triangle.top_left[e] = dy < 0 || (dy == 0 && dx > 0);
+
+		if (!triangle.top_left[e])
+			triangle.c[e] -= 1;
+
+		min_sx = std::min(min_sx, sx[e]);
+		min_sy = std::min(min_sy, sy[e]);
+		max_sx = std::max(max_sx, sx[e]);
+		max_sy = std::max(max_sy, sy[e]);
+	}
+
+	triangle.min_x = std::max((int32_t)FloorDiv(min_sx - (SubpixelScale / 2) + SubpixelScale - 1, SubpixelScale), setup.min_x);
+	triangle.min_y = std::max((int32_t)FloorDiv(min_sy - (SubpixelScale / 2) + SubpixelScale - 1, SubpixelScale), setup.min_y);
+	triangle.max_x = std::min((int32_t)FloorDiv(max_sx - (SubpixelScale / 2), SubpixelScale), setup.max_x);
+	triangle.max_y = std::min((int32_t)FloorDiv(max_sy - (SubpixelScale / 2), SubpixelScale), setup.max_y);
+
+	if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+		return;
+
+	for (int i = 0; i < 3; i++)
+	{
+		x[i] = (double)sx[i] / SubpixelScale;
+		y[i] = (double)sy[i] / SubpixelScale;
+	}
+
+	triangle.x0 = (float)x[0];
+	triangle.y0 = (float)y[0];
+	triangle.planes = (uint32_t)output.planes.size();
+
+	auto e1x = x[1] - x[0];
+	auto e1y = y[1] - y[0];
+	auto e2x = x[2] - x[0];
+	auto e2y = y[2] - y[0];
+	auto inv_det = 1.0 / ((e1x * e2y) - (e2x * e1y));
+
+	auto AddPlane = [&](double v0, double v1, double v2) {
+		auto d1 = v1 - v0;
+		auto d2 = v2 - v0;
+		output.planes.push_back({
+			(float)v0,
+			(float)(((d1 * e2y) - (d2 * e1y)) * inv_det),
+			(float)(((d2 * e1x) - (d1 * e2x)) * inv_det)
+		});
+	};
+
+	AddPlane(z[0], z[1], z[2]);
+	AddPlane(inv_w[0], inv_w[1], inv_w[2]);
+
+	for (size_t i = 0; i < setup.shader->inputs.size(); i++)
+	{
+		const auto& input = setup.shader->inputs[i];
+		auto offset = VertexHeader + i;
+
+		if (input.flat)
+		{
+			output.planes.push_back({ provoking[offset], 0.0f, 0.0f });
+		}
+		else if (input.no_perspective)
+		{
+			AddPlane(vertices[0][offset], vertices[1][offset], vertices[2][offset]);
+		}
+		else
+		{
+			AddPlane(vertices[0][offset] * inv_w[0], vertices[1][offset] * inv_w[1], vertices[2][offset] * inv_w[2]);
+		}
+	}
+
+	output.triangles.push_back(triangle);
+}
+
+static void ClipTriangle(const SetupSoftware& setup, const float* v0, const float* v1, const float* v2,
+	const float* provoking, std::optional<bool> front_facing, SetupOutputSoftware& output)
+{
+	auto code0 = GetOutcode(v0);
+	auto code1 = GetOutcode(v1);
+	auto code2 = GetOutcode(v2);
+
+	if ((code0 & code1 & code2) != 0)
+		return;
+
+	if ((code0 | code1 | code2) == 0)
+	{
+		const float* vertices[3] = { v0, v1, v2 };
+		SetupTriangle(setup, vertices, provoking, front_facing, output);
+		return;
+	}
+
+	auto stride = setup.stride;
+	auto& polygon = output.polygon;
+	auto& clipped = output.clipped;
+
+	polygon.resize(stride * 3);
+	std::copy(v0, v0 + stride, polygon.begin());
+	std::copy(v1, v1 + stride, polygon.begin() + stride);
+	std::copy(v2, v2 + stride, polygon.begin() + (stride * 2));
+
+	auto codes = code0 | code1 | code2;
+
+	for (int plane = 0; plane < 6; plane++)
+	{
+		if ((codes & (1 << plane)) == 0)
+			continue;
+
+		auto count = polygon.size() / stride;
+		clipped.clear();
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const auto* current = &polygon[i * stride];
+			const auto* next = &polygon[((i + 1) % count) * stride];
+			auto current_distance = GetClipDistance(current, plane);
+			auto next_distance = GetClipDistance(next, plane);
+
+			if (current_distance >= 0.0f)
+				clipped.insert(clipped.end(), current, current + stride);
+
+			if ((current_distance >= 0.0f) != (next_distance >= 0.0f))
+			{
+				auto t = current_distance / (current_distance - next_distance);
+
+				for (uint32_t j = 0; j < stride; j++)
+					clipped.push_back(current[j] + ((next[j] - current[j]) * t));
+			}
+		}
+
+		std::swap(polygon, clipped);
+
+		if (polygon.size() < stride * 3)
+			return;
+	}
+
+	// SetupTriangle does not touch the scratch buffers, so pointers into polygon stay valid
+
+	auto count = polygon.size() / stride;
+
+	for (size_t i = 1; i + 1 < count; i++)
+	{
+		const float* vertices[3] = { &polygon[0], &polygon[i * stride], &polygon[(i + 1) * stride] };
+		SetupTriangle(setup, vertices, provoking, front_facing, output);
+	}
+}
+
+static void SetupQuad(const SetupSoftware& setup, const float* provoking, SetupOutputSoftware& output)
+{
+	auto stride = setup.stride;
+	const auto* q = output.expanded.data();
+
+	ClipTriangle(setup, q, q + stride, q + (stride * 2), provoking, true, output);
+	ClipTriangle(setup, q, q + (stride * 2), q + (stride * 3), provoking, true, output);
+}
+
+// lines are drawn as one pixel wide quads
+static void SetupLine(const SetupSoftware& setup, const float* v0, const float* v1, SetupOutputSoftware& output)
+{
+	// cut the segment by near and far planes first, so both ends have positive w when projected
+
+	float t0 = 0.0f;
+	float t1 = 1.0f;
+
+	for (int plane = 4; plane < 6; plane++)
+	{
+		auto d0 = GetClipDistance(v0, plane);
+		auto d1 = GetClipDistance(v1, plane);
+
+		if (d0 < 0.0f && d1 < 0.0f)
+			return;
+
+		if (d0 < 0.0f)
+			t0 = std::max(t0, d0 / (d0 - d1));
+		else if (d1 < 0.0f)
+			t1 = std::min(t1, d0 / (d0 - d1));
+	}
+
+	if (t0 > t1)
+		return;
+
+	auto stride = setup.stride;
+	auto& quad = output.expanded;
+	quad.resize(stride * 4);
+
+	for (uint32_t j = 0; j < stride; j++)
+	{
+		auto a = v0[j] + ((v1[j] - v0[j]) * t0);
+		auto b = v0[j] + ((v1[j] - v0[j]) * t1);
+		quad[j] = a;
+		quad[stride + j] = a;
+		quad[(stride * 2) + j] = b;
+		quad[(stride * 3) + j] = b;
+	}
+
+	auto w0 = quad[3];
+	auto w1 = quad[(stride * 2) + 3];
+
+	if (!(w0 > 0.0f) || !(w1 > 0.0f))
+		return;
+
+	auto dx = ((quad[(stride * 2) + 0] / w1) - (quad[0] / w0)) * setup.viewport_width;
+	auto dy = ((quad[(stride * 2) + 1] / w1) - (quad[1] / w0)) * setup.viewport_height;
+	auto length = std::sqrt((dx * dx) + (dy * dy));
+
+	if (length == 0.0f)
+		return;
+
+	// half a pixel along the normal, in ndc units
+	auto nx = -dy / length / setup.viewport_width;
+	auto ny = dx / length / setup.viewport_height;
+
+	quad[0] += nx * w0;
+	quad[1] += ny * w0;
+	quad[stride + 0] -= nx * w0;
+	quad[stride + 1] -= ny * w0;
+	quad[(stride * 2) + 0] -= nx * w1;
+	quad[(stride * 2) + 1] -= ny * w1;
+	quad[(stride * 3) + 0] += nx * w1;
+	quad[(stride * 3) + 1] += ny * w1;
+
+	SetupQuad(setup, v0, output);
+}
+
+// points are drawn as squares of PointSize pixels, one pixel when the vertex shader does not write it
+static void SetupPoint(const SetupSoftware& setup, const float* v, SetupOutputSoftware& output)
+{
+	if (GetClipDistance(v, 4) < 0.0f || GetClipDistance(v, 5) < 0.0f || !(v[3] > 0.0f))
+		return;
+
+	auto stride = setup.stride;
+	auto& quad = output.expanded;
+	quad.resize(stride * 4);
+
+	for (uint32_t i = 0; i < 4; i++)
+		std::copy(v, v + stride, quad.begin() + (i * stride));
+
+	auto size = std::max(v[4], 1.0f);
+	auto x = size / setup.viewport_width * v[3];
+	auto y = size / setup.viewport_height * v[3];
+
+	quad[0] -= x;
+	quad[1] += y;
+	quad[stride + 0] += x;
+	quad[stride + 1] += y;
+	quad[(stride * 2) + 0] += x;
+	quad[(stride * 2) + 1] -= y;
+	quad[(stride * 3) + 0] -= x;
+	quad[(stride * 3) + 1] -= y;
+
+	SetupQuad(setup, v, output);
+}
+
+static void FetchAttribute(Vertex::Attribute::Format format, const uint8_t* memory, size_t size, float result[4])
+{
+	static const std::unordered_map<Vertex::Attribute::Format, std::pair<uint32_t, bool>> FormatMap = {
+		{ Vertex::Attribute::Format::R32F, { 1, true } },
+		{ Vertex::Attribute::Format::R32G32F, { 2, true } },
+		{ Vertex::Attribute::Format::R32G32B32F, { 3, true } },
+		{ Vertex::Attribute::Format::R32G32B32A32F, { 4, true } },
+		{ Vertex::Attribute::Format::R8UN, { 1, false } },
+		{ Vertex::Attribute::Format::R8G8UN, { 2, false } },
+		{ Vertex::Attribute::Format::R8G8B8UN, { 3, false } },
+		{ Vertex::Attribute::Format::R8G8B8A8UN, { 4, false } },
+	};
+
+	result[0] = 0.0f;
+	result[1] = 0.0f;
+	result[2] = 0.0f;
+	result[3] = 1.0f;
+
+	auto [components, is_float] = FormatMap.at(format);
+
+	if (memory == nullptr || size < components * (is_float ? 4 : 1))
+		return;
+
+	for (uint32_t i = 0; i < components; i++)
+	{
+		if (is_float)
+			memcpy(&result[i], memory + (i * 4), 4);
+		else
+			result[i] = memory[i] / 255.0f;
+	}
+}
+
+static void ShadeVertices(const ShaderDataSoftware& shader, const DrawSoftware& draw, const uint32_t* ids,
+	uint32_t count, uint32_t worker, float* output)
+{
+	auto& context = *shader.vertex_contexts.at(worker);
+	auto registers = context.getRegisters();
+
+	BindDraw(draw, context, worker);
+
+	for (uint32_t base = 0; base < count; base += Lanes)
+	{
+		auto lanes = std::min(count - base, Lanes);
+
+		for (size_t location = 0; location < shader.layout.attributes.size(); location++)
+		{
+			if (!shader.attributes.contains((uint32_t)location))
+				continue;
+
+			const auto& attribute = shader.layout.attributes.at(location);
+			const auto& input = shader.attributes.at((uint32_t)location);
+
+			for (uint32_t l = 0; l < lanes; l++)
+			{
+				auto offset = ((size_t)ids[base + l] * gVertexStride) + attribute.offset;
+				const uint8_t* memory = offset < gVertexBuffer.size() ? gVertexBuffer.data() + offset : nullptr;
+				float value[4];
+				FetchAttribute(attribute.format, memory, memory ? gVertexBuffer.size() - offset : 0, value);
+
+				for (uint32_t c = 0; c < std::min(input.components, 4u); c++)
+					registers[input.reg + c].f[l] = value[c];
+			}
+		}
+
+		if (shader.vertex_index_reg.has_value())
+		{
+			for (uint32_t l = 0; l < lanes; l++)
+				registers[shader.vertex_index_reg.value()].u[l] = ids[base + l];
+		}
+
+		context.execute((1 << lanes) - 1);
+
+		for (uint32_t l = 0; l < lanes; l++)
+		{
+			auto* v = output + ((size_t)(base + l) * shader.vertex_stride);
+
+			for (uint32_t c = 0; c < 4; c++)
+				v[c] = shader.position_reg.has_value() ? registers[shader.position_reg.value() + c].f[l] : 0.0f;
+
+			v[4] = shader.point_size_reg.has_value() ? registers[shader.point_size_reg.value()].f[l] : 1.0f;
+
+			for (size_t i = 0; i < shader.inputs.size(); i++)
+			{
+				auto reg = shader.inputs[i].vertex_reg;
+				v[VertexHeader + i] = reg != ~0u ? registers[reg].f[l] : 0.0f;
+			}
+		}
+	}
+}
+
+static void PrepareTileBins(const FramebufferSoftware& framebuffer)
+{
+	auto tiles_x = (framebuffer.width + TileSize - 1) / TileSize;
+	auto tiles_y = (framebuffer.height + TileSize - 1) / TileSize;
+
+	if (tiles_x == gTilesX && tiles_y == gTilesY)
+		return;
+
+	FlushDraws();
+
+	gTilesX = tiles_x;
+	gTilesY = tiles_y;
+	gTileBins.clear();
+	gTileBins.resize(tiles_x * tiles_y);
+}
+
+static void BinTriangles(uint32_t draw_index, const DrawSoftware& draw)
+{
+	for (uint32_t i = 0; i < draw.triangles.size(); i++)
+	{
+		const auto& triangle = draw.triangles[i];
+		auto entry = ((uint64_t)draw_index << 32) | i;
+
+		for (int32_t ty = triangle.min_y / TileSize; ty <= triangle.max_y / TileSize; ty++)
+		{
+			for (int32_t tx = triangle.min_x / TileSize; tx <= triangle.max_x / TileSize; tx++)
+			{
+				// skip tiles lying fully outside one of the edges, by the most inside pixel center
+
+				auto min_x = ((int64_t)std::max(tx * TileSize, triangle.min_x) << SubpixelBits) + (SubpixelScale / 2);
+				auto min_y = ((int64_t)std::max(ty * TileSize, triangle.min_y) << SubpixelBits) + (SubpixelScale / 2);
+				auto max_x = ((int64_t)std::min((tx * TileSize) + TileSize - 1, triangle.max_x) << SubpixelBits) + (SubpixelScale / 2);
+				auto max_y = ((int64_t)std::min((ty * TileSize) + TileSize - 1, triangle.max_y) << SubpixelBits) + (SubpixelScale / 2);
+
+				auto outside = false;
+
+				for (int e = 0; e < 3 && !outside; e++)
+				{
+					auto x = triangle.a[e] > 0 ? max_x : min_x;
+					auto y = triangle.b[e] > 0 ? max_y : min_y;
+					outside = (triangle.a[e] * x) + (triangle.b[e] * y) + triangle.c[e] < 0;
+				}
+
+				if (!outside)
+					gTileBins.at((ty * gTilesX) + tx).push_back(entry);
+			}
+		}
+	}
+}
+
+SoftwareBackendImage skygfx::GetSoftwareBackendFrame()
+{
+	SoftwareBackendImage result;
+	result.width = gBackbufferWidth;
+	result.height = gBackbufferHeight;
+	result.pixels.resize(gFrontbufferColor.size() * 4);
+	memcpy(result.pixels.data(), gFrontbufferColor.data(), result.pixels.size());
+	return result;
+}
+
+SoftwareBackendImage skygfx::GetSoftwareBackendTexture(TextureHandle* handle)
+{
+	FlushDraws();
+
+	auto texture = (TextureDataSoftware*)handle;
+	const auto& level = texture->levels.at(0);
+
+	SoftwareBackendImage result;
+	result.width = level.width;
+	result.height = level.height;
+	result.pixels.resize(level.pixels.size() * 4);
+	memcpy(result.pixels.data(), level.pixels.data(), result.pixels.size());
+	return result;
+}
+
+BackendSoftware::BackendSoftware(void* window, uint32_t width, uint32_t height)
+{
+	// the window is not used, frames are kept in memory and can be read with GetSoftwareBackendFrame
+
+	gWorkerPool = std::make_unique<WorkerPool>();
+
+	for (uint32_t i = 0; i < gWorkerPool->getWorkerCount(); i++)
+	{
+		gTextureProviders.push_back(std::make_unique<TextureProviderSoftware>());
+	}
+
+	resize(width, height);
+}
+
+BackendSoftware::~BackendSoftware()
+{
+	gDraws.clear();
+	gTileBins.clear();
+	gTilesX = 0;
+	gTilesY = 0;
+	gPendingTriangles = 0;
+	gTextureProviders.clear();
+	gWorkerPool.reset();
+	gRenderTarget = nullptr;
+	gShader = nullptr;
+	gTextures.clear();
+	gUniformBuffers.clear();
+	gTimerStart.reset();
+	gFrameTimers.clear();
+	gGpuTimers.clear();
+}
+
+void BackendSoftware::resize(uint32_t width, uint32_t height)
+{
+	FlushDraws();
+
+	gBackbufferWidth = width;
+	gBackbufferHeight = height;
+	gBackbufferColor.assign(width * height, 0);
+	gFrontbufferColor.assign(width * height, 0);
+	gBackbufferDepth.assign(width * height, 1.0f);
+	gBackbufferStencil.assign(width * height, 0);
+}
+
+void BackendSoftware::setTopology(Topology topology)
+{
+	gTopology = topology;
+}
+
+void BackendSoftware::setViewport(std::optional<Viewport> viewport)
+{
+	gViewport = viewport;
+}
+
+void BackendSoftware::setScissor(std::optional<Scissor> scissor)
+{
+	gScissor = scissor;
+}
+
+void BackendSoftware::setTexture(TextureHandle* handle, uint32_t slot)
+{
+	if (slot >= gTextures.size())
+		gTextures.resize(slot + 1, nullptr);
+
+	gTextures[slot] = (TextureDataSoftware*)handle;
+}
+
+void BackendSoftware::setRenderTarget(RenderTargetHandle* handle)
+{
+	FlushDraws();
+	gRenderTarget = (RenderTargetDataSoftware*)handle;
+}
+
+void BackendSoftware::setRenderTarget(std::nullptr_t value)
+{
+	FlushDraws();
+	gRenderTarget = nullptr;
+}
+
+void BackendSoftware::setShader(ShaderHandle* handle)
+{
+	gShader = (ShaderDataSoftware*)handle;
+}
+
+void BackendSoftware::setVertexBuffer(const Buffer& buffer)
+{
+	gDynamicVertexBuffer.assign((uint8_t*)buffer.data, (uint8_t*)buffer.data + buffer.size);
+	gVertexBuffer = gDynamicVertexBuffer;
+	gVertexStride = buffer.stride;
+}
+
+void BackendSoftware::setIndexBuffer(const Buffer& buffer)
+{
+	gDynamicIndexBuffer.assign((uint8_t*)buffer.data, (uint8_t*)buffer.data + buffer.size);
+	gIndexBuffer = gDynamicIndexBuffer;
+	gIndexStride = buffer.stride;
+}
+
+void BackendSoftware::setVertexBuffer(VertexBufferHandle* handle)
+{
+	// vertices are shaded by the draw call, so the buffer is read in place
+	auto buffer = (BufferDataSoftware*)handle;
+	gVertexBuffer = buffer->memory;
+	gVertexStride = buffer->stride;
+}
+
+void BackendSoftware::setIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataSoftware*)handle;
+	gIndexBuffer = buffer->memory;
+	gIndexStride = buffer->stride;
+}
+
+void BackendSoftware::setUniformBuffer(uint32_t slot, void* memory, size_t size)
+{
+	if (slot >= gUniformBuffers.size())
+		gUniformBuffers.resize(slot + 1);
+
+	// pending draws keep the previous contents alive
+	gUniformBuffers[slot] = std::make_shared<std::vector<uint8_t>>((uint8_t*)memory, (uint8_t*)memory + size);
+}
+
+void BackendSoftware::setBlendMode(const BlendMode& value)
+{
+	gBlendMode = value;
+}
+
+void BackendSoftware::setDepthMode(std::optional<DepthMode> depth_mode)
+{
+	gDepthMode = depth_mode;
+}
+
+void BackendSoftware::setStencilMode(std::optional<StencilMode> stencil_mode)
+{
+	gStencilMode = stencil_mode;
+}
+
+void BackendSoftware::setCullMode(CullMode cull_mode)
+{
+	gCullMode = cull_mode;
+}
+
+void BackendSoftware::setSampler(const Sampler& value)
+{
+	gSampler = value;
+}
+
+void BackendSoftware::setTextureAddressMode(const TextureAddress& value)
+{
+	gTextureAddress = value;
+}
+
+void BackendSoftware::clear(const std::optional<glm::vec4>& color, const std::optional<float>& depth,
+	const std::optional<uint8_t>& stencil)
+{
+	// a full clear overwrites everything pending draws could write, so they are dropped instead of rasterized
+
+	if (color.has_value() && depth.has_value() && stencil.has_value())
+	{
+		for (auto& bin : gTileBins)
+		{
+			bin.clear();
+		}
+
+		gDraws.clear();
+		gPendingTriangles = 0;
+	}
+	else
+	{
+		FlushDraws();
+	}
+
+	auto framebuffer = GetFramebuffer();
+	auto pixels = framebuffer.width * framebuffer.height;
+
+	if (color.has_value())
+		std::fill(framebuffer.color, framebuffer.color + pixels, PackColor(color.value()));
+
+	if (depth.has_value())
+		std::fill(framebuffer.depth, framebuffer.depth + pixels, depth.value());
+
+	if (stencil.has_value())
+		std::fill(framebuffer.stencil, framebuffer.stencil + pixels, stencil.value());
+}
+
+void BackendSoftware::draw(uint32_t vertex_count, uint32_t vertex_offset)
+{
+	std::vector<uint32_t> vertex_indices(vertex_count);
+
+	for (uint32_t i = 0; i < vertex_count; i++)
+	{
+		vertex_indices[i] = vertex_offset + i;
+	}
+
+	drawPrimitives(vertex_indices);
+}
+
+void BackendSoftware::drawIndexed(uint32_t index_count, uint32_t index_offset)
+{
+	std::vector<uint32_t> vertex_indices(index_count);
+
+	for (uint32_t i = 0; i < index_count; i++)
+	{
+		auto offset = (index_offset + i) * gIndexStride;
+
+		if (offset + gIndexStride > gIndexBuffer.size())
+		{
+			vertex_indices[i] = 0;
+			continue;
+		}
+
+		if (gIndexStride == 2)
+		{
+			uint16_t index;
+			memcpy(&index, &gIndexBuffer[offset], 2);
+			vertex_indices[i] = index;
+		}
+		else
+		{
+			memcpy(&vertex_indices[i], &gIndexBuffer[offset], 4);
+		}
+	}
+
+	drawPrimitives(vertex_indices);
+}
+
+void BackendSoftware::drawPrimitives(const std::vector<uint32_t>& vertex_indices)
+{
+	assert(gShader != nullptr);
+
+	auto framebuffer = GetFramebuffer();
+
+	if (vertex_indices.empty() || framebuffer.width == 0 || framebuffer.height == 0)
+		return;
+
+	PrepareTileBins(framebuffer);
+
+	const auto& shader = *gShader;
+
+	for (const auto& descriptor_set : shader.reflection.descriptor_sets)
+	{
+		if (descriptor_set.type != ShaderReflection::DescriptorSet::Type::UniformBuffer)
+			continue;
+
+		auto binding = (size_t)descriptor_set.binding;
+
+		if (binding < gUniformBuffers.size() && gUniformBuffers.at(binding) != nullptr)
+			CheckUniformBufferSize(descriptor_set, gUniformBuffers.at(binding)->size());
+	}
+
+	auto draw = std::make_unique<DrawSoftware>();
+	draw->shader = gShader;
+	draw->blend_mode = gBlendMode;
+	draw->blend_opaque = gBlendMode == BlendStates::Opaque;
+	draw->depth_mode = gDepthMode;
+	draw->stencil_mode = gStencilMode;
+	draw->sampler = gSampler;
+	draw->texture_address = gTextureAddress;
+	draw->textures = gTextures;
+	draw->uniform_buffers = gUniformBuffers;
+
+	auto viewport = gViewport.value_or(Viewport{ { 0.0f, 0.0f }, { (float)framebuffer.width, (float)framebuffer.height } });
+
+	draw->min_depth = std::min(viewport.min_depth, viewport.max_depth);
+	draw->max_depth = std::max(viewport.min_depth, viewport.max_depth);
+
+	// shade every referenced vertex once, a dense range is cheaper than deduplication when indices are local
+
+	auto [min_index, max_index] = std::minmax_element(vertex_indices.begin(), vertex_indices.end());
+	auto range = (size_t)*max_index - *min_index + 1;
+
+	std::vector<uint32_t> ids;
+	std::vector<uint32_t> local_indices(vertex_indices.size());
+
+	if (range <= (vertex_indices.size() * 2) + 64)
+	{
+		ids.resize(range);
+
+		for (uint32_t i = 0; i < range; i++)
+			ids[i] = *min_index + i;
+
+		for (size_t i = 0; i < vertex_indices.size(); i++)
+			local_indices[i] = vertex_indices[i] - *min_index;
+	}
+	else
+	{
+		ids = vertex_indices;
+		std::sort(ids.begin(), ids.end());
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+		for (size_t i = 0; i < vertex_indices.size(); i++)
+			local_indices[i] = (uint32_t)(std::lower_bound(ids.begin(), ids.end(), vertex_indices[i]) - ids.begin());
+	}
+
+	std::vector<float> vertices(ids.size() * shader.vertex_stride);
+
+	auto vertices_per_job = Lanes * VertexBatchesPerJob;
+	auto vertex_jobs = (uint32_t)((ids.size() + vertices_per_job - 1) / vertices_per_job);
+
+	gWorkerPool->run(vertex_jobs, [&](uint32_t index, uint32_t worker) {
+		auto base = index * vertices_per_job;
+		auto count = std::min((uint32_t)ids.size() - base, vertices_per_job);
+		ShadeVertices(shader, *draw, &ids[base], count, worker, &vertices[(size_t)base * shader.vertex_stride]);
+	});
+
+	// primitive assembly and setup
+
+	SetupSoftware setup;
+	setup.shader = &shader;
+	setup.stride = shader.vertex_stride;
+	setup.viewport_x = viewport.position.x;
+	setup.viewport_y = viewport.position.y;
+	setup.viewport_width = viewport.size.x;
+	setup.viewport_height = viewport.size.y;
+	setup.min_depth = viewport.min_depth;
+	setup.max_depth = viewport.max_depth;
+	setup.min_x = std::max(0, (int32_t)std::ceil(viewport.position.x - 0.5f));
+	setup.min_y = std::max(0, (int32_t)std::ceil(viewport.position.y - 0.5f));
+	setup.max_x = std::min((int32_t)framebuffer.width, (int32_t)std::ceil(viewport.position.x + viewport.size.x - 0.5f)) - 1;
+	setup.max_y = std::min((int32_t)framebuffer.height, (int32_t)std::ceil(viewport.position.y + viewport.size.y - 0.5f)) - 1;
+	setup.cull_mode = gCullMode;
+
+	if (gScissor.has_value())
+	{
+		const auto& scissor = gScissor.value();
+		setup.min_x = std::max(setup.min_x, (int32_t)scissor.position.x);
+		setup.min_y = std::max(setup.min_y, (int32_t)scissor.position.y);
+		setup.max_x = std::min(setup.max_x, (int32_t)(scissor.position.x + scissor.size.x) - 1);
+		setup.max_y = std::min(setup.max_y, (int32_t)(scissor.position.y + scissor.size.y) - 1);
+	}
+
+	if (setup.min_x > setup.max_x || setup.min_y > setup.max_y)
+		return;
+
+	static const std::unordered_map<Topology, uint32_t> VerticesPerPrimitive = {
+		{ Topology::PointList, 1 },
+		{ Topology::LineList, 2 },
+		{ Topology::LineStrip, 2 },
+		{ Topology::TriangleList, 3 },
+		{ Topology::TriangleStrip, 3 },
+	};
+
+	auto topology = gTopology;
+	auto vertices_per_primitive = VerticesPerPrimitive.at(topology);
+	auto count = (uint32_t)local_indices.size();
+	uint32_t primitive_count = 0;
+
+	if (topology == Topology::LineStrip || topology == Topology::TriangleStrip)
+		primitive_count = count >= vertices_per_primitive ? count - vertices_per_primitive + 1 : 0;
+	else
+		primitive_count = count / vertices_per_primitive;
+
+	auto GetVertex = [&](uint32_t primitive, uint32_t i) {
+		uint32_t index = primitive * vertices_per_primitive + i;
+
+		if (topology == Topology::LineStrip)
+			index = primitive + i;
+
+		if (topology == Topology::TriangleStrip)
+		{
+			// odd triangles are (n, n + 2, n + 1), keeping the winding and the first vertex
+			static const uint32_t OddOrder[3] = { 0, 2, 1 };
+			index = primitive + (primitive % 2 == 0 ? i : OddOrder[i]);
+		}
+
+		return &vertices[(size_t)local_indices[index] * shader.vertex_stride];
+	};
+
+	auto setup_jobs = (primitive_count + PrimitivesPerJob - 1) / PrimitivesPerJob;
+	std::vector<SetupOutputSoftware> outputs(setup_jobs);
+
+	gWorkerPool->run(setup_jobs, [&](uint32_t index, uint32_t worker) {
+		auto& output = outputs[index];
+		auto end = std::min((index + 1) * PrimitivesPerJob, primitive_count);
+
+		for (uint32_t primitive = index * PrimitivesPerJob; primitive < end; primitive++)
+		{
+			if (vertices_per_primitive == 3)
+			{
+				auto v0 = GetVertex(primitive, 0);
+				ClipTriangle(setup, v0, GetVertex(primitive, 1), GetVertex(primitive, 2), v0, std::nullopt, output);
+			}
+			else if (vertices_per_primitive == 2)
+			{
+				SetupLine(setup, GetVertex(primitive, 0), GetVertex(primitive, 1), output);
+			}
+			else
+			{
+				SetupPoint(setup, GetVertex(primitive, 0), output);
+			}
+		}
+	});
+
+	for (auto& output : outputs)
+	{
+		auto plane_offset = (uint32_t)draw->planes.size();
+
+		for (auto& triangle : output.triangles)
+		{
+			triangle.planes += plane_offset;
+		}
+
+		draw->triangles.insert(draw->triangles.end(), output.triangles.begin(), output.triangles.end());
+		draw->planes.insert(draw->planes.end(), output.planes.begin(), output.planes.end());
+	}
+
+	if (draw->triangles.empty())
+		return;
+
+	BinTriangles((uint32_t)gDraws.size(), *draw);
+	gPendingTriangles += draw->triangles.size();
+	gDraws.push_back(std::move(draw));
+
+	if (gPendingTriangles >= MaxPendingTriangles)
+		FlushDraws();
+}
+
+void BackendSoftware::readPixels(const glm::ivec2& pos, const glm::ivec2& size, TextureHandle* dst_texture_handle)
+{
+	FlushDraws();
+
+	auto dst_texture = (TextureDataSoftware*)dst_texture_handle;
+
+	if (size.x <= 0 || size.y <= 0)
+		return;
+
+	assert(dst_texture->width == (uint32_t)size.x);
+	assert(dst_texture->height == (uint32_t)size.y);
+
+	auto framebuffer = GetFramebuffer();
+	auto& dst = dst_texture->levels.at(0);
+
+	for (int32_t y = 0; y < size.y; y++)
+	{
+		auto src_y = pos.y + y;
+
+		if (src_y < 0 || src_y >= (int32_t)framebuffer.height || y >= (int32_t)dst.height)
+			continue;
+
+		for (int32_t x = 0; x < size.x; x++)
+		{
+			auto src_x = pos.x + x;
+
+			if (src_x < 0 || src_x >= (int32_t)framebuffer.width || x >= (int32_t)dst.width)
+				continue;
+
+			dst.pixels[(y * dst.width) + x] = framebuffer.color[(src_y * framebuffer.width) + src_x];
+		}
+	}
+
+	dst_texture->generateMips();
+}
+
+void BackendSoftware::present()
+{
+	FlushDraws();
+	gFrontbufferColor = gBackbufferColor;
+
+	std::swap(gGpuTimers, gFrameTimers);
+	gFrameTimers.clear();
+}
+
+void BackendSoftware::beginTimer(const std::string& name)
+{
+	assert(!gTimerStart.has_value());
+
+	// rasterization happens on the cpu, so the timer measures wall time of the deferred draws between the scopes
+
+	FlushDraws();
+	gTimerStart = std::chrono::steady_clock::now();
+	gFrameTimers.push_back({ name });
+}
+
+void BackendSoftware::endTimer()
+{
+	assert(gTimerStart.has_value());
+
+	FlushDraws();
+	auto duration = std::chrono::steady_clock::now() - gTimerStart.value();
+	gFrameTimers.back().milliseconds = std::chrono::duration<double, std::milli>(duration).count();
+	gTimerStart.reset();
+}
+
+const std::vector<GpuTimer>& BackendSoftware::getGpuTimers()
+{
+	return gGpuTimers;
+}
+
+TextureHandle* BackendSoftware::createTexture(uint32_t width, uint32_t height, uint32_t channels,
+	void* memory, bool mipmap)
+{
+	SKYGFX_TRACE_SCOPE("BackendSoftware::createTexture");
+
+	auto texture = new TextureDataSoftware(width, height, channels, memory, mipmap);
+	return (TextureHandle*)texture;
+}
+
+void BackendSoftware::destroyTexture(TextureHandle* handle)
+{
+	FlushDraws();
+
+	auto texture = (TextureDataSoftware*)handle;
+
+	for (auto& slot : gTextures)
+	{
+		if (slot == texture)
+			slot = nullptr;
+	}
+
+	delete texture;
+}
+
+RenderTargetHandle* BackendSoftware::createRenderTarget(uint32_t width, uint32_t height, TextureHandle* texture_handle)
+{
+	auto render_target = new RenderTargetDataSoftware;
+	render_target->width = width;
+	render_target->height = height;
+	render_target->texture = (TextureDataSoftware*)texture_handle;
+	render_target->depth.assign(width * height, 1.0f);
+	render_target->stencil.assign(width * height, 0);
+	return (RenderTargetHandle*)render_target;
+}
+
+void BackendSoftware::destroyRenderTarget(RenderTargetHandle* handle)
+{
+	auto render_target = (RenderTargetDataSoftware*)handle;
+
+	if (gRenderTarget == render_target)
+		setRenderTarget(nullptr);
+
+	delete render_target;
+}
+
+VertexBufferHandle* BackendSoftware::createVertexBuffer(void* memory, size_t size, size_t stride)
+{
+	auto buffer = new BufferDataSoftware{ std::vector<uint8_t>((uint8_t*)memory, (uint8_t*)memory + size), stride };
+	return (VertexBufferHandle*)buffer;
+}
+
+void BackendSoftware::destroyVertexBuffer(VertexBufferHandle* handle)
+{
+	auto buffer = (BufferDataSoftware*)handle;
+
+	if (gVertexBuffer.data() == buffer->memory.data())
+		gVertexBuffer = {};
+
+	delete buffer;
+}
+
+IndexBufferHandle* BackendSoftware::createIndexBuffer(void* memory, size_t size, size_t stride)
+{
+	auto buffer = new BufferDataSoftware{ std::vector<uint8_t>((uint8_t*)memory, (uint8_t*)memory + size), stride };
+	return (IndexBufferHandle*)buffer;
+}
+
+void BackendSoftware::destroyIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataSoftware*)handle;
+
+	if (gIndexBuffer.data() == buffer->memory.data())
+		gIndexBuffer = {};
+
+	delete buffer;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+ShaderHandle* BackendSoftware::createShader(const Vertex::Layout& layout, const std::string& vertex_code,
+	const std::string& fragment_code, const std::vector<std::string>& defines,
+	const SpecializationConstants& specialization_constants)
+{
+	SKYGFX_TRACE_SCOPE("BackendSoftware::createShader");
+
+	auto shader_defines = MakeShaderDefines(BackendType::Software, layout, defines);
+	auto vertex_shader = CompileShader(ShaderStage::Vertex, ShaderTarget::Spirv, vertex_code, shader_defines);
+	auto fragment_shader = fragment_code.empty() ? CompiledShader() :
+		CompileShader(ShaderStage::Fragment, ShaderTarget::Spirv, fragment_code, shader_defines);
+
+	return createShader(layout, vertex_shader, fragment_shader, specialization_constants);
+}
+#endif
+
+ShaderHandle* BackendSoftware::createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+	const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants)
+{
+	if (!specialization_constants.empty())
+	{
+		auto vertex_shader = SpecializeShader(vertex, ShaderTarget::Spirv, specialization_constants);
+		auto fragment_shader = fragment.spirv.empty() ? CompiledShader() :
+			SpecializeShader(fragment, ShaderTarget::Spirv, specialization_constants);
+
+		return createShader(layout, vertex_shader, fragment_shader, {});
+	}
+
+	auto vertex_shader_spirv = std::vector<uint32_t>(vertex.spirv.begin(), vertex.spirv.end());
+
+	auto shader = new ShaderDataSoftware;
+	shader->layout = layout;
+	shader->reflection = MergeShaderReflections(vertex, fragment);
+	shader->vertex_shader = std::make_unique<ShaderInterpreter>(vertex_shader_spirv);
+
+	if (!fragment.spirv.empty())
+	{
+		auto fragment_shader_spirv = std::vector<uint32_t>(fragment.spirv.begin(), fragment.spirv.end());
+		shader->fragment_shader = std::make_unique<ShaderInterpreter>(fragment_shader_spirv);
+	}
+
+	const auto& vs = *shader->vertex_shader;
+	const auto* fs = shader->fragment_shader.get();
+
+	for (const auto& input : vs.getInputs())
+	{
+		shader->attributes.insert({ input.location, input });
+	}
+
+	std::unordered_map<uint32_t, ShaderInterpreter::Varying> vertex_outputs;
+
+	for (const auto& output : vs.getOutputs())
+	{
+		vertex_outputs.insert({ output.location, output });
+	}
+
+	if (fs != nullptr)
+	{
+		for (const auto& input : fs->getInputs())
+		{
+			auto output = vertex_outputs.find(input.location);
+
+			for (uint32_t c = 0; c < input.components; c++)
+			{
+				ShaderDataSoftware::Input value;
+				value.fragment_reg = input.reg + c;
+				value.vertex_reg = output != vertex_outputs.end() && c < output->second.components ? output->second.reg + c : ~0u;
+				value.flat = input.flat;
+				value.no_perspective = input.no_perspective;
+				shader->inputs.push_back(value);
+			}
+		}
+
+		for (const auto& output : fs->getOutputs())
+		{
+			if (output.location == 0)
+				shader->color_output = output;
+		}
+
+		shader->frag_coord_reg = fs->getBuiltIn(ShaderInterpreter::BuiltIn::FragCoord);
+		shader->front_facing_reg = fs->getBuiltIn(ShaderInterpreter::BuiltIn::FrontFacing);
+		shader->frag_depth_reg = fs->getBuiltIn(ShaderInterpreter::BuiltIn::FragDepth);
+	}
+
+	shader->vertex_stride = VertexHeader + (uint32_t)shader->inputs.size();
+	shader->position_reg = vs.getBuiltIn(ShaderInterpreter::BuiltIn::Position);
+	shader->point_size_reg = vs.getBuiltIn(ShaderInterpreter::BuiltIn::PointSize);
+	shader->vertex_index_reg = vs.getBuiltIn(ShaderInterpreter::BuiltIn::VertexIndex);
+	shader->early_depth_stencil = fs == nullptr || (!fs->hasKill() && !fs->writesDepth());
+
+	for (uint32_t i = 0; i < gWorkerPool->getWorkerCount(); i++)
+	{
+		auto vertex_context = std::make_unique<ShaderInterpreter::Context>(vs);
+		vertex_context->setTextureProvider(gTextureProviders.at(i).get());
+		shader->vertex_contexts.push_back(std::move(vertex_context));
+
+		if (fs == nullptr)
+			continue;
+
+		auto fragment_context = std::make_unique<ShaderInterpreter::Context>(*fs);
+		fragment_context->setTextureProvider(gTextureProviders.at(i).get());
+		shader->fragment_contexts.push_back(std::move(fragment_context));
+	}
+
+	return (ShaderHandle*)shader;
+}
+
+void BackendSoftware::destroyShader(ShaderHandle* handle)
+{
+	FlushDraws();
+
+	auto shader = (ShaderDataSoftware*)handle;
+
+	if (gShader == shader)
+		gShader = nullptr;
+
+	delete shader;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+std::vector<std::shared_future<CompiledShader>> BackendSoftware::compileShaderAsync(const Vertex::Layout& layout,
+	const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& _defines)
+{
+	auto defines = MakeShaderDefines(BackendType::Software, layout, _defines);
+
+	std::vector<std::shared_future<CompiledShader>> result = {
+		CompileShaderAsync(ShaderStage::Vertex, ShaderTarget::Spirv, vertex_code, defines)
+	};
+
+	if (!fragment_code.empty())
+		result.push_back(CompileShaderAsync(ShaderStage::Fragment, ShaderTarget::Spirv, fragment_code, defines));
+
+	return result;
+}
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "backend.h"
+
+namespace skygfx
+{
+	struct SoftwareBackendImage
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint8_t> pixels; // rgba8, top row first
+	};
+
+	// color buffer of the last presented frame
+	SoftwareBackendImage GetSoftwareBackendFrame();
+
+	// level 0 of a texture or of a render target texture, pending draws are rasterized before reading
+	SoftwareBackendImage GetSoftwareBackendTexture(TextureHandle* handle);
+
+	class BackendSoftware : public Backend
+	{
+	public:
+		BackendSoftware(void* window, uint32_t width, uint32_t height);
+		~BackendSoftware();
+
+		void resize(uint32_t width, uint32_t height) override;
+
+		void setTopology(Topology topology) override;
+		void setViewport(std::optional<Viewport> viewport) override;
+		void setScissor(std::optional<Scissor> scissor) override;
+		void setTexture(TextureHandle* handle, uint32_t slot) override;
+		void setRenderTarget(RenderTargetHandle* handle) override;
+		void setRenderTarget(std::nullptr_t value) override;
+		void setShader(ShaderHandle* handle) override;
+		void setVertexBuffer(const Buffer& buffer) override;
+		void setIndexBuffer(const Buffer& buffer) override;
+		void setVertexBuffer(VertexBufferHandle* handle) override;
+		void setIndexBuffer(IndexBufferHandle* handle) override;
+		void setUniformBuffer(uint32_t slot, void* memory, size_t size) override;
+		void setBlendMode(const BlendMode& value) override;
+		void setDepthMode(std::optional<DepthMode> depth_mode) override;
+		void setStencilMode(std::optional<StencilMode> stencil_mode) override;
+		void setCullMode(CullMode cull_mode) override;
+		void setSampler(const Sampler& value) override;
+		void setTextureAddressMode(const TextureAddress& value) override;
+
+		void clear(const std::optional<glm::vec4>& color, const std::optional<float>& depth,
+			const std::optional<uint8_t>& stencil) override;
+		void draw(uint32_t vertex_count, uint32_t vertex_offset) override;
+		void drawIndexed(uint32_t index_count, uint32_t index_offset) override;
+
+		void readPixels(const glm::ivec2& pos, const glm::ivec2& size, TextureHandle* dst_texture) override;
+
+		void present() override;
+
+		void beginTimer(const std::string& name) override;
+		void endTimer() override;
+		const std::vector<GpuTimer>& getGpuTimers() override;
+
+		TextureHandle* createTexture(uint32_t width, uint32_t height, uint32_t channels,
+			void* memory, bool mipmap) override;
+		void destroyTexture(TextureHandle* handle) override;
+
+		RenderTargetHandle* createRenderTarget(uint32_t width, uint32_t height, TextureHandle* texture) override;
+		void destroyRenderTarget(RenderTargetHandle* handle) override;
+
+		VertexBufferHandle* createVertexBuffer(void* memory, size_t size, size_t stride) override;
+		void destroyVertexBuffer(VertexBufferHandle* handle) override;
+		IndexBufferHandle* createIndexBuffer(void* memory, size_t size, size_t stride) override;
+		void destroyIndexBuffer(IndexBufferHandle* handle) override;
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+		ShaderHandle* createShader(const Vertex::Layout& layout, const std::string& vertex_code,
+			const std::string& fragment_code, const std::vector<std::string>& defines,
+			const SpecializationConstants& specialization_constants) override;
+#endif
+		ShaderHandle* createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+			const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants) override;
+		void destroyShader(ShaderHandle* handle) override;
+#ifdef SKYGFX_RUNTIME_COMPILER
+		std::vector<std::shared_future<CompiledShader>> compileShaderAsync(const Vertex::Layout& layout,
+			const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& defines) override;
+#endif
+
+	private:
+		void drawPrimitives(const std::vector<uint32_t>& vertex_indices);
+	};
+}
@@ -1,4 +1,8 @@
 #include "backend_vk.h"
+#include "buddy_allocator.h"
+#include "ring_allocator.h"
+#include "shader_cache.h"
+#include "trace.h"
 
 #ifdef SKYGFX_HAS_VULKAN
 
@@ -16,20 +20,170 @@ static vk::SurfaceFormatKHR gSurfaceFormat;
 static vk::raii::SurfaceKHR gSurface = nullptr;
 static vk::raii::SwapchainKHR gSwapchain = nullptr;
 static vk::raii::CommandPool gCommandPool = nullptr;
-static vk::raii::CommandBuffer gCommandBuffer = nullptr;
+static vk::raii::CommandBuffer* gCommandBuffer = nullptr; // secondary command buffer of the frame being recorded
 static vk::raii::Sampler gSampler = nullptr;
 static bool gWorking = false;
 static uint32_t gWidth = 0;
 static uint32_t gHeight = 0;
 static const uint32_t gMinImageCount = 2; // TODO: https://github.com/nvpro-samples/nvpro_core/blob/f2c05e161bba9ab9a8c96c0173bf0edf7c168dfa/nvvk/swapchain_vk.cpp#L143
+static const uint32_t gOffscreenFrameCount = 3;
+static bool gOffscreen = false; // no window, frames are rendered into device local images
+static uint64_t gPresentCount = 0;
+
+// images and buffers are bound to ranges of big device memory blocks, which keeps the number of driver
+// allocations far below maxMemoryAllocationCount and out of frames. blocks are pooled by memory type and
+// tiling, so linear and optimal resources never share a block and bufferImageGranularity does not apply.
+// ranges bigger than a block get a dedicated block
+
+static const vk::DeviceSize MemoryBlockSize = 64 * 1024 * 1024;
+static const vk::DeviceSize MemoryMinNodeSize = 256;
+
+static vk::PhysicalDeviceMemoryProperties gMemoryProperties;
+
+struct MemoryBlockVK
+{
+	MemoryBlockVK(uint32_t memory_type, vk::DeviceSize _size, bool _dedicated, uint32_t _pool);
+
+	vk::raii::DeviceMemory memory = nullptr;
+	void* mapped = nullptr; // host visible blocks stay mapped for their lifetime
+	vk::DeviceSize size;
+	bool dedicated;
+	uint32_t pool;
+	BuddyAllocator allocator;
+};
+
+static std::unordered_map<uint32_t, std::vector<std::unique_ptr<MemoryBlockVK>>> gMemoryPools; // by memory type * 2 + linear
+
+class MemoryAllocationVK
+{
+public:
+	MemoryAllocationVK() = default;
+	MemoryAllocationVK(MemoryBlockVK* block, vk::DeviceSize offset) : mBlock(block), mOffset(offset) {}
+	MemoryAllocationVK(MemoryAllocationVK&& other) noexcept { *this = std::move(other); }
+	~MemoryAllocationVK() { release(); }
+
+	MemoryAllocationVK& operator=(MemoryAllocationVK&& other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		release();
+		mBlock = std::exchange(other.mBlock, nullptr);
+		mOffset = other.mOffset;
+		return *this;
+	}
+
+	vk::DeviceMemory getMemory() const { return *mBlock->memory; }
+	vk::DeviceSize getOffset() const { return mOffset; }
+	void* getMapped() const { return (uint8_t*)mBlock->mapped + mOffset; }
+
+private:
+	void release();
+
+private:
+	MemoryBlockVK* mBlock = nullptr;
+	vk::DeviceSize mOffset = 0;
+};
+
+static vk::DeviceSize RoundUpToPowerOfTwo(vk::DeviceSize value)
+{
+	vk::DeviceSize result = MemoryMinNodeSize;
+
+	while (result < value)
+		result *= 2;
+
+	return result;
+}
+
+MemoryBlockVK::MemoryBlockVK(uint32_t memory_type, vk::DeviceSize _size, bool _dedicated, uint32_t _pool) :
+	size(_size),
+	dedicated(_dedicated),
+	pool(_pool),
+	allocator((size_t)RoundUpToPowerOfTwo(_size), (size_t)MemoryMinNodeSize)
+{
+	SKYGFX_TRACE_SCOPE("BackendVK::allocateMemoryBlock");
+
+	auto memory_allocate_info = vk::MemoryAllocateInfo()
+		.setAllocationSize(size)
+		.setMemoryTypeIndex(memory_type);
+
+	memory = gDevice.allocateMemory(memory_allocate_info);
+
+	if (gMemoryProperties.memoryTypes[memory_type].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+		mapped = memory.mapMemory(0, VK_WHOLE_SIZE);
+}
+
+void MemoryAllocationVK::release()
+{
+	if (mBlock == nullptr)
+		return;
+
+	mBlock->allocator.free((size_t)mOffset);
+
+	auto& blocks = gMemoryPools.at(mBlock->pool);
+
+	// the last block of a pool is kept when it gets empty, so resources recreated every frame do not
+	// allocate device memory every frame
+	if (mBlock->allocator.isEmpty() && (mBlock->dedicated || blocks.size() > 1))
+	{
+		std::erase_if(blocks, [&](const auto& block) { return block.get() == mBlock; });
+	}
+
+	mBlock = nullptr;
+}
+
+static uint32_t GetMemoryType(vk::MemoryPropertyFlags properties, uint32_t type_bits)
+{
+	for (uint32_t i = 0; i < gMemoryProperties.memoryTypeCount; i++)
+		if ((gMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties && type_bits & (1 << i))
+			return i;
+
+	return 0xFFFFFFFF; // Unable to find memoryType
+}
+
+// linear is for buffers and linear tiling images, optimal tiling images go to other blocks
+static MemoryAllocationVK AllocateMemory(const vk::MemoryRequirements& requirements,
+	vk::MemoryPropertyFlags properties, bool linear)
+{
+	auto memory_type = GetMemoryType(properties, requirements.memoryTypeBits);
+	auto pool = memory_type * 2 + (linear ? 1 : 0);
+	auto& blocks = gMemoryPools[pool];
+
+	if (requirements.size > MemoryBlockSize)
+	{
+		const auto& block = blocks.emplace_back(std::make_unique<MemoryBlockVK>(memory_type, requirements.size, true, pool));
+		return MemoryAllocationVK(block.get(), block->allocator.allocate((size_t)requirements.size, 1).value());
+	}
+
+	for (const auto& block : blocks)
+	{
+		if (block->dedicated)
+			continue;
+
+		auto offset = block->allocator.allocate((size_t)requirements.size, (size_t)requirements.alignment);
+
+		if (offset.has_value())
+			return MemoryAllocationVK(block.get(), offset.value());
+	}
+
+	const auto& block = blocks.emplace_back(std::make_unique<MemoryBlockVK>(memory_type, MemoryBlockSize, false, pool));
+	auto offset = block->allocator.allocate((size_t)requirements.size, (size_t)requirements.alignment);
+	return MemoryAllocationVK(block.get(), offset.value());
+}
 
 struct FrameVK
 {
+	MemoryAllocationVK offscreen_memory;
+	vk::raii::Image offscreen_image = nullptr;
 	vk::raii::CommandBuffer command_buffer = nullptr;
+	vk::raii::CommandBuffer secondary_command_buffer = nullptr; // device calls, executed by command_buffer
 	vk::raii::Fence fence = nullptr;
 	vk::raii::ImageView backbuffer_color_image_view = nullptr;
 	vk::raii::Semaphore image_acquired_semaphore = nullptr;
 	vk::raii::Semaphore render_complete_semaphore = nullptr;
+	std::optional<uint64_t> transient_frame; // frame of gTransientRing submitted with the fence
+	std::vector<std::string> timer_names; // gpu timers recorded into secondary_command_buffer
+	std::vector<std::shared_ptr<void>> released_objects; // destroyed while the frame was recorded
 };
 
 static struct
@@ -38,31 +192,70 @@ static struct
 
 	vk::raii::Image image = nullptr;
 	vk::raii::ImageView view = nullptr;
-	vk::raii::DeviceMemory memory = nullptr;
+	MemoryAllocationVK memory;
 } gDepthStencil;
 
 static std::vector<FrameVK> gFrames;
 
-static int gVertexBufferIndex = 0;
-static int gIndexBufferIndex = 0;
-static int gUniformBufferIndex = 0;
-
 static uint32_t gSemaphoreIndex = 0;
 static uint32_t gFrameIndex = 0;
 
+// device calls are recorded into the frame of the present count, so in offscreen mode a frame is recorded
+// and submitted with the same fence. the frame is reused once its fence is signaled, in swapchain mode
+// present waits for the queue anyway
+
+static uint32_t GetRecordingFrameIndex()
+{
+	return (uint32_t)(gPresentCount % gFrames.size());
+}
+
+static FrameVK& GetRecordingFrame()
+{
+	return gFrames.at(GetRecordingFrameIndex());
+}
+
+// objects which commands of frames in flight can still use are released when the recorded frame is finished,
+// frames finish in submission order
+static void ReleaseAfterFrame(std::shared_ptr<void> object)
+{
+	GetRecordingFrame().released_objects.push_back(std::move(object));
+}
+
 struct DeviceBufferVK
 {
 	vk::raii::Buffer buffer = nullptr;
-	vk::raii::DeviceMemory memory = nullptr;
+	MemoryAllocationVK memory;
 	vk::DeviceSize size = 0;
 };
 
-static std::vector<DeviceBufferVK> gVertexBuffers;
-static std::vector<DeviceBufferVK> gIndexBuffers;
-static std::vector<DeviceBufferVK> gUniformBuffers;
+// dynamic vertices, indices and uniforms of every frame in flight are sub-allocated from one persistently
+// mapped buffer, space of a frame is reclaimed once the fence of the frame is signaled.
+// a full buffer is replaced with a bigger one, the old one lives until frames which use it are retired
+
+static const vk::DeviceSize TransientRingCapacity = 4 * 1024 * 1024;
+static const vk::DeviceSize TransientDataAlignment = 16; // vertices and indices
+
+static struct
+{
+	DeviceBufferVK buffer;
+	void* memory = nullptr;
+	RingAllocator allocator;
+	vk::DeviceSize uniform_alignment = 256;
+	std::deque<std::pair<uint64_t, DeviceBufferVK>> replaced_buffers; // with the last frame which used them
+} gTransientRing;
 
 static std::unordered_map<uint32_t, vk::ImageView> gTexturesPushQueue;
-static std::unordered_map<uint32_t, vk::Buffer> gUniformBuffersPushQueue;
+
+// uniform data is written to the transient ring and pushed at draw time, only the range the current
+// shader reads. it is pushed again when the shader or the command buffer changes
+
+struct UniformBufferVK
+{
+	std::vector<uint8_t> data;
+	size_t pushed_size = 0; // 0 when the data is not pushed for the current shader
+};
+
+static std::unordered_map<uint32_t, UniformBufferVK> gUniformBuffers;
 
 static std::optional<Scissor> gScissor;
 static bool gScissorDirty = true;
@@ -81,20 +274,70 @@ static bool gDepthModeDirty = true;
 static CullMode gCullMode = CullMode::None;
 static bool gCullModeDirty = true;
 
-static uint32_t GetMemoryType(vk::MemoryPropertyFlags properties, uint32_t type_bits)
+// timer queries are written into the secondary command buffer and reset by the primary one before it.
+// every frame has its own range of GpuTimerCapacity queries, results are read when the frame is reused
+
+static const uint32_t GpuTimerCapacity = 64; // per frame, timers above are ignored
+static vk::raii::QueryPool gTimestampQueryPool = nullptr;
+static vk::raii::QueryPool gStatisticsQueryPool = nullptr; // vertices, primitives, fragment invocations
+static float gTimestampPeriod = 1.0f; // nanoseconds per tick
+static std::vector<GpuTimer> gGpuTimers;
+static bool gTimerActive = false;
+static std::optional<uint32_t> gActiveTimerIndex; // nullopt when the active timer is over the capacity
+
+static void CreateTransientRing(vk::DeviceSize capacity)
 {
-	auto prop = gPhysicalDevice.getMemoryProperties();
+	auto buffer_create_info = vk::BufferCreateInfo()
+		.setSize(capacity)
+		.setUsage(vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer |
+			vk::BufferUsageFlagBits::eUniformBuffer)
+		.setSharingMode(vk::SharingMode::eExclusive);
+
+	auto buffer = DeviceBufferVK();
+	buffer.buffer = gDevice.createBuffer(buffer_create_info);
+
+	buffer.memory = AllocateMemory(buffer.buffer.getMemoryRequirements(), vk::MemoryPropertyFlagBits::eHostVisible |
+		vk::MemoryPropertyFlagBits::eHostCoherent, true);
+	buffer.size = capacity;
+	buffer.buffer.bindMemory(buffer.memory.getMemory(), buffer.memory.getOffset());
+
+	if (*gTransientRing.buffer.buffer)
+		gTransientRing.replaced_buffers.push_back({ gTransientRing.allocator.getFrame(), std::move(gTransientRing.buffer) });
+
+	gTransientRing.memory = buffer.memory.getMapped();
+	gTransientRing.buffer = std::move(buffer);
+	gTransientRing.allocator.reset((size_t)capacity);
+}
 
-	for (uint32_t i = 0; i < prop.memoryTypeCount; i++)
-		if ((prop.memoryTypes[i].propertyFlags & properties) == properties && type_bits & (1 << i))
-			return i;
+static std::pair<vk::Buffer, vk::DeviceSize> WriteTransientData(const void* memory, size_t size, vk::DeviceSize alignment)
+{
+	auto offset = gTransientRing.allocator.allocate(size, (size_t)alignment);
 
-	return 0xFFFFFFFF; // Unable to find memoryType
+	if (!offset.has_value())
+	{
+		CreateTransientRing(std::max(gTransientRing.buffer.size * 2, (vk::DeviceSize)size));
+		offset = gTransientRing.allocator.allocate(size, (size_t)alignment);
+	}
+
+	memcpy((uint8_t*)gTransientRing.memory + offset.value(), memory, size);
+	return { *gTransientRing.buffer.buffer, (vk::DeviceSize)offset.value() };
+}
+
+static void RetireTransientFrame(uint64_t frame)
+{
+	gTransientRing.allocator.retire(frame);
+
+	while (!gTransientRing.replaced_buffers.empty() && gTransientRing.replaced_buffers.front().first <= frame)
+	{
+		gTransientRing.replaced_buffers.pop_front();
+	}
 }
 
 template <typename Func>
 static void OneTimeSubmit(const vk::raii::CommandBuffer& cmd, const vk::raii::Queue& queue, const Func& func)
 {
+	SKYGFX_TRACE_SCOPE("OneTimeSubmit");
+
 	cmd.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
 	func(cmd);
 	cmd.end();
@@ -126,6 +369,7 @@ static void SetImageLayout(const vk::raii::CommandBuffer& cmd, vk::Image image,
 	case vk::ImageLayout::eTransferSrcOptimal: src_access_mask = vk::AccessFlagBits::eTransferRead; break;
 	case vk::ImageLayout::eTransferDstOptimal: src_access_mask = vk::AccessFlagBits::eTransferWrite; break;
 	case vk::ImageLayout::ePreinitialized: src_access_mask = vk::AccessFlagBits::eHostWrite; break;
+	case vk::ImageLayout::eColorAttachmentOptimal: src_access_mask = vk::AccessFlagBits::eColorAttachmentWrite; break;
 	case vk::ImageLayout::eGeneral:  // src_access_mask is empty
 	case vk::ImageLayout::eUndefined: break;
 	default: assert(false); break;
@@ -138,6 +382,7 @@ static void SetImageLayout(const vk::raii::CommandBuffer& cmd, vk::Image image,
 	case vk::ImageLayout::ePreinitialized: src_stage = vk::PipelineStageFlagBits::eHost; break;
 	case vk::ImageLayout::eTransferSrcOptimal:
 	case vk::ImageLayout::eTransferDstOptimal: src_stage = vk::PipelineStageFlagBits::eTransfer; break;
+	case vk::ImageLayout::eColorAttachmentOptimal: src_stage = vk::PipelineStageFlagBits::eColorAttachmentOutput; break;
 	case vk::ImageLayout::eUndefined: src_stage = vk::PipelineStageFlagBits::eTopOfPipe; break;
 	default: assert(false); break;
 	}
@@ -220,22 +465,39 @@ class ShaderDataVK
 private:
 	vk::raii::DescriptorSetLayout descriptor_set_layout = nullptr;
 	vk::raii::PipelineLayout pipeline_layout = nullptr;
+	ShaderReflection reflection;
 	vk::raii::ShaderModule vertex_shader_module = nullptr;
-	vk::raii::ShaderModule fragment_shader_module = nullptr;
+	vk::raii::ShaderModule fragment_shader_module = nullptr; // null without fragment stage
 	vk::VertexInputBindingDescription vertex_input_binding_description;
 	std::vector<vk::VertexInputAttributeDescription> vertex_input_attribute_descriptions;
+	std::vector<vk::SpecializationMapEntry> specialization_map_entries;
+	std::vector<uint32_t> specialization_data;
 
 public:
-	ShaderDataVK(const Vertex::Layout& layout, const std::string& vertex_code, const std::string& fragment_code,
-		std::vector<std::string> defines)
+	ShaderDataVK(const Vertex::Layout& layout, const CompiledShaderView& vertex_shader,
+		const CompiledShaderView& fragment_shader, const SpecializationConstants& specialization_constants)
 	{
-		AddShaderLocationDefines(layout, defines);
+		// every constant is 32 bits, bool included, so entries are packed one after another
+		for (const auto& [constant_id, value] : specialization_constants)
+		{
+			auto specialization_map_entry = vk::SpecializationMapEntry()
+				.setConstantID(constant_id)
+				.setOffset(static_cast<uint32_t>(specialization_data.size() * sizeof(uint32_t)))
+				.setSize(sizeof(uint32_t));
+
+			specialization_map_entries.push_back(specialization_map_entry);
+			specialization_data.push_back(value);
+		}
+
+		const auto& vertex_shader_spirv = vertex_shader.spirv;
+		const auto& fragment_shader_spirv = fragment_shader.spirv;
 
-		auto vertex_shader_spirv = CompileGlslToSpirv(ShaderStage::Vertex, vertex_code, defines);
-		auto fragment_shader_spirv = CompileGlslToSpirv(ShaderStage::Fragment, fragment_code, defines);
+		reflection = MergeShaderReflections(vertex_shader, fragment_shader);
 
-		auto vertex_shader_reflection = MakeSpirvReflection(vertex_shader_spirv);
-		auto fragment_shader_reflection = MakeSpirvReflection(fragment_shader_spirv);
+		std::vector<ShaderReflection> reflections = { vertex_shader.reflection };
+
+		if (!fragment_shader_spirv.empty())
+			reflections.push_back(fragment_shader.reflection);
 
 		static const std::unordered_map<ShaderStage, vk::ShaderStageFlagBits> StageMap = {
 			{ ShaderStage::Vertex, vk::ShaderStageFlagBits::eVertex },
@@ -249,7 +511,7 @@ public:
 		
 		std::vector<vk::DescriptorSetLayoutBinding> bindings;
 
-		for (const auto& reflection : { vertex_shader_reflection, fragment_shader_reflection })
+		for (const auto& reflection : reflections)
 		{
 			for (const auto& descriptor_set : reflection.descriptor_sets)
 			{
@@ -291,13 +553,19 @@ public:
 		pipeline_layout = gDevice.createPipelineLayout(pipeline_layout_create_info);
 
 		auto vertex_shader_module_create_info = vk::ShaderModuleCreateInfo()
-			.setCode(vertex_shader_spirv);
-
-		auto fragment_shader_module_create_info = vk::ShaderModuleCreateInfo()
-			.setCode(fragment_shader_spirv);
+			.setCodeSize(vertex_shader_spirv.size_bytes())
+			.setPCode(vertex_shader_spirv.data());
 
 		vertex_shader_module = gDevice.createShaderModule(vertex_shader_module_create_info);
-		fragment_shader_module = gDevice.createShaderModule(fragment_shader_module_create_info);
+
+		if (!fragment_shader_spirv.empty())
+		{
+			auto fragment_shader_module_create_info = vk::ShaderModuleCreateInfo()
+				.setCodeSize(fragment_shader_spirv.size_bytes())
+				.setPCode(fragment_shader_spirv.data());
+
+			fragment_shader_module = gDevice.createShaderModule(fragment_shader_module_create_info);
+		}
 
 		static const std::unordered_map<Vertex::Attribute::Format, vk::Format> Format = {
 			{ Vertex::Attribute::Format::R32F, vk::Format::eR32Sfloat },
@@ -315,7 +583,7 @@ public:
 			.setInputRate(vk::VertexInputRate::eVertex)
 			.setBinding(0);
 
-		for (int i = 0; i < layout.attributes.size(); i++)
+		for (auto i : GetUsedVertexAttributes(layout, vertex_shader.reflection))
 		{
 			const auto& attrib = layout.attributes.at(i);
 
@@ -337,7 +605,7 @@ class TextureDataVK
 private:
 	vk::raii::Image image = nullptr;
 	vk::raii::ImageView image_view = nullptr;
-	vk::raii::DeviceMemory memory = nullptr;
+	MemoryAllocationVK memory;
 
 public:
 	TextureDataVK(uint32_t width, uint32_t height, uint32_t channels, void* data, bool mipmap)
@@ -364,16 +632,8 @@ public:
 
 		image = gDevice.createImage(image_create_info);
 
-		auto memory_requirements = image.getMemoryRequirements();
-
-		auto memory_allocate_info = vk::MemoryAllocateInfo()
-			.setAllocationSize(memory_requirements.size)
-			.setMemoryTypeIndex(GetMemoryType(vk::MemoryPropertyFlagBits::eDeviceLocal, 
-				memory_requirements.memoryTypeBits));
-
-		memory = gDevice.allocateMemory(memory_allocate_info);
-	
-		image.bindMemory(*memory, 0);
+		memory = AllocateMemory(image.getMemoryRequirements(), vk::MemoryPropertyFlagBits::eDeviceLocal, false);
+		image.bindMemory(memory.getMemory(), memory.getOffset());
 
 		auto image_subresource_range = vk::ImageSubresourceRange()
 			.setAspectMask(vk::ImageAspectFlagBits::eColor)
@@ -399,21 +659,12 @@ public:
 
 			auto upload_buffer = gDevice.createBuffer(buffer_create_info);
 
-			auto req = upload_buffer.getMemoryRequirements();
-
-			//bd->BufferMemoryAlignment = (bd->BufferMemoryAlignment > req.alignment) ? bd->BufferMemoryAlignment : req.alignment;
+			auto upload_buffer_memory = AllocateMemory(upload_buffer.getMemoryRequirements(),
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, true);
 
-			auto memory_allocate_info = vk::MemoryAllocateInfo()
-				.setAllocationSize(req.size)
-				.setMemoryTypeIndex(GetMemoryType(vk::MemoryPropertyFlagBits::eHostVisible, req.memoryTypeBits));
+			upload_buffer.bindMemory(upload_buffer_memory.getMemory(), upload_buffer_memory.getOffset());
 
-			auto upload_buffer_memory = gDevice.allocateMemory(memory_allocate_info);
-
-			upload_buffer.bindMemory(*upload_buffer_memory, 0);
-
-			auto map = upload_buffer_memory.mapMemory(0, size);
-			memcpy(map, data, size);
-			upload_buffer_memory.unmapMemory();
+			memcpy(upload_buffer_memory.getMapped(), data, size);
 
 			OneTimeSubmit(gDevice, gCommandPool, gQueue, [&](auto& cmd) {
 				SetImageLayout(cmd, *image, vk::Format::eUndefined, vk::ImageLayout::eUndefined,
@@ -478,6 +729,49 @@ public:
 	}
 };
 
+class BufferDataVK
+{
+	friend class BackendVK;
+
+private:
+	vk::raii::Buffer buffer = nullptr;
+	MemoryAllocationVK memory;
+	size_t stride;
+
+public:
+	BufferDataVK(void* data, size_t size, size_t _stride, vk::BufferUsageFlags usage) :
+		stride(_stride)
+	{
+		auto buffer_create_info = vk::BufferCreateInfo()
+			.setSize(size)
+			.setUsage(usage | vk::BufferUsageFlagBits::eTransferDst)
+			.setSharingMode(vk::SharingMode::eExclusive);
+
+		buffer = gDevice.createBuffer(buffer_create_info);
+
+		memory = AllocateMemory(buffer.getMemoryRequirements(), vk::MemoryPropertyFlagBits::eDeviceLocal, true);
+		buffer.bindMemory(memory.getMemory(), memory.getOffset());
+
+		auto upload_buffer_create_info = vk::BufferCreateInfo()
+			.setSize(size)
+			.setUsage(vk::BufferUsageFlagBits::eTransferSrc)
+			.setSharingMode(vk::SharingMode::eExclusive);
+
+		auto upload_buffer = gDevice.createBuffer(upload_buffer_create_info);
+
+		auto upload_buffer_memory = AllocateMemory(upload_buffer.getMemoryRequirements(),
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, true);
+
+		upload_buffer.bindMemory(upload_buffer_memory.getMemory(), upload_buffer_memory.getOffset());
+
+		memcpy(upload_buffer_memory.getMapped(), data, size);
+
+		OneTimeSubmit(gDevice, gCommandPool, gQueue, [&](auto& cmd) {
+			cmd.copyBuffer(*upload_buffer, *buffer, { vk::BufferCopy(0, 0, size) });
+		});
+	}
+};
+
 class RenderTargetDataVK
 {
 public:
@@ -490,30 +784,165 @@ public:
 	}
 };
 
-BackendVK::BackendVK(void* window, uint32_t width, uint32_t height)
+std::vector<uint8_t> skygfx::ReadVulkanBackendOffscreenFrame(uint32_t frames_ago)
 {
-	auto all_extensions = gContext.enumerateInstanceExtensionProperties();
+	if (!gOffscreen)
+		throw std::runtime_error("vulkan backend is not in offscreen mode");
+
+	if (frames_ago >= gFrames.size() || frames_ago >= gPresentCount)
+		throw std::runtime_error("offscreen frame is not available");
+
+	auto index = (gFrameIndex + gFrames.size() - frames_ago) % gFrames.size();
+	const auto& frame = gFrames.at(index);
+
+	auto wait_result = gDevice.waitForFences({ *frame.fence }, true, UINT64_MAX);
+
+	auto size = (vk::DeviceSize)gWidth * gHeight * 4;
+
+	auto buffer_create_info = vk::BufferCreateInfo()
+		.setSize(size)
+		.setUsage(vk::BufferUsageFlagBits::eTransferDst)
+		.setSharingMode(vk::SharingMode::eExclusive);
+
+	auto readback_buffer = gDevice.createBuffer(buffer_create_info);
+
+	auto readback_memory = AllocateMemory(readback_buffer.getMemoryRequirements(),
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, true);
+
+	readback_buffer.bindMemory(readback_memory.getMemory(), readback_memory.getOffset());
+
+	OneTimeSubmit(gDevice, gCommandPool, gQueue, [&](auto& cmd) {
+		auto image_subresource_layers = vk::ImageSubresourceLayers()
+			.setAspectMask(vk::ImageAspectFlagBits::eColor)
+			.setLayerCount(1);
+
+		auto region = vk::BufferImageCopy()
+			.setImageSubresource(image_subresource_layers)
+			.setImageExtent({ gWidth, gHeight, 1 });
 
-	for (auto extension : all_extensions)
+		cmd.copyImageToBuffer(*frame.offscreen_image, vk::ImageLayout::eTransferSrcOptimal, *readback_buffer, { region });
+	});
+
+	std::vector<uint8_t> result(size);
+
+	memcpy(result.data(), readback_memory.getMapped(), size);
+
+	return result;
+}
+
+VulkanMemoryStats skygfx::GetVulkanBackendMemoryStats()
+{
+	auto result = VulkanMemoryStats();
+	uint64_t free_bytes = 0;
+	uint64_t largest_free_bytes = 0;
+
+	for (const auto& [pool, blocks] : gMemoryPools)
 	{
-		//	std::cout << extension.extensionName << std::endl;
+		for (const auto& block : blocks)
+		{
+			result.block_count += 1;
+			result.allocation_count += (uint32_t)block->allocator.getAllocationCount();
+			result.block_bytes += block->size;
+
+			if (block->dedicated)
+			{
+				result.dedicated_block_count += 1;
+				result.allocated_bytes += block->size; // node of a dedicated block is rounded up past its memory
+				continue;
+			}
+
+			result.allocated_bytes += block->allocator.getAllocatedSize();
+
+			auto largest_free_size = (uint64_t)block->allocator.getLargestFreeSize();
+			result.largest_free_range = std::max(result.largest_free_range, largest_free_size);
+			free_bytes += block->allocator.getCapacity() - block->allocator.getAllocatedSize();
+			largest_free_bytes += largest_free_size;
+		}
 	}
 
+	if (free_bytes > 0)
+		result.fragmentation = 1.0f - (float)((double)largest_free_bytes / (double)free_bytes);
+
+	return result;
+}
+
+static void ResolveGpuTimers(uint32_t frame_index)
+{
+	auto& frame = gFrames.at(frame_index);
+	auto count = (uint32_t)frame.timer_names.size();
+	auto first_query = frame_index * GpuTimerCapacity;
+
+	std::vector<uint64_t> timestamps;
+	std::vector<uint64_t> statistics;
+
+	if (count > 0 && *gTimestampQueryPool)
+	{
+		auto [result, data] = gTimestampQueryPool.getResults<uint64_t>(first_query * 2, count * 2,
+			count * 2 * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+
+		if (result == vk::Result::eSuccess)
+			timestamps = std::move(data);
+	}
+
+	if (count > 0 && *gStatisticsQueryPool)
+	{
+		auto [result, data] = gStatisticsQueryPool.getResults<uint64_t>(first_query, count,
+			count * 3 * sizeof(uint64_t), 3 * sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+
+		if (result == vk::Result::eSuccess)
+			statistics = std::move(data);
+	}
+
+	gGpuTimers.clear();
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		auto gpu_timer = GpuTimer();
+		gpu_timer.name = frame.timer_names.at(i);
+
+		if (!timestamps.empty())
+			gpu_timer.milliseconds = (double)(timestamps.at(i * 2 + 1) - timestamps.at(i * 2)) * gTimestampPeriod / 1000000.0;
+
+		if (!statistics.empty())
+		{
+			gpu_timer.statistics = PipelineStatistics{
+				.vertices = statistics.at(i * 3),
+				.primitives = statistics.at(i * 3 + 1),
+				.fragment_invocations = statistics.at(i * 3 + 2)
+			};
+		}
+
+		gGpuTimers.push_back(gpu_timer);
+	}
+
+	frame.timer_names.clear();
+}
+
+BackendVK::BackendVK(void* window, uint32_t width, uint32_t height)
+{
+	gOffscreen = window == nullptr;
+
 	auto all_layers = gContext.enumerateInstanceLayerProperties();
 
-	for (auto layer : all_layers)
+	std::vector<const char*> layers;
+
+	// validation is optional, render nodes usually have no sdk layers installed
+
+	for (const auto& layer : all_layers)
 	{
-		//	std::cout << layer.layerName << std::endl;
+		if (std::string_view(layer.layerName) == "VK_LAYER_KHRONOS_validation")
+			layers.push_back("VK_LAYER_KHRONOS_validation");
 	}
 
-	auto extensions = {
-		VK_KHR_SURFACE_EXTENSION_NAME,
-		VK_KHR_WIN32_SURFACE_EXTENSION_NAME
-	};
+	std::vector<const char*> extensions;
 
-	auto layers = {
-		"VK_LAYER_KHRONOS_validation"
-	};
+	if (!gOffscreen)
+	{
+		extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+		extensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif
+	}
 
 	auto version = gContext.enumerateInstanceVersion();
 
@@ -558,18 +987,13 @@ BackendVK::BackendVK(void* window, uint32_t width, uint32_t height)
 		}
 	}
 
-	auto all_device_extensions = gPhysicalDevice.enumerateDeviceExtensionProperties();
-
-	for (auto device_extension : all_device_extensions)
-	{
-		//	std::cout << device_extension.extensionName << std::endl;
-	}
-
-	auto device_extensions = {
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+	std::vector<const char*> device_extensions = {
 		VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME
 	};
 
+	if (!gOffscreen)
+		device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
 	auto queue_priority = { 1.0f };
 
 	auto queue_info = vk::DeviceQueueCreateInfo()
@@ -590,38 +1014,53 @@ BackendVK::BackendVK(void* window, uint32_t width, uint32_t height)
 		.setPNext(&device_features.get<vk::PhysicalDeviceFeatures2>());
 
 	gDevice = gPhysicalDevice.createDevice(device_info);
+	gMemoryProperties = gPhysicalDevice.getMemoryProperties();
 
 	gQueue = gDevice.getQueue(gQueueFamilyIndex, 0);
 
-	auto surface_info = vk::Win32SurfaceCreateInfoKHR()
-		.setHwnd((HWND)window);
-
-	gSurface = vk::raii::SurfaceKHR(gInstance, surface_info);
-
-	auto formats = gPhysicalDevice.getSurfaceFormatsKHR(*gSurface);
-
-	if ((formats.size() == 1) && (formats.at(0).format == vk::Format::eUndefined))
+	if (gOffscreen)
 	{
 		gSurfaceFormat = {
-			vk::Format::eB8G8R8A8Unorm,
-			formats.at(0).colorSpace
+			vk::Format::eR8G8B8A8Unorm,
+			vk::ColorSpaceKHR::eSrgbNonlinear
 		};
 	}
 	else
 	{
-		bool found = false;
-		for (const auto& format : formats)
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+		auto surface_info = vk::Win32SurfaceCreateInfoKHR()
+			.setHwnd((HWND)window);
+
+		gSurface = vk::raii::SurfaceKHR(gInstance, surface_info);
+#else
+		throw std::runtime_error("vulkan surface is not supported on this platform, create device without window");
+#endif
+
+		auto formats = gPhysicalDevice.getSurfaceFormatsKHR(*gSurface);
+
+		if ((formats.size() == 1) && (formats.at(0).format == vk::Format::eUndefined))
 		{
-			if (format.format == vk::Format::eB8G8R8A8Unorm)
-			{
-				gSurfaceFormat = format;
-				found = true;
-				break;
-			}
+			gSurfaceFormat = {
+				vk::Format::eB8G8R8A8Unorm,
+				formats.at(0).colorSpace
+			};
 		}
-		if (!found)
+		else
 		{
-			gSurfaceFormat = formats.at(0);
+			bool found = false;
+			for (const auto& format : formats)
+			{
+				if (format.format == vk::Format::eB8G8R8A8Unorm)
+				{
+					gSurfaceFormat = format;
+					found = true;
+					break;
+				}
+			}
+			if (!found)
+			{
+				gSurfaceFormat = formats.at(0);
+			}
 		}
 	}
 
@@ -631,14 +1070,6 @@ BackendVK::BackendVK(void* window, uint32_t width, uint32_t height)
 
 	gCommandPool = gDevice.createCommandPool(command_pool_info);
 
-	auto command_buffer_allocate_info = vk::CommandBufferAllocateInfo()
-		.setCommandBufferCount(1)
-		.setLevel(vk::CommandBufferLevel::eSecondary)
-		.setCommandPool(*gCommandPool);
-
-	auto command_buffers = gDevice.allocateCommandBuffers(command_buffer_allocate_info);
-	gCommandBuffer = std::move(command_buffers.at(0));
-
 	auto sampler_create_info = vk::SamplerCreateInfo()
 		.setMagFilter(vk::Filter::eLinear)
 		.setMinFilter(vk::Filter::eLinear)
@@ -652,7 +1083,35 @@ BackendVK::BackendVK(void* window, uint32_t width, uint32_t height)
 
 	gSampler = gDevice.createSampler(sampler_create_info);
 
-	createSwapchain(width, height);
+	gTransientRing.uniform_alignment = gPhysicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+	CreateTransientRing(TransientRingCapacity);
+
+	if (gOffscreen)
+		createOffscreenFrames(width, height);
+	else
+		createSwapchain(width, height);
+
+	if (gPhysicalDevice.getQueueFamilyProperties().at(gQueueFamilyIndex).timestampValidBits > 0)
+	{
+		auto timestamp_query_pool_info = vk::QueryPoolCreateInfo()
+			.setQueryType(vk::QueryType::eTimestamp)
+			.setQueryCount(GpuTimerCapacity * 2 * (uint32_t)gFrames.size());
+
+		gTimestampQueryPool = gDevice.createQueryPool(timestamp_query_pool_info);
+		gTimestampPeriod = gPhysicalDevice.getProperties().limits.timestampPeriod;
+	}
+
+	if (device_features.get<vk::PhysicalDeviceFeatures2>().features.pipelineStatisticsQuery)
+	{
+		auto statistics_query_pool_info = vk::QueryPoolCreateInfo()
+			.setQueryType(vk::QueryType::ePipelineStatistics)
+			.setQueryCount(GpuTimerCapacity * (uint32_t)gFrames.size())
+			.setPipelineStatistics(vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
+				vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+				vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations);
+
+		gStatisticsQueryPool = gDevice.createQueryPool(statistics_query_pool_info);
+	}
 
 	begin();
 }
@@ -660,10 +1119,32 @@ BackendVK::BackendVK(void* window, uint32_t width, uint32_t height)
 BackendVK::~BackendVK()
 {
 	end();
+	gQueue.waitIdle();
+	gUniformBuffers.clear();
+
+	for (auto& frame : gFrames)
+	{
+		frame.released_objects.clear();
+	}
 }
 
 void BackendVK::resize(uint32_t width, uint32_t height)
 {
+	if (!gOffscreen)
+		return; // TODO: recreate swapchain
+
+	// secondary command buffers belong to frames, calls since the last present are dropped
+	end();
+	gQueue.waitIdle();
+
+	for (const auto& frame : gFrames)
+	{
+		if (frame.transient_frame.has_value())
+			RetireTransientFrame(frame.transient_frame.value());
+	}
+
+	createOffscreenFrames(width, height);
+	begin();
 }
 
 void BackendVK::setTopology(Topology topology)
@@ -676,7 +1157,7 @@ void BackendVK::setTopology(Topology topology)
 		{ Topology::TriangleStrip, vk::PrimitiveTopology::eTriangleStrip },
 	};
 
-	gCommandBuffer.setPrimitiveTopology(TopologyMap.at(topology));
+	gCommandBuffer->setPrimitiveTopology(TopologyMap.at(topology));
 }
 
 void BackendVK::setViewport(std::optional<Viewport> viewport)
@@ -707,156 +1188,52 @@ void BackendVK::setRenderTarget(std::nullptr_t value)
 
 void BackendVK::setShader(ShaderHandle* handle)
 {
+	if (gShader == (ShaderDataVK*)handle)
+		return;
+
 	gShader = (ShaderDataVK*)handle;
+
+	for (auto& [slot, uniform_buffer] : gUniformBuffers)
+	{
+		uniform_buffer.pushed_size = 0;
+	}
 }
 
 void BackendVK::setVertexBuffer(const Buffer& value)
 {
 	assert(value.size > 0);
 
-	auto create_buffer = [&] {
-		DeviceBufferVK buffer;
-
-		auto buffer_create_info = vk::BufferCreateInfo()
-			.setSize(value.size)
-			.setUsage(vk::BufferUsageFlagBits::eVertexBuffer)
-			.setSharingMode(vk::SharingMode::eExclusive);
-
-		buffer.buffer = gDevice.createBuffer(buffer_create_info);
-
-		auto memory_requirements = buffer.buffer.getMemoryRequirements();
-
-		auto memory_allocate_info = vk::MemoryAllocateInfo()
-			.setAllocationSize(memory_requirements.size)
-			.setMemoryTypeIndex(GetMemoryType(vk::MemoryPropertyFlagBits::eHostVisible, memory_requirements.memoryTypeBits));
-
-		buffer.memory = gDevice.allocateMemory(memory_allocate_info);
-		buffer.size = memory_requirements.size;
-
-		buffer.buffer.bindMemory(*buffer.memory, 0);
-
-		return buffer;
-	};
-
-	if (gVertexBuffers.size() < gVertexBufferIndex + 1)
-	{
-		assert(gVertexBuffers.size() == gVertexBufferIndex);
-		gVertexBuffers.push_back(create_buffer());
-	}
-
-	auto& buffer = gVertexBuffers[gVertexBufferIndex];
-
-	if (buffer.size < value.size)
-	{
-		buffer = create_buffer();
-	}
-
-	auto mem = buffer.memory.mapMemory(0, VK_WHOLE_SIZE);
-	memcpy(mem, value.data, value.size);
-	buffer.memory.unmapMemory();
-
-	gCommandBuffer.bindVertexBuffers2(0, { *buffer.buffer }, { 0 }, nullptr, { value.stride });
-
-	gVertexBufferIndex += 1;
+	auto [buffer, offset] = WriteTransientData(value.data, value.size, TransientDataAlignment);
+	gCommandBuffer->bindVertexBuffers2(0, { buffer }, { offset }, nullptr, { value.stride });
 }
 
 void BackendVK::setIndexBuffer(const Buffer& value)
 {
 	assert(value.size > 0);
 
-	auto create_buffer = [&] {
-		DeviceBufferVK buffer;
-
-		auto buffer_create_info = vk::BufferCreateInfo()
-			.setSize(value.size)
-			.setUsage(vk::BufferUsageFlagBits::eIndexBuffer)
-			.setSharingMode(vk::SharingMode::eExclusive);
-
-		buffer.buffer = gDevice.createBuffer(buffer_create_info);
-
-		auto memory_requirements = buffer.buffer.getMemoryRequirements();
-
-		auto memory_allocate_info = vk::MemoryAllocateInfo()
-			.setAllocationSize(memory_requirements.size)
-			.setMemoryTypeIndex(GetMemoryType(vk::MemoryPropertyFlagBits::eHostVisible, memory_requirements.memoryTypeBits));
-
-		buffer.memory = gDevice.allocateMemory(memory_allocate_info);
-		buffer.size = memory_requirements.size;
-
-		buffer.buffer.bindMemory(*buffer.memory, 0);
-
-		return buffer;
-	};
-
-	if (gIndexBuffers.size() < gIndexBufferIndex + 1)
-	{
-		assert(gIndexBuffers.size() == gIndexBufferIndex);
-		gIndexBuffers.push_back(create_buffer());
-	}
-
-	auto& buffer = gIndexBuffers[gIndexBufferIndex];
-
-	if (buffer.size < value.size)
-	{
-		buffer = create_buffer();
-	}
-
-	auto mem = buffer.memory.mapMemory(0, VK_WHOLE_SIZE);
-	memcpy(mem, value.data, value.size);
-	buffer.memory.unmapMemory();
+	auto [buffer, offset] = WriteTransientData(value.data, value.size, TransientDataAlignment);
+	gCommandBuffer->bindIndexBuffer(buffer, offset, value.stride == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32);
+}
 
-	gCommandBuffer.bindIndexBuffer(*buffer.buffer, 0, value.stride == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32);
+void BackendVK::setVertexBuffer(VertexBufferHandle* handle)
+{
+	auto buffer = (BufferDataVK*)handle;
+	gCommandBuffer->bindVertexBuffers2(0, { *buffer->buffer }, { 0 }, nullptr, { buffer->stride });
+}
 
-	gIndexBufferIndex += 1;
+void BackendVK::setIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataVK*)handle;
+	gCommandBuffer->bindIndexBuffer(*buffer->buffer, 0, buffer->stride == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32);
 }
 
 void BackendVK::setUniformBuffer(uint32_t slot, void* memory, size_t size)
 {
 	assert(size > 0);
 
-	auto create_buffer = [&] {
-		DeviceBufferVK buffer;
-
-		auto buffer_create_info = vk::BufferCreateInfo()
-			.setSize(size)
-			.setUsage(vk::BufferUsageFlagBits::eUniformBuffer)
-			.setSharingMode(vk::SharingMode::eExclusive);
-
-		buffer.buffer = gDevice.createBuffer(buffer_create_info);
-
-		auto memory_requirements = buffer.buffer.getMemoryRequirements();
-
-		auto memory_allocate_info = vk::MemoryAllocateInfo()
-			.setAllocationSize(memory_requirements.size)
-			.setMemoryTypeIndex(GetMemoryType(vk::MemoryPropertyFlagBits::eHostVisible, memory_requirements.memoryTypeBits));
-
-		buffer.memory = gDevice.allocateMemory(memory_allocate_info);
-		buffer.size = memory_requirements.size;
-
-		buffer.buffer.bindMemory(*buffer.memory, 0);
-
-		return buffer;
-	};
-
-	if (gUniformBuffers.size() < gUniformBufferIndex + 1)
-	{
-		assert(gUniformBuffers.size() == gUniformBufferIndex);
-		gUniformBuffers.push_back(create_buffer());
-	}
-
-	auto& buffer = gUniformBuffers[gUniformBufferIndex];
-
-	if (buffer.size < size)
-	{
-		buffer = create_buffer();
-	}
-
-	auto mem = buffer.memory.mapMemory(0, VK_WHOLE_SIZE);
-	memcpy(mem, memory, size);
-	buffer.memory.unmapMemory();
-
-	gUniformBuffersPushQueue[slot] = *buffer.buffer;
-	gUniformBufferIndex += 1;
+	auto& uniform_buffer = gUniformBuffers[slot];
+	uniform_buffer.data.assign((uint8_t*)memory, (uint8_t*)memory + size);
+	uniform_buffer.pushed_size = 0;
 }
 
 void BackendVK::setBlendMode(const BlendMode& value)
@@ -875,7 +1252,7 @@ void BackendVK::setDepthMode(std::optional<DepthMode> depth_mode)
 
 void BackendVK::setStencilMode(std::optional<StencilMode> stencil_mode)
 {
-	gCommandBuffer.setStencilTestEnable(stencil_mode.has_value());
+	gCommandBuffer->setStencilTestEnable(stencil_mode.has_value());
 }
 
 void BackendVK::setCullMode(CullMode cull_mode)
@@ -915,7 +1292,7 @@ void BackendVK::clear(const std::optional<glm::vec4>& color, const std::optional
 			.setColorAttachment(0)
 			.setClearValue(clear_value);
 
-		gCommandBuffer.clearAttachments({ attachment }, { clear_rect });
+		gCommandBuffer->clearAttachments({ attachment }, { clear_rect });
 	}
 
 	if (depth.has_value() || stencil.has_value())
@@ -940,20 +1317,20 @@ void BackendVK::clear(const std::optional<glm::vec4>& color, const std::optional
 			.setColorAttachment(0)
 			.setClearValue(clear_value);
 
-		gCommandBuffer.clearAttachments({ attachment }, { clear_rect });
+		gCommandBuffer->clearAttachments({ attachment }, { clear_rect });
 	}
 }
 
 void BackendVK::draw(uint32_t vertex_count, uint32_t vertex_offset)
 {
 	prepareForDrawing();
-	gCommandBuffer.draw(vertex_count, 0, vertex_offset, 0);
+	gCommandBuffer->draw(vertex_count, 0, vertex_offset, 0);
 }
 
 void BackendVK::drawIndexed(uint32_t index_count, uint32_t index_offset)
 {
 	prepareForDrawing();
-	gCommandBuffer.drawIndexed(index_count, 1, index_offset, 0, 0);
+	gCommandBuffer->drawIndexed(index_count, 1, index_offset, 0, 0);
 }
 
 void BackendVK::readPixels(const glm::ivec2& pos, const glm::ivec2& size, TextureHandle* dst_texture_handle)
@@ -966,16 +1343,27 @@ void BackendVK::present()
 
 	const auto& image_acquired_semaphore = gFrames.at(gSemaphoreIndex).image_acquired_semaphore;
 
-	auto [result, image_index] = gSwapchain.acquireNextImage(UINT64_MAX, *image_acquired_semaphore);
-
-	gFrameIndex = image_index;
+	if (gOffscreen)
+	{
+		gFrameIndex = (uint32_t)(gPresentCount % gFrames.size());
+	}
+	else
+	{
+		auto [result, image_index] = gSwapchain.acquireNextImage(UINT64_MAX, *image_acquired_semaphore);
+		gFrameIndex = image_index;
+	}
 
-	const auto& frame = gFrames.at(gFrameIndex);
+	auto& frame = gFrames.at(gFrameIndex);
 
 	auto wait_result = gDevice.waitForFences({ *frame.fence }, true, UINT64_MAX);
 
 	gDevice.resetFences({ *frame.fence });
 
+	if (frame.transient_frame.has_value())
+		RetireTransientFrame(frame.transient_frame.value());
+
+	frame.transient_frame = gTransientRing.allocator.endFrame();
+
 	auto begin_info = vk::CommandBufferBeginInfo()
 		.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
 
@@ -983,9 +1371,15 @@ void BackendVK::present()
 
 	cmd.begin(begin_info);
 
+	if (gOffscreen)
+	{
+		SetImageLayout(cmd, *frame.offscreen_image, gSurfaceFormat.format, vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eColorAttachmentOptimal);
+	}
+
 	auto color_attachment = vk::RenderingAttachmentInfo()
 		.setImageView(*frame.backbuffer_color_image_view)
-		.setImageLayout(vk::ImageLayout::eAttachmentOptimal)
+		.setImageLayout(gOffscreen ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::eAttachmentOptimal)
 		.setLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStoreOp(vk::AttachmentStoreOp::eStore);
 
@@ -1004,11 +1398,49 @@ void BackendVK::present()
 		.setPStencilAttachment(&depth_stencil_attachment)
 		.setFlags(vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
 
+	auto first_query = GetRecordingFrameIndex() * GpuTimerCapacity;
+
+	if (*gTimestampQueryPool)
+		cmd.resetQueryPool(*gTimestampQueryPool, first_query * 2, GpuTimerCapacity * 2);
+
+	if (*gStatisticsQueryPool)
+		cmd.resetQueryPool(*gStatisticsQueryPool, first_query, GpuTimerCapacity);
+
+	// frames in flight share the depth stencil image
+	auto depth_stencil_barrier = vk::MemoryBarrier()
+		.setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+	cmd.pipelineBarrier(vk::PipelineStageFlagBits::eLateFragmentTests, vk::PipelineStageFlagBits::eEarlyFragmentTests |
+		vk::PipelineStageFlagBits::eLateFragmentTests, {}, depth_stencil_barrier, nullptr, nullptr);
+
 	cmd.beginRendering(rendering_info);
-	cmd.executeCommands({ *gCommandBuffer });
+	cmd.executeCommands({ **gCommandBuffer });
 	cmd.endRendering();
+
+	if (gOffscreen)
+	{
+		// frames stay readable until they are rendered again
+		SetImageLayout(cmd, *frame.offscreen_image, gSurfaceFormat.format, vk::ImageLayout::eColorAttachmentOptimal,
+			vk::ImageLayout::eTransferSrcOptimal);
+	}
+
 	cmd.end();
 
+	if (gOffscreen)
+	{
+		auto submit_info = vk::SubmitInfo()
+			.setCommandBufferCount(1)
+			.setPCommandBuffers(&*frame.command_buffer);
+
+		gQueue.submit({ submit_info }, *frame.fence);
+
+		gPresentCount += 1;
+
+		begin();
+		return;
+	}
+
 	const auto& render_complete_semaphore = gFrames.at(gSemaphoreIndex).render_complete_semaphore;
 
 	vk::PipelineStageFlags wait_dst_stage_mask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
@@ -1035,13 +1467,61 @@ void BackendVK::present()
 
 	gQueue.waitIdle();
 
+	gPresentCount += 1;
 	gSemaphoreIndex = (gSemaphoreIndex + 1) % gFrames.size(); // TODO: maybe gFrameIndex can be used for both
 
 	begin();
 }
 
+void BackendVK::beginTimer(const std::string& name)
+{
+	assert(!gTimerActive);
+	gTimerActive = true;
+
+	auto& timer_names = GetRecordingFrame().timer_names;
+
+	if (timer_names.size() >= GpuTimerCapacity)
+		return;
+
+	auto index = GetRecordingFrameIndex() * GpuTimerCapacity + (uint32_t)timer_names.size();
+
+	if (*gTimestampQueryPool)
+		gCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *gTimestampQueryPool, index * 2);
+
+	if (*gStatisticsQueryPool)
+		gCommandBuffer->beginQuery(*gStatisticsQueryPool, index, {});
+
+	timer_names.push_back(name);
+	gActiveTimerIndex = index;
+}
+
+void BackendVK::endTimer()
+{
+	assert(gTimerActive);
+	gTimerActive = false;
+
+	if (!gActiveTimerIndex.has_value())
+		return;
+
+	auto index = gActiveTimerIndex.value();
+	gActiveTimerIndex.reset();
+
+	if (*gStatisticsQueryPool)
+		gCommandBuffer->endQuery(*gStatisticsQueryPool, index);
+
+	if (*gTimestampQueryPool)
+		gCommandBuffer->writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *gTimestampQueryPool, index * 2 + 1);
+}
+
+const std::vector<GpuTimer>& BackendVK::getGpuTimers()
+{
+	return gGpuTimers;
+}
+
 TextureHandle* BackendVK::createTexture(uint32_t width, uint32_t height, uint32_t channels, void* memory, bool mipmap)
 {
+	SKYGFX_TRACE_SCOPE("BackendVK::createTexture");
+
 	auto texture = new TextureDataVK(width, height, channels, memory, mipmap);
 	return (TextureHandle*)texture;
 }
@@ -1049,7 +1529,7 @@ TextureHandle* BackendVK::createTexture(uint32_t width, uint32_t height, uint32_
 void BackendVK::destroyTexture(TextureHandle* handle)
 {
 	auto texture = (TextureDataVK*)handle;
-	delete texture;
+	ReleaseAfterFrame(std::shared_ptr<TextureDataVK>(texture));
 }
 
 RenderTargetHandle* BackendVK::createRenderTarget(uint32_t width, uint32_t height, TextureHandle* texture_handle)
@@ -1062,24 +1542,93 @@ RenderTargetHandle* BackendVK::createRenderTarget(uint32_t width, uint32_t heigh
 void BackendVK::destroyRenderTarget(RenderTargetHandle* handle)
 {
 	auto render_target = (RenderTargetDataVK*)handle;
-	delete render_target;
+	ReleaseAfterFrame(std::shared_ptr<RenderTargetDataVK>(render_target));
 }
 
+VertexBufferHandle* BackendVK::createVertexBuffer(void* memory, size_t size, size_t stride)
+{
+	SKYGFX_TRACE_SCOPE("BackendVK::createVertexBuffer");
+
+	auto buffer = new BufferDataVK(memory, size, stride, vk::BufferUsageFlagBits::eVertexBuffer);
+	return (VertexBufferHandle*)buffer;
+}
+
+void BackendVK::destroyVertexBuffer(VertexBufferHandle* handle)
+{
+	auto buffer = (BufferDataVK*)handle;
+	ReleaseAfterFrame(std::shared_ptr<BufferDataVK>(buffer));
+}
+
+IndexBufferHandle* BackendVK::createIndexBuffer(void* memory, size_t size, size_t stride)
+{
+	SKYGFX_TRACE_SCOPE("BackendVK::createIndexBuffer");
+
+	auto buffer = new BufferDataVK(memory, size, stride, vk::BufferUsageFlagBits::eIndexBuffer);
+	return (IndexBufferHandle*)buffer;
+}
+
+void BackendVK::destroyIndexBuffer(IndexBufferHandle* handle)
+{
+	auto buffer = (BufferDataVK*)handle;
+	ReleaseAfterFrame(std::shared_ptr<BufferDataVK>(buffer));
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
 ShaderHandle* BackendVK::createShader(const Vertex::Layout& layout, const std::string& vertex_code,
-	const std::string& fragment_code, const std::vector<std::string>& defines)
+	const std::string& fragment_code, const std::vector<std::string>& defines,
+	const SpecializationConstants& specialization_constants)
+{
+	SKYGFX_TRACE_SCOPE("BackendVK::createShader");
+
+	auto shader_defines = MakeShaderDefines(BackendType::Vulkan, layout, defines);
+	auto vertex_shader = CompileShader(ShaderStage::Vertex, ShaderTarget::Spirv, vertex_code, shader_defines);
+	auto fragment_shader = fragment_code.empty() ? CompiledShader() :
+		CompileShader(ShaderStage::Fragment, ShaderTarget::Spirv, fragment_code, shader_defines);
+
+	return createShader(layout, vertex_shader, fragment_shader, specialization_constants);
+}
+#endif
+
+ShaderHandle* BackendVK::createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+	const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants)
 {
-	auto shader = new ShaderDataVK(layout, vertex_code, fragment_code, defines);
+	auto shader = new ShaderDataVK(layout, vertex, fragment, specialization_constants);
 	return (ShaderHandle*)shader;
 }
 
 void BackendVK::destroyShader(ShaderHandle* handle)
 {
-	// TODO: remove pipeline connected with this shader
-
 	auto shader = (ShaderDataVK*)handle;
-	delete shader;
+
+	// a shader created later at the same address must not find this pipeline
+	auto pipeline = gPipelines.extract(shader);
+
+	if (!pipeline.empty())
+		ReleaseAfterFrame(std::make_shared<vk::raii::Pipeline>(std::move(pipeline.mapped())));
+
+	if (gShader == shader)
+		gShader = nullptr;
+
+	ReleaseAfterFrame(std::shared_ptr<ShaderDataVK>(shader));
 }
 
+#ifdef SKYGFX_RUNTIME_COMPILER
+std::vector<std::shared_future<CompiledShader>> BackendVK::compileShaderAsync(const Vertex::Layout& layout,
+	const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& _defines)
+{
+	auto defines = MakeShaderDefines(BackendType::Vulkan, layout, _defines);
+
+	std::vector<std::shared_future<CompiledShader>> result = {
+		CompileShaderAsync(ShaderStage::Vertex, ShaderTarget::Spirv, vertex_code, defines)
+	};
+
+	if (!fragment_code.empty())
+		result.push_back(CompileShaderAsync(ShaderStage::Fragment, ShaderTarget::Spirv, fragment_code, defines));
+
+	return result;
+}
+#endif
+
 void BackendVK::createSwapchain(uint32_t width, uint32_t height)
 {
 	gWidth = width;
@@ -1120,6 +1669,14 @@ void BackendVK::createSwapchain(uint32_t width, uint32_t height)
 		auto command_buffers = gDevice.allocateCommandBuffers(buffer_allocate_info);
 		frame.command_buffer = std::move(command_buffers.at(0));
 
+		auto secondary_buffer_allocate_info = vk::CommandBufferAllocateInfo()
+			.setCommandBufferCount(1)
+			.setLevel(vk::CommandBufferLevel::eSecondary)
+			.setCommandPool(*gCommandPool);
+
+		auto secondary_command_buffers = gDevice.allocateCommandBuffers(secondary_buffer_allocate_info);
+		frame.secondary_command_buffer = std::move(secondary_command_buffers.at(0));
+
 		auto fence_info = vk::FenceCreateInfo()
 			.setFlags(vk::FenceCreateFlagBits::eSignaled);
 
@@ -1156,8 +1713,86 @@ void BackendVK::createSwapchain(uint32_t width, uint32_t height)
 		gFrames.push_back(std::move(frame));
 	}
 
-	// depth stencil
+	createDepthStencil(width, height);
+}
+
+void BackendVK::createOffscreenFrames(uint32_t width, uint32_t height)
+{
+	gWidth = width;
+	gHeight = height;
+	gPresentCount = 0;
+
+	gFrames.clear();
+
+	for (uint32_t i = 0; i < gOffscreenFrameCount; i++)
+	{
+		auto frame = FrameVK();
+
+		auto image_create_info = vk::ImageCreateInfo()
+			.setImageType(vk::ImageType::e2D)
+			.setFormat(gSurfaceFormat.format)
+			.setExtent({ width, height, 1 })
+			.setMipLevels(1)
+			.setArrayLayers(1)
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc)
+			.setSharingMode(vk::SharingMode::eExclusive)
+			.setInitialLayout(vk::ImageLayout::eUndefined);
+
+		frame.offscreen_image = gDevice.createImage(image_create_info);
+
+		frame.offscreen_memory = AllocateMemory(frame.offscreen_image.getMemoryRequirements(),
+			vk::MemoryPropertyFlagBits::eDeviceLocal, false);
+
+		frame.offscreen_image.bindMemory(frame.offscreen_memory.getMemory(), frame.offscreen_memory.getOffset());
+
+		auto buffer_allocate_info = vk::CommandBufferAllocateInfo()
+			.setCommandBufferCount(1)
+			.setLevel(vk::CommandBufferLevel::ePrimary)
+			.setCommandPool(*gCommandPool);
+
+		auto command_buffers = gDevice.allocateCommandBuffers(buffer_allocate_info);
+		frame.command_buffer = std::move(command_buffers.at(0));
+
+		auto secondary_buffer_allocate_info = vk::CommandBufferAllocateInfo()
+			.setCommandBufferCount(1)
+			.setLevel(vk::CommandBufferLevel::eSecondary)
+			.setCommandPool(*gCommandPool);
+
+		auto secondary_command_buffers = gDevice.allocateCommandBuffers(secondary_buffer_allocate_info);
+		frame.secondary_command_buffer = std::move(secondary_command_buffers.at(0));
+
+		auto fence_info = vk::FenceCreateInfo()
+			.setFlags(vk::FenceCreateFlagBits::eSignaled);
+
+		frame.fence = gDevice.createFence(fence_info);
+
+		frame.image_acquired_semaphore = gDevice.createSemaphore({});
+		frame.render_complete_semaphore = gDevice.createSemaphore({});
+
+		auto image_view_info = vk::ImageViewCreateInfo()
+			.setViewType(vk::ImageViewType::e2D)
+			.setFormat(gSurfaceFormat.format)
+			.setSubresourceRange(vk::ImageSubresourceRange()
+				.setAspectMask(vk::ImageAspectFlagBits::eColor)
+				.setBaseMipLevel(0)
+				.setLevelCount(1)
+				.setBaseArrayLayer(0)
+				.setLayerCount(1)
+			)
+			.setImage(*frame.offscreen_image);
+
+		frame.backbuffer_color_image_view = gDevice.createImageView(image_view_info);
+
+		gFrames.push_back(std::move(frame));
+	}
+
+	createDepthStencil(width, height);
+}
 
+void BackendVK::createDepthStencil(uint32_t width, uint32_t height)
+{
 	auto depth_stencil_image_create_info = vk::ImageCreateInfo()
 		.setImageType(vk::ImageType::e2D)
 		.setFormat(gDepthStencil.format)
@@ -1170,15 +1805,10 @@ void BackendVK::createSwapchain(uint32_t width, uint32_t height)
 
 	gDepthStencil.image = gDevice.createImage(depth_stencil_image_create_info);
 
-	auto depth_stencil_mem_req = gDepthStencil.image.getMemoryRequirements();
-
-	auto depth_stencil_memory_allocate_info = vk::MemoryAllocateInfo()
-		.setAllocationSize(depth_stencil_mem_req.size)
-		.setMemoryTypeIndex(GetMemoryType(vk::MemoryPropertyFlagBits::eDeviceLocal, depth_stencil_mem_req.memoryTypeBits));
+	gDepthStencil.memory = AllocateMemory(gDepthStencil.image.getMemoryRequirements(),
+		vk::MemoryPropertyFlagBits::eDeviceLocal, false);
 
-	gDepthStencil.memory = gDevice.allocateMemory(depth_stencil_memory_allocate_info);
-
-	gDepthStencil.image.bindMemory(*gDepthStencil.memory, 0);
+	gDepthStencil.image.bindMemory(gDepthStencil.memory.getMemory(), gDepthStencil.memory.getOffset());
 
 	auto depth_stencil_view_subresource_range = vk::ImageSubresourceRange()
 		.setLevelCount(1)
@@ -1204,13 +1834,14 @@ void BackendVK::begin()
 	assert(!gWorking);
 	gWorking = true;
 
-	gVertexBufferIndex = 0;
-	gIndexBufferIndex = 0;
-	gUniformBufferIndex = 0;
-
 	gViewportDirty = true;
 	gScissorDirty = true;
 
+	for (auto& [slot, uniform_buffer] : gUniformBuffers)
+	{
+		uniform_buffer.pushed_size = 0;
+	}
+
 	auto inheritance_rendering_info = vk::CommandBufferInheritanceRenderingInfo()
 		.setColorAttachmentCount(1)
 		.setPColorAttachmentFormats(&gSurfaceFormat.format)
@@ -1225,7 +1856,16 @@ void BackendVK::begin()
 		.setFlags(vk::CommandBufferUsageFlagBits::eRenderPassContinue)
 		.setPInheritanceInfo(&inheritance_info);
 
-	gCommandBuffer.begin(begin_info);
+	auto frame_index = GetRecordingFrameIndex();
+	auto& frame = gFrames.at(frame_index);
+
+	auto wait_result = gDevice.waitForFences({ *frame.fence }, true, UINT64_MAX);
+
+	ResolveGpuTimers(frame_index);
+	frame.released_objects.clear();
+
+	gCommandBuffer = &frame.secondary_command_buffer;
+	gCommandBuffer->begin(begin_info);
 }
 
 void BackendVK::end()
@@ -1233,7 +1873,7 @@ void BackendVK::end()
 	assert(gWorking);
 	gWorking = false;
 
-	gCommandBuffer.end();
+	gCommandBuffer->end();
 }
 
 void BackendVK::prepareForDrawing()
@@ -1248,14 +1888,14 @@ void BackendVK::prepareForDrawing()
 
 		if (gDepthMode.has_value())
 		{
-			gCommandBuffer.setDepthTestEnable(true);
-			gCommandBuffer.setDepthWriteEnable(true);
-			gCommandBuffer.setDepthCompareOp(CompareOpMap.at(gDepthMode.value().func));
+			gCommandBuffer->setDepthTestEnable(true);
+			gCommandBuffer->setDepthWriteEnable(true);
+			gCommandBuffer->setDepthCompareOp(CompareOpMap.at(gDepthMode.value().func));
 		}
 		else
 		{
-			gCommandBuffer.setDepthTestEnable(false);
-			gCommandBuffer.setDepthWriteEnable(false);
+			gCommandBuffer->setDepthTestEnable(false);
+			gCommandBuffer->setDepthWriteEnable(false);
 		}
 
 		gDepthModeDirty = false;
@@ -1263,17 +1903,36 @@ void BackendVK::prepareForDrawing()
 
 	if (!gPipelines.contains(gShader))
 	{
-		auto pipeline_shader_stage_create_info = {
+		SKYGFX_TRACE_SCOPE("BackendVK::createPipeline");
+
+		// constants which are missing in a stage are ignored by vulkan, so both stages share the info
+		auto specialization_info = vk::SpecializationInfo()
+			.setMapEntries(gShader->specialization_map_entries)
+			.setDataSize(gShader->specialization_data.size() * sizeof(uint32_t))
+			.setPData(gShader->specialization_data.data());
+
+		std::vector<vk::PipelineShaderStageCreateInfo> pipeline_shader_stage_create_info = {
 			vk::PipelineShaderStageCreateInfo()
 				.setStage(vk::ShaderStageFlagBits::eVertex)
 				.setModule(*gShader->vertex_shader_module)
-				.setPName("main"),
+				.setPName("main")
+				.setPSpecializationInfo(&specialization_info)
+		};
 
-			vk::PipelineShaderStageCreateInfo()
+		bool has_fragment_stage = *gShader->fragment_shader_module != nullptr;
+
+		if (has_fragment_stage)
+		{
+			pipeline_shader_stage_create_info.push_back(vk::PipelineShaderStageCreateInfo()
 				.setStage(vk::ShaderStageFlagBits::eFragment)
 				.setModule(*gShader->fragment_shader_module)
 				.setPName("main")
-		};
+				.setPSpecializationInfo(&specialization_info));
+		}
+
+		// without fragment stage colors are undefined, so they are not written at all
+		auto color_write_mask = has_fragment_stage ? vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+			vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA : vk::ColorComponentFlags();
 
 		auto pipeline_input_assembly_state_create_info = vk::PipelineInputAssemblyStateCreateInfo()
 			.setTopology(vk::PrimitiveTopology::eTriangleList);
@@ -1298,8 +1957,7 @@ void BackendVK::prepareForDrawing()
 			.setSrcAlphaBlendFactor(vk::BlendFactor::eOne)
 			.setDstAlphaBlendFactor(vk::BlendFactor::eOneMinusSrcAlpha)
 			.setAlphaBlendOp(vk::BlendOp::eAdd)
-			.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-				vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+			.setColorWriteMask(color_write_mask);
 
 		auto pipeline_color_blend_state_create_info = vk::PipelineColorBlendStateCreateInfo()
 			.setAttachmentCount(1)
@@ -1346,11 +2004,12 @@ void BackendVK::prepareForDrawing()
 			.setPNext(&pipeline_rendering_create_info);
 
 		gPipelines.insert({ gShader, gDevice.createGraphicsPipeline(nullptr, graphics_pipeline_create_info) });
+		GetCurrentFrameStats().pipelines_created += 1;
 	}
 
 	auto pipeline = *gPipelines.at(gShader);
 
-	gCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+	gCommandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
 
 	auto pipeline_layout = *gShader->pipeline_layout;
 
@@ -1367,28 +2026,43 @@ void BackendVK::prepareForDrawing()
 			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
 			.setPImageInfo(&descriptor_image_info);
 
-		gCommandBuffer.pushDescriptorSetKHR(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0, { write_descriptor_set });
+		gCommandBuffer->pushDescriptorSetKHR(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0, { write_descriptor_set });
 	}
 
 	gTexturesPushQueue.clear();
 
-	for (const auto& [slot, buffer] : gUniformBuffersPushQueue)
+	for (const auto& descriptor_set : gShader->reflection.descriptor_sets)
 	{
-		auto descriptor_buffer_info = vk::DescriptorBufferInfo()
-			.setBuffer(buffer)
-			.setRange(VK_WHOLE_SIZE);
+		if (descriptor_set.type != ShaderReflection::DescriptorSet::Type::UniformBuffer)
+			continue;
+
+		auto it = gUniformBuffers.find((uint32_t)descriptor_set.binding);
+
+		if (it == gUniformBuffers.end())
+			continue;
+
+		auto& uniform_buffer = it->second;
+
+		CheckUniformBufferSize(descriptor_set, uniform_buffer.data.size());
+
+		auto size = (size_t)descriptor_set.size;
+
+		if (uniform_buffer.pushed_size >= size)
+			continue;
+
+		auto [buffer, offset] = WriteTransientData(uniform_buffer.data.data(), size, gTransientRing.uniform_alignment);
+		auto descriptor_buffer_info = vk::DescriptorBufferInfo(buffer, offset, size);
 
 		auto write_descriptor_set = vk::WriteDescriptorSet()
 			.setDescriptorCount(1)
-			.setDstBinding(slot)
+			.setDstBinding(descriptor_set.binding)
 			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
 			.setPBufferInfo(&descriptor_buffer_info);
 
-		gCommandBuffer.pushDescriptorSetKHR(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0, { write_descriptor_set });
+		gCommandBuffer->pushDescriptorSetKHR(vk::PipelineBindPoint::eGraphics, pipeline_layout, 0, { write_descriptor_set });
+		uniform_buffer.pushed_size = size;
 	}
 
-	gUniformBuffersPushQueue.clear();
-
 	if (gViewportDirty)
 	{
 		auto value = gViewport.value_or(Viewport{ { 0.0f, 0.0f }, { static_cast<float>(gWidth), static_cast<float>(gHeight) } });
@@ -1401,7 +2075,7 @@ void BackendVK::prepareForDrawing()
 			.setMinDepth(value.min_depth)
 			.setMaxDepth(value.max_depth);
 
-		gCommandBuffer.setViewport(0, { viewport });
+		gCommandBuffer->setViewport(0, { viewport });
 		gViewportDirty = false;
 	}
 
@@ -1413,7 +2087,7 @@ void BackendVK::prepareForDrawing()
 			.setOffset({ static_cast<int32_t>(value.position.x), static_cast<int32_t>(value.position.y) })
 			.setExtent({ static_cast<uint32_t>(value.size.x), static_cast<uint32_t>(value.size.y) });
 
-		gCommandBuffer.setScissor(0, { rect });
+		gCommandBuffer->setScissor(0, { rect });
 		gScissorDirty = false;
 	}
 
@@ -1427,11 +2101,25 @@ void BackendVK::prepareForDrawing()
 			{ CullMode::Back, vk::CullModeFlagBits::eBack },
 		};
 
-		gCommandBuffer.setFrontFace(vk::FrontFace::eClockwise);
-		gCommandBuffer.setCullMode(CullModeMap.at(gCullMode));
+		gCommandBuffer->setFrontFace(vk::FrontFace::eClockwise);
+		gCommandBuffer->setCullMode(CullModeMap.at(gCullMode));
 
 		gCullModeDirty = false;
 	}
 }
 
+#else
+
+#include <stdexcept>
+
+std::vector<uint8_t> skygfx::ReadVulkanBackendOffscreenFrame(uint32_t frames_ago)
+{
+	throw std::runtime_error("vulkan backend is not built");
+}
+
+skygfx::VulkanMemoryStats skygfx::GetVulkanBackendMemoryStats()
+{
+	throw std::runtime_error("vulkan backend is not built");
+}
+
 #endif
\ No newline at end of file
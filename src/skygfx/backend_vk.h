@@ -1,9 +1,32 @@
 #pragma once
 
-#ifdef SKYGFX_HAS_VULKAN
-
 #include "backend.h"
 
+namespace skygfx
+{
+	// rgba8, top row first, available when the device was created without window.
+	// frames_ago selects one of the last offscreen frames, 0 is the last presented one.
+	// throws when the library is built without the vulkan backend
+	std::vector<uint8_t> ReadVulkanBackendOffscreenFrame(uint32_t frames_ago = 0);
+
+	// device memory blocks which images and buffers are carved from, bytes of all memory types.
+	// fragmentation is 0 when free space of every regular block is one range, close to 1 when it is scattered
+	struct VulkanMemoryStats
+	{
+		uint32_t block_count = 0;
+		uint32_t dedicated_block_count = 0;
+		uint32_t allocation_count = 0;
+		uint64_t block_bytes = 0;
+		uint64_t allocated_bytes = 0; // in power of two nodes, so includes internal fragmentation
+		uint64_t largest_free_range = 0;
+		float fragmentation = 0.0f;
+	};
+
+	VulkanMemoryStats GetVulkanBackendMemoryStats(); // throws when the library is built without the vulkan backend
+}
+
+#ifdef SKYGFX_HAS_VULKAN
+
 namespace skygfx
 {
 	class BackendVK : public Backend
@@ -23,6 +46,8 @@ namespace skygfx
 		void setShader(ShaderHandle* handle) override;
 		void setVertexBuffer(const Buffer& buffer) override;
 		void setIndexBuffer(const Buffer& buffer) override;
+		void setVertexBuffer(VertexBufferHandle* handle) override;
+		void setIndexBuffer(IndexBufferHandle* handle) override;
 		void setUniformBuffer(uint32_t slot, void* memory, size_t size) override;
 		void setBlendMode(const BlendMode& value) override;
 		void setDepthMode(std::optional<DepthMode> depth_mode) override;
@@ -40,6 +65,10 @@ namespace skygfx
 
 		void present() override;
 
+		void beginTimer(const std::string& name) override;
+		void endTimer() override;
+		const std::vector<GpuTimer>& getGpuTimers() override;
+
 		TextureHandle* createTexture(uint32_t width, uint32_t height, uint32_t channels, 
 			void* memory, bool mipmap) override;
 		void destroyTexture(TextureHandle* handle) override;
@@ -47,12 +76,28 @@ namespace skygfx
 		RenderTargetHandle* createRenderTarget(uint32_t width, uint32_t height, TextureHandle* texture) override;
 		void destroyRenderTarget(RenderTargetHandle* handle) override;
 
+		VertexBufferHandle* createVertexBuffer(void* memory, size_t size, size_t stride) override;
+		void destroyVertexBuffer(VertexBufferHandle* handle) override;
+		IndexBufferHandle* createIndexBuffer(void* memory, size_t size, size_t stride) override;
+		void destroyIndexBuffer(IndexBufferHandle* handle) override;
+
+#ifdef SKYGFX_RUNTIME_COMPILER
 		ShaderHandle* createShader(const Vertex::Layout& layout, const std::string& vertex_code, 
-			const std::string& fragment_code, const std::vector<std::string>& defines) override;
+			const std::string& fragment_code, const std::vector<std::string>& defines,
+			const SpecializationConstants& specialization_constants) override;
+#endif
+		ShaderHandle* createShader(const Vertex::Layout& layout, const CompiledShaderView& vertex,
+			const CompiledShaderView& fragment, const SpecializationConstants& specialization_constants) override;
 		void destroyShader(ShaderHandle* handle) override;
+#ifdef SKYGFX_RUNTIME_COMPILER
+		std::vector<std::shared_future<CompiledShader>> compileShaderAsync(const Vertex::Layout& layout,
+			const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& defines) override;
+#endif
 
 	private:
 		void createSwapchain(uint32_t width, uint32_t height);
+		void createOffscreenFrames(uint32_t width, uint32_t height);
+		void createDepthStencil(uint32_t width, uint32_t height);
 		void begin();
 		void end();
 		void prepareForDrawing();
@@ -0,0 +1,90 @@
+#include "buddy_allocator.h"
+
+#include <cassert>
+
+using namespace skygfx;
+
+BuddyAllocator::BuddyAllocator(size_t capacity, size_t min_node_size) :
+	mCapacity(capacity),
+	mMinNodeSize(min_node_size)
+{
+	assert(capacity >= min_node_size);
+	assert((capacity & (capacity - 1)) == 0);
+	assert((min_node_size & (min_node_size - 1)) == 0);
+
+	uint32_t max_order = 0;
+
+	while (getNodeSize(max_order) < capacity)
+		max_order += 1;
+
+	mFreeNodes.resize(max_order + 1);
+	mFreeNodes.at(max_order).insert(0);
+}
+
+std::optional<size_t> BuddyAllocator::allocate(size_t size, size_t alignment)
+{
+	// nodes are aligned to their size, so alignment is only a lower bound of the node size
+	uint32_t order = 0;
+
+	while (order < mFreeNodes.size() && (getNodeSize(order) < size || getNodeSize(order) < alignment))
+		order += 1;
+
+	auto free_order = order;
+
+	while (free_order < mFreeNodes.size() && mFreeNodes.at(free_order).empty())
+		free_order += 1;
+
+	if (free_order >= mFreeNodes.size())
+		return std::nullopt;
+
+	auto offset = *mFreeNodes.at(free_order).begin();
+	mFreeNodes.at(free_order).erase(mFreeNodes.at(free_order).begin());
+
+	// the upper halves of split nodes become free
+	while (free_order > order)
+	{
+		free_order -= 1;
+		mFreeNodes.at(free_order).insert(offset + getNodeSize(free_order));
+	}
+
+	mAllocations.insert({ offset, order });
+	mAllocatedSize += getNodeSize(order);
+	return offset;
+}
+
+void BuddyAllocator::free(size_t offset)
+{
+	auto it = mAllocations.find(offset);
+	assert(it != mAllocations.end());
+
+	auto order = it->second;
+	mAllocations.erase(it);
+	mAllocatedSize -= getNodeSize(order);
+
+	while (order + 1 < mFreeNodes.size())
+	{
+		auto buddy = offset ^ getNodeSize(order);
+		auto& free_nodes = mFreeNodes.at(order);
+		auto buddy_it = free_nodes.find(buddy);
+
+		if (buddy_it == free_nodes.end())
+			break;
+
+		free_nodes.erase(buddy_it);
+		offset &= ~getNodeSize(order);
+		order += 1;
+	}
+
+	mFreeNodes.at(order).insert(offset);
+}
+
+size_t BuddyAllocator::getLargestFreeSize() const
+{
+	for (auto order = mFreeNodes.size(); order > 0; order--)
+	{
+		if (!mFreeNodes.at(order - 1).empty())
+			return getNodeSize((uint32_t)order - 1);
+	}
+
+	return 0;
+}
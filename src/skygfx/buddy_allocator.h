@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace skygfx
+{
+	// splits a range of power of two capacity into power of two nodes, every node is aligned to its size.
+	// freed nodes are merged with their free buddies, so a block which had every node freed is whole again.
+	// the range itself belongs to the caller, the allocator only hands out offsets
+	class BuddyAllocator
+	{
+	public:
+		BuddyAllocator(size_t capacity, size_t min_node_size); // both are powers of two
+
+		// offset of the node, nullopt when there is no free node big enough
+		std::optional<size_t> allocate(size_t size, size_t alignment);
+		void free(size_t offset);
+
+		size_t getCapacity() const { return mCapacity; }
+		size_t getAllocatedSize() const { return mAllocatedSize; } // sizes of allocated nodes
+		size_t getAllocationCount() const { return mAllocations.size(); }
+		size_t getLargestFreeSize() const;
+		bool isEmpty() const { return mAllocations.empty(); }
+
+	private:
+		size_t getNodeSize(uint32_t order) const { return mMinNodeSize << order; }
+
+	private:
+		size_t mCapacity;
+		size_t mMinNodeSize;
+		size_t mAllocatedSize = 0;
+		std::vector<std::set<size_t>> mFreeNodes; // offsets by order, order 0 is the min node size
+		std::unordered_map<size_t, uint32_t> mAllocations; // order by offset
+	};
+}
@@ -0,0 +1,66 @@
+#include "ring_allocator.h"
+
+using namespace skygfx;
+
+RingAllocator::RingAllocator(size_t capacity) :
+	mCapacity(capacity)
+{
+}
+
+std::optional<size_t> RingAllocator::allocate(size_t size, size_t alignment)
+{
+	if (mUsedSize == 0)
+		mHead = 0; // nothing is in flight, start over to keep allocations of the frame together
+
+	auto free_size = mCapacity - mUsedSize;
+	auto offset = (mHead + alignment - 1) / alignment * alignment;
+
+	if (offset + size <= mCapacity)
+	{
+		auto required_size = offset - mHead + size;
+
+		if (required_size > free_size)
+			return std::nullopt;
+
+		mHead = offset + size;
+		mUsedSize += required_size;
+		mFrameSize += required_size;
+		return offset;
+	}
+
+	// does not fit before the end, the rest of the buffer is skipped and allocation starts from zero
+	auto required_size = mCapacity - mHead + size;
+
+	if (required_size > free_size)
+		return std::nullopt;
+
+	mHead = size;
+	mUsedSize += required_size;
+	mFrameSize += required_size;
+	return 0;
+}
+
+uint64_t RingAllocator::endFrame()
+{
+	mClosedFrames.push_back({ mFrame, mFrameSize });
+	mFrameSize = 0;
+	return mFrame++;
+}
+
+void RingAllocator::retire(uint64_t frame)
+{
+	while (!mClosedFrames.empty() && mClosedFrames.front().frame <= frame)
+	{
+		mUsedSize -= mClosedFrames.front().size;
+		mClosedFrames.pop_front();
+	}
+}
+
+void RingAllocator::reset(size_t capacity)
+{
+	mCapacity = capacity;
+	mHead = 0;
+	mUsedSize = 0;
+	mFrameSize = 0;
+	mClosedFrames.clear();
+}
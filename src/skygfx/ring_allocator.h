@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+namespace skygfx
+{
+	// sub-allocates transient data of frames from a buffer of fixed capacity, the buffer itself belongs
+	// to the backend. allocations go forward and wrap around, space of a frame is reused only after the
+	// frame is retired, that is when the gpu is known to be done with it
+	class RingAllocator
+	{
+	public:
+		RingAllocator(size_t capacity = 0);
+
+		// offset of the allocation, nullopt when free space does not fit the size
+		std::optional<size_t> allocate(size_t size, size_t alignment);
+
+		// closes the frame in progress and returns its number for retire
+		uint64_t endFrame();
+
+		// frees space of the given frame and every frame before it
+		void retire(uint64_t frame);
+
+		// drops every allocation, used when the backend replaces or discards the buffer.
+		// frame numbers keep going, so frames closed before are retired as no-op
+		void reset(size_t capacity);
+
+		size_t getCapacity() const { return mCapacity; }
+		size_t getUsedSize() const { return mUsedSize; }
+		uint64_t getFrame() const { return mFrame; } // number of the frame in progress
+
+	private:
+		struct ClosedFrame
+		{
+			uint64_t frame;
+			size_t size; // allocations of the frame with alignment padding and the skipped end of the buffer
+		};
+
+		size_t mCapacity;
+		size_t mHead = 0;
+		size_t mUsedSize = 0;
+		size_t mFrameSize = 0;
+		uint64_t mFrame = 0;
+		std::deque<ClosedFrame> mClosedFrames;
+	};
+}
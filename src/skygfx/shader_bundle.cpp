@@ -0,0 +1,323 @@
+#include "shader_bundle.h"
+#include "backend.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace skygfx;
+
+// file layout, every value is uint32_t:
+// header: magic, version, entry count
+// entry: name offset, name size, backend, attribute count, attributes offset, vertex stage, fragment stage
+// stage: spirv offset, spirv size in words, source offset, source size, reflection offset, reflection size
+// offsets are from the start of the file, spirv is 4 byte aligned and sources are null terminated.
+// reflection is in the form of WriteShaderReflection. a stage without spirv is missing, see CompiledShaderView
+
+static const uint32_t ShaderBundleMagic = 0x42534B53; // "SKSB"
+static const uint32_t ShaderBundleVersion = 2;
+
+static const uint32_t HeaderWords = 3;
+static const uint32_t StageWords = 6;
+static const uint32_t EntryWords = 5 + StageWords * 2;
+
+ShaderBundle::ShaderBundle(const std::string& path)
+{
+#ifdef _WIN32
+	auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("cannot open shader bundle " + path);
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	mSize = (size_t)size.QuadPart;
+
+	if (mSize > 0)
+	{
+		auto mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (mapping != NULL)
+		{
+			mMapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping); // the view keeps the mapping alive
+		}
+	}
+
+	CloseHandle(file);
+#else
+	auto file = open(path.c_str(), O_RDONLY);
+
+	if (file == -1)
+		throw std::runtime_error("cannot open shader bundle " + path);
+
+	struct stat info;
+	fstat(file, &info);
+	mSize = (size_t)info.st_size;
+
+	if (mSize > 0)
+	{
+		auto mapping = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (mapping != MAP_FAILED)
+			mMapping = mapping;
+	}
+
+	close(file);
+#endif
+
+	if (mMapping == nullptr)
+		throw std::runtime_error("cannot map shader bundle " + path);
+
+	mMemory = (const uint8_t*)mMapping;
+
+	try
+	{
+		parse();
+	}
+	catch (...)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mMapping);
+#else
+		munmap(mMapping, mSize);
+#endif
+		throw;
+	}
+}
+
+ShaderBundle::ShaderBundle(const void* memory, size_t size) :
+	mMemory((const uint8_t*)memory),
+	mSize(size)
+{
+	if ((uintptr_t)memory % sizeof(uint32_t) != 0)
+		throw std::runtime_error("shader bundle memory is not aligned");
+
+	parse();
+}
+
+ShaderBundle::~ShaderBundle()
+{
+	if (mMapping == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(mMapping);
+#else
+	munmap(mMapping, mSize);
+#endif
+}
+
+const ShaderBundle::Entry* ShaderBundle::find(const std::string& name, BackendType backend) const
+{
+	for (const auto& entry : mEntries)
+	{
+		if (entry.backend == backend && entry.name == name)
+			return &entry;
+	}
+
+	return nullptr;
+}
+
+void ShaderBundle::parse()
+{
+	auto invalid = [] {
+		return std::runtime_error("shader bundle is corrupted");
+	};
+
+	auto checkRange = [&](uint64_t offset, uint64_t size) {
+		if (offset + size > mSize)
+			throw invalid();
+	};
+
+	auto words = (const uint32_t*)mMemory;
+
+	checkRange(0, HeaderWords * sizeof(uint32_t));
+
+	if (words[0] != ShaderBundleMagic)
+		throw invalid();
+
+	if (words[1] != ShaderBundleVersion)
+		throw std::runtime_error("shader bundle version is not supported, rebuild it with skygfx-shaderc");
+
+	auto entry_count = words[2];
+
+	checkRange(HeaderWords * sizeof(uint32_t), (uint64_t)entry_count * EntryWords * sizeof(uint32_t));
+
+	auto readStage = [&](const uint32_t* stage_words, ShaderStage stage) {
+		auto spirv_offset = stage_words[0];
+		auto spirv_size = stage_words[1];
+		auto source_offset = stage_words[2];
+		auto source_size = stage_words[3];
+		auto reflection_offset = stage_words[4];
+		auto reflection_size = stage_words[5];
+
+		if (spirv_offset % sizeof(uint32_t) != 0)
+			throw invalid();
+
+		checkRange(spirv_offset, (uint64_t)spirv_size * sizeof(uint32_t));
+		checkRange(source_offset, (uint64_t)source_size + 1);
+		checkRange(reflection_offset, reflection_size);
+
+		if (mMemory[source_offset + source_size] != '\0')
+			throw invalid();
+
+		auto result = CompiledShaderView();
+
+		if (spirv_size == 0)
+			return result;
+
+		result.spirv = { (const uint32_t*)(mMemory + spirv_offset), spirv_size };
+		result.source = { (const char*)(mMemory + source_offset), source_size };
+		result.reflection = ReadShaderReflection(mMemory + reflection_offset, reflection_size);
+
+		if (result.reflection.stage != stage)
+			throw invalid();
+
+		return result;
+	};
+
+	for (uint32_t i = 0; i < entry_count; i++)
+	{
+		auto entry_words = words + HeaderWords + i * EntryWords;
+		auto name_offset = entry_words[0];
+		auto name_size = entry_words[1];
+		auto attribute_count = entry_words[3];
+		auto attributes_offset = entry_words[4];
+
+		if (attributes_offset % sizeof(uint32_t) != 0)
+			throw invalid();
+
+		checkRange(name_offset, name_size);
+		checkRange(attributes_offset, (uint64_t)attribute_count * sizeof(uint32_t));
+
+		auto entry = Entry();
+		entry.name = std::string((const char*)(mMemory + name_offset), name_size);
+		entry.backend = (BackendType)entry_words[2];
+
+		auto attributes = (const uint32_t*)(mMemory + attributes_offset);
+
+		for (uint32_t j = 0; j < attribute_count; j++)
+		{
+			entry.attributes.push_back((Vertex::Attribute::Type)attributes[j]);
+		}
+
+		entry.vertex = readStage(entry_words + 5, ShaderStage::Vertex);
+		entry.fragment = readStage(entry_words + 5 + StageWords, ShaderStage::Fragment);
+
+		mEntries.push_back(std::move(entry));
+	}
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+
+class ShaderBundleWriter
+{
+public:
+	ShaderBundleWriter(size_t entry_count) :
+		mTable(HeaderWords + entry_count * EntryWords, 0)
+	{
+		mTable[0] = ShaderBundleMagic;
+		mTable[1] = ShaderBundleVersion;
+		mTable[2] = (uint32_t)entry_count;
+	}
+
+	void writeEntry(size_t index, const std::string& name, BackendType backend,
+		const std::vector<Vertex::Attribute::Type>& attributes, const CompiledShader& vertex,
+		const CompiledShader& fragment)
+	{
+		auto entry_words = mTable.data() + HeaderWords + index * EntryWords;
+		entry_words[0] = writeData(name.data(), name.size());
+		entry_words[1] = (uint32_t)name.size();
+		entry_words[2] = (uint32_t)backend;
+		entry_words[3] = (uint32_t)attributes.size();
+
+		std::vector<uint32_t> attribute_words;
+
+		for (auto attribute : attributes)
+		{
+			attribute_words.push_back((uint32_t)attribute);
+		}
+
+		entry_words[4] = writeWords(attribute_words);
+
+		writeStage(entry_words + 5, vertex);
+		writeStage(entry_words + 5 + StageWords, fragment);
+	}
+
+	void flush(std::ostream& stream) const
+	{
+		stream.write((const char*)mTable.data(), mTable.size() * sizeof(uint32_t));
+		stream.write((const char*)mData.data(), mData.size());
+	}
+
+private:
+	void writeStage(uint32_t* stage_words, const CompiledShader& shader)
+	{
+		auto reflection = WriteShaderReflection(shader.reflection);
+
+		stage_words[0] = writeWords(shader.spirv);
+		stage_words[1] = (uint32_t)shader.spirv.size();
+		stage_words[2] = writeData(shader.source.c_str(), shader.source.size() + 1);
+		stage_words[3] = (uint32_t)shader.source.size();
+		stage_words[4] = writeData(reflection.data(), reflection.size());
+		stage_words[5] = (uint32_t)reflection.size();
+	}
+
+	uint32_t writeWords(const std::vector<uint32_t>& words)
+	{
+		mData.resize((mData.size() + sizeof(uint32_t) - 1) / sizeof(uint32_t) * sizeof(uint32_t));
+		return writeData(words.data(), words.size() * sizeof(uint32_t));
+	}
+
+	uint32_t writeData(const void* data, size_t size)
+	{
+		auto offset = mTable.size() * sizeof(uint32_t) + mData.size();
+		mData.insert(mData.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+		return (uint32_t)offset;
+	}
+
+private:
+	std::vector<uint32_t> mTable;
+	std::vector<uint8_t> mData;
+};
+
+void skygfx::WriteShaderBundle(std::ostream& stream, const std::vector<ShaderBundleSource>& sources,
+	const std::vector<BackendType>& backends)
+{
+	auto writer = ShaderBundleWriter(sources.size() * backends.size());
+	size_t index = 0;
+
+	for (const auto& source : sources)
+	{
+		// only attribute types affect compilation, through the location defines
+		auto layout = Vertex::Layout();
+
+		for (auto attribute : source.attributes)
+		{
+			layout.attributes.push_back({ attribute });
+		}
+
+		for (auto backend : backends)
+		{
+			auto target = GetShaderTarget(backend);
+			auto defines = MakeShaderDefines(backend, layout, source.defines);
+			auto vertex = CompileShader(ShaderStage::Vertex, target, source.vertex_code, defines);
+			auto fragment = source.fragment_code.empty() ? CompiledShader() :
+				CompileShader(ShaderStage::Fragment, target, source.fragment_code, defines);
+
+			writer.writeEntry(index++, source.name, backend, source.attributes, vertex, fragment);
+		}
+	}
+
+	writer.flush(stream);
+}
+
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "skygfx.h"
+#include "shader_cache.h"
+#include <ostream>
+
+namespace skygfx
+{
+	// shaders precompiled for several backends in one file, written by skygfx-shaderc.
+	// the file is memory mapped and stages are handed to the backend from the mapping,
+	// so creating a shader from a bundle runs no glsl or spirv compilers
+	class ShaderBundle
+	{
+	public:
+		struct Entry
+		{
+			std::string name;
+			BackendType backend;
+			std::vector<Vertex::Attribute::Type> attributes; // vertex layout the stages were compiled for
+			CompiledShaderView vertex;
+			CompiledShaderView fragment;
+		};
+
+	public:
+		ShaderBundle(const std::string& path);
+		ShaderBundle(const void* memory, size_t size); // memory must be 4 byte aligned and outlive the bundle
+		~ShaderBundle();
+
+		ShaderBundle(const ShaderBundle&) = delete;
+		ShaderBundle& operator=(const ShaderBundle&) = delete;
+
+		const Entry* find(const std::string& name, BackendType backend) const;
+		const std::vector<Entry>& getEntries() const { return mEntries; }
+
+	private:
+		void parse();
+
+	private:
+		const uint8_t* mMemory = nullptr;
+		size_t mSize = 0;
+		void* mMapping = nullptr; // not null when the file is mapped by the bundle
+		std::vector<Entry> mEntries;
+	};
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+	struct ShaderBundleSource
+	{
+		std::string name;
+		std::vector<Vertex::Attribute::Type> attributes;
+		std::string vertex_code;
+		std::string fragment_code; // empty for depth-only shaders
+		std::vector<std::string> defines;
+	};
+
+	// compiles every source for every backend, throws on compile errors
+	void WriteShaderBundle(std::ostream& stream, const std::vector<ShaderBundleSource>& sources,
+		const std::vector<BackendType>& backends);
+#endif
+}
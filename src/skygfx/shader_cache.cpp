@@ -0,0 +1,732 @@
+#include "shader_cache.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+using namespace skygfx;
+
+// bump when the entry layout or the output of the compilers changes, old entries are ignored then
+static const uint32_t ShaderCacheMagic = 0x43534B53; // "SKSC"
+static const uint32_t ShaderCacheVersion = 3;
+
+static std::mutex gShaderCacheMutex;
+static std::unordered_map<uint64_t, CompiledShader> gShaderCache;
+static ShaderCacheStats gShaderCacheStats;
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+
+static std::string gShaderCacheDirectory;
+static std::atomic<uint32_t> gShaderCompilerThreadCount = 0; // 0 is one per hardware thread
+
+static SpirvOptimizationOptions MakeDefaultSpirvOptimizationOptions()
+{
+	auto options = SpirvOptimizationOptions();
+#ifndef SKYGFX_SPIRV_KEEP_DEBUG_INFO
+	options.strip_debug_info = true;
+#endif
+	return options;
+}
+
+static SpirvOptimizationOptions gSpirvOptimizationOptions = MakeDefaultSpirvOptimizationOptions();
+
+class ShaderCompilerThreads
+{
+public:
+	ShaderCompilerThreads(uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			mThreads.emplace_back([this] {
+				work();
+			});
+		}
+	}
+
+	~ShaderCompilerThreads()
+	{
+		{
+			std::lock_guard lock(mMutex);
+			mStopping = true;
+		}
+
+		mCondition.notify_all();
+
+		for (auto& thread : mThreads)
+		{
+			thread.join();
+		}
+	}
+
+	void push(std::function<void()> task)
+	{
+		{
+			std::lock_guard lock(mMutex);
+			mTasks.push_back(std::move(task));
+		}
+
+		mCondition.notify_one();
+	}
+
+private:
+	void work()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+
+			{
+				std::unique_lock lock(mMutex);
+
+				mCondition.wait(lock, [this] {
+					return mStopping || !mTasks.empty();
+				});
+
+				if (mStopping)
+					return;
+
+				task = std::move(mTasks.front());
+				mTasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+private:
+	std::vector<std::thread> mThreads;
+	std::deque<std::function<void()>> mTasks;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mStopping = false;
+};
+
+static ShaderCompilerThreads& GetShaderCompilerThreads()
+{
+	static ShaderCompilerThreads threads(gShaderCompilerThreadCount > 0 ? gShaderCompilerThreadCount.load() :
+		std::max(std::thread::hardware_concurrency(), 1u));
+
+	return threads;
+}
+
+#endif
+
+// fnv-1a, stable between runs and platforms, unlike std::hash
+
+static void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+	auto bytes = (const uint8_t*)data;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3;
+	}
+}
+
+template <class T>
+static void HashValue(uint64_t& hash, const T& value)
+{
+	HashBytes(hash, &value, sizeof(T));
+}
+
+static void HashString(uint64_t& hash, const std::string& value)
+{
+	HashValue(hash, (uint64_t)value.size());
+	HashBytes(hash, value.data(), value.size());
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+
+static uint64_t MakeShaderCacheKey(ShaderStage stage, ShaderTarget target, const std::string& code,
+	const std::vector<std::string>& defines, const SpirvOptimizationOptions& optimization)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	HashValue(hash, ShaderCacheVersion);
+	HashValue(hash, (uint32_t)stage);
+	HashValue(hash, (uint32_t)target);
+	HashValue(hash, optimization.remove_dead_code);
+	HashValue(hash, optimization.optimize_load_store);
+	HashValue(hash, optimization.strip_debug_info);
+	HashValue(hash, optimization.remap_ids);
+	HashString(hash, code);
+	HashValue(hash, (uint64_t)defines.size());
+
+	for (const auto& define : defines)
+	{
+		HashString(hash, define);
+	}
+
+	return hash;
+}
+
+#endif
+
+static uint64_t MakeSpecializationCacheKey(const CompiledShaderView& shader, ShaderTarget target,
+	const SpecializationConstants& constants)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	HashString(hash, "specialization");
+	HashValue(hash, ShaderCacheVersion);
+	HashValue(hash, (uint32_t)target);
+	HashValue(hash, (uint64_t)shader.spirv.size());
+	HashBytes(hash, shader.spirv.data(), shader.spirv.size_bytes());
+	HashValue(hash, (uint64_t)constants.size());
+
+	for (const auto& [id, value] : constants)
+	{
+		HashValue(hash, id);
+		HashValue(hash, value);
+	}
+
+	return hash;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+
+static std::filesystem::path GetShaderCacheEntryPath(const std::string& directory, uint64_t key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	return std::filesystem::path(directory) / name;
+}
+
+template <class T>
+static void Write(std::ostream& stream, const T& value)
+{
+	stream.write((const char*)&value, sizeof(T));
+}
+
+template <class T>
+static bool Read(std::istream& stream, T& value)
+{
+	stream.read((char*)&value, sizeof(T));
+	return stream.good();
+}
+
+#endif
+
+class ReflectionWriter
+{
+public:
+	template <class T>
+	void write(const T& value)
+	{
+		auto bytes = (const uint8_t*)&value;
+		mData.insert(mData.end(), bytes, bytes + sizeof(T));
+	}
+
+	void write(const std::string& value)
+	{
+		write((uint32_t)value.size());
+		mData.insert(mData.end(), value.begin(), value.end());
+	}
+
+	void write(const std::vector<ShaderReflection::Member>& members)
+	{
+		write((uint32_t)members.size());
+
+		for (const auto& member : members)
+		{
+			write(member.name);
+			write(member.offset);
+			write(member.size);
+			write((uint32_t)member.type);
+			write(member.components);
+			write(member.columns);
+			write(member.array_size);
+		}
+	}
+
+	auto& getData() { return mData; }
+
+private:
+	std::vector<uint8_t> mData;
+};
+
+class ReflectionReader
+{
+public:
+	ReflectionReader(const void* data, size_t size) : mData((const uint8_t*)data), mSize(size) {}
+
+	template <class T>
+	T read()
+	{
+		T value;
+		readBytes(&value, sizeof(T));
+		return value;
+	}
+
+	std::string readString()
+	{
+		auto size = read<uint32_t>();
+		auto result = std::string(size, '\0');
+		readBytes(result.data(), size);
+		return result;
+	}
+
+	std::vector<ShaderReflection::Member> readMembers()
+	{
+		std::vector<ShaderReflection::Member> result(readCount());
+
+		for (auto& member : result)
+		{
+			member.name = readString();
+			member.offset = read<uint32_t>();
+			member.size = read<uint32_t>();
+			member.type = (ShaderReflection::DataType)read<uint32_t>();
+			member.components = read<uint32_t>();
+			member.columns = read<uint32_t>();
+			member.array_size = read<uint32_t>();
+		}
+
+		return result;
+	}
+
+	size_t readCount()
+	{
+		auto count = read<uint32_t>();
+
+		// every element takes at least one byte, so bad counts fail before allocating
+		if (count > mSize - mPosition)
+			throw std::runtime_error("shader reflection is corrupted");
+
+		return count;
+	}
+
+private:
+	void readBytes(void* dst, size_t size)
+	{
+		if (size > mSize - mPosition)
+			throw std::runtime_error("shader reflection is corrupted");
+
+		memcpy(dst, mData + mPosition, size);
+		mPosition += size;
+	}
+
+private:
+	const uint8_t* mData;
+	size_t mSize;
+	size_t mPosition = 0;
+};
+
+std::vector<uint8_t> skygfx::WriteShaderReflection(const ShaderReflection& reflection)
+{
+	ReflectionWriter writer;
+	writer.write((uint32_t)reflection.stage);
+	writer.write((uint32_t)reflection.descriptor_sets.size());
+
+	for (const auto& descriptor_set : reflection.descriptor_sets)
+	{
+		writer.write((int32_t)descriptor_set.binding);
+		writer.write((uint32_t)descriptor_set.type);
+		writer.write(descriptor_set.name);
+		writer.write(descriptor_set.stages);
+		writer.write(descriptor_set.size);
+		writer.write(descriptor_set.members);
+	}
+
+	writer.write((uint32_t)reflection.push_constant_blocks.size());
+
+	for (const auto& block : reflection.push_constant_blocks)
+	{
+		writer.write(block.name);
+		writer.write(block.offset);
+		writer.write(block.size);
+		writer.write(block.stages);
+		writer.write(block.members);
+	}
+
+	writer.write((uint32_t)reflection.inputs.size());
+
+	for (const auto& input : reflection.inputs)
+	{
+		writer.write(input.location);
+		writer.write(input.name);
+		writer.write((uint32_t)input.type);
+		writer.write(input.components);
+	}
+
+	return std::move(writer.getData());
+}
+
+ShaderReflection skygfx::ReadShaderReflection(const void* data, size_t size)
+{
+	ReflectionReader reader(data, size);
+
+	ShaderReflection result;
+	result.stage = (ShaderStage)reader.read<uint32_t>();
+	result.descriptor_sets.resize(reader.readCount());
+
+	for (auto& descriptor_set : result.descriptor_sets)
+	{
+		descriptor_set.binding = reader.read<int32_t>();
+		descriptor_set.type = (ShaderReflection::DescriptorSet::Type)reader.read<uint32_t>();
+		descriptor_set.name = reader.readString();
+		descriptor_set.stages = reader.read<uint32_t>();
+		descriptor_set.size = reader.read<uint32_t>();
+		descriptor_set.members = reader.readMembers();
+	}
+
+	result.push_constant_blocks.resize(reader.readCount());
+
+	for (auto& block : result.push_constant_blocks)
+	{
+		block.name = reader.readString();
+		block.offset = reader.read<uint32_t>();
+		block.size = reader.read<uint32_t>();
+		block.stages = reader.read<uint32_t>();
+		block.members = reader.readMembers();
+	}
+
+	result.inputs.resize(reader.readCount());
+
+	for (auto& input : result.inputs)
+	{
+		input.location = reader.read<uint32_t>();
+		input.name = reader.readString();
+		input.type = (ShaderReflection::DataType)reader.read<uint32_t>();
+		input.components = reader.read<uint32_t>();
+	}
+
+	return result;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+
+static void WriteShaderCacheEntry(const std::string& directory, uint64_t key, const CompiledShader& shader)
+{
+	// written next to the final file and renamed, so other processes never see partial entries
+
+	auto path = GetShaderCacheEntryPath(directory, key);
+	auto temp_path = path;
+	temp_path += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	{
+		auto stream = std::ofstream(temp_path, std::ios::binary);
+
+		if (!stream)
+			return;
+
+		Write(stream, ShaderCacheMagic);
+		Write(stream, ShaderCacheVersion);
+		Write(stream, key);
+		Write(stream, (uint32_t)shader.spirv.size());
+		stream.write((const char*)shader.spirv.data(), shader.spirv.size() * sizeof(uint32_t));
+		Write(stream, (uint32_t)shader.source.size());
+		stream.write(shader.source.data(), shader.source.size());
+		auto reflection = WriteShaderReflection(shader.reflection);
+		Write(stream, (uint32_t)reflection.size());
+		stream.write((const char*)reflection.data(), reflection.size());
+		Write(stream, (uint32_t)shader.includes.size());
+
+		for (const auto& include : shader.includes)
+		{
+			Write(stream, (uint32_t)include.name.size());
+			stream.write(include.name.data(), include.name.size());
+			Write(stream, include.hash);
+		}
+
+		if (!stream)
+		{
+			stream.close();
+			std::filesystem::remove(temp_path, error);
+			return;
+		}
+	}
+
+	std::filesystem::rename(temp_path, path, error);
+
+	if (error)
+		std::filesystem::remove(temp_path, error);
+}
+
+static std::optional<CompiledShader> ReadShaderCacheEntry(const std::string& directory, uint64_t key)
+{
+	auto stream = std::ifstream(GetShaderCacheEntryPath(directory, key), std::ios::binary);
+
+	if (!stream)
+		return std::nullopt;
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint64_t entry_key = 0;
+
+	if (!Read(stream, magic) || !Read(stream, version) || !Read(stream, entry_key))
+		return std::nullopt;
+
+	if (magic != ShaderCacheMagic || version != ShaderCacheVersion || entry_key != key)
+		return std::nullopt;
+
+	auto shader = CompiledShader();
+
+	uint32_t spirv_size = 0;
+
+	if (!Read(stream, spirv_size))
+		return std::nullopt;
+
+	shader.spirv.resize(spirv_size);
+	stream.read((char*)shader.spirv.data(), spirv_size * sizeof(uint32_t));
+
+	uint32_t source_size = 0;
+
+	if (!Read(stream, source_size))
+		return std::nullopt;
+
+	shader.source.resize(source_size);
+	stream.read(shader.source.data(), source_size);
+
+	uint32_t reflection_size = 0;
+
+	if (!Read(stream, reflection_size))
+		return std::nullopt;
+
+	std::vector<uint8_t> reflection(reflection_size);
+	stream.read((char*)reflection.data(), reflection_size);
+
+	uint32_t include_count = 0;
+
+	if (!Read(stream, include_count))
+		return std::nullopt;
+
+	for (uint32_t i = 0; i < include_count; i++)
+	{
+		auto include = ShaderIncludeDependency();
+		uint32_t name_size = 0;
+
+		if (!Read(stream, name_size))
+			return std::nullopt;
+
+		include.name.resize(name_size);
+		stream.read(include.name.data(), name_size);
+
+		if (!Read(stream, include.hash))
+			return std::nullopt;
+
+		shader.includes.push_back(std::move(include));
+	}
+
+	if (!stream)
+		return std::nullopt;
+
+	try
+	{
+		shader.reflection = ReadShaderReflection(reflection.data(), reflection.size());
+	}
+	catch (const std::exception&)
+	{
+		return std::nullopt;
+	}
+
+	return shader;
+}
+
+static bool AreShaderIncludesUpToDate(const CompiledShader& shader)
+{
+	return std::all_of(shader.includes.begin(), shader.includes.end(), [](const auto& include) {
+		return GetShaderIncludeHash(include.name) == include.hash;
+	});
+}
+
+CompiledShader skygfx::CompileShader(ShaderStage stage, ShaderTarget target, const std::string& code,
+	const std::vector<std::string>& defines)
+{
+	SKYGFX_TRACE_SCOPE("CompileShader");
+
+	SpirvOptimizationOptions optimization;
+
+	{
+		std::lock_guard lock(gShaderCacheMutex);
+		optimization = gSpirvOptimizationOptions;
+	}
+
+	auto key = MakeShaderCacheKey(stage, target, code, defines, optimization);
+
+	std::string directory;
+	std::optional<CompiledShader> cached;
+
+	{
+		std::lock_guard lock(gShaderCacheMutex);
+
+		if (gShaderCache.contains(key))
+			cached = gShaderCache.at(key);
+
+		directory = gShaderCacheDirectory;
+	}
+
+	// includes are checked outside of the lock, the include loader may be slow
+	if (cached.has_value() && AreShaderIncludesUpToDate(cached.value()))
+	{
+		std::lock_guard lock(gShaderCacheMutex);
+		gShaderCacheStats.memory_hits += 1;
+		return cached.value();
+	}
+
+	// compilation runs outside of the lock, two threads can compile the same shader at once,
+	// the result is the same
+
+	std::optional<CompiledShader> shader;
+
+	if (!directory.empty())
+		shader = ReadShaderCacheEntry(directory, key);
+
+	if (shader.has_value() && !AreShaderIncludesUpToDate(shader.value()))
+		shader.reset();
+
+	bool disk_hit = shader.has_value();
+
+	if (!disk_hit)
+	{
+		shader.emplace();
+		// reflected before stripping, so names of blocks, members and inputs are kept
+
+		auto dead_code_optimization = optimization;
+		dead_code_optimization.strip_debug_info = false;
+		dead_code_optimization.remap_ids = false;
+
+		auto strip_optimization = SpirvOptimizationOptions{ false, false, optimization.strip_debug_info, optimization.remap_ids };
+
+		shader->spirv = OptimizeSpirv(CompileGlslToSpirv(stage, code, defines, &shader->includes), dead_code_optimization);
+		shader->reflection = MakeSpirvReflection(shader->spirv);
+		shader->spirv = OptimizeSpirv(shader->spirv, strip_optimization);
+
+		if (target == ShaderTarget::Hlsl)
+			shader->source = CompileSpirvToHlsl(shader->spirv);
+		else if (target == ShaderTarget::Glsl)
+			shader->source = CompileSpirvToGlsl(shader->spirv);
+		else if (target == ShaderTarget::Msl)
+			shader->source = CompileSpirvToMsl(shader->spirv);
+
+		if (!directory.empty())
+			WriteShaderCacheEntry(directory, key, shader.value());
+	}
+
+	std::lock_guard lock(gShaderCacheMutex);
+
+	if (disk_hit)
+		gShaderCacheStats.disk_hits += 1;
+	else
+		gShaderCacheStats.misses += 1;
+
+	gShaderCache.insert_or_assign(key, shader.value());
+
+	return shader.value();
+}
+
+#endif
+
+CompiledShader skygfx::SpecializeShader(const CompiledShaderView& shader, ShaderTarget target,
+	const SpecializationConstants& constants)
+{
+	SKYGFX_TRACE_SCOPE("SpecializeShader");
+
+	auto key = MakeSpecializationCacheKey(shader, target, constants);
+
+	{
+		std::lock_guard lock(gShaderCacheMutex);
+
+		if (gShaderCache.contains(key))
+		{
+			gShaderCacheStats.memory_hits += 1;
+			return gShaderCache.at(key);
+		}
+	}
+
+	auto result = CompiledShader();
+	result.spirv.assign(shader.spirv.begin(), shader.spirv.end());
+	result.reflection = shader.reflection;
+
+	if (target == ShaderTarget::Spirv)
+		result.spirv = SpecializeSpirv(result.spirv, constants);
+#ifdef SKYGFX_RUNTIME_COMPILER
+	else if (target == ShaderTarget::Hlsl)
+		result.source = CompileSpirvToHlsl(result.spirv, constants);
+	else if (target == ShaderTarget::Glsl)
+		result.source = CompileSpirvToGlsl(result.spirv, constants);
+	else if (target == ShaderTarget::Msl)
+		result.source = CompileSpirvToMsl(result.spirv, constants);
+#else
+	else
+		throw std::runtime_error("spirv can not be translated without SKYGFX_RUNTIME_COMPILER");
+#endif
+
+	std::lock_guard lock(gShaderCacheMutex);
+	gShaderCacheStats.misses += 1;
+	gShaderCache.insert({ key, result });
+
+	return result;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+
+std::shared_future<CompiledShader> skygfx::CompileShaderAsync(ShaderStage stage, ShaderTarget target, const std::string& code,
+	const std::vector<std::string>& defines)
+{
+	auto task = std::make_shared<std::packaged_task<CompiledShader()>>([stage, target, code, defines] {
+		return CompileShader(stage, target, code, defines);
+	});
+
+	auto future = task->get_future().share();
+
+	GetShaderCompilerThreads().push([task] {
+		(*task)();
+	});
+
+	return future;
+}
+
+void skygfx::SetShaderCompilerThreadCount(uint32_t count)
+{
+	gShaderCompilerThreadCount = count;
+}
+
+void skygfx::SetSpirvOptimizationOptions(const SpirvOptimizationOptions& options)
+{
+	std::lock_guard lock(gShaderCacheMutex);
+	gSpirvOptimizationOptions = options;
+}
+
+SpirvOptimizationOptions skygfx::GetSpirvOptimizationOptions()
+{
+	std::lock_guard lock(gShaderCacheMutex);
+	return gSpirvOptimizationOptions;
+}
+
+void skygfx::SetShaderCacheDirectory(const std::string& path)
+{
+	std::lock_guard lock(gShaderCacheMutex);
+	gShaderCacheDirectory = path;
+}
+
+std::string skygfx::GetShaderCacheDirectory()
+{
+	std::lock_guard lock(gShaderCacheMutex);
+	return gShaderCacheDirectory;
+}
+
+#endif
+
+void skygfx::ClearShaderCache()
+{
+	std::lock_guard lock(gShaderCacheMutex);
+	gShaderCache.clear();
+}
+
+ShaderCacheStats skygfx::GetShaderCacheStats()
+{
+	std::lock_guard lock(gShaderCacheMutex);
+	return gShaderCacheStats;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "shader_compiler.h"
+#include <future>
+#include <span>
+#include <string_view>
+
+namespace skygfx
+{
+	enum class ShaderTarget
+	{
+		Spirv, // no translation
+		Hlsl,
+		Glsl,
+		Msl
+	};
+
+	struct CompiledShader
+	{
+		std::vector<uint32_t> spirv;
+		std::string source; // translated for the target, empty for ShaderTarget::Spirv
+		ShaderReflection reflection;
+#ifdef SKYGFX_RUNTIME_COMPILER
+		std::vector<ShaderIncludeDependency> includes; // files of SetShaderInclude the stage was compiled with
+#endif
+	};
+
+	// compiled stage which does not own its memory, points into CompiledShader or a shader bundle.
+	// a view without spirv stands for a missing stage, such as the fragment stage of a depth-only shader
+	struct CompiledShaderView
+	{
+		CompiledShaderView() = default;
+		CompiledShaderView(const CompiledShader& shader) :
+			spirv(shader.spirv), source(shader.source), reflection(shader.reflection) {}
+
+		std::span<const uint32_t> spirv;
+		std::string_view source; // null terminated
+		ShaderReflection reflection;
+	};
+
+	// binary form of reflection in shader cache entries and shader bundles, reading throws on malformed data
+	std::vector<uint8_t> WriteShaderReflection(const ShaderReflection& reflection);
+	ShaderReflection ReadShaderReflection(const void* data, size_t size);
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+	// compiles glsl through a two-tier cache: in-process first, then the cache directory when it is set.
+	// entries are keyed by a hash of stage, target, source and defines, vertex layout takes part in the key
+	// through its location defines. entries remember the include files they were compiled with and are
+	// compiled again when one of them changes. safe to call from several threads
+	CompiledShader CompileShader(ShaderStage stage, ShaderTarget target, const std::string& code,
+		const std::vector<std::string>& defines = {});
+
+	// same as CompileShader, but runs on the shader compiler threads, one per hardware thread by default.
+	// compile errors are rethrown from get() of the future
+	std::shared_future<CompiledShader> CompileShaderAsync(ShaderStage stage, ShaderTarget target, const std::string& code,
+		const std::vector<std::string>& defines = {});
+#endif
+
+	// translates spirv of a compiled stage again with specialization constants applied, glslang does not run.
+	// spirv keeps the constants for ShaderTarget::Hlsl, Glsl and Msl and gets new default values of them
+	// for ShaderTarget::Spirv. results are kept in the in-process tier only.
+	// without SKYGFX_RUNTIME_COMPILER only ShaderTarget::Spirv can be specialized, other targets throw
+	CompiledShader SpecializeShader(const CompiledShaderView& shader, ShaderTarget target,
+		const SpecializationConstants& constants);
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+	// applied to spirv of every stage before translation, takes part in the cache key.
+	// by default debug info is stripped unless the library is built in the Debug configuration
+	void SetSpirvOptimizationOptions(const SpirvOptimizationOptions& options);
+	SpirvOptimizationOptions GetSpirvOptimizationOptions();
+
+	// threads are created on the first async compilation, changing the count later has no effect
+	void SetShaderCompilerThreadCount(uint32_t count);
+
+	// every entry is stored in its own file, empty path disables the disk tier (default)
+	void SetShaderCacheDirectory(const std::string& path);
+	std::string GetShaderCacheDirectory();
+#endif
+
+	void ClearShaderCache(); // in-process tier only
+
+	struct ShaderCacheStats
+	{
+		uint32_t memory_hits = 0;
+		uint32_t disk_hits = 0;
+		uint32_t misses = 0;
+	};
+
+	ShaderCacheStats GetShaderCacheStats();
+}
@@ -1,12 +1,25 @@
 #include "shader_compiler.h"
+#include "trace.h"
+#ifdef SKYGFX_RUNTIME_COMPILER
 #include <glslang/SPIRV/GlslangToSpv.h>
+#include <glslang/SPIRV/SPVRemapper.h>
+#include <glslang/SPIRV/doc.h>
 #include <glslang/StandAlone/ResourceLimits.h>
 #include <spirv_hlsl.hpp>
-#include <spirv_reflect.h>
 #include <spirv_msl.hpp>
+#endif
+#include <spirv.hpp>
+#include <spirv_reflect.h>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 using namespace skygfx;
 
+#ifdef SKYGFX_RUNTIME_COMPILER
+
 const TBuiltInResource DefaultTBuiltInResource = {
 	/* .MaxLights = */ 32,
 	/* .MaxClipPlanes = */ 6,
@@ -115,8 +128,170 @@ const TBuiltInResource DefaultTBuiltInResource = {
 	}
 };
 
-std::vector<uint32_t> skygfx::CompileGlslToSpirv(ShaderStage stage, const std::string& code, const std::vector<std::string>& defines)
+static void InitializeGlslang()
+{
+	// builtin symbol tables are built once and shared by all threads, they live until process exit,
+	// finalizing after every compilation would rebuild them on the next one
+	static std::once_flag once;
+	std::call_once(once, [] {
+		glslang::InitializeProcess();
+	});
+}
+
+struct ShaderIncludeFile
+{
+	std::shared_ptr<const std::string> code;
+	uint64_t hash;
+};
+
+static std::mutex gShaderIncludesMutex;
+static std::unordered_map<std::string, ShaderIncludeFile> gShaderIncludes;
+static ShaderIncludeLoader gShaderIncludeLoader;
+
+static uint64_t HashShaderInclude(const std::string& code)
+{
+	// fnv-1a, like shader cache keys
+	uint64_t hash = 0xcbf29ce484222325;
+
+	for (auto c : code)
+	{
+		hash ^= (uint8_t)c;
+		hash *= 0x100000001b3;
+	}
+
+	return hash;
+}
+
+static std::optional<ShaderIncludeFile> FindShaderInclude(const std::string& name)
+{
+	ShaderIncludeLoader loader;
+
+	{
+		std::lock_guard lock(gShaderIncludesMutex);
+
+		if (gShaderIncludes.contains(name))
+			return gShaderIncludes.at(name);
+
+		loader = gShaderIncludeLoader;
+	}
+
+	if (!loader)
+		return std::nullopt;
+
+	// the loader runs outside of the lock, it may be slow
+	auto code = loader(name);
+
+	if (!code.has_value())
+		return std::nullopt;
+
+	auto hash = HashShaderInclude(code.value());
+	auto file = ShaderIncludeFile{ std::make_shared<const std::string>(std::move(code.value())), hash };
+
+	std::lock_guard lock(gShaderIncludesMutex);
+	return gShaderIncludes.insert({ name, std::move(file) }).first->second;
+}
+
+void skygfx::SetShaderInclude(const std::string& name, const std::string& code)
+{
+	auto file = ShaderIncludeFile{ std::make_shared<const std::string>(code), HashShaderInclude(code) };
+
+	std::lock_guard lock(gShaderIncludesMutex);
+	gShaderIncludes.insert_or_assign(name, std::move(file));
+}
+
+void skygfx::RemoveShaderInclude(const std::string& name)
+{
+	std::lock_guard lock(gShaderIncludesMutex);
+	gShaderIncludes.erase(name);
+}
+
+void skygfx::SetShaderIncludeLoader(ShaderIncludeLoader loader)
+{
+	std::lock_guard lock(gShaderIncludesMutex);
+	gShaderIncludeLoader = std::move(loader);
+}
+
+std::optional<uint64_t> skygfx::GetShaderIncludeHash(const std::string& name)
+{
+	auto file = FindShaderInclude(name);
+
+	if (!file.has_value())
+		return std::nullopt;
+
+	return file->hash;
+}
+
+class ShaderIncluder : public glslang::TShader::Includer
+{
+public:
+	IncludeResult* includeLocal(const char* header_name, const char* includer_name, size_t inclusion_depth) override
+	{
+		std::string directory = includer_name;
+		auto slash = directory.find_last_of('/');
+
+		if (slash == std::string::npos)
+			return nullptr; // the name is tried as is by includeSystem then
+
+		return include(directory.substr(0, slash + 1) + header_name);
+	}
+
+	IncludeResult* includeSystem(const char* header_name, const char* includer_name, size_t inclusion_depth) override
+	{
+		return include(header_name);
+	}
+
+	void releaseInclude(IncludeResult* result) override
+	{
+		if (result == nullptr)
+			return;
+
+		delete (std::shared_ptr<const std::string>*)result->userData;
+		delete result;
+	}
+
+	const auto& getDependencies() const { return mDependencies; }
+
+private:
+	IncludeResult* include(const std::string& name)
+	{
+		auto file = FindShaderInclude(name);
+
+		if (!file.has_value())
+			return nullptr;
+
+		bool known = std::any_of(mDependencies.begin(), mDependencies.end(), [&](const auto& dependency) {
+			return dependency.name == name;
+		});
+
+		if (!known)
+			mDependencies.push_back({ name, file->hash });
+
+		// the contents stay alive until release even when the file is replaced meanwhile
+		auto code = new std::shared_ptr<const std::string>(file->code);
+		return new IncludeResult(name, (*code)->data(), (*code)->size(), code);
+	}
+
+private:
+	std::vector<ShaderIncludeDependency> mDependencies;
+};
+
+static void InitializeSpirvRemapper()
+{
+	// opcode tables are filled without synchronization on the first remap, the default error handler exits
+	static std::once_flag once;
+	std::call_once(once, [] {
+		spv::Parameterize();
+		spv::spirvbin_t::registerErrorHandler([](const std::string& error) {
+			throw std::runtime_error(error);
+		});
+	});
+}
+
+std::vector<uint32_t> skygfx::CompileGlslToSpirv(ShaderStage stage, const std::string& code, const std::vector<std::string>& defines,
+	std::vector<ShaderIncludeDependency>* dependencies)
 {
+	SKYGFX_TRACE_SCOPE("CompileGlslToSpirv");
+
 	auto translateShaderStage = [](ShaderStage stage) {
 		switch (stage)
 		{
@@ -126,7 +301,7 @@ std::vector<uint32_t> skygfx::CompileGlslToSpirv(ShaderStage stage, const std::s
 		}
 	};
 
-	glslang::InitializeProcess();
+	InitializeGlslang();
 
 	auto str = code.c_str();
 
@@ -137,6 +312,10 @@ std::vector<uint32_t> skygfx::CompileGlslToSpirv(ShaderStage stage, const std::s
 
 	std::string preamble;
 
+	// enabled only when needed, the extension leaves a trace in spirv
+	if (code.find("#include") != std::string::npos)
+		preamble += "#extension GL_GOOGLE_include_directive : enable\n";
+
 	for (auto define : defines)
 	{
 		preamble += "#define " + define + "\n";
@@ -146,7 +325,9 @@ std::vector<uint32_t> skygfx::CompileGlslToSpirv(ShaderStage stage, const std::s
 
 	auto messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
 
-	if (!shader.parse(&DefaultTBuiltInResource, 100, false, messages))
+	ShaderIncluder includer;
+
+	if (!shader.parse(&DefaultTBuiltInResource, 100, false, messages, includer))
 	{
 		auto info_log = shader.getInfoLog();
 		throw std::runtime_error(info_log);
@@ -165,14 +346,144 @@ std::vector<uint32_t> skygfx::CompileGlslToSpirv(ShaderStage stage, const std::s
 
 	std::vector<uint32_t> result;
 	glslang::GlslangToSpv(*intermediate, result);
-	glslang::FinalizeProcess();
+
+	if (dependencies != nullptr)
+		*dependencies = includer.getDependencies();
 
 	return result;
 }
 
-std::string skygfx::CompileSpirvToHlsl(const std::vector<uint32_t>& spirv)
+std::vector<uint32_t> skygfx::OptimizeSpirv(const std::vector<uint32_t>& spirv, const SpirvOptimizationOptions& options)
+{
+	SKYGFX_TRACE_SCOPE("OptimizeSpirv");
+
+	uint32_t flags = spv::spirvbin_t::NONE;
+
+	if (options.remove_dead_code)
+		flags |= spv::spirvbin_t::DCE_ALL;
+
+	if (options.optimize_load_store)
+		flags |= spv::spirvbin_t::OPT_LOADSTORE;
+
+	if (options.strip_debug_info)
+		flags |= spv::spirvbin_t::STRIP;
+
+	if (options.remap_ids)
+		flags |= spv::spirvbin_t::MAP_ALL;
+
+	if (flags == spv::spirvbin_t::NONE)
+		return spirv;
+
+	InitializeSpirvRemapper();
+
+	auto result = spirv;
+	spv::spirvbin_t().remap(result, {}, flags);
+
+	return result;
+}
+
+#endif
+
+std::vector<uint32_t> skygfx::GetSpirvSpecializationConstantIds(std::span<const uint32_t> spirv)
 {
+	const size_t HeaderWords = 5;
+
+	std::vector<uint32_t> result;
+
+	for (size_t i = HeaderWords; i < spirv.size();)
+	{
+		auto op = (spv::Op)(spirv[i] & spv::OpCodeMask);
+		auto count = spirv[i] >> spv::WordCountShift;
+
+		if (count == 0 || i + count > spirv.size())
+			throw std::runtime_error("spirv is corrupted");
+
+		if (op == spv::OpDecorate && count >= 4 && spirv[i + 2] == spv::DecorationSpecId)
+			result.push_back(spirv[i + 3]);
+
+		i += count;
+	}
+
+	return result;
+}
+
+std::vector<uint32_t> skygfx::SpecializeSpirv(const std::vector<uint32_t>& spirv, const SpecializationConstants& constants)
+{
+	SKYGFX_TRACE_SCOPE("SpecializeSpirv");
+
+	const size_t HeaderWords = 5;
+
+	auto result = spirv;
+
+	if (constants.empty() || result.size() < HeaderWords)
+		return result;
+
+	// decorations come before constants in a module, so one pass is enough
+	std::unordered_map<uint32_t, uint32_t> constant_ids; // by result id
+
+	for (size_t i = HeaderWords; i < result.size();)
+	{
+		auto op = (spv::Op)(result[i] & spv::OpCodeMask);
+		auto count = result[i] >> spv::WordCountShift;
+
+		if (count == 0 || i + count > result.size())
+			throw std::runtime_error("spirv is corrupted");
+
+		auto w = result.data() + i;
+
+		if (op == spv::OpDecorate && count >= 4 && w[2] == spv::DecorationSpecId)
+		{
+			constant_ids.insert({ w[1], w[3] });
+		}
+		else if (op == spv::OpSpecConstantTrue || op == spv::OpSpecConstantFalse)
+		{
+			auto it = constant_ids.find(w[2]);
+
+			if (it != constant_ids.end() && constants.contains(it->second))
+			{
+				auto value = constants.at(it->second) != 0;
+				w[0] = (count << spv::WordCountShift) | (value ? spv::OpSpecConstantTrue : spv::OpSpecConstantFalse);
+			}
+		}
+		else if (op == spv::OpSpecConstant && count == 4) // 64 bit constants are not specialized
+		{
+			auto it = constant_ids.find(w[2]);
+
+			if (it != constant_ids.end() && constants.contains(it->second))
+				w[3] = constants.at(it->second);
+		}
+
+		i += count;
+	}
+
+	return result;
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+
+static void SetSpecializationConstants(spirv_cross::Compiler& compiler, const SpecializationConstants& constants)
+{
+	for (const auto& specialization_constant : compiler.get_specialization_constants())
+	{
+		if (!constants.contains(specialization_constant.constant_id))
+			continue;
+
+		auto& constant = compiler.get_constant(specialization_constant.id);
+		auto value = constants.at(specialization_constant.constant_id);
+
+		if (compiler.get_type(constant.constant_type).basetype == spirv_cross::SPIRType::Boolean)
+			value = value != 0 ? 1 : 0;
+
+		constant.m.c[0].r[0].u32 = value;
+	}
+}
+
+std::string skygfx::CompileSpirvToHlsl(const std::vector<uint32_t>& spirv, const SpecializationConstants& specialization_constants)
+{
+	SKYGFX_TRACE_SCOPE("CompileSpirvToHlsl");
+
 	auto compiler = spirv_cross::CompilerHLSL(spirv);
+	SetSpecializationConstants(compiler, specialization_constants);
 
 	spirv_cross::CompilerHLSL::Options options;
 	options.shader_model = 40;
@@ -181,9 +492,12 @@ std::string skygfx::CompileSpirvToHlsl(const std::vector<uint32_t>& spirv)
 	return compiler.compile();
 }
 
-std::string skygfx::CompileSpirvToGlsl(const std::vector<uint32_t>& spirv)
+std::string skygfx::CompileSpirvToGlsl(const std::vector<uint32_t>& spirv, const SpecializationConstants& specialization_constants)
 {
+	SKYGFX_TRACE_SCOPE("CompileSpirvToGlsl");
+
 	auto compiler = spirv_cross::CompilerGLSL(spirv);
+	SetSpecializationConstants(compiler, specialization_constants);
 
 	spirv_cross::CompilerGLSL::Options options;
 	compiler.set_common_options(options);
@@ -191,9 +505,12 @@ std::string skygfx::CompileSpirvToGlsl(const std::vector<uint32_t>& spirv)
 	return compiler.compile();
 }
 
-std::string skygfx::CompileSpirvToMsl(const std::vector<uint32_t>& spirv)
+std::string skygfx::CompileSpirvToMsl(const std::vector<uint32_t>& spirv, const SpecializationConstants& specialization_constants)
 {
+	SKYGFX_TRACE_SCOPE("CompileSpirvToMsl");
+
 	auto compiler = spirv_cross::CompilerMSL(spirv);
+	SetSpecializationConstants(compiler, specialization_constants);
 	
 	spirv_cross::CompilerMSL::Options options;
 	options.enable_decoration_binding = true;
@@ -202,6 +519,8 @@ std::string skygfx::CompileSpirvToMsl(const std::vector<uint32_t>& spirv)
 	return compiler.compile();
 }
 
+#endif
+
 void skygfx::AddShaderLocationDefines(const Vertex::Layout& layout, std::vector<std::string>& defines)
 {
 	const std::unordered_map<Vertex::Attribute::Type, std::string> Names = {
@@ -220,8 +539,119 @@ void skygfx::AddShaderLocationDefines(const Vertex::Layout& layout, std::vector<
 	}
 }
 
+static ShaderReflection::DataType GetReflectionDataType(const SpvReflectTypeDescription* type,
+	const SpvReflectNumericTraits& numeric)
+{
+	auto flags = type != nullptr ? type->type_flags : 0;
+
+	if (flags & SPV_REFLECT_TYPE_FLAG_STRUCT)
+		return ShaderReflection::DataType::Struct;
+
+	if (flags & SPV_REFLECT_TYPE_FLAG_FLOAT)
+		return ShaderReflection::DataType::Float;
+
+	if (flags & SPV_REFLECT_TYPE_FLAG_INT)
+		return numeric.scalar.signedness ? ShaderReflection::DataType::Int : ShaderReflection::DataType::UInt;
+
+	if (flags & SPV_REFLECT_TYPE_FLAG_BOOL)
+		return ShaderReflection::DataType::Bool;
+
+	return ShaderReflection::DataType::Other;
+}
+
+static uint32_t GetReflectionArraySize(const SpvReflectArrayTraits& array)
+{
+	if (array.dims_count == 0)
+		return 0;
+
+	uint32_t result = 1;
+
+	for (uint32_t i = 0; i < array.dims_count; i++)
+	{
+		result *= array.dims[i];
+	}
+
+	return result;
+}
+
+static void AddReflectionMembers(const SpvReflectBlockVariable& block, const std::string& prefix,
+	std::vector<ShaderReflection::Member>& members)
+{
+	for (uint32_t i = 0; i < block.member_count; i++)
+	{
+		const auto& variable = block.members[i];
+
+		ShaderReflection::Member member;
+		member.name = prefix + (variable.name != nullptr ? variable.name : "");
+		member.offset = variable.absolute_offset;
+		member.size = variable.size;
+		member.type = GetReflectionDataType(variable.type_description, variable.numeric);
+		member.array_size = GetReflectionArraySize(variable.array);
+
+		auto flags = variable.type_description != nullptr ? variable.type_description->type_flags : 0;
+
+		if (member.type == ShaderReflection::DataType::Struct && member.array_size == 0)
+		{
+			AddReflectionMembers(variable, member.name + ".", members);
+			continue;
+		}
+
+		if (flags & SPV_REFLECT_TYPE_FLAG_MATRIX)
+		{
+			member.components = variable.numeric.matrix.row_count;
+			member.columns = variable.numeric.matrix.column_count;
+		}
+		else
+		{
+			member.components = std::max(variable.numeric.vector.component_count, 1u);
+			member.columns = 1;
+		}
+
+		members.push_back(member);
+	}
+}
+
+// spirv-reflect pads block sizes up to 16 bytes, members tell how many bytes the shader really reads
+
+static uint32_t GetReflectionMembersBegin(const std::vector<ShaderReflection::Member>& members)
+{
+	uint32_t result = members.empty() ? 0 : UINT32_MAX;
+
+	for (const auto& member : members)
+	{
+		result = std::min(result, member.offset);
+	}
+
+	return result;
+}
+
+static uint32_t GetReflectionMembersEnd(const std::vector<ShaderReflection::Member>& members)
+{
+	uint32_t result = 0;
+
+	for (const auto& member : members)
+	{
+		result = std::max(result, member.offset + member.size);
+	}
+
+	return result;
+}
+
+const ShaderReflection::DescriptorSet* ShaderReflection::findDescriptorSet(int binding, DescriptorSet::Type type) const
+{
+	for (const auto& descriptor_set : descriptor_sets)
+	{
+		if (descriptor_set.binding == binding && descriptor_set.type == type)
+			return &descriptor_set;
+	}
+
+	return nullptr;
+}
+
 ShaderReflection skygfx::MakeSpirvReflection(const std::vector<uint32_t>& spirv)
 {
+	SKYGFX_TRACE_SCOPE("MakeSpirvReflection");
+
 	static const std::unordered_map<SpvReflectDescriptorType, ShaderReflection::DescriptorSet::Type> DescriptorTypeMap = {
 		{ SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, ShaderReflection::DescriptorSet::Type::CombinedImageSampler },
 		{ SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER, ShaderReflection::DescriptorSet::Type::UniformBuffer },
@@ -249,13 +679,137 @@ ShaderReflection skygfx::MakeSpirvReflection(const std::vector<uint32_t>& spirv)
 	auto stage = refl.GetShaderStage();
 	result.stage = StageMap.at(stage);
 
+	auto getName = [](const char* name, const SpvReflectTypeDescription* type) {
+		if (name != nullptr && name[0] != '\0')
+			return std::string(name);
+
+		if (type != nullptr && type->type_name != nullptr)
+			return std::string(type->type_name); // block without an instance name
+
+		return std::string();
+	};
+
 	for (const auto& binding : bindings)
 	{
 		ShaderReflection::DescriptorSet descriptor_set;
 		descriptor_set.binding = binding->binding;
 		descriptor_set.type = DescriptorTypeMap.at(binding->descriptor_type);
+		descriptor_set.name = getName(binding->name, binding->type_description);
+		descriptor_set.stages = GetShaderStageBit(result.stage);
+
+		if (descriptor_set.type == ShaderReflection::DescriptorSet::Type::UniformBuffer)
+		{
+			AddReflectionMembers(binding->block, "", descriptor_set.members);
+			descriptor_set.size = GetReflectionMembersEnd(descriptor_set.members);
+		}
+
 		result.descriptor_sets.push_back(descriptor_set);
 	}
 
+	count = 0;
+	r = refl.EnumeratePushConstantBlocks(&count, nullptr);
+	assert(r == SPV_REFLECT_RESULT_SUCCESS);
+
+	std::vector<SpvReflectBlockVariable*> push_constants(count);
+	r = refl.EnumeratePushConstantBlocks(&count, push_constants.data());
+	assert(r == SPV_REFLECT_RESULT_SUCCESS);
+
+	for (const auto& block : push_constants)
+	{
+		ShaderReflection::PushConstantBlock push_constant_block;
+		push_constant_block.name = getName(block->name, block->type_description);
+		push_constant_block.stages = GetShaderStageBit(result.stage);
+		AddReflectionMembers(*block, "", push_constant_block.members);
+		push_constant_block.offset = GetReflectionMembersBegin(push_constant_block.members);
+		push_constant_block.size = GetReflectionMembersEnd(push_constant_block.members) - push_constant_block.offset;
+		result.push_constant_blocks.push_back(push_constant_block);
+	}
+
+	if (result.stage == ShaderStage::Vertex)
+	{
+		count = 0;
+		r = refl.EnumerateInputVariables(&count, nullptr);
+		assert(r == SPV_REFLECT_RESULT_SUCCESS);
+
+		std::vector<SpvReflectInterfaceVariable*> inputs(count);
+		r = refl.EnumerateInputVariables(&count, inputs.data());
+		assert(r == SPV_REFLECT_RESULT_SUCCESS);
+
+		for (const auto& variable : inputs)
+		{
+			if (variable->decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN)
+				continue;
+
+			ShaderReflection::Input input;
+			input.location = variable->location;
+			input.name = variable->name != nullptr ? variable->name : "";
+			input.type = GetReflectionDataType(variable->type_description, variable->numeric);
+			input.components = std::max(variable->numeric.vector.component_count, 1u);
+			result.inputs.push_back(input);
+		}
+
+		std::sort(result.inputs.begin(), result.inputs.end(), [](const auto& left, const auto& right) {
+			return left.location < right.location;
+		});
+	}
+
+	return result;
+}
+
+ShaderReflection skygfx::MergeShaderReflections(const std::vector<ShaderReflection>& stages)
+{
+	ShaderReflection result;
+
+	if (!stages.empty())
+		result.stage = stages.front().stage;
+
+	for (const auto& reflection : stages)
+	{
+		for (const auto& descriptor_set : reflection.descriptor_sets)
+		{
+			auto it = std::find_if(result.descriptor_sets.begin(), result.descriptor_sets.end(), [&](const auto& value) {
+				return value.binding == descriptor_set.binding;
+			});
+
+			if (it == result.descriptor_sets.end())
+			{
+				result.descriptor_sets.push_back(descriptor_set);
+				continue;
+			}
+
+			it->stages |= descriptor_set.stages;
+
+			if (descriptor_set.size > it->size)
+			{
+				it->size = descriptor_set.size;
+				it->members = descriptor_set.members;
+			}
+		}
+
+		for (const auto& block : reflection.push_constant_blocks)
+		{
+			auto it = std::find_if(result.push_constant_blocks.begin(), result.push_constant_blocks.end(), [&](const auto& value) {
+				return value.offset == block.offset;
+			});
+
+			if (it == result.push_constant_blocks.end())
+			{
+				result.push_constant_blocks.push_back(block);
+				continue;
+			}
+
+			it->stages |= block.stages;
+
+			if (block.size > it->size)
+			{
+				it->size = block.size;
+				it->members = block.members;
+			}
+		}
+
+		if (reflection.stage == ShaderStage::Vertex)
+			result.inputs = reflection.inputs;
+	}
+
 	return result;
 }
@@ -2,6 +2,10 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <span>
+#include <functional>
+#include <optional>
 #include "vertex.h"
 
 namespace skygfx
@@ -12,15 +16,90 @@ namespace skygfx
 		Fragment
 	};
 
-	std::vector<uint32_t> CompileGlslToSpirv(ShaderStage stage, const std::string& code, const std::vector<std::string>& defines = {});
-	std::string CompileSpirvToHlsl(const std::vector<uint32_t>& spirv);
-	std::string CompileSpirvToGlsl(const std::vector<uint32_t>& spirv);
-	std::string CompileSpirvToMsl(const std::vector<uint32_t>& spirv);
+	// compilation and reflection functions can be called from several threads at once
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+	// #include "name" and #include <name> in glsl are resolved from a virtual file system of include files,
+	// quoted names are looked up next to the including file first. the extension directive is not needed
+
+	using ShaderIncludeLoader = std::function<std::optional<std::string>(const std::string& name)>;
+
+	struct ShaderIncludeDependency
+	{
+		std::string name;
+		uint64_t hash; // of the contents the shader was compiled with
+	};
+
+	// stages compiled after a change see it, cached stages which include a changed file are compiled again
+	void SetShaderInclude(const std::string& name, const std::string& code);
+	void RemoveShaderInclude(const std::string& name); // a loaded file is loaded again on the next use
+
+	// called for names which are not set, for example to read them from disk. loaded files are kept
+	// like set ones, so the loader runs once per file
+	void SetShaderIncludeLoader(ShaderIncludeLoader loader);
+
+	std::optional<uint64_t> GetShaderIncludeHash(const std::string& name); // loads the file when needed
+
+	std::vector<uint32_t> CompileGlslToSpirv(ShaderStage stage, const std::string& code, const std::vector<std::string>& defines = {},
+		std::vector<ShaderIncludeDependency>* dependencies = nullptr);
+
+	// passes of the spirv remapper from glslang, constants are already folded by glslang itself
+	struct SpirvOptimizationOptions
+	{
+		bool remove_dead_code = true; // unused functions, variables and types
+		bool optimize_load_store = true; // function variables which are stored once
+		bool strip_debug_info = false; // names and lines, translated sources get generated names
+		bool remap_ids = false; // canonical ids, compresses better
+	};
+
+	std::vector<uint32_t> OptimizeSpirv(const std::vector<uint32_t>& spirv, const SpirvOptimizationOptions& options);
+#endif
+
+	// values of specialization constants by constant_id, 32 bits of an int, uint or float, bool is true when not zero.
+	// constants which are not listed keep their default values
+	using SpecializationConstants = std::map<uint32_t, uint32_t>;
+
+	// constant_id of every specialization constant declared in spirv
+	std::vector<uint32_t> GetSpirvSpecializationConstantIds(std::span<const uint32_t> spirv);
+
+	// default values of listed constants are replaced, for consumers of spirv which can not specialize it themselves
+	std::vector<uint32_t> SpecializeSpirv(const std::vector<uint32_t>& spirv, const SpecializationConstants& constants);
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+	std::string CompileSpirvToHlsl(const std::vector<uint32_t>& spirv, const SpecializationConstants& specialization_constants = {});
+	std::string CompileSpirvToGlsl(const std::vector<uint32_t>& spirv, const SpecializationConstants& specialization_constants = {});
+	std::string CompileSpirvToMsl(const std::vector<uint32_t>& spirv, const SpecializationConstants& specialization_constants = {});
+#endif
 
 	void AddShaderLocationDefines(const Vertex::Layout& layout, std::vector<std::string>& defines);
 
+	inline uint32_t GetShaderStageBit(ShaderStage stage) { return 1u << (uint32_t)stage; }
+
 	struct ShaderReflection
 	{
+		enum class DataType
+		{
+			Float,
+			Int,
+			UInt,
+			Bool,
+			Struct,
+			Other
+		};
+
+		// of a uniform or push constant block, members of nested structs are flattened into "outer.inner" names,
+		// arrays of structs stay one member of DataType::Struct
+		struct Member
+		{
+			std::string name;
+			uint32_t offset; // bytes from the start of the block
+			uint32_t size; // bytes, all array elements included
+			DataType type;
+			uint32_t components; // of a vector or of a matrix column, 1 for scalars
+			uint32_t columns; // 1 unless matrix
+			uint32_t array_size; // 0 unless array
+		};
+
 		struct DescriptorSet
 		{
 			enum class Type
@@ -31,11 +110,40 @@ namespace skygfx
 
 			int binding;
 			Type type;
+			std::string name;
+			uint32_t stages = 0; // mask of GetShaderStageBit
+			uint32_t size = 0; // bytes the shader reads from a uniform buffer
+			std::vector<Member> members; // of a uniform buffer
+		};
+
+		struct PushConstantBlock
+		{
+			std::string name;
+			uint32_t offset; // bytes
+			uint32_t size; // bytes
+			uint32_t stages = 0;
+			std::vector<Member> members;
+		};
+
+		struct Input // of the vertex stage, built-ins are not included
+		{
+			uint32_t location;
+			std::string name;
+			DataType type;
+			uint32_t components;
 		};
 
 		std::vector<DescriptorSet> descriptor_sets;
+		std::vector<PushConstantBlock> push_constant_blocks;
+		std::vector<Input> inputs;
 		ShaderStage stage;
+
+		const DescriptorSet* findDescriptorSet(int binding, DescriptorSet::Type type) const;
 	};
 
 	ShaderReflection MakeSpirvReflection(const std::vector<uint32_t>& spirv);
+
+	// reflection of a program: descriptor sets and push constant blocks of several stages are joined by binding
+	// and offset with their stage masks combined, inputs come from the vertex stage. stage is the first one
+	ShaderReflection MergeShaderReflections(const std::vector<ShaderReflection>& stages);
 }
@@ -0,0 +1,152 @@
+#include "shader_family.h"
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace skygfx;
+
+ShaderFamily::ShaderFamily(const Vertex::Layout& layout, const std::string& vertex_code, const std::string& fragment_code,
+	const std::vector<Keyword>& keywords, const std::vector<std::string>& defines) :
+	mLayout(layout),
+	mVertexCode(vertex_code),
+	mFragmentCode(fragment_code),
+	mDefines(defines)
+{
+	uint32_t offset = 0;
+
+	for (const auto& keyword : keywords)
+	{
+		if (keyword.empty())
+			throw std::runtime_error("shader family keyword has no defines");
+
+		uint32_t bits = 1;
+
+		if (keyword.size() > 1)
+		{
+			bits = 0;
+
+			while ((size_t(1) << bits) < keyword.size())
+				bits += 1;
+		}
+
+		mKeywords.push_back({ keyword, offset, bits });
+		offset += bits;
+	}
+
+	if (offset > sizeof(Key) * 8)
+		throw std::runtime_error("shader family keywords do not fit in the key");
+}
+
+ShaderFamily::Key ShaderFamily::makeKey(const std::vector<std::string>& defines) const
+{
+	Key key = 0;
+
+	for (const auto& define : defines)
+	{
+		bool found = false;
+
+		for (const auto& keyword : mKeywords)
+		{
+			auto it = std::find(keyword.defines.begin(), keyword.defines.end(), define);
+
+			if (it == keyword.defines.end())
+				continue;
+
+			Key value = keyword.defines.size() == 1 ? 1 : (Key)(it - keyword.defines.begin());
+			key &= ~(((Key(1) << keyword.bits) - 1) << keyword.offset);
+			key |= value << keyword.offset;
+			found = true;
+			break;
+		}
+
+		if (!found)
+			throw std::runtime_error("define " + define + " is not a keyword of the shader family");
+	}
+
+	return key;
+}
+
+std::vector<std::string> ShaderFamily::getDefines(Key key) const
+{
+	std::vector<std::string> result;
+
+	for (const auto& keyword : mKeywords)
+	{
+		auto value = (key >> keyword.offset) & ((Key(1) << keyword.bits) - 1);
+
+		if (keyword.defines.size() == 1)
+		{
+			if (value != 0)
+				result.push_back(keyword.defines.at(0));
+
+			continue;
+		}
+
+		if (value >= keyword.defines.size())
+			throw std::runtime_error("shader family key has an invalid keyword value");
+
+		result.push_back(keyword.defines.at(value));
+	}
+
+	return result;
+}
+
+std::vector<ShaderFamily::Key> ShaderFamily::getAllKeys() const
+{
+	std::vector<Key> result = { 0 };
+
+	for (const auto& keyword : mKeywords)
+	{
+		auto count = std::max(keyword.defines.size(), size_t(2)); // boolean has two values
+		auto keys = std::move(result);
+		result.clear();
+
+		for (auto key : keys)
+		{
+			for (Key value = 0; value < count; value++)
+			{
+				result.push_back(key | (value << keyword.offset));
+			}
+		}
+	}
+
+	return result;
+}
+
+Shader& ShaderFamily::getShader(Key key)
+{
+	return getVariant(key).getShader();
+}
+
+void ShaderFamily::prebuild(const std::vector<Key>& keys)
+{
+	for (auto key : keys)
+	{
+		getVariant(key);
+	}
+}
+
+bool ShaderFamily::isReady(Key key) const
+{
+	auto it = mVariants.find(key);
+	return it != mVariants.end() && it->second->isReady();
+}
+
+AsyncShader& ShaderFamily::getVariant(Key key)
+{
+	auto it = mVariants.find(key);
+
+	if (it != mVariants.end())
+		return *it->second;
+
+	auto defines = mDefines;
+	auto keyword_defines = getDefines(key);
+	defines.insert(defines.end(), keyword_defines.begin(), keyword_defines.end());
+
+	auto variant = std::make_unique<AsyncShader>(mLayout, mVertexCode, mFragmentCode, defines);
+	return *mVariants.insert({ key, std::move(variant) }).first->second;
+}
+
+#endif
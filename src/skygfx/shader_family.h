@@ -0,0 +1,59 @@
+#pragma once
+
+#include "skygfx.h"
+#include <unordered_map>
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+
+namespace skygfx
+{
+	// variants of one shader selected by keywords. every keyword maps onto defines:
+	// a keyword with one define is boolean (the define is set or not), a keyword with several defines
+	// is an enum (exactly one of them is set, the first by default). a variant is identified by a key,
+	// bitmask of keyword values, and is compiled the first time it is requested, or ahead with prebuild
+	class ShaderFamily
+	{
+	public:
+		using Key = uint64_t;
+		using Keyword = std::vector<std::string>;
+
+	public:
+		ShaderFamily(const Vertex::Layout& layout, const std::string& vertex_code, const std::string& fragment_code,
+			const std::vector<Keyword>& keywords, const std::vector<std::string>& defines = {});
+
+		// throws on defines which are not declared by any keyword
+		Key makeKey(const std::vector<std::string>& defines) const;
+		std::vector<std::string> getDefines(Key key) const; // keyword defines of the variant
+		std::vector<Key> getAllKeys() const;
+
+		Shader& getShader(Key key);
+		Shader& getShader(const std::vector<std::string>& defines) { return getShader(makeKey(defines)); }
+
+		// starts compilation of variants on the shader compiler threads
+		void prebuild(const std::vector<Key>& keys);
+		void prebuildAll() { prebuild(getAllKeys()); }
+
+		bool isReady(Key key) const; // getShader will not wait for compilation
+		size_t getVariantCount() const { return mVariants.size(); } // requested or prebuilt
+
+	private:
+		struct KeywordBits
+		{
+			Keyword defines;
+			uint32_t offset;
+			uint32_t bits;
+		};
+
+		AsyncShader& getVariant(Key key);
+
+	private:
+		Vertex::Layout mLayout;
+		std::string mVertexCode;
+		std::string mFragmentCode;
+		std::vector<std::string> mDefines;
+		std::vector<KeywordBits> mKeywords;
+		std::unordered_map<Key, std::unique_ptr<AsyncShader>> mVariants;
+	};
+}
+
+#endif
@@ -0,0 +1,2367 @@
+#include "shader_interpreter.h"
+
+#define SPV_ENABLE_UTILITY_CODE
+#include <spirv.hpp>
+#include <GLSL.std.450.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+using namespace skygfx;
+
+static constexpr uint32_t Lanes = ShaderInterpreter::Lanes;
+static constexpr uint32_t AllLanes = ShaderInterpreter::AllLanes;
+static constexpr uint32_t BufferBindingShift = 20; // uniform buffer pointers are (binding << shift) | byte offset
+static constexpr uint32_t BufferOffsetMask = (1 << BufferBindingShift) - 1;
+static constexpr uint32_t NoBlock = ~0u;
+
+using Register = ShaderInterpreter::Register;
+
+enum class ScalarKind
+{
+	None,
+	Bool,
+	Int,
+	UInt,
+	Float
+};
+
+struct TypeInfo
+{
+	spv::Op op = spv::OpNop;
+	uint32_t components = 0; // number of registers occupied by a value of this type
+	ScalarKind scalar = ScalarKind::None;
+	uint32_t element = 0; // component, column, element or pointee type
+	uint32_t count = 0; // vector size, matrix columns or array length
+	uint32_t rows = 1; // vector size, column size for matrices
+	uint32_t array_stride = 0;
+	spv::StorageClass storage = spv::StorageClassMax;
+	std::vector<uint32_t> members;
+	std::vector<uint32_t> member_components; // register offset of each member
+	std::vector<uint32_t> member_offsets; // byte offset of each member in a buffer
+	std::vector<uint32_t> member_matrix_strides;
+	std::vector<uint32_t> buffer_offsets; // byte offset of each component in a buffer
+};
+
+struct Instruction
+{
+	uint32_t offset; // index of the first word
+	spv::Op op;
+	uint32_t count;
+};
+
+struct Block
+{
+	uint32_t label;
+	uint32_t begin; // first phi instruction
+	uint32_t body; // first instruction after phis
+	uint32_t end; // one past the terminator
+};
+
+struct Function
+{
+	uint32_t id;
+	uint32_t index;
+	std::vector<uint32_t> params;
+	std::vector<Block> blocks;
+};
+
+struct ShaderInterpreter::Program
+{
+	std::vector<uint32_t> words;
+	std::vector<Instruction> instructions;
+	std::vector<TypeInfo> types; // by id
+	std::vector<uint32_t> id_types; // result type by id
+	std::vector<uint32_t> registers; // first register by id
+	std::vector<uint32_t> block_indices; // block index within its function by label id
+	std::vector<uint32_t> function_indices; // by id
+	std::vector<Function> functions;
+	std::unordered_map<uint32_t, std::vector<uint32_t>> constants;
+	std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> decorations;
+	std::unordered_map<uint64_t, std::unordered_map<uint32_t, uint32_t>> member_decorations;
+	std::vector<std::pair<uint32_t, uint32_t>> initial_values; // register, bits
+	uint32_t register_count = 0;
+	uint32_t scratch_size = 0;
+	uint32_t entry_point = 0;
+	uint32_t glsl_std_450 = 0;
+	ShaderStage stage = ShaderStage::Vertex;
+	std::vector<Varying> inputs;
+	std::vector<Varying> outputs;
+	std::unordered_map<BuiltIn, uint32_t> builtins;
+	bool has_kill = false;
+	bool writes_depth = false;
+
+	std::optional<uint32_t> getDecoration(uint32_t id, spv::Decoration decoration) const
+	{
+		auto it = decorations.find(id);
+		if (it == decorations.end() || !it->second.contains(decoration))
+			return std::nullopt;
+
+		return it->second.at(decoration);
+	}
+
+	std::optional<uint32_t> getMemberDecoration(uint32_t id, uint32_t member, spv::Decoration decoration) const
+	{
+		auto it = member_decorations.find(((uint64_t)id << 32) | member);
+		if (it == member_decorations.end() || !it->second.contains(decoration))
+			return std::nullopt;
+
+		return it->second.at(decoration);
+	}
+};
+
+static bool IsRegisterStorage(spv::StorageClass storage)
+{
+	return storage == spv::StorageClassFunction || storage == spv::StorageClassPrivate ||
+		storage == spv::StorageClassInput || storage == spv::StorageClassOutput;
+}
+
+static bool IsBufferStorage(spv::StorageClass storage)
+{
+	return storage == spv::StorageClassUniform || storage == spv::StorageClassStorageBuffer;
+}
+
+static bool IsSupportedInstruction(spv::Op op)
+{
+	switch (op)
+	{
+	case spv::OpNop:
+	case spv::OpUndef:
+	case spv::OpLine:
+	case spv::OpNoLine:
+	case spv::OpExtInst:
+	case spv::OpFunctionParameter:
+	case spv::OpFunctionCall:
+	case spv::OpVariable:
+	case spv::OpLoad:
+	case spv::OpStore:
+	case spv::OpCopyMemory:
+	case spv::OpAccessChain:
+	case spv::OpInBoundsAccessChain:
+	case spv::OpVectorExtractDynamic:
+	case spv::OpVectorInsertDynamic:
+	case spv::OpVectorShuffle:
+	case spv::OpCompositeConstruct:
+	case spv::OpCompositeExtract:
+	case spv::OpCompositeInsert:
+	case spv::OpCopyObject:
+	case spv::OpCopyLogical:
+	case spv::OpTranspose:
+	case spv::OpSampledImage:
+	case spv::OpImage:
+	case spv::OpImageSampleImplicitLod:
+	case spv::OpImageSampleExplicitLod:
+	case spv::OpImageSampleProjImplicitLod:
+	case spv::OpImageSampleProjExplicitLod:
+	case spv::OpImageFetch:
+	case spv::OpImageQuerySizeLod:
+	case spv::OpImageQuerySize:
+	case spv::OpConvertFToU:
+	case spv::OpConvertFToS:
+	case spv::OpConvertSToF:
+	case spv::OpConvertUToF:
+	case spv::OpUConvert:
+	case spv::OpSConvert:
+	case spv::OpFConvert:
+	case spv::OpBitcast:
+	case spv::OpSNegate:
+	case spv::OpFNegate:
+	case spv::OpIAdd:
+	case spv::OpFAdd:
+	case spv::OpISub:
+	case spv::OpFSub:
+	case spv::OpIMul:
+	case spv::OpFMul:
+	case spv::OpUDiv:
+	case spv::OpSDiv:
+	case spv::OpFDiv:
+	case spv::OpUMod:
+	case spv::OpSRem:
+	case spv::OpSMod:
+	case spv::OpFRem:
+	case spv::OpFMod:
+	case spv::OpVectorTimesScalar:
+	case spv::OpMatrixTimesScalar:
+	case spv::OpVectorTimesMatrix:
+	case spv::OpMatrixTimesVector:
+	case spv::OpMatrixTimesMatrix:
+	case spv::OpOuterProduct:
+	case spv::OpDot:
+	case spv::OpAny:
+	case spv::OpAll:
+	case spv::OpIsNan:
+	case spv::OpIsInf:
+	case spv::OpLogicalEqual:
+	case spv::OpLogicalNotEqual:
+	case spv::OpLogicalOr:
+	case spv::OpLogicalAnd:
+	case spv::OpLogicalNot:
+	case spv::OpSelect:
+	case spv::OpIEqual:
+	case spv::OpINotEqual:
+	case spv::OpUGreaterThan:
+	case spv::OpSGreaterThan:
+	case spv::OpUGreaterThanEqual:
+	case spv::OpSGreaterThanEqual:
+	case spv::OpULessThan:
+	case spv::OpSLessThan:
+	case spv::OpULessThanEqual:
+	case spv::OpSLessThanEqual:
+	case spv::OpFOrdEqual:
+	case spv::OpFUnordEqual:
+	case spv::OpFOrdNotEqual:
+	case spv::OpFUnordNotEqual:
+	case spv::OpFOrdLessThan:
+	case spv::OpFUnordLessThan:
+	case spv::OpFOrdGreaterThan:
+	case spv::OpFUnordGreaterThan:
+	case spv::OpFOrdLessThanEqual:
+	case spv::OpFUnordLessThanEqual:
+	case spv::OpFOrdGreaterThanEqual:
+	case spv::OpFUnordGreaterThanEqual:
+	case spv::OpShiftRightLogical:
+	case spv::OpShiftRightArithmetic:
+	case spv::OpShiftLeftLogical:
+	case spv::OpBitwiseOr:
+	case spv::OpBitwiseXor:
+	case spv::OpBitwiseAnd:
+	case spv::OpNot:
+	case spv::OpBitCount:
+	case spv::OpDPdx:
+	case spv::OpDPdy:
+	case spv::OpFwidth:
+	case spv::OpDPdxFine:
+	case spv::OpDPdyFine:
+	case spv::OpFwidthFine:
+	case spv::OpDPdxCoarse:
+	case spv::OpDPdyCoarse:
+	case spv::OpFwidthCoarse:
+	case spv::OpPhi:
+	case spv::OpLoopMerge:
+	case spv::OpSelectionMerge:
+	case spv::OpBranch:
+	case spv::OpBranchConditional:
+	case spv::OpSwitch:
+	case spv::OpKill:
+	case spv::OpTerminateInvocation:
+	case spv::OpDemoteToHelperInvocation:
+	case spv::OpReturn:
+	case spv::OpReturnValue:
+	case spv::OpUnreachable:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool IsTerminator(spv::Op op)
+{
+	switch (op)
+	{
+	case spv::OpBranch:
+	case spv::OpBranchConditional:
+	case spv::OpSwitch:
+	case spv::OpKill:
+	case spv::OpTerminateInvocation:
+	case spv::OpReturn:
+	case spv::OpReturnValue:
+	case spv::OpUnreachable:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void CollectVaryings(const ShaderInterpreter::Program& program, uint32_t type_id, uint32_t reg,
+	uint32_t& location, bool flat, bool no_perspective, std::vector<ShaderInterpreter::Varying>& result)
+{
+	const auto& type = program.types.at(type_id);
+
+	if (type.op == spv::OpTypeStruct)
+	{
+		for (uint32_t i = 0; i < type.members.size(); i++)
+		{
+			if (auto value = program.getMemberDecoration(type_id, i, spv::DecorationLocation); value.has_value())
+				location = value.value();
+
+			auto member_flat = flat || program.getMemberDecoration(type_id, i, spv::DecorationFlat).has_value();
+			auto member_no_perspective = no_perspective ||
+				program.getMemberDecoration(type_id, i, spv::DecorationNoPerspective).has_value();
+
+			CollectVaryings(program, type.members.at(i), reg + type.member_components.at(i), location,
+				member_flat, member_no_perspective, result);
+		}
+	}
+	else if (type.op == spv::OpTypeArray || type.op == spv::OpTypeMatrix)
+	{
+		const auto& element = program.types.at(type.element);
+
+		for (uint32_t i = 0; i < type.count; i++)
+		{
+			CollectVaryings(program, type.element, reg + (i * element.components), location, flat,
+				no_perspective, result);
+		}
+	}
+	else
+	{
+		auto is_float = type.scalar == ScalarKind::Float;
+		result.push_back({ location, type.components, flat || !is_float, no_perspective, reg });
+		location += 1;
+	}
+}
+
+static void MakeBufferOffsets(ShaderInterpreter::Program& program, uint32_t type_id)
+{
+	auto& type = program.types.at(type_id);
+
+	if (!type.buffer_offsets.empty() || type.components == 0)
+		return;
+
+	std::vector<uint32_t> offsets;
+
+	switch (type.op)
+	{
+	case spv::OpTypeBool:
+	case spv::OpTypeInt:
+	case spv::OpTypeFloat:
+	case spv::OpTypeVector:
+		for (uint32_t i = 0; i < type.components; i++)
+			offsets.push_back(i * 4);
+		break;
+
+	case spv::OpTypeMatrix:
+		for (uint32_t column = 0; column < type.count; column++)
+			for (uint32_t row = 0; row < type.rows; row++)
+				offsets.push_back((column * 16) + (row * 4));
+		break;
+
+	case spv::OpTypeArray:
+	{
+		MakeBufferOffsets(program, type.element);
+		const auto& element = program.types.at(type.element);
+		auto stride = type.array_stride != 0 ? type.array_stride : 16;
+
+		for (uint32_t i = 0; i < type.count; i++)
+			for (auto offset : element.buffer_offsets)
+				offsets.push_back((i * stride) + offset);
+		break;
+	}
+
+	case spv::OpTypeStruct:
+		for (uint32_t i = 0; i < type.members.size(); i++)
+		{
+			auto member_id = type.members.at(i);
+			MakeBufferOffsets(program, member_id);
+			const auto& member = program.types.at(member_id);
+
+			if (member.op == spv::OpTypeMatrix)
+			{
+				auto stride = type.member_matrix_strides.at(i);
+
+				for (uint32_t column = 0; column < member.count; column++)
+					for (uint32_t row = 0; row < member.rows; row++)
+						offsets.push_back(type.member_offsets.at(i) + (column * stride) + (row * 4));
+			}
+			else
+			{
+				for (auto offset : member.buffer_offsets)
+					offsets.push_back(type.member_offsets.at(i) + offset);
+			}
+		}
+		break;
+
+	default:
+		offsets.assign(type.components, 0);
+		break;
+	}
+
+	program.types.at(type_id).buffer_offsets = std::move(offsets);
+}
+
+// integer and boolean operations, the only ones shaders may use in spec constant operations.
+// values are computed component-wise, booleans are ~0u when true like in registers
+static std::vector<uint32_t> FoldSpecConstantOp(spv::Op op, const std::vector<const std::vector<uint32_t>*>& operands)
+{
+	if (operands.empty())
+		throw std::runtime_error("spec constant operation has no operands");
+
+	size_t size = 0;
+
+	for (const auto* operand : operands)
+	{
+		size = std::max(size, operand->size());
+	}
+
+	std::vector<uint32_t> result(size);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		auto u = [&](size_t operand) {
+			const auto& values = *operands.at(operand);
+			return values.size() == 1 ? values.at(0) : values.at(i);
+		};
+
+		auto s = [&](size_t operand) { return (int32_t)u(operand); };
+		auto b = [](bool value) { return value ? ~0u : 0u; };
+
+		switch (op)
+		{
+		case spv::OpSConvert:
+		case spv::OpUConvert: result[i] = u(0); break; // only 32 bit integers are supported
+		case spv::OpSNegate: result[i] = (uint32_t)-s(0); break;
+		case spv::OpNot: result[i] = ~u(0); break;
+		case spv::OpIAdd: result[i] = u(0) + u(1); break;
+		case spv::OpISub: result[i] = u(0) - u(1); break;
+		case spv::OpIMul: result[i] = u(0) * u(1); break;
+		case spv::OpUDiv: result[i] = u(1) != 0 ? u(0) / u(1) : 0; break;
+		case spv::OpSDiv: result[i] = s(1) != 0 ? (uint32_t)(s(0) / s(1)) : 0; break;
+		case spv::OpUMod: result[i] = u(1) != 0 ? u(0) % u(1) : 0; break;
+		case spv::OpSRem: result[i] = s(1) != 0 ? (uint32_t)(s(0) % s(1)) : 0; break;
+		case spv::OpSMod:
+		{
+			auto value = s(1) != 0 ? s(0) % s(1) : 0;
+			result[i] = (uint32_t)(value != 0 && (value < 0) != (s(1) < 0) ? value + s(1) : value);
+			break;
+		}
+		case spv::OpShiftRightLogical: result[i] = u(0) >> (u(1) & 31); break;
+		case spv::OpShiftRightArithmetic: result[i] = (uint32_t)(s(0) >> (u(1) & 31)); break;
+		case spv::OpShiftLeftLogical: result[i] = u(0) << (u(1) & 31); break;
+		case spv::OpBitwiseOr: result[i] = u(0) | u(1); break;
+		case spv::OpBitwiseXor: result[i] = u(0) ^ u(1); break;
+		case spv::OpBitwiseAnd: result[i] = u(0) & u(1); break;
+		case spv::OpLogicalOr: result[i] = b(u(0) || u(1)); break;
+		case spv::OpLogicalAnd: result[i] = b(u(0) && u(1)); break;
+		case spv::OpLogicalNot: result[i] = b(!u(0)); break;
+		case spv::OpLogicalEqual: result[i] = b((u(0) != 0) == (u(1) != 0)); break;
+		case spv::OpLogicalNotEqual: result[i] = b((u(0) != 0) != (u(1) != 0)); break;
+		case spv::OpSelect: result[i] = u(0) ? u(1) : u(2); break;
+		case spv::OpIEqual: result[i] = b(u(0) == u(1)); break;
+		case spv::OpINotEqual: result[i] = b(u(0) != u(1)); break;
+		case spv::OpULessThan: result[i] = b(u(0) < u(1)); break;
+		case spv::OpSLessThan: result[i] = b(s(0) < s(1)); break;
+		case spv::OpUGreaterThan: result[i] = b(u(0) > u(1)); break;
+		case spv::OpSGreaterThan: result[i] = b(s(0) > s(1)); break;
+		case spv::OpULessThanEqual: result[i] = b(u(0) <= u(1)); break;
+		case spv::OpSLessThanEqual: result[i] = b(s(0) <= s(1)); break;
+		case spv::OpUGreaterThanEqual: result[i] = b(u(0) >= u(1)); break;
+		case spv::OpSGreaterThanEqual: result[i] = b(s(0) >= s(1)); break;
+		default:
+			throw std::runtime_error("spec constant operation " + std::to_string(op) + " is not supported by interpreter");
+		}
+	}
+
+	return result;
+}
+
+ShaderInterpreter::ShaderInterpreter(const std::vector<uint32_t>& spirv) : mProgram(std::make_unique<Program>())
+{
+	auto& p = *mProgram;
+
+	if (spirv.size() < 5 || spirv.at(0) != spv::MagicNumber)
+		throw std::runtime_error("invalid spirv");
+
+	auto bound = spirv.at(3);
+
+	p.words = spirv;
+	p.types.resize(bound);
+	p.id_types.resize(bound, 0);
+	p.registers.resize(bound, 0);
+	p.block_indices.resize(bound, NoBlock);
+	p.function_indices.resize(bound, NoBlock);
+
+	const auto& words = p.words;
+
+	auto getConstant = [&](uint32_t id) -> uint32_t {
+		if (!p.constants.contains(id))
+			throw std::runtime_error("spirv constant expected");
+
+		return p.constants.at(id).at(0);
+	};
+
+	std::vector<uint32_t> variables;
+	Function* function = nullptr;
+	Block* block = nullptr;
+
+	for (uint32_t offset = 5; offset < words.size();)
+	{
+		auto op = (spv::Op)(words.at(offset) & spv::OpCodeMask);
+		auto count = words.at(offset) >> spv::WordCountShift;
+
+		if (count == 0 || offset + count > words.size())
+			throw std::runtime_error("invalid spirv");
+
+		const auto* w = &words.at(offset);
+		auto index = (uint32_t)p.instructions.size();
+		p.instructions.push_back({ offset, op, count });
+		offset += count;
+
+		bool has_result = false;
+		bool has_result_type = false;
+		spv::HasResultAndType(op, &has_result, &has_result_type);
+
+		if (has_result_type)
+			p.id_types.at(w[2]) = w[1];
+
+		if (function != nullptr && op != spv::OpFunctionEnd && op != spv::OpLabel && op != spv::OpFunctionParameter &&
+			!IsSupportedInstruction(op))
+		{
+			throw std::runtime_error("spirv instruction " + std::to_string(op) + " is not supported by interpreter");
+		}
+
+		switch (op)
+		{
+		case spv::OpExtInstImport:
+			if (std::string((const char*)&w[2]) == "GLSL.std.450")
+				p.glsl_std_450 = w[1];
+			break;
+
+		case spv::OpEntryPoint:
+			if (p.entry_point != 0)
+				break;
+
+			if (w[1] == spv::ExecutionModelVertex)
+				p.stage = ShaderStage::Vertex;
+			else if (w[1] == spv::ExecutionModelFragment)
+				p.stage = ShaderStage::Fragment;
+			else
+				throw std::runtime_error("only vertex and fragment stages are supported by interpreter");
+
+			p.entry_point = w[2];
+			break;
+
+		case spv::OpDecorate:
+			p.decorations[w[1]][w[2]] = count > 3 ? w[3] : 1;
+			break;
+
+		case spv::OpMemberDecorate:
+			p.member_decorations[((uint64_t)w[1] << 32) | w[2]][w[3]] = count > 4 ? w[4] : 1;
+			break;
+
+		case spv::OpTypeVoid:
+			p.types.at(w[1]) = { op, 0 };
+			break;
+
+		case spv::OpTypeBool:
+			p.types.at(w[1]) = { op, 1, ScalarKind::Bool };
+			break;
+
+		case spv::OpTypeInt:
+			if (w[2] != 32)
+				throw std::runtime_error("only 32 bit integers are supported by interpreter");
+
+			p.types.at(w[1]) = { op, 1, w[3] ? ScalarKind::Int : ScalarKind::UInt };
+			break;
+
+		case spv::OpTypeFloat:
+			if (w[2] != 32)
+				throw std::runtime_error("only 32 bit floats are supported by interpreter");
+
+			p.types.at(w[1]) = { op, 1, ScalarKind::Float };
+			break;
+
+		case spv::OpTypeVector:
+		{
+			auto& type = p.types.at(w[1]);
+			type = { op, w[3], p.types.at(w[2]).scalar, w[2], w[3] };
+			type.rows = w[3];
+			break;
+		}
+
+		case spv::OpTypeMatrix:
+		{
+			const auto& column = p.types.at(w[2]);
+			auto& type = p.types.at(w[1]);
+			type = { op, column.components * w[3], column.scalar, w[2], w[3] };
+			type.rows = column.rows;
+			break;
+		}
+
+		case spv::OpTypeImage:
+		case spv::OpTypeSampler:
+		case spv::OpTypeSampledImage:
+			p.types.at(w[1]) = { op, 1, ScalarKind::UInt, count > 2 ? w[2] : 0 };
+			break;
+
+		case spv::OpTypeArray:
+		{
+			const auto& element = p.types.at(w[2]);
+			auto length = getConstant(w[3]);
+			auto& type = p.types.at(w[1]);
+			type = { op, element.components * length, element.scalar, w[2], length };
+			type.array_stride = p.getDecoration(w[1], spv::DecorationArrayStride).value_or(0);
+			break;
+		}
+
+		case spv::OpTypeRuntimeArray:
+			throw std::runtime_error("runtime arrays are not supported by interpreter");
+
+		case spv::OpTypeStruct:
+		{
+			auto& type = p.types.at(w[1]);
+			type = { op, 0 };
+			uint32_t buffer_offset = 0;
+
+			for (uint32_t i = 2; i < count; i++)
+			{
+				auto member = i - 2;
+				const auto& member_type = p.types.at(w[i]);
+				type.members.push_back(w[i]);
+				type.member_components.push_back(type.components);
+				type.components += member_type.components;
+
+				buffer_offset = p.getMemberDecoration(w[1], member, spv::DecorationOffset).value_or(buffer_offset);
+				type.member_offsets.push_back(buffer_offset);
+				buffer_offset += member_type.components * 4;
+
+				type.member_matrix_strides.push_back(p.getMemberDecoration(w[1], member,
+					spv::DecorationMatrixStride).value_or(16));
+
+				if (p.getMemberDecoration(w[1], member, spv::DecorationRowMajor).has_value())
+					throw std::runtime_error("row major matrices are not supported by interpreter");
+			}
+			break;
+		}
+
+		case spv::OpTypePointer:
+		{
+			auto& type = p.types.at(w[1]);
+			type = { op, 1, ScalarKind::UInt, w[3] };
+			type.storage = (spv::StorageClass)w[2];
+
+			if (type.storage == spv::StorageClassPushConstant)
+				throw std::runtime_error("push constants are not supported by interpreter");
+			break;
+		}
+
+		case spv::OpTypeFunction:
+			p.types.at(w[1]) = { op, 0 };
+			break;
+
+		case spv::OpConstantTrue:
+		case spv::OpSpecConstantTrue:
+			p.constants[w[2]] = { ~0u };
+			break;
+
+		case spv::OpConstantFalse:
+		case spv::OpSpecConstantFalse:
+			p.constants[w[2]] = { 0u };
+			break;
+
+		case spv::OpConstant:
+		case spv::OpSpecConstant:
+			p.constants[w[2]] = { w[3] };
+			break;
+
+		case spv::OpConstantComposite:
+		case spv::OpSpecConstantComposite:
+		{
+			std::vector<uint32_t> values;
+
+			for (uint32_t i = 3; i < count; i++)
+			{
+				const auto& constituent = p.constants.at(w[i]);
+				values.insert(values.end(), constituent.begin(), constituent.end());
+			}
+
+			p.constants[w[2]] = std::move(values);
+			break;
+		}
+
+		case spv::OpConstantNull:
+		case spv::OpUndef:
+			if (function == nullptr || op == spv::OpConstantNull)
+				p.constants[w[2]] = std::vector<uint32_t>(p.types.at(w[1]).components, 0);
+			break;
+
+		case spv::OpSpecConstantOp:
+		{
+			std::vector<const std::vector<uint32_t>*> operands;
+
+			for (uint32_t i = 4; i < count; i++)
+			{
+				operands.push_back(&p.constants.at(w[i]));
+			}
+
+			p.constants[w[2]] = FoldSpecConstantOp((spv::Op)w[3], operands);
+			break;
+		}
+
+		case spv::OpVariable:
+			if (function == nullptr)
+				variables.push_back(index);
+			break;
+
+		case spv::OpFunction:
+			function = &p.functions.emplace_back();
+			function->id = w[2];
+			function->index = (uint32_t)p.functions.size() - 1;
+			p.function_indices.at(w[2]) = function->index;
+			break;
+
+		case spv::OpFunctionParameter:
+			function->params.push_back(w[2]);
+			break;
+
+		case spv::OpFunctionEnd:
+			function = nullptr;
+			break;
+
+		case spv::OpLabel:
+			p.block_indices.at(w[1]) = (uint32_t)function->blocks.size();
+			block = &function->blocks.emplace_back();
+			block->label = w[1];
+			block->begin = index + 1;
+			block->body = index + 1;
+			break;
+
+		case spv::OpPhi:
+			block->body = index + 1;
+			break;
+
+		case spv::OpKill:
+		case spv::OpTerminateInvocation:
+		case spv::OpDemoteToHelperInvocation:
+			p.has_kill = true;
+			break;
+
+		default:
+			break;
+		}
+
+		if (block != nullptr && IsTerminator(op))
+		{
+			block->end = index + 1;
+			block = nullptr;
+		}
+	}
+
+	if (p.entry_point == 0)
+		throw std::runtime_error("spirv entry point not found");
+
+	for (uint32_t id = 0; id < bound; id++)
+	{
+		if (p.types.at(id).op != spv::OpNop)
+			MakeBufferOffsets(p, id);
+	}
+
+	// registers
+
+	uint32_t max_components = 4;
+
+	for (uint32_t id = 0; id < bound; id++)
+	{
+		auto type_id = p.id_types.at(id);
+
+		if (type_id == 0)
+			continue;
+
+		auto components = p.types.at(type_id).components;
+		p.registers.at(id) = p.register_count;
+		p.register_count += components;
+		max_components = std::max(max_components, components);
+	}
+
+	for (const auto& [id, values] : p.constants)
+	{
+		for (uint32_t i = 0; i < values.size(); i++)
+			p.initial_values.push_back({ p.registers.at(id) + i, values.at(i) });
+	}
+
+	// storage of variables lives in registers too, the variable id holds the pointer
+
+	for (const auto& instruction : p.instructions)
+	{
+		if (instruction.op != spv::OpVariable)
+			continue;
+
+		const auto* w = &words.at(instruction.offset);
+		const auto& pointer_type = p.types.at(w[1]);
+		const auto& type = p.types.at(pointer_type.element);
+		auto storage = (spv::StorageClass)w[3];
+		auto binding = p.getDecoration(w[2], spv::DecorationBinding).value_or(0);
+
+		if (IsRegisterStorage(storage))
+		{
+			p.initial_values.push_back({ p.registers.at(w[2]), p.register_count });
+
+			if (storage == spv::StorageClassPrivate && instruction.count > 4)
+			{
+				const auto& values = p.constants.at(w[4]);
+
+				for (uint32_t i = 0; i < values.size(); i++)
+					p.initial_values.push_back({ p.register_count + i, values.at(i) });
+			}
+
+			p.register_count += type.components;
+			max_components = std::max(max_components, type.components);
+		}
+		else if (IsBufferStorage(storage))
+		{
+			p.initial_values.push_back({ p.registers.at(w[2]), binding << BufferBindingShift });
+		}
+		else if (storage == spv::StorageClassUniformConstant)
+		{
+			p.initial_values.push_back({ p.registers.at(w[2]), binding });
+		}
+		else
+		{
+			throw std::runtime_error("storage class " + std::to_string(storage) + " is not supported by interpreter");
+		}
+	}
+
+	// stage interface
+
+	for (auto index : variables)
+	{
+		const auto* w = &words.at(p.instructions.at(index).offset);
+		auto storage = (spv::StorageClass)w[3];
+
+		if (storage != spv::StorageClassInput && storage != spv::StorageClassOutput)
+			continue;
+
+		auto id = w[2];
+		auto type_id = p.types.at(w[1]).element;
+		const auto& type = p.types.at(type_id);
+		auto reg = std::find_if(p.initial_values.begin(), p.initial_values.end(), [&](const auto& value) {
+			return value.first == p.registers.at(id);
+		})->second;
+
+		static const std::unordered_map<uint32_t, BuiltIn> BuiltInMap = {
+			{ spv::BuiltInPosition, BuiltIn::Position },
+			{ spv::BuiltInPointSize, BuiltIn::PointSize },
+			{ spv::BuiltInVertexIndex, BuiltIn::VertexIndex },
+			{ spv::BuiltInInstanceIndex, BuiltIn::InstanceIndex },
+			{ spv::BuiltInFragCoord, BuiltIn::FragCoord },
+			{ spv::BuiltInFrontFacing, BuiltIn::FrontFacing },
+			{ spv::BuiltInFragDepth, BuiltIn::FragDepth },
+		};
+
+		if (auto builtin = p.getDecoration(id, spv::DecorationBuiltIn); builtin.has_value())
+		{
+			if (BuiltInMap.contains(builtin.value()))
+				p.builtins[BuiltInMap.at(builtin.value())] = reg;
+
+			continue;
+		}
+
+		if (type.op == spv::OpTypeStruct && p.getMemberDecoration(type_id, 0, spv::DecorationBuiltIn).has_value())
+		{
+			for (uint32_t i = 0; i < type.members.size(); i++)
+			{
+				auto builtin = p.getMemberDecoration(type_id, i, spv::DecorationBuiltIn);
+
+				if (builtin.has_value() && BuiltInMap.contains(builtin.value()))
+					p.builtins[BuiltInMap.at(builtin.value())] = reg + type.member_components.at(i);
+			}
+			continue;
+		}
+
+		auto location = p.getDecoration(id, spv::DecorationLocation).value_or(0);
+		auto flat = p.getDecoration(id, spv::DecorationFlat).has_value();
+		auto no_perspective = p.getDecoration(id, spv::DecorationNoPerspective).has_value();
+		auto& varyings = storage == spv::StorageClassInput ? p.inputs : p.outputs;
+		CollectVaryings(p, type_id, reg, location, flat, no_perspective, varyings);
+	}
+
+	p.writes_depth = p.builtins.contains(BuiltIn::FragDepth);
+
+	for (auto& varyings : { &p.inputs, &p.outputs })
+	{
+		std::sort(varyings->begin(), varyings->end(), [](const auto& a, const auto& b) {
+			return a.location < b.location;
+		});
+	}
+
+	// phi values are gathered before being written, reserve scratch for them after the result area
+
+	uint32_t max_phi_components = 0;
+
+	for (const auto& function : p.functions)
+	{
+		for (const auto& block : function.blocks)
+		{
+			uint32_t components = 0;
+
+			for (auto i = block.begin; i < block.body; i++)
+				components += p.types.at(words.at(p.instructions.at(i).offset + 1)).components;
+
+			max_phi_components = std::max(max_phi_components, components);
+		}
+	}
+
+	p.scratch_size = max_components + max_phi_components;
+}
+
+ShaderInterpreter::~ShaderInterpreter()
+{
+}
+
+ShaderStage ShaderInterpreter::getStage() const
+{
+	return mProgram->stage;
+}
+
+const std::vector<ShaderInterpreter::Varying>& ShaderInterpreter::getInputs() const
+{
+	return mProgram->inputs;
+}
+
+const std::vector<ShaderInterpreter::Varying>& ShaderInterpreter::getOutputs() const
+{
+	return mProgram->outputs;
+}
+
+std::optional<uint32_t> ShaderInterpreter::getBuiltIn(BuiltIn value) const
+{
+	if (!mProgram->builtins.contains(value))
+		return std::nullopt;
+
+	return mProgram->builtins.at(value);
+}
+
+bool ShaderInterpreter::hasKill() const
+{
+	return mProgram->has_kill;
+}
+
+bool ShaderInterpreter::writesDepth() const
+{
+	return mProgram->writes_depth;
+}
+
+// execution
+
+template <typename T> static T* Lane(Register& reg);
+template <> float* Lane<float>(Register& reg) { return reg.f; }
+template <> int32_t* Lane<int32_t>(Register& reg) { return reg.i; }
+template <> uint32_t* Lane<uint32_t>(Register& reg) { return reg.u; }
+
+template <typename T> static const T* Lane(const Register& reg) { return Lane<T>(const_cast<Register&>(reg)); }
+
+static const std::array<Register, 1 << Lanes> LaneMasks = [] {
+	std::array<Register, 1 << Lanes> result;
+
+	for (uint32_t mask = 0; mask < result.size(); mask++)
+		for (uint32_t l = 0; l < Lanes; l++)
+			result[mask].u[l] = (mask & (1 << l)) ? ~0u : 0u;
+
+	return result;
+}();
+
+static uint32_t MaskOf(const Register& reg)
+{
+	uint32_t result = 0;
+
+	for (uint32_t l = 0; l < Lanes; l++)
+		result |= (reg.u[l] != 0 ? 1u : 0u) << l;
+
+	return result;
+}
+
+static void Blend(Register& dst, const Register& src, uint32_t mask)
+{
+	const auto& m = LaneMasks[mask];
+
+	for (uint32_t l = 0; l < Lanes; l++)
+		dst.u[l] = (src.u[l] & m.u[l]) | (dst.u[l] & ~m.u[l]);
+}
+
+static bool IsUniform(const Register& reg, uint32_t mask, uint32_t& value)
+{
+	value = reg.u[std::countr_zero(mask)];
+
+	for (uint32_t l = 0; l < Lanes; l++)
+	{
+		if ((mask & (1 << l)) && reg.u[l] != value)
+			return false;
+	}
+
+	return true;
+}
+
+struct skygfx::ShaderExecutor
+{
+	using Program = ShaderInterpreter::Program;
+
+	ShaderInterpreter::Context& ctx;
+	const Program& p;
+	Register* regs;
+
+	const TypeInfo& typeOf(uint32_t id) const { return p.types[p.id_types[id]]; }
+	Register* reg(uint32_t id) { return &regs[p.registers[id]]; }
+
+	// results are written directly when all lanes are active, otherwise through scratch and blended
+
+	Register* beginWrite(uint32_t id, uint32_t mask)
+	{
+		return mask == AllLanes ? reg(id) : ctx.mScratch.data();
+	}
+
+	void endWrite(uint32_t id, Register* result, uint32_t components, uint32_t mask)
+	{
+		if (mask == AllLanes)
+			return;
+
+		auto dst = reg(id);
+
+		for (uint32_t c = 0; c < components; c++)
+			Blend(dst[c], result[c], mask);
+	}
+
+	void copy(uint32_t dst_id, const Register* src, uint32_t components, uint32_t mask)
+	{
+		auto dst = reg(dst_id);
+
+		for (uint32_t c = 0; c < components; c++)
+		{
+			if (mask == AllLanes)
+				dst[c] = src[c];
+			else
+				Blend(dst[c], src[c], mask);
+		}
+	}
+
+	template <typename T, typename R = T, typename F>
+	void unary(const uint32_t* w, const uint32_t* operands, uint32_t mask, F func)
+	{
+		auto n = p.types[w[1]].components;
+		auto a = reg(operands[0]);
+		auto out = beginWrite(w[2], mask);
+
+		for (uint32_t c = 0; c < n; c++)
+		{
+			auto src = Lane<T>(a[c]);
+			auto dst = Lane<R>(out[c]);
+
+			for (uint32_t l = 0; l < Lanes; l++)
+				dst[l] = (R)func(src[l]);
+		}
+
+		endWrite(w[2], out, n, mask);
+	}
+
+	template <typename T, typename R = T, typename F>
+	void binary(const uint32_t* w, const uint32_t* operands, uint32_t mask, F func)
+	{
+		auto n = p.types[w[1]].components;
+		auto a = reg(operands[0]);
+		auto b = reg(operands[1]);
+		auto a_step = typeOf(operands[0]).components > 1 ? 1 : 0;
+		auto b_step = typeOf(operands[1]).components > 1 ? 1 : 0;
+		auto out = beginWrite(w[2], mask);
+
+		for (uint32_t c = 0; c < n; c++)
+		{
+			auto x = Lane<T>(a[c * a_step]);
+			auto y = Lane<T>(b[c * b_step]);
+			auto dst = Lane<R>(out[c]);
+
+			for (uint32_t l = 0; l < Lanes; l++)
+				dst[l] = (R)func(x[l], y[l]);
+		}
+
+		endWrite(w[2], out, n, mask);
+	}
+
+	template <typename T, typename F>
+	void ternary(const uint32_t* w, const uint32_t* operands, uint32_t mask, F func)
+	{
+		auto n = p.types[w[1]].components;
+		auto a = reg(operands[0]);
+		auto b = reg(operands[1]);
+		auto c_ = reg(operands[2]);
+		auto a_step = typeOf(operands[0]).components > 1 ? 1 : 0;
+		auto b_step = typeOf(operands[1]).components > 1 ? 1 : 0;
+		auto c_step = typeOf(operands[2]).components > 1 ? 1 : 0;
+		auto out = beginWrite(w[2], mask);
+
+		for (uint32_t c = 0; c < n; c++)
+		{
+			auto x = Lane<T>(a[c * a_step]);
+			auto y = Lane<T>(b[c * b_step]);
+			auto z = Lane<T>(c_[c * c_step]);
+			auto dst = Lane<T>(out[c]);
+
+			for (uint32_t l = 0; l < Lanes; l++)
+				dst[l] = func(x[l], y[l], z[l]);
+		}
+
+		endWrite(w[2], out, n, mask);
+	}
+
+	template <typename T, typename F>
+	void compare(const uint32_t* w, uint32_t mask, F func)
+	{
+		binary<T, uint32_t>(w, &w[3], mask, [&](T a, T b) { return func(a, b) ? ~0u : 0u; });
+	}
+
+	void dot(const Register* a, const Register* b, uint32_t n, Register& out)
+	{
+		for (uint32_t l = 0; l < Lanes; l++)
+			out.f[l] = 0.0f;
+
+		for (uint32_t c = 0; c < n; c++)
+			for (uint32_t l = 0; l < Lanes; l++)
+				out.f[l] += a[c].f[l] * b[c].f[l];
+	}
+
+	// lanes are 2x2 quads: 0 - top left, 1 - top right, 2 - bottom left, 3 - bottom right
+
+	void derivative(const uint32_t* w, uint32_t mask, bool x, bool fine)
+	{
+		auto n = p.types[w[1]].components;
+		auto a = reg(w[3]);
+		auto out = beginWrite(w[2], mask);
+
+		for (uint32_t c = 0; c < n; c++)
+		{
+			for (uint32_t l = 0; l < Lanes; l++)
+			{
+				auto quad = l & ~3u;
+				auto row = fine ? (l & 2u) : 0u;
+				auto column = fine ? (l & 1u) : 0u;
+
+				if (x)
+					out[c].f[l] = a[c].f[quad + row + 1] - a[c].f[quad + row];
+				else
+					out[c].f[l] = a[c].f[quad + column + 2] - a[c].f[quad + column];
+			}
+		}
+
+		endWrite(w[2], out, n, mask);
+	}
+
+	void fwidth(const uint32_t* w, uint32_t mask, bool fine)
+	{
+		auto n = p.types[w[1]].components;
+		auto a = reg(w[3]);
+		auto out = beginWrite(w[2], mask);
+
+		for (uint32_t c = 0; c < n; c++)
+		{
+			for (uint32_t l = 0; l < Lanes; l++)
+			{
+				auto quad = l & ~3u;
+				auto row = fine ? (l & 2u) : 0u;
+				auto column = fine ? (l & 1u) : 0u;
+				auto dx = a[c].f[quad + row + 1] - a[c].f[quad + row];
+				auto dy = a[c].f[quad + column + 2] - a[c].f[quad + column];
+				out[c].f[l] = std::abs(dx) + std::abs(dy);
+			}
+		}
+
+		endWrite(w[2], out, n, mask);
+	}
+
+	// memory
+
+	uint32_t readBuffer(uint32_t address)
+	{
+		auto binding = address >> BufferBindingShift;
+		auto offset = address & BufferOffsetMask;
+
+		if (binding >= ctx.mUniformBuffers.size())
+			return 0;
+
+		const auto& buffer = ctx.mUniformBuffers[binding];
+
+		if (offset + 4 > buffer.size)
+			return 0;
+
+		uint32_t result;
+		memcpy(&result, buffer.memory + offset, 4);
+		return result;
+	}
+
+	void load(uint32_t pointer_id, Register* out, uint32_t mask)
+	{
+		const auto& pointer_type = typeOf(pointer_id);
+		const auto& type = p.types[pointer_type.element];
+		const auto& address = *reg(pointer_id);
+		auto n = type.components;
+
+		if (pointer_type.storage == spv::StorageClassUniformConstant)
+		{
+			out[0] = address;
+			return;
+		}
+
+		uint32_t uniform_address;
+		bool uniform = IsUniform(address, mask, uniform_address);
+
+		if (IsBufferStorage(pointer_type.storage))
+		{
+			for (uint32_t c = 0; c < n; c++)
+			{
+				if (uniform)
+				{
+					auto value = readBuffer(uniform_address + type.buffer_offsets[c]);
+
+					for (uint32_t l = 0; l < Lanes; l++)
+						out[c].u[l] = value;
+				}
+				else
+				{
+					for (uint32_t l = 0; l < Lanes; l++)
+						out[c].u[l] = (mask & (1 << l)) ? readBuffer(address.u[l] + type.buffer_offsets[c]) : 0;
+				}
+			}
+			return;
+		}
+
+		if (uniform)
+		{
+			memcpy(out, &regs[uniform_address], n * sizeof(Register));
+			return;
+		}
+
+		for (uint32_t c = 0; c < n; c++)
+			for (uint32_t l = 0; l < Lanes; l++)
+				out[c].u[l] = (mask & (1 << l)) ? regs[address.u[l] + c].u[l] : 0;
+	}
+
+	void store(uint32_t pointer_id, const Register* value, uint32_t mask)
+	{
+		const auto& pointer_type = typeOf(pointer_id);
+		const auto& type = p.types[pointer_type.element];
+		const auto& address = *reg(pointer_id);
+		auto n = type.components;
+
+		if (!IsRegisterStorage(pointer_type.storage))
+			throw std::runtime_error("store to read only memory");
+
+		uint32_t uniform_address;
+
+		if (IsUniform(address, mask, uniform_address))
+		{
+			for (uint32_t c = 0; c < n; c++)
+			{
+				if (mask == AllLanes)
+					regs[uniform_address + c] = value[c];
+				else
+					Blend(regs[uniform_address + c], value[c], mask);
+			}
+			return;
+		}
+
+		for (uint32_t c = 0; c < n; c++)
+			for (uint32_t l = 0; l < Lanes; l++)
+				if (mask & (1 << l))
+					regs[address.u[l] + c].u[l] = value[c].u[l];
+	}
+
+	void accessChain(const uint32_t* w, uint32_t count, uint32_t mask)
+	{
+		const auto& pointer_type = typeOf(w[3]);
+		auto buffer = IsBufferStorage(pointer_type.storage);
+		auto type_id = pointer_type.element;
+		auto matrix_stride = 16u;
+		auto out = beginWrite(w[2], mask);
+
+		out[0] = *reg(w[3]);
+
+		for (uint32_t i = 4; i < count; i++)
+		{
+			const auto& type = p.types[type_id];
+			const auto& index = *reg(w[i]);
+			uint32_t stride = 0;
+
+			switch (type.op)
+			{
+			case spv::OpTypeStruct:
+			{
+				auto member = index.u[0];
+				auto offset = buffer ? type.member_offsets[member] : type.member_components[member];
+				matrix_stride = type.member_matrix_strides[member];
+				type_id = type.members[member];
+
+				for (uint32_t l = 0; l < Lanes; l++)
+					out[0].u[l] += offset;
+
+				continue;
+			}
+			case spv::OpTypeArray:
+				stride = buffer ? (type.array_stride != 0 ? type.array_stride : 16) : p.types[type.element].components;
+				break;
+			case spv::OpTypeMatrix:
+				stride = buffer ? matrix_stride : type.rows;
+				break;
+			case spv::OpTypeVector:
+				stride = buffer ? 4 : 1;
+				break;
+			default:
+				throw std::runtime_error("invalid access chain");
+			}
+
+			type_id = type.element;
+
+			for (uint32_t l = 0; l < Lanes; l++)
+				out[0].u[l] += index.u[l] * stride;
+		}
+
+		endWrite(w[2], out, 1, mask);
+	}
+
+	uint32_t compositeOffset(uint32_t type_id, const uint32_t* indices, uint32_t count, uint32_t& result_type)
+	{
+		uint32_t offset = 0;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const auto& type = p.types[type_id];
+
+			if (type.op == spv::OpTypeStruct)
+			{
+				offset += type.member_components[indices[i]];
+				type_id = type.members[indices[i]];
+			}
+			else
+			{
+				type_id = type.element;
+				offset += indices[i] * p.types[type_id].components;
+			}
+		}
+
+		result_type = type_id;
+		return offset;
+	}
+
+	// images
+
+	uint32_t bindingOf(uint32_t id, uint32_t mask)
+	{
+		return reg(id)->u[std::countr_zero(mask)];
+	}
+
+	void computeLod(uint32_t binding, const Register* ddx, const Register* ddy, Register& lod)
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		ctx.mTextureProvider->getSize(binding, 0, width, height);
+
+		for (uint32_t l = 0; l < Lanes; l++)
+		{
+			auto dudx = ddx[0].f[l] * (float)width;
+			auto dvdx = ddx[1].f[l] * (float)height;
+			auto dudy = ddy[0].f[l] * (float)width;
+			auto dvdy = ddy[1].f[l] * (float)height;
+			auto rho = std::max((dudx * dudx) + (dvdx * dvdx), (dudy * dudy) + (dvdy * dvdy));
+			lod.f[l] = rho > 0.0f ? 0.5f * std::log2(rho) : -16.0f;
+		}
+	}
+
+	void sample(const uint32_t* w, uint32_t count, uint32_t mask, bool proj)
+	{
+		if (ctx.mTextureProvider == nullptr)
+			throw std::runtime_error("texture provider is not set");
+
+		auto binding = bindingOf(w[3], mask);
+		auto coord = reg(w[4]);
+		auto coord_components = typeOf(w[4]).components;
+		auto operands = count > 5 ? w[5] : 0;
+		uint32_t operand = 6;
+
+		Register uv[2] = { coord[0], coord[1] };
+
+		if (proj)
+		{
+			const auto& q = coord[coord_components - 1];
+
+			for (uint32_t l = 0; l < Lanes; l++)
+			{
+				uv[0].f[l] /= q.f[l];
+				uv[1].f[l] /= q.f[l];
+			}
+		}
+
+		Register lod;
+		Register ddx[2];
+		Register ddy[2];
+		bool explicit_lod = false;
+		float bias = 0.0f;
+
+		if (operands & spv::ImageOperandsBiasMask)
+			bias = reg(w[operand++])->f[std::countr_zero(mask)];
+
+		if (operands & spv::ImageOperandsLodMask)
+		{
+			lod = *reg(w[operand++]);
+			explicit_lod = true;
+		}
+
+		if (operands & spv::ImageOperandsGradMask)
+		{
+			auto dx = reg(w[operand++]);
+			auto dy = reg(w[operand++]);
+			ddx[0] = dx[0];
+			ddx[1] = dx[1];
+			ddy[0] = dy[0];
+			ddy[1] = dy[1];
+			computeLod(binding, ddx, ddy, lod);
+			explicit_lod = true;
+		}
+
+		if (operands & spv::ImageOperandsConstOffsetMask)
+		{
+			auto offset = reg(w[operand++]);
+			uint32_t width = 0;
+			uint32_t height = 0;
+			ctx.mTextureProvider->getSize(binding, 0, width, height);
+
+			for (uint32_t l = 0; l < Lanes; l++)
+			{
+				uv[0].f[l] += (float)offset[0].i[l] / (float)std::max(width, 1u);
+				uv[1].f[l] += (float)offset[1].i[l] / (float)std::max(height, 1u);
+			}
+		}
+
+		if (!explicit_lod)
+		{
+			if (p.stage == ShaderStage::Fragment)
+			{
+				for (uint32_t i = 0; i < 2; i++)
+				{
+					for (uint32_t l = 0; l < Lanes; l++)
+					{
+						auto quad = l & ~3u;
+						ddx[i].f[l] = uv[i].f[quad + 1] - uv[i].f[quad];
+						ddy[i].f[l] = uv[i].f[quad + 2] - uv[i].f[quad];
+					}
+				}
+
+				computeLod(binding, ddx, ddy, lod);
+			}
+			else
+			{
+				lod = {};
+			}
+		}
+
+		for (uint32_t l = 0; l < Lanes; l++)
+			lod.f[l] += bias;
+
+		Register result[4];
+		ctx.mTextureProvider->sample(binding, uv[0], uv[1], lod, mask, result);
+		copy(w[2], result, p.types[w[1]].components, mask);
+	}
+
+	void fetch(const uint32_t* w, uint32_t count, uint32_t mask)
+	{
+		if (ctx.mTextureProvider == nullptr)
+			throw std::runtime_error("texture provider is not set");
+
+		auto binding = bindingOf(w[3], mask);
+		auto coord = reg(w[4]);
+		Register lod = {};
+
+		if (count > 6 && (w[5] & spv::ImageOperandsLodMask))
+			lod = *reg(w[6]);
+
+		Register result[4];
+		ctx.mTextureProvider->fetch(binding, coord[0], coord[1], lod, mask, result);
+		copy(w[2], result, p.types[w[1]].components, mask);
+	}
+
+	void querySize(const uint32_t* w, uint32_t count, uint32_t mask)
+	{
+		if (ctx.mTextureProvider == nullptr)
+			throw std::runtime_error("texture provider is not set");
+
+		auto binding = bindingOf(w[3], mask);
+		auto lod = count > 4 ? reg(w[4])->u[std::countr_zero(mask)] : 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		ctx.mTextureProvider->getSize(binding, lod, width, height);
+
+		Register result[2];
+
+		for (uint32_t l = 0; l < Lanes; l++)
+		{
+			result[0].u[l] = width;
+			result[1].u[l] = height;
+		}
+
+		copy(w[2], result, std::min(p.types[w[1]].components, 2u), mask);
+	}
+
+	// GLSL.std.450
+
+	template <typename F>
+	void unaryFloat(const uint32_t* w, uint32_t mask, F func)
+	{
+		unary<float>(w, &w[5], mask, func);
+	}
+
+	template <typename F>
+	void binaryFloat(const uint32_t* w, uint32_t mask, F func)
+	{
+		binary<float>(w, &w[5], mask, func);
+	}
+
+	template <typename F>
+	void ternaryFloat(const uint32_t* w, uint32_t mask, F func)
+	{
+		ternary<float>(w, &w[5], mask, func);
+	}
+
+	template <typename F>
+	void forEachMatrix(uint32_t id, uint32_t size, F func)
+	{
+		auto m = reg(id);
+
+		for (uint32_t l = 0; l < Lanes; l++)
+		{
+			glm::mat4 value(1.0f);
+
+			for (uint32_t column = 0; column < size; column++)
+				for (uint32_t row = 0; row < size; row++)
+					value[column][row] = m[(column * size) + row].f[l];
+
+			func(l, value);
+		}
+	}
+
+	void extInst(const uint32_t* w, uint32_t count, uint32_t mask)
+	{
+		if (w[3] != p.glsl_std_450)
+			throw std::runtime_error("unknown extended instruction set");
+
+		auto n = p.types[w[1]].components;
+
+		switch (w[4])
+		{
+		case GLSLstd450Round: unaryFloat(w, mask, [](float x) { return std::round(x); }); break;
+		case GLSLstd450RoundEven: unaryFloat(w, mask, [](float x) { return std::nearbyint(x); }); break;
+		case GLSLstd450Trunc: unaryFloat(w, mask, [](float x) { return std::trunc(x); }); break;
+		case GLSLstd450FAbs: unaryFloat(w, mask, [](float x) { return std::abs(x); }); break;
+		case GLSLstd450SAbs: unary<int32_t>(w, &w[5], mask, [](int32_t x) { return x < 0 ? -x : x; }); break;
+		case GLSLstd450FSign: unaryFloat(w, mask, [](float x) { return x > 0.0f ? 1.0f : (x < 0.0f ? -1.0f : 0.0f); }); break;
+		case GLSLstd450SSign: unary<int32_t>(w, &w[5], mask, [](int32_t x) { return x > 0 ? 1 : (x < 0 ? -1 : 0); }); break;
+		case GLSLstd450Floor: unaryFloat(w, mask, [](float x) { return std::floor(x); }); break;
+		case GLSLstd450Ceil: unaryFloat(w, mask, [](float x) { return std::ceil(x); }); break;
+		case GLSLstd450Fract: unaryFloat(w, mask, [](float x) { return x - std::floor(x); }); break;
+		case GLSLstd450Radians: unaryFloat(w, mask, [](float x) { return glm::radians(x); }); break;
+		case GLSLstd450Degrees: unaryFloat(w, mask, [](float x) { return glm::degrees(x); }); break;
+		case GLSLstd450Sin: unaryFloat(w, mask, [](float x) { return std::sin(x); }); break;
+		case GLSLstd450Cos: unaryFloat(w, mask, [](float x) { return std::cos(x); }); break;
+		case GLSLstd450Tan: unaryFloat(w, mask, [](float x) { return std::tan(x); }); break;
+		case GLSLstd450Asin: unaryFloat(w, mask, [](float x) { return std::asin(x); }); break;
+		case GLSLstd450Acos: unaryFloat(w, mask, [](float x) { return std::acos(x); }); break;
+		case GLSLstd450Atan: unaryFloat(w, mask, [](float x) { return std::atan(x); }); break;
+		case GLSLstd450Sinh: unaryFloat(w, mask, [](float x) { return std::sinh(x); }); break;
+		case GLSLstd450Cosh: unaryFloat(w, mask, [](float x) { return std::cosh(x); }); break;
+		case GLSLstd450Tanh: unaryFloat(w, mask, [](float x) { return std::tanh(x); }); break;
+		case GLSLstd450Asinh: unaryFloat(w, mask, [](float x) { return std::asinh(x); }); break;
+		case GLSLstd450Acosh: unaryFloat(w, mask, [](float x) { return std::acosh(x); }); break;
+		case GLSLstd450Atanh: unaryFloat(w, mask, [](float x) { return std::atanh(x); }); break;
+		case GLSLstd450Atan2: binaryFloat(w, mask, [](float y, float x) { return std::atan2(y, x); }); break;
+		case GLSLstd450Pow: binaryFloat(w, mask, [](float x, float y) { return std::pow(x, y); }); break;
+		case GLSLstd450Exp: unaryFloat(w, mask, [](float x) { return std::exp(x); }); break;
+		case GLSLstd450Log: unaryFloat(w, mask, [](float x) { return std::log(x); }); break;
+		case GLSLstd450Exp2: unaryFloat(w, mask, [](float x) { return std::exp2(x); }); break;
+		case GLSLstd450Log2: unaryFloat(w, mask, [](float x) { return std::log2(x); }); break;
+		case GLSLstd450Sqrt: unaryFloat(w, mask, [](float x) { return std::sqrt(x); }); break;
+		case GLSLstd450InverseSqrt: unaryFloat(w, mask, [](float x) { return 1.0f / std::sqrt(x); }); break;
+		case GLSLstd450FMin:
+		case GLSLstd450NMin: binaryFloat(w, mask, [](float x, float y) { return y < x ? y : x; }); break;
+		case GLSLstd450FMax:
+		case GLSLstd450NMax: binaryFloat(w, mask, [](float x, float y) { return x < y ? y : x; }); break;
+		case GLSLstd450UMin: binary<uint32_t>(w, &w[5], mask, [](uint32_t x, uint32_t y) { return std::min(x, y); }); break;
+		case GLSLstd450UMax: binary<uint32_t>(w, &w[5], mask, [](uint32_t x, uint32_t y) { return std::max(x, y); }); break;
+		case GLSLstd450SMin: binary<int32_t>(w, &w[5], mask, [](int32_t x, int32_t y) { return std::min(x, y); }); break;
+		case GLSLstd450SMax: binary<int32_t>(w, &w[5], mask, [](int32_t x, int32_t y) { return std::max(x, y); }); break;
+		case GLSLstd450FClamp:
+		case GLSLstd450NClamp: ternaryFloat(w, mask, [](float x, float lo, float hi) { return std::min(std::max(x, lo), hi); }); break;
+		case GLSLstd450UClamp: ternary<uint32_t>(w, &w[5], mask, [](uint32_t x, uint32_t lo, uint32_t hi) { return std::min(std::max(x, lo), hi); }); break;
+		case GLSLstd450SClamp: ternary<int32_t>(w, &w[5], mask, [](int32_t x, int32_t lo, int32_t hi) { return std::min(std::max(x, lo), hi); }); break;
+		case GLSLstd450FMix: ternaryFloat(w, mask, [](float x, float y, float a) { return x + ((y - x) * a); }); break;
+		case GLSLstd450Step: binaryFloat(w, mask, [](float edge, float x) { return x < edge ? 0.0f : 1.0f; }); break;
+		case GLSLstd450SmoothStep: ternaryFloat(w, mask, [](float e0, float e1, float x) {
+			auto t = std::min(std::max((x - e0) / (e1 - e0), 0.0f), 1.0f);
+			return t * t * (3.0f - (2.0f * t));
+		}); break;
+		case GLSLstd450Fma: ternaryFloat(w, mask, [](float a, float b, float c) { return (a * b) + c; }); break;
+		case GLSLstd450FindILsb: unary<uint32_t>(w, &w[5], mask, [](uint32_t x) { return x == 0 ? ~0u : (uint32_t)std::countr_zero(x); }); break;
+		case GLSLstd450FindUMsb: unary<uint32_t>(w, &w[5], mask, [](uint32_t x) { return x == 0 ? ~0u : 31u - std::countl_zero(x); }); break;
+		case GLSLstd450FindSMsb: unary<int32_t>(w, &w[5], mask, [](int32_t x) {
+			auto u = (uint32_t)(x < 0 ? ~x : x);
+			return u == 0 ? -1 : 31 - std::countl_zero(u);
+		}); break;
+		case GLSLstd450PackUnorm4x8:
+		{
+			auto v = reg(w[5]);
+			auto out = beginWrite(w[2], mask);
+
+			for (uint32_t l = 0; l < Lanes; l++)
+			{
+				uint32_t result = 0;
+
+				for (uint32_t c = 0; c < 4; c++)
+					result |= (uint32_t)std::round(std::clamp(v[c].f[l], 0.0f, 1.0f) * 255.0f) << (c * 8);
+
+				out[0].u[l] = result;
+			}
+
+			endWrite(w[2], out, 1, mask);
+			break;
+		}
+		case GLSLstd450UnpackUnorm4x8:
+		{
+			auto v = reg(w[5]);
+			auto out = beginWrite(w[2], mask);
+
+			for (uint32_t c = 0; c < 4; c++)
+				for (uint32_t l = 0; l < Lanes; l++)
+					out[c].f[l] = (float)((v[0].u[l] >> (c * 8)) & 0xFF) / 255.0f;
+
+			endWrite(w[2], out, 4, mask);
+			break;
+		}
+		case GLSLstd450Length:
+		case GLSLstd450Distance:
+		{
+			auto a = reg(w[5]);
+			auto b = w[4] == GLSLstd450Distance ? reg(w[6]) : nullptr;
+			auto components = typeOf(w[5]).components;
+			auto out = beginWrite(w[2], mask);
+			out[0] = {};
+
+			for (uint32_t c = 0; c < components; c++)
+			{
+				for (uint32_t l = 0; l < Lanes; l++)
+				{
+					auto d = b ? a[c].f[l] - b[c].f[l] : a[c].f[l];
+					out[0].f[l] += d * d;
+				}
+			}
+
+			for (uint32_t l = 0; l < Lanes; l++)
+				out[0].f[l] = std::sqrt(out[0].f[l]);
+
+			endWrite(w[2], out, 1, mask);
+			break;
+		}
+		case GLSLstd450Cross:
+		{
+			auto a = reg(w[5]);
+			auto b = reg(w[6]);
+			auto out = beginWrite(w[2], mask);
+
+			for (uint32_t l = 0; l < Lanes; l++)
+			{
+				out[0].f[l] = (a[1].f[l] * b[2].f[l]) - (b[1].f[l] * a[2].f[l]);
+				out[1].f[l] = (a[2].f[l] * b[0].f[l]) - (b[2].f[l] * a[0].f[l]);
+				out[2].f[l] = (a[0].f[l] * b[1].f[l]) - (b[0].f[l] * a[1].f[l]);
+			}
+
+			endWrite(w[2], out, 3, mask);
+			break;
+		}
+		case GLSLstd450Normalize:
+		{
+			auto a = reg(w[5]);
+			auto out = beginWrite(w[2], mask);
+			Register length;
+			dot(a, a, n, length);
+
+			for (uint32_t l = 0; l < Lanes; l++)
+				length.f[l] = 1.0f / std::sqrt(length.f[l]);
+
+			for (uint32_t c = 0; c < n; c++)
+				for (uint32_t l = 0; l < Lanes; l++)
+					out[c].f[l] = a[c].f[l] * length.f[l];
+
+			endWrite(w[2], out, n, mask);
+			break;
+		}
+		case GLSLstd450FaceForward:
+		{
+			auto normal = reg(w[5]);
+			auto incident = reg(w[6]);
+			auto reference = reg(w[7]);
+			auto out = beginWrite(w[2], mask);
+			Register d;
+			dot(reference, incident, n, d);
+
+			for (uint32_t c = 0; c < n; c++)
+				for (uint32_t l = 0; l < Lanes; l++)
+					out[c].f[l] = d.f[l] < 0.0f ? normal[c].f[l] : -normal[c].f[l];
+
+			endWrite(w[2], out, n, mask);
+			break;
+		}
+		case GLSLstd450Reflect:
+		{
+			auto incident = reg(w[5]);
+			auto normal = reg(w[6]);
+			auto out = beginWrite(w[2], mask);
+			Register d;
+			dot(normal, incident, n, d);
+
+			for (uint32_t c = 0; c < n; c++)
+				for (uint32_t l = 0; l < Lanes; l++)
+					out[c].f[l] = incident[c].f[l] - (2.0f * d.f[l] * normal[c].f[l]);
+
+			endWrite(w[2], out, n, mask);
+			break;
+		}
+		case GLSLstd450Refract:
+		{
+			auto incident = reg(w[5]);
+			auto normal = reg(w[6]);
+			auto eta = reg(w[7]);
+			auto out = beginWrite(w[2], mask);
+			Register d;
+			dot(normal, incident, n, d);
+
+			for (uint32_t l = 0; l < Lanes; l++)
+			{
+				auto e = eta->f[l];
+				auto k = 1.0f - (e * e * (1.0f - (d.f[l] * d.f[l])));
+
+				for (uint32_t c = 0; c < n; c++)
+				{
+					out[c].f[l] = k < 0.0f ? 0.0f :
+						(e * incident[c].f[l]) - (((e * d.f[l]) + std::sqrt(k)) * normal[c].f[l]);
+				}
+			}
+
+			endWrite(w[2], out, n, mask);
+			break;
+		}
+		case GLSLstd450Determinant:
+		{
+			auto size = typeOf(w[5]).count;
+			auto out = beginWrite(w[2], mask);
+
+			forEachMatrix(w[5], size, [&](uint32_t l, const glm::mat4& m) {
+				out[0].f[l] = size == 2 ? glm::determinant(glm::mat2(m)) :
+					size == 3 ? glm::determinant(glm::mat3(m)) : glm::determinant(m);
+			});
+
+			endWrite(w[2], out, 1, mask);
+			break;
+		}
+		case GLSLstd450MatrixInverse:
+		{
+			auto size = typeOf(w[5]).count;
+			auto out = beginWrite(w[2], mask);
+
+			forEachMatrix(w[5], size, [&](uint32_t l, const glm::mat4& m) {
+				auto inverse = size == 2 ? glm::mat4(glm::inverse(glm::mat2(m))) :
+					size == 3 ? glm::mat4(glm::inverse(glm::mat3(m))) : glm::inverse(m);
+
+				for (uint32_t column = 0; column < size; column++)
+					for (uint32_t row = 0; row < size; row++)
+						out[(column * size) + row].f[l] = inverse[column][row];
+			});
+
+			endWrite(w[2], out, n, mask);
+			break;
+		}
+		default:
+			throw std::runtime_error("GLSL.std.450 instruction " + std::to_string(w[4]) + " is not supported by interpreter");
+		}
+	}
+
+	// control flow
+
+	uint32_t moveLanes(const Function& function, const Block& from, uint32_t label, uint32_t lanes)
+	{
+		if (lanes == 0)
+			return NoBlock;
+
+		auto index = p.block_indices[label];
+		const auto& target = function.blocks[index];
+
+		if (target.begin != target.body)
+		{
+			// all incoming values are gathered first, a phi may use another phi of the same block
+			auto gathered = ctx.mScratch.data() + ctx.mScratch.size();
+			uint32_t offset = 0;
+
+			for (auto i = target.begin; i < target.body; i++)
+			{
+				const auto& instruction = p.instructions[i];
+				const auto* w = &p.words[instruction.offset];
+				auto n = p.types[w[1]].components;
+
+				for (uint32_t j = 3; j + 1 < instruction.count; j += 2)
+				{
+					if (w[j + 1] != from.label)
+						continue;
+
+					offset += n;
+					memcpy(gathered - offset, reg(w[j]), n * sizeof(Register));
+					break;
+				}
+			}
+
+			offset = 0;
+
+			for (auto i = target.begin; i < target.body; i++)
+			{
+				const auto* w = &p.words[p.instructions[i].offset];
+				auto n = p.types[w[1]].components;
+				offset += n;
+				copy(w[2], gathered - offset, n, lanes);
+			}
+		}
+
+		ctx.mPendingMasks[function.index][index] |= lanes;
+		return index;
+	}
+
+	void runFunction(const Function& function, uint32_t mask)
+	{
+		auto& pending = ctx.mPendingMasks[function.index];
+		std::fill(pending.begin(), pending.end(), 0);
+		pending[0] = mask;
+
+		// blocks are visited in layout order, back edges rewind to the loop header,
+		// lanes which left a loop wait in the merge block until the loop is done for all lanes
+
+		uint32_t i = 0;
+
+		while (i < function.blocks.size())
+		{
+			auto lanes = pending[i] & ctx.mAliveMask;
+			pending[i] = 0;
+
+			if (lanes == 0)
+			{
+				i += 1;
+				continue;
+			}
+
+			auto next = runBlock(function, function.blocks[i], lanes);
+			i = std::min(i + 1, next);
+		}
+	}
+
+	uint32_t runBlock(const Function& function, const Block& block, uint32_t mask)
+	{
+		for (auto index = block.body; index < block.end; index++)
+		{
+			const auto& instruction = p.instructions[index];
+			const auto* w = &p.words[instruction.offset];
+			auto count = instruction.count;
+
+			switch (instruction.op)
+			{
+			case spv::OpNop:
+			case spv::OpUndef:
+			case spv::OpLine:
+			case spv::OpNoLine:
+			case spv::OpLoopMerge:
+			case spv::OpSelectionMerge:
+			case spv::OpUnreachable:
+				break;
+
+			case spv::OpVariable:
+				if (count > 4)
+					store(w[2], reg(w[4]), mask);
+				break;
+
+			case spv::OpLoad:
+			{
+				auto out = beginWrite(w[2], mask);
+				load(w[3], out, mask);
+				endWrite(w[2], out, p.types[w[1]].components, mask);
+				break;
+			}
+
+			case spv::OpStore:
+				store(w[1], reg(w[2]), mask);
+				break;
+
+			case spv::OpCopyMemory:
+			{
+				auto value = ctx.mScratch.data();
+				load(w[2], value, mask);
+				store(w[1], value, mask);
+				break;
+			}
+
+			case spv::OpAccessChain:
+			case spv::OpInBoundsAccessChain:
+				accessChain(w, count, mask);
+				break;
+
+			case spv::OpFunctionCall:
+			{
+				const auto& callee = p.functions[p.function_indices[w[3]]];
+
+				for (uint32_t i = 0; i < callee.params.size(); i++)
+					copy(callee.params[i], reg(w[4 + i]), typeOf(callee.params[i]).components, mask);
+
+				runFunction(callee, mask);
+				mask &= ctx.mAliveMask;
+
+				if (mask == 0)
+					return NoBlock;
+
+				copy(w[2], reg(w[3]), p.types[w[1]].components, mask);
+				break;
+			}
+
+			case spv::OpExtInst:
+				extInst(w, count, mask);
+				break;
+
+			// composites
+
+			case spv::OpCopyObject:
+			case spv::OpCopyLogical:
+			case spv::OpSampledImage:
+			case spv::OpImage:
+			case spv::OpBitcast:
+			case spv::OpUConvert:
+			case spv::OpSConvert:
+			case spv::OpFConvert:
+				copy(w[2], reg(w[3]), p.types[w[1]].components, mask);
+				break;
+
+			case spv::OpCompositeConstruct:
+			{
+				auto out = beginWrite(w[2], mask);
+				uint32_t offset = 0;
+
+				for (uint32_t i = 3; i < count; i++)
+				{
+					auto n = typeOf(w[i]).components;
+					memcpy(out + offset, reg(w[i]), n * sizeof(Register));
+					offset += n;
+				}
+
+				endWrite(w[2], out, offset, mask);
+				break;
+			}
+
+			case spv::OpCompositeExtract:
+			{
+				uint32_t type;
+				auto offset = compositeOffset(p.id_types[w[3]], &w[4], count - 4, type);
+				copy(w[2], reg(w[3]) + offset, p.types[type].components, mask);
+				break;
+			}
+
+			case spv::OpCompositeInsert:
+			{
+				uint32_t type;
+				auto offset = compositeOffset(p.id_types[w[4]], &w[5], count - 5, type);
+				auto n = p.types[w[1]].components;
+				auto out = beginWrite(w[2], mask);
+				memcpy(out, reg(w[4]), n * sizeof(Register));
+				memcpy(out + offset, reg(w[3]), p.types[type].components * sizeof(Register));
+				endWrite(w[2], out, n, mask);
+				break;
+			}
+
+			case spv::OpVectorShuffle:
+			{
+				auto a = reg(w[3]);
+				auto b = reg(w[4]);
+				auto a_count = typeOf(w[3]).components;
+				auto out = beginWrite(w[2], mask);
+
+				for (uint32_t i = 5; i < count; i++)
+				{
+					auto component = w[i];
+
+					if (component == ~0u)
+						out[i - 5] = {};
+					else
+						out[i - 5] = component < a_count ? a[component] : b[component - a_count];
+				}
+
+				endWrite(w[2], out, count - 5, mask);
+				break;
+			}
+
+			case spv::OpVectorExtractDynamic:
+			{
+				auto v = reg(w[3]);
+				auto index = reg(w[4]);
+				auto n = typeOf(w[3]).components;
+				auto out = beginWrite(w[2], mask);
+
+				for (uint32_t l = 0; l < Lanes; l++)
+					out[0].u[l] = v[std::min(index->u[l], n - 1)].u[l];
+
+				endWrite(w[2], out, 1, mask);
+				break;
+			}
+
+			case spv::OpVectorInsertDynamic:
+			{
+				auto v = reg(w[3]);
+				auto value = reg(w[4]);
+				auto index = reg(w[5]);
+				auto n = p.types[w[1]].components;
+				auto out = beginWrite(w[2], mask);
+
+				for (uint32_t c = 0; c < n; c++)
+					for (uint32_t l = 0; l < Lanes; l++)
+						out[c].u[l] = index->u[l] == c ? value->u[l] : v[c].u[l];
+
+				endWrite(w[2], out, n, mask);
+				break;
+			}
+
+			case spv::OpTranspose:
+			{
+				const auto& type = p.types[w[1]];
+				const auto& source = typeOf(w[3]);
+				auto m = reg(w[3]);
+				auto out = beginWrite(w[2], mask);
+
+				for (uint32_t column = 0; column < type.count; column++)
+					for (uint32_t row = 0; row < type.rows; row++)
+						out[(column * type.rows) + row] = m[(row * source.rows) + column];
+
+				endWrite(w[2], out, type.components, mask);
+				break;
+			}
+
+			// images
+
+			case spv::OpImageSampleImplicitLod:
+			case spv::OpImageSampleExplicitLod:
+				sample(w, count, mask, false);
+				break;
+
+			case spv::OpImageSampleProjImplicitLod:
+			case spv::OpImageSampleProjExplicitLod:
+				sample(w, count, mask, true);
+				break;
+
+			case spv::OpImageFetch:
+				fetch(w, count, mask);
+				break;
+
+			case spv::OpImageQuerySizeLod:
+			case spv::OpImageQuerySize:
+				querySize(w, count, mask);
+				break;
+
+			// conversions
+
+			case spv::OpConvertFToU: unary<float, uint32_t>(w, &w[3], mask, [](float x) { return x <= 0.0f ? 0u : (x >= 4294967040.0f ? ~0u : (uint32_t)x); }); break;
+			case spv::OpConvertFToS: unary<float, int32_t>(w, &w[3], mask, [](float x) { return (int32_t)std::clamp(x, -2147483648.0f, 2147483520.0f); }); break;
+			case spv::OpConvertSToF: unary<int32_t, float>(w, &w[3], mask, [](int32_t x) { return (float)x; }); break;
+			case spv::OpConvertUToF: unary<uint32_t, float>(w, &w[3], mask, [](uint32_t x) { return (float)x; }); break;
+
+			// arithmetic
+
+			case spv::OpSNegate: unary<uint32_t>(w, &w[3], mask, [](uint32_t x) { return 0u - x; }); break;
+			case spv::OpFNegate: unary<float>(w, &w[3], mask, [](float x) { return -x; }); break;
+			case spv::OpIAdd: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return a + b; }); break;
+			case spv::OpFAdd: binary<float>(w, &w[3], mask, [](float a, float b) { return a + b; }); break;
+			case spv::OpISub: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return a - b; }); break;
+			case spv::OpFSub: binary<float>(w, &w[3], mask, [](float a, float b) { return a - b; }); break;
+			case spv::OpIMul: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return a * b; }); break;
+			case spv::OpFMul: binary<float>(w, &w[3], mask, [](float a, float b) { return a * b; }); break;
+			case spv::OpFDiv: binary<float>(w, &w[3], mask, [](float a, float b) { return a / b; }); break;
+			case spv::OpUDiv: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return b == 0 ? 0 : a / b; }); break;
+			case spv::OpUMod: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return b == 0 ? 0 : a % b; }); break;
+			case spv::OpSDiv: binary<int32_t>(w, &w[3], mask, [](int32_t a, int32_t b) { return (b == 0 || (b == -1 && a == INT32_MIN)) ? 0 : a / b; }); break;
+			case spv::OpSRem: binary<int32_t>(w, &w[3], mask, [](int32_t a, int32_t b) { return (b == 0 || b == -1) ? 0 : a % b; }); break;
+			case spv::OpSMod: binary<int32_t>(w, &w[3], mask, [](int32_t a, int32_t b) {
+				if (b == 0 || b == -1)
+					return 0;
+
+				auto r = a % b;
+				return (r != 0 && ((r < 0) != (b < 0))) ? r + b : r;
+			}); break;
+			case spv::OpFRem: binary<float>(w, &w[3], mask, [](float a, float b) { return std::fmod(a, b); }); break;
+			case spv::OpFMod: binary<float>(w, &w[3], mask, [](float a, float b) { return a - (b * std::floor(a / b)); }); break;
+
+			case spv::OpVectorTimesScalar:
+			case spv::OpMatrixTimesScalar:
+				binary<float>(w, &w[3], mask, [](float a, float b) { return a * b; });
+				break;
+
+			case spv::OpDot:
+			{
+				auto out = beginWrite(w[2], mask);
+				dot(reg(w[3]), reg(w[4]), typeOf(w[3]).components, out[0]);
+				endWrite(w[2], out, 1, mask);
+				break;
+			}
+
+			case spv::OpMatrixTimesVector:
+			{
+				const auto& m_type = typeOf(w[3]);
+				auto m = reg(w[3]);
+				auto v = reg(w[4]);
+				auto out = beginWrite(w[2], mask);
+
+				for (uint32_t row = 0; row < m_type.rows; row++)
+				{
+					out[row] = {};
+
+					for (uint32_t column = 0; column < m_type.count; column++)
+						for (uint32_t l = 0; l < Lanes; l++)
+							out[row].f[l] += m[(column * m_type.rows) + row].f[l] * v[column].f[l];
+				}
+
+				endWrite(w[2], out, m_type.rows, mask);
+				break;
+			}
+
+			case spv::OpVectorTimesMatrix:
+			{
+				const auto& m_type = typeOf(w[4]);
+				auto v = reg(w[3]);
+				auto m = reg(w[4]);
+				auto out = beginWrite(w[2], mask);
+
+				for (uint32_t column = 0; column < m_type.count; column++)
+					dot(v, m + (column * m_type.rows), m_type.rows, out[column]);
+
+				endWrite(w[2], out, m_type.count, mask);
+				break;
+			}
+
+			case spv::OpMatrixTimesMatrix:
+			{
+				const auto& a_type = typeOf(w[3]);
+				const auto& b_type = typeOf(w[4]);
+				auto a = reg(w[3]);
+				auto b = reg(w[4]);
+				auto rows = a_type.rows;
+				auto out = beginWrite(w[2], mask);
+
+				for (uint32_t column = 0; column < b_type.count; column++)
+				{
+					for (uint32_t row = 0; row < rows; row++)
+					{
+						auto& dst = out[(column * rows) + row];
+						dst = {};
+
+						for (uint32_t k = 0; k < a_type.count; k++)
+							for (uint32_t l = 0; l < Lanes; l++)
+								dst.f[l] += a[(k * rows) + row].f[l] * b[(column * b_type.rows) + k].f[l];
+					}
+				}
+
+				endWrite(w[2], out, rows * b_type.count, mask);
+				break;
+			}
+
+			case spv::OpOuterProduct:
+			{
+				auto a = reg(w[3]);
+				auto b = reg(w[4]);
+				auto rows = typeOf(w[3]).components;
+				auto columns = typeOf(w[4]).components;
+				auto out = beginWrite(w[2], mask);
+
+				for (uint32_t column = 0; column < columns; column++)
+					for (uint32_t row = 0; row < rows; row++)
+						for (uint32_t l = 0; l < Lanes; l++)
+							out[(column * rows) + row].f[l] = a[row].f[l] * b[column].f[l];
+
+				endWrite(w[2], out, rows * columns, mask);
+				break;
+			}
+
+			// bits
+
+			case spv::OpShiftRightLogical: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return a >> (b & 31); }); break;
+			case spv::OpShiftRightArithmetic: binary<int32_t>(w, &w[3], mask, [](int32_t a, int32_t b) { return a >> (b & 31); }); break;
+			case spv::OpShiftLeftLogical: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return a << (b & 31); }); break;
+			case spv::OpBitwiseOr: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return a | b; }); break;
+			case spv::OpBitwiseXor: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return a ^ b; }); break;
+			case spv::OpBitwiseAnd: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return a & b; }); break;
+			case spv::OpNot: unary<uint32_t>(w, &w[3], mask, [](uint32_t a) { return ~a; }); break;
+			case spv::OpBitCount: unary<uint32_t>(w, &w[3], mask, [](uint32_t a) { return (uint32_t)std::popcount(a); }); break;
+
+			// relational and logical, booleans are stored as all bits set or zero
+
+			case spv::OpAny:
+			case spv::OpAll:
+			{
+				auto a = reg(w[3]);
+				auto n = typeOf(w[3]).components;
+				auto out = beginWrite(w[2], mask);
+				auto any = instruction.op == spv::OpAny;
+				out[0] = a[0];
+
+				for (uint32_t c = 1; c < n; c++)
+					for (uint32_t l = 0; l < Lanes; l++)
+						out[0].u[l] = any ? (out[0].u[l] | a[c].u[l]) : (out[0].u[l] & a[c].u[l]);
+
+				endWrite(w[2], out, 1, mask);
+				break;
+			}
+
+			case spv::OpIsNan: unary<float, uint32_t>(w, &w[3], mask, [](float x) { return std::isnan(x) ? ~0u : 0u; }); break;
+			case spv::OpIsInf: unary<float, uint32_t>(w, &w[3], mask, [](float x) { return std::isinf(x) ? ~0u : 0u; }); break;
+			case spv::OpLogicalEqual: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return (a != 0) == (b != 0) ? ~0u : 0u; }); break;
+			case spv::OpLogicalNotEqual: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return (a != 0) != (b != 0) ? ~0u : 0u; }); break;
+			case spv::OpLogicalOr: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return a | b; }); break;
+			case spv::OpLogicalAnd: binary<uint32_t>(w, &w[3], mask, [](uint32_t a, uint32_t b) { return a & b; }); break;
+			case spv::OpLogicalNot: unary<uint32_t>(w, &w[3], mask, [](uint32_t a) { return ~a; }); break;
+
+			case spv::OpSelect:
+			{
+				auto n = p.types[w[1]].components;
+				auto condition = reg(w[3]);
+				auto a = reg(w[4]);
+				auto b = reg(w[5]);
+				auto condition_step = typeOf(w[3]).components > 1 ? 1 : 0;
+				auto out = beginWrite(w[2], mask);
+
+				for (uint32_t c = 0; c < n; c++)
+				{
+					const auto& m = condition[c * condition_step];
+
+					for (uint32_t l = 0; l < Lanes; l++)
+						out[c].u[l] = (a[c].u[l] & m.u[l]) | (b[c].u[l] & ~m.u[l]);
+				}
+
+				endWrite(w[2], out, n, mask);
+				break;
+			}
+
+			case spv::OpIEqual: compare<uint32_t>(w, mask, [](uint32_t a, uint32_t b) { return a == b; }); break;
+			case spv::OpINotEqual: compare<uint32_t>(w, mask, [](uint32_t a, uint32_t b) { return a != b; }); break;
+			case spv::OpUGreaterThan: compare<uint32_t>(w, mask, [](uint32_t a, uint32_t b) { return a > b; }); break;
+			case spv::OpSGreaterThan: compare<int32_t>(w, mask, [](int32_t a, int32_t b) { return a > b; }); break;
+			case spv::OpUGreaterThanEqual: compare<uint32_t>(w, mask, [](uint32_t a, uint32_t b) { return a >= b; }); break;
+			case spv::OpSGreaterThanEqual: compare<int32_t>(w, mask, [](int32_t a, int32_t b) { return a >= b; }); break;
+			case spv::OpULessThan: compare<uint32_t>(w, mask, [](uint32_t a, uint32_t b) { return a < b; }); break;
+			case spv::OpSLessThan: compare<int32_t>(w, mask, [](int32_t a, int32_t b) { return a < b; }); break;
+			case spv::OpULessThanEqual: compare<uint32_t>(w, mask, [](uint32_t a, uint32_t b) { return a <= b; }); break;
+			case spv::OpSLessThanEqual: compare<int32_t>(w, mask, [](int32_t a, int32_t b) { return a <= b; }); break;
+			case spv::OpFOrdEqual: compare<float>(w, mask, [](float a, float b) { return a == b; }); break;
+			case spv::OpFUnordEqual: compare<float>(w, mask, [](float a, float b) { return !(a < b || a > b); }); break;
+			case spv::OpFOrdNotEqual: compare<float>(w, mask, [](float a, float b) { return a < b || a > b; }); break;
+			case spv::OpFUnordNotEqual: compare<float>(w, mask, [](float a, float b) { return a != b; }); break;
+			case spv::OpFOrdLessThan: compare<float>(w, mask, [](float a, float b) { return a < b; }); break;
+			case spv::OpFUnordLessThan: compare<float>(w, mask, [](float a, float b) { return !(a >= b); }); break;
+			case spv::OpFOrdGreaterThan: compare<float>(w, mask, [](float a, float b) { return a > b; }); break;
+			case spv::OpFUnordGreaterThan: compare<float>(w, mask, [](float a, float b) { return !(a <= b); }); break;
+			case spv::OpFOrdLessThanEqual: compare<float>(w, mask, [](float a, float b) { return a <= b; }); break;
+			case spv::OpFUnordLessThanEqual: compare<float>(w, mask, [](float a, float b) { return !(a > b); }); break;
+			case spv::OpFOrdGreaterThanEqual: compare<float>(w, mask, [](float a, float b) { return a >= b; }); break;
+			case spv::OpFUnordGreaterThanEqual: compare<float>(w, mask, [](float a, float b) { return !(a < b); }); break;
+
+			// derivatives
+
+			case spv::OpDPdx:
+			case spv::OpDPdxFine: derivative(w, mask, true, true); break;
+			case spv::OpDPdxCoarse: derivative(w, mask, true, false); break;
+			case spv::OpDPdy:
+			case spv::OpDPdyFine: derivative(w, mask, false, true); break;
+			case spv::OpDPdyCoarse: derivative(w, mask, false, false); break;
+			case spv::OpFwidth:
+			case spv::OpFwidthFine: fwidth(w, mask, true); break;
+			case spv::OpFwidthCoarse: fwidth(w, mask, false); break;
+
+			// terminators
+
+			case spv::OpBranch:
+				return moveLanes(function, block, w[1], mask);
+
+			case spv::OpBranchConditional:
+			{
+				auto condition = MaskOf(*reg(w[1]));
+				auto a = moveLanes(function, block, w[2], mask & condition);
+				auto b = moveLanes(function, block, w[3], mask & ~condition);
+				return std::min(a, b);
+			}
+
+			case spv::OpSwitch:
+			{
+				const auto& selector = *reg(w[1]);
+				auto remaining = mask;
+				auto next = NoBlock;
+
+				for (uint32_t i = 3; i + 1 < count; i += 2)
+				{
+					uint32_t lanes = 0;
+
+					for (uint32_t l = 0; l < Lanes; l++)
+						lanes |= (selector.u[l] == w[i] ? 1u : 0u) << l;
+
+					lanes &= remaining;
+					remaining &= ~lanes;
+					next = std::min(next, moveLanes(function, block, w[i + 1], lanes));
+				}
+
+				return std::min(next, moveLanes(function, block, w[2], remaining));
+			}
+
+			case spv::OpReturnValue:
+				copy(function.id, reg(w[1]), typeOf(w[1]).components, mask);
+				return NoBlock;
+
+			case spv::OpReturn:
+				return NoBlock;
+
+			case spv::OpKill:
+			case spv::OpTerminateInvocation:
+				ctx.mAliveMask &= ~mask;
+				return NoBlock;
+
+			case spv::OpDemoteToHelperInvocation:
+				// helper invocations are not tracked, demoted lanes are terminated
+				ctx.mAliveMask &= ~mask;
+				return NoBlock;
+
+			default:
+				throw std::runtime_error("spirv instruction " + std::to_string(instruction.op) + " is not supported by interpreter");
+			}
+		}
+
+		return NoBlock;
+	}
+};
+
+ShaderInterpreter::Context::Context(const ShaderInterpreter& shader) : mProgram(*shader.mProgram)
+{
+	mRegisters.resize(mProgram.register_count);
+	mScratch.resize(mProgram.scratch_size);
+
+	for (const auto& [reg, value] : mProgram.initial_values)
+	{
+		for (uint32_t l = 0; l < Lanes; l++)
+			mRegisters.at(reg).u[l] = value;
+	}
+
+	for (const auto& function : mProgram.functions)
+	{
+		mPendingMasks.push_back(std::vector<uint32_t>(function.blocks.size(), 0));
+	}
+}
+
+ShaderInterpreter::Context::~Context()
+{
+}
+
+void ShaderInterpreter::Context::setUniformBuffer(uint32_t binding, const void* memory, size_t size)
+{
+	if (binding >= mUniformBuffers.size())
+		mUniformBuffers.resize(binding + 1);
+
+	mUniformBuffers[binding] = { (const uint8_t*)memory, size };
+}
+
+uint32_t ShaderInterpreter::Context::execute(uint32_t mask)
+{
+	mAliveMask = mask;
+
+	ShaderExecutor executor{ *this, mProgram, mRegisters.data() };
+	executor.runFunction(mProgram.functions.at(mProgram.function_indices.at(mProgram.entry_point)), mask);
+
+	return mAliveMask;
+}
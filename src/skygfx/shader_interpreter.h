@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "shader_compiler.h"
+
+namespace skygfx
+{
+	struct ShaderExecutor;
+
+	// executes a spirv vertex or fragment stage on the cpu, Lanes invocations at a time.
+	// every value is stored as Lanes wide registers, one register per scalar component.
+	// fragment lanes are expected to be arranged as 2x2 quads for derivatives:
+	// lane 0 - (0, 0), lane 1 - (1, 0), lane 2 - (0, 1), lane 3 - (1, 1), next quad starts at lane 4.
+
+	class ShaderInterpreter
+	{
+	public:
+		static constexpr uint32_t Lanes = 8;
+		static constexpr uint32_t AllLanes = (1 << Lanes) - 1;
+
+		union alignas(32) Register
+		{
+			float f[Lanes];
+			int32_t i[Lanes];
+			uint32_t u[Lanes];
+		};
+
+		enum class BuiltIn
+		{
+			Position,
+			PointSize,
+			VertexIndex,
+			InstanceIndex,
+			FragCoord,
+			FrontFacing,
+			FragDepth
+		};
+
+		struct Varying
+		{
+			uint32_t location;
+			uint32_t components;
+			bool flat;
+			bool no_perspective;
+			uint32_t reg; // index of the first component register
+		};
+
+		class TextureProvider
+		{
+		public:
+			virtual ~TextureProvider() {}
+
+			virtual void getSize(uint32_t binding, uint32_t lod, uint32_t& width, uint32_t& height) = 0;
+			virtual void sample(uint32_t binding, const Register& u, const Register& v, const Register& lod,
+				uint32_t mask, Register result[4]) = 0;
+			virtual void fetch(uint32_t binding, const Register& x, const Register& y, const Register& lod,
+				uint32_t mask, Register result[4]) = 0;
+		};
+
+		class Context;
+		struct Program;
+
+	public:
+		ShaderInterpreter(const std::vector<uint32_t>& spirv);
+		~ShaderInterpreter();
+
+		ShaderStage getStage() const;
+		const std::vector<Varying>& getInputs() const;
+		const std::vector<Varying>& getOutputs() const;
+		std::optional<uint32_t> getBuiltIn(BuiltIn value) const;
+
+		bool hasKill() const;
+		bool writesDepth() const;
+
+	private:
+		std::unique_ptr<Program> mProgram;
+
+		friend struct ShaderExecutor;
+	};
+
+	// per thread execution state of ShaderInterpreter, keeps registers between runs
+
+	class ShaderInterpreter::Context
+	{
+	public:
+		Context(const ShaderInterpreter& shader);
+		~Context();
+
+		Register* getRegisters() { return mRegisters.data(); }
+
+		void setUniformBuffer(uint32_t binding, const void* memory, size_t size);
+		void setTextureProvider(TextureProvider* value) { mTextureProvider = value; }
+
+		// runs the entry point for lanes in mask, returns lanes which were not discarded
+		uint32_t execute(uint32_t mask = AllLanes);
+
+	private:
+		struct UniformBuffer
+		{
+			const uint8_t* memory = nullptr;
+			size_t size = 0;
+		};
+
+		const Program& mProgram;
+		std::vector<Register> mRegisters;
+		std::vector<UniformBuffer> mUniformBuffers;
+		std::vector<std::vector<uint32_t>> mPendingMasks;
+		std::vector<Register> mScratch;
+		TextureProvider* mTextureProvider = nullptr;
+		uint32_t mAliveMask = 0;
+
+		friend struct ShaderExecutor;
+	};
+}
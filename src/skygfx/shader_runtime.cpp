@@ -0,0 +1,125 @@
+#include "shader_runtime.h"
+#include "shader_cache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace skygfx;
+
+ShaderRuntime::ShaderRuntime(const std::vector<uint32_t>& spirv) :
+	mReflection(MakeSpirvReflection(spirv)),
+	mInterpreter(spirv),
+	mContext(mInterpreter)
+{
+}
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+ShaderRuntime::ShaderRuntime(ShaderStage stage, const std::string& code, const std::vector<std::string>& defines) :
+	ShaderRuntime(CompileShader(stage, ShaderTarget::Spirv, code, defines))
+{
+}
+#endif
+
+ShaderRuntime::ShaderRuntime(const CompiledShader& shader) :
+	mReflection(shader.reflection),
+	mInterpreter(shader.spirv),
+	mContext(mInterpreter)
+{
+}
+
+void ShaderRuntime::setUniformBuffer(uint32_t binding, const void* memory, size_t size)
+{
+	auto descriptor_set = mReflection.findDescriptorSet((int)binding, ShaderReflection::DescriptorSet::Type::UniformBuffer);
+
+	if (descriptor_set == nullptr)
+		throw std::runtime_error("uniform buffer binding " + std::to_string(binding) + " is not used by the shader");
+
+	if (size < descriptor_set->size)
+		throw std::runtime_error("uniform buffer binding " + std::to_string(binding) + " has " + std::to_string(size) +
+			" bytes, the shader reads " + std::to_string(descriptor_set->size));
+
+	auto& buffer = mUniformBuffers[binding];
+	buffer.assign((const uint8_t*)memory, (const uint8_t*)memory + size);
+	mContext.setUniformBuffer(binding, buffer.data(), buffer.size());
+}
+
+void ShaderRuntime::setTextureProvider(ShaderInterpreter::TextureProvider* value)
+{
+	mContext.setTextureProvider(value);
+}
+
+void ShaderRuntime::run(const Batch& batch)
+{
+	constexpr auto Lanes = ShaderInterpreter::Lanes;
+
+	auto registers = mContext.getRegisters();
+	auto position = mInterpreter.getBuiltIn(ShaderInterpreter::BuiltIn::Position);
+	auto vertex_index = mInterpreter.getBuiltIn(ShaderInterpreter::BuiltIn::VertexIndex);
+	auto frag_coord = mInterpreter.getBuiltIn(ShaderInterpreter::BuiltIn::FragCoord);
+
+	for (uint32_t base = 0; base < batch.count; base += Lanes)
+	{
+		auto lanes = std::min(batch.count - base, Lanes);
+		auto mask = (1u << lanes) - 1;
+
+		for (const auto& input : mInterpreter.getInputs())
+		{
+			auto it = batch.inputs.find(input.location);
+
+			if (it == batch.inputs.end())
+				continue;
+
+			for (uint32_t c = 0; c < input.components; c++)
+			{
+				const auto* src = it->second + (c * batch.count) + base;
+				std::copy(src, src + lanes, registers[input.reg + c].f);
+			}
+		}
+
+		if (vertex_index.has_value())
+		{
+			for (uint32_t l = 0; l < lanes; l++)
+				registers[vertex_index.value()].u[l] = base + l;
+		}
+
+		if (frag_coord.has_value() && batch.frag_coord != nullptr)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				const auto* src = batch.frag_coord + (c * batch.count) + base;
+				std::copy(src, src + lanes, registers[frag_coord.value() + c].f);
+			}
+		}
+
+		auto alive = mContext.execute(mask);
+
+		for (const auto& output : mInterpreter.getOutputs())
+		{
+			auto it = batch.outputs.find(output.location);
+
+			if (it == batch.outputs.end())
+				continue;
+
+			for (uint32_t c = 0; c < output.components; c++)
+			{
+				auto* dst = it->second + (c * batch.count) + base;
+				std::copy(registers[output.reg + c].f, registers[output.reg + c].f + lanes, dst);
+			}
+		}
+
+		if (position.has_value() && batch.position != nullptr)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				auto* dst = batch.position + (c * batch.count) + base;
+				std::copy(registers[position.value() + c].f, registers[position.value() + c].f + lanes, dst);
+			}
+		}
+
+		if (batch.alive != nullptr)
+		{
+			for (uint32_t l = 0; l < lanes; l++)
+				batch.alive[base + l] = (alive >> l) & 1;
+		}
+	}
+}
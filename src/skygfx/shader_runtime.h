@@ -0,0 +1,55 @@
+#pragma once
+
+#include <unordered_map>
+#include "shader_compiler.h"
+#include "shader_interpreter.h"
+
+namespace skygfx
+{
+	struct CompiledShader;
+
+	// runs a vertex or fragment stage on the cpu over batches of invocations stored as structure of arrays.
+	// every location is an array of components * count floats, component c of invocation i is at [c * count + i].
+	// fragment invocations are grouped by 4 into 2x2 quads for derivatives: (0, 0), (1, 0), (0, 1), (1, 1).
+
+	class ShaderRuntime
+	{
+	public:
+		struct Batch
+		{
+			uint32_t count = 0;
+			std::unordered_map<uint32_t, const float*> inputs; // by location
+			std::unordered_map<uint32_t, float*> outputs; // by location
+			float* position = nullptr; // vertex stage, 4 * count floats
+			const float* frag_coord = nullptr; // fragment stage, 4 * count floats
+			uint8_t* alive = nullptr; // fragment stage, count values, 0 for discarded invocations
+		};
+
+	public:
+		ShaderRuntime(const std::vector<uint32_t>& spirv);
+#ifdef SKYGFX_RUNTIME_COMPILER
+		ShaderRuntime(ShaderStage stage, const std::string& code, const std::vector<std::string>& defines = {});
+#endif
+
+		const auto& getReflection() const { return mReflection; }
+		auto getStage() const { return mReflection.stage; }
+
+		void setUniformBuffer(uint32_t binding, const void* memory, size_t size);
+
+		template <class T>
+		void setUniformBuffer(uint32_t binding, const T& buffer) { setUniformBuffer(binding, &buffer, sizeof(T)); }
+
+		void setTextureProvider(ShaderInterpreter::TextureProvider* value);
+
+		void run(const Batch& batch);
+
+	private:
+		ShaderRuntime(const CompiledShader& shader); // reflection of the cache keeps names stripped from spirv
+
+	private:
+		ShaderReflection mReflection;
+		ShaderInterpreter mInterpreter;
+		ShaderInterpreter::Context mContext;
+		std::unordered_map<uint32_t, std::vector<uint8_t>> mUniformBuffers;
+	};
+}
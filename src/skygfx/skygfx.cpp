@@ -4,13 +4,85 @@
 #include "backend_gl44.h"
 #include "backend_vk.h"
 #include "backend_mtl.h"
+#include "backend_null.h"
+#include "backend_sw.h"
+#include "backend_capture.h"
+#include "shader_bundle.h"
+#include "trace.h"
 
 #include <stdexcept>
 #include <cassert>
+#include <chrono>
 
 using namespace skygfx;
 
 static Backend* gBackend = nullptr;
+static BackendType gBackendType;
+
+static FrameStats gFrameStats;
+static FrameStats gLastFrameStats;
+static Topology gTopology = Topology::TriangleList;
+static bool gFrameStatsTimingEnabled = false;
+
+Backend* skygfx::GetCurrentBackend()
+{
+	return gBackend;
+}
+
+BackendType skygfx::GetCurrentBackendType()
+{
+	return gBackendType;
+}
+
+FrameStats& skygfx::GetCurrentFrameStats()
+{
+	return gFrameStats;
+}
+
+void skygfx::SetFrameStatsTimingEnabled(bool value)
+{
+	gFrameStatsTimingEnabled = value;
+}
+
+bool skygfx::IsFrameStatsTimingEnabled()
+{
+	return gFrameStatsTimingEnabled;
+}
+
+class BackendTimer
+{
+public:
+	BackendTimer()
+	{
+		if (gFrameStatsTimingEnabled)
+			mStart = std::chrono::steady_clock::now();
+	}
+
+	~BackendTimer()
+	{
+		if (!mStart.has_value())
+			return;
+
+		auto duration = std::chrono::steady_clock::now() - mStart.value();
+		gFrameStats.backend_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+	}
+
+private:
+	std::optional<std::chrono::steady_clock::time_point> mStart;
+};
+
+static uint64_t GetPrimitiveCount(Topology topology, uint32_t count)
+{
+	switch (topology)
+	{
+	case Topology::PointList: return count;
+	case Topology::LineList: return count / 2;
+	case Topology::LineStrip: return count > 1 ? count - 1 : 0;
+	case Topology::TriangleList: return count / 3;
+	case Topology::TriangleStrip: return count > 2 ? count - 2 : 0;
+	}
+	return 0;
+}
 
 // texture
 
@@ -18,42 +90,164 @@ Texture::Texture(uint32_t width, uint32_t height, uint32_t channels, void* memor
 	mWidth(width),
 	mHeight(height)
 {
+	BackendTimer timer;
+	gFrameStats.textures_created += 1;
 	mTextureHandle = gBackend->createTexture(width, height, channels, memory, mipmap);
 }
 
 Texture::~Texture()
 {
+	BackendTimer timer;
 	gBackend->destroyTexture(mTextureHandle);
 }
 
 RenderTarget::RenderTarget(uint32_t width, uint32_t height) : Texture(width, height, 4, nullptr)
 {
+	BackendTimer timer;
+	gFrameStats.render_targets_created += 1;
 	mRenderTargetHandle = gBackend->createRenderTarget(width, height, *this);
 }
 
 RenderTarget::~RenderTarget()
 {
+	BackendTimer timer;
 	gBackend->destroyRenderTarget(mRenderTargetHandle);
 }
 
+// buffers
+
+VertexBuffer::VertexBuffer(const Buffer& buffer) :
+	mSize(buffer.size),
+	mStride(buffer.stride)
+{
+	BackendTimer timer;
+	gFrameStats.buffers_created += 1;
+	mVertexBufferHandle = gBackend->createVertexBuffer(buffer.data, buffer.size, buffer.stride);
+}
+
+VertexBuffer::~VertexBuffer()
+{
+	BackendTimer timer;
+	gBackend->destroyVertexBuffer(mVertexBufferHandle);
+}
+
+IndexBuffer::IndexBuffer(const Buffer& buffer) :
+	mSize(buffer.size),
+	mStride(buffer.stride)
+{
+	assert(buffer.stride == 2 || buffer.stride == 4);
+
+	BackendTimer timer;
+	gFrameStats.buffers_created += 1;
+	mIndexBufferHandle = gBackend->createIndexBuffer(buffer.data, buffer.size, buffer.stride);
+}
+
+IndexBuffer::~IndexBuffer()
+{
+	BackendTimer timer;
+	gBackend->destroyIndexBuffer(mIndexBufferHandle);
+}
+
 // shader
 
-Shader::Shader(const Vertex::Layout& layout, const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& defines)
+#ifdef SKYGFX_RUNTIME_COMPILER
+Shader::Shader(const Vertex::Layout& layout, const std::string& vertex_code, const std::string& fragment_code, const std::vector<std::string>& defines,
+	const SpecializationConstants& specialization_constants)
+{
+	BackendTimer timer;
+	gFrameStats.shaders_created += 1;
+	mShaderHandle = gBackend->createShader(layout, vertex_code, fragment_code, defines, specialization_constants);
+}
+#endif
+
+Shader::Shader(const Vertex::Layout& layout, const ShaderBundle& bundle, const std::string& name,
+	const SpecializationConstants& specialization_constants)
 {
-	mShaderHandle = gBackend->createShader(layout, vertex_code, fragment_code, defines);
+	auto entry = bundle.find(name, gBackendType);
+
+	if (entry == nullptr)
+		throw std::runtime_error("shader bundle has no " + name + " for this backend");
+
+	bool layout_matches = entry->attributes.size() == layout.attributes.size();
+
+	for (size_t i = 0; layout_matches && i < layout.attributes.size(); i++)
+	{
+		layout_matches = entry->attributes.at(i) == layout.attributes.at(i).type;
+	}
+
+	if (!layout_matches)
+		throw std::runtime_error("vertex layout does not match " + name + " of the shader bundle");
+
+	BackendTimer timer;
+	gFrameStats.shaders_created += 1;
+	mShaderHandle = gBackend->createShader(layout, entry->vertex, entry->fragment, specialization_constants);
 }
 
 Shader::~Shader()
 {
+	BackendTimer timer;
 	gBackend->destroyShader(mShaderHandle);
 }
 
+// async shader
+
+#ifdef SKYGFX_RUNTIME_COMPILER
+
+AsyncShader::AsyncShader(const Vertex::Layout& layout, const std::string& vertex_code,
+	const std::string& fragment_code, const std::vector<std::string>& defines,
+	const SpecializationConstants& specialization_constants) :
+	mLayout(layout),
+	mVertexCode(vertex_code),
+	mFragmentCode(fragment_code),
+	mDefines(defines),
+	mSpecializationConstants(specialization_constants)
+{
+	mStages = gBackend->compileShaderAsync(layout, vertex_code, fragment_code, defines);
+}
+
+bool AsyncShader::isReady() const
+{
+	if (mShader)
+		return true;
+
+	for (const auto& stage : mStages)
+	{
+		if (stage.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
+	}
+
+	return true;
+}
+
+Shader& AsyncShader::getShader()
+{
+	if (mShader)
+		return *mShader;
+
+	for (const auto& stage : mStages)
+	{
+		stage.get();
+	}
+
+	mShader = std::make_unique<Shader>(mLayout, mVertexCode, mFragmentCode, mDefines, mSpecializationConstants);
+	mStages.clear();
+
+	return *mShader;
+}
+
+#endif
+
 // device
 
 Device::Device(BackendType type, void* window, uint32_t width, uint32_t height)
 {
 	assert(gBackend == nullptr);
 
+	gFrameStats = FrameStats();
+	gLastFrameStats = FrameStats();
+	gTopology = Topology::TriangleList;
+	gBackendType = type;
+
 #ifdef SKYGFX_HAS_D3D11
 	if (type == BackendType::D3D11)
 		gBackend = new BackendD3D11(window, width, height);
@@ -70,9 +264,17 @@ Device::Device(BackendType type, void* window, uint32_t width, uint32_t height)
 	if (type == BackendType::Metal)
 		gBackend = new BackendMetal(window, width, height);
 #endif
+	if (type == BackendType::Null)
+		gBackend = new BackendNull(window, width, height);
+
+	if (type == BackendType::Software)
+		gBackend = new BackendSoftware(window, width, height);
 
 	if (gBackend == nullptr)
 		throw std::runtime_error("backend not implemented");
+
+	if (IsCaptureEnabled())
+		gBackend = new BackendCapture(gBackend, width, height);
 }
 
 Device::~Device()
@@ -83,111 +285,200 @@ Device::~Device()
 
 void Device::resize(uint32_t width, uint32_t height)
 {
+	BackendTimer timer;
 	gBackend->resize(width, height);
 }
 
 void Device::setTopology(Topology topology)
 {
+	BackendTimer timer;
+	gFrameStats.topology_changes += 1;
+	gTopology = topology;
 	gBackend->setTopology(topology);
 }
 
 void Device::setViewport(std::optional<Viewport> viewport)
 {
+	BackendTimer timer;
+	gFrameStats.viewport_changes += 1;
 	gBackend->setViewport(viewport);
 }
 
 void Device::setScissor(std::optional<Scissor> scissor)
 {
+	BackendTimer timer;
+	gFrameStats.scissor_changes += 1;
 	gBackend->setScissor(scissor);
 }
 
 void Device::setTexture(const Texture& texture, uint32_t slot)
 {
+	BackendTimer timer;
+	gFrameStats.texture_changes += 1;
 	gBackend->setTexture(const_cast<Texture&>(texture), slot);
 }
 
 void Device::setRenderTarget(const RenderTarget& value)
 {
+	BackendTimer timer;
+	gFrameStats.render_target_changes += 1;
 	gBackend->setRenderTarget(const_cast<RenderTarget&>(value));
 }
 
 void Device::setRenderTarget(std::nullptr_t value)
 {
+	BackendTimer timer;
+	gFrameStats.render_target_changes += 1;
 	gBackend->setRenderTarget(value);
 }
 
 void Device::setShader(const Shader& shader)
 {
+	BackendTimer timer;
+	gFrameStats.shader_changes += 1;
 	gBackend->setShader(const_cast<Shader&>(shader));
 }
 
 void Device::setVertexBuffer(const Buffer& buffer)
 {
+	BackendTimer timer;
+	gFrameStats.vertex_buffer_changes += 1;
+	gFrameStats.vertex_buffer_bytes += buffer.size;
 	gBackend->setVertexBuffer(buffer);
 }
 
 void Device::setIndexBuffer(const Buffer& buffer)
 {
+	BackendTimer timer;
+	gFrameStats.index_buffer_changes += 1;
+	gFrameStats.index_buffer_bytes += buffer.size;
 	gBackend->setIndexBuffer(buffer);
 }
 
+void Device::setVertexBuffer(const VertexBuffer& buffer)
+{
+	BackendTimer timer;
+	gFrameStats.vertex_buffer_changes += 1;
+	gBackend->setVertexBuffer(const_cast<VertexBuffer&>(buffer));
+}
+
+void Device::setIndexBuffer(const IndexBuffer& buffer)
+{
+	BackendTimer timer;
+	gFrameStats.index_buffer_changes += 1;
+	gBackend->setIndexBuffer(const_cast<IndexBuffer&>(buffer));
+}
+
 void Device::setUniformBuffer(int slot, void* memory, size_t size)
 {
+	BackendTimer timer;
+	gFrameStats.uniform_buffer_changes += 1;
+	gFrameStats.uniform_buffer_bytes += size;
 	gBackend->setUniformBuffer(slot, memory, size);
 }
 
 void Device::setBlendMode(const BlendMode& value)
 {
+	BackendTimer timer;
+	gFrameStats.blend_mode_changes += 1;
 	gBackend->setBlendMode(value);
 }
 
 void Device::setDepthMode(std::optional<DepthMode> depth_mode)
 {
+	BackendTimer timer;
+	gFrameStats.depth_mode_changes += 1;
 	gBackend->setDepthMode(depth_mode);
 }
 
 void Device::setStencilMode(std::optional<StencilMode> stencil_mode)
 {
+	BackendTimer timer;
+	gFrameStats.stencil_mode_changes += 1;
 	gBackend->setStencilMode(stencil_mode);
 }
 
 void Device::setCullMode(CullMode cull_mode)
 {
+	BackendTimer timer;
+	gFrameStats.cull_mode_changes += 1;
 	gBackend->setCullMode(cull_mode);
 }
 
 void Device::setSampler(const Sampler& value)
 {
+	BackendTimer timer;
+	gFrameStats.sampler_changes += 1;
 	gBackend->setSampler(value);
 }
 
 void Device::setTextureAddressMode(const TextureAddress& value)
 {
+	BackendTimer timer;
+	gFrameStats.texture_address_changes += 1;
 	gBackend->setTextureAddressMode(value);
 }
 
 void Device::clear(const std::optional<glm::vec4>& color, const std::optional<float>& depth, 
 	const std::optional<uint8_t>& stencil)
 {
+	BackendTimer timer;
 	gBackend->clear(color, depth, stencil);
 }
 
 void Device::draw(uint32_t vertex_count, uint32_t vertex_offset)
 {
+	BackendTimer timer;
+	gFrameStats.draw_calls += 1;
+	gFrameStats.primitives += GetPrimitiveCount(gTopology, vertex_count);
 	gBackend->draw(vertex_count, vertex_offset);
 }
 
 void Device::drawIndexed(uint32_t index_count, uint32_t index_offset)
 {
+	BackendTimer timer;
+	gFrameStats.draw_indexed_calls += 1;
+	gFrameStats.primitives += GetPrimitiveCount(gTopology, index_count);
 	gBackend->drawIndexed(index_count, index_offset);
 }
 
 void Device::readPixels(const glm::ivec2& pos, const glm::ivec2& size, Texture& dst_texture)
 {
+	BackendTimer timer;
 	gBackend->readPixels(pos, size, dst_texture);
 }
 
 void Device::present()
 {
-	gBackend->present();
+	SKYGFX_TRACE_SCOPE("Device::present");
+
+	{
+		BackendTimer timer;
+		gBackend->present();
+	}
+
+	gLastFrameStats = gFrameStats;
+	gFrameStats = FrameStats();
+}
+
+const FrameStats& Device::getFrameStats() const
+{
+	return gLastFrameStats;
+}
+
+void Device::beginTimer(const std::string& name)
+{
+	BackendTimer timer;
+	gBackend->beginTimer(name);
+}
+
+void Device::endTimer()
+{
+	BackendTimer timer;
+	gBackend->endTimer();
+}
+
+const std::vector<GpuTimer>& Device::getGpuTimers() const
+{
+	return gBackend->getGpuTimers();
 }
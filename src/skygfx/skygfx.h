@@ -4,10 +4,12 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <memory>
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 #include "vertex.h"
 #include "shader_compiler.h"
+#include "shader_cache.h"
 #include "utils.h"
 
 namespace skygfx
@@ -17,12 +19,16 @@ namespace skygfx
 		D3D11,
 		OpenGL44,
 		Vulkan,
-		Metal
+		Metal,
+		Null,
+		Software
 	};
 
 	using TextureHandle = struct TextureHandle;
 	using RenderTargetHandle = struct RenderTargetHandle;
 	using ShaderHandle = struct ShaderHandle;
+	using VertexBufferHandle = struct VertexBufferHandle;
+	using IndexBufferHandle = struct IndexBufferHandle;
 
 	class Texture
 	{
@@ -53,11 +59,24 @@ namespace skygfx
 		RenderTargetHandle* mRenderTargetHandle = nullptr;
 	};
 
+	class ShaderBundle;
+
 	class Shader
 	{
 	public:
+#ifdef SKYGFX_RUNTIME_COMPILER
+		// shaders which differ only in specialization constants share one glsl compilation,
+		// unlike shaders with different defines. empty fragment_code makes a depth-only shader,
+		// it has no fragment stage and writes no color
 		Shader(const Vertex::Layout& layout, const std::string& vertex_code, 
-			const std::string& fragment_code, const std::vector<std::string>& defines = {});
+			const std::string& fragment_code, const std::vector<std::string>& defines = {},
+			const SpecializationConstants& specialization_constants = {});
+#endif
+
+		// precompiled entry of the bundle for the backend of the device, throws when there is no such entry.
+		// layout must have the attribute types the entry was compiled with
+		Shader(const Vertex::Layout& layout, const ShaderBundle& bundle, const std::string& name,
+			const SpecializationConstants& specialization_constants = {});
 		~Shader();
 
 		operator ShaderHandle* () { return mShaderHandle; }
@@ -66,6 +85,32 @@ namespace skygfx
 		ShaderHandle* mShaderHandle;
 	};
 
+#ifdef SKYGFX_RUNTIME_COMPILER
+	// stages are compiled on the shader compiler threads right away, the shader itself
+	// is created on the device thread by the first getShader call
+	class AsyncShader
+	{
+	public:
+		AsyncShader(const Vertex::Layout& layout, const std::string& vertex_code,
+			const std::string& fragment_code, const std::vector<std::string>& defines = {},
+			const SpecializationConstants& specialization_constants = {});
+
+		bool isReady() const; // getShader will not wait for compilation
+
+		// waits for compilation when it is not finished yet, rethrows compile errors
+		Shader& getShader();
+
+	private:
+		Vertex::Layout mLayout;
+		std::string mVertexCode;
+		std::string mFragmentCode;
+		std::vector<std::string> mDefines;
+		SpecializationConstants mSpecializationConstants;
+		std::vector<std::shared_future<CompiledShader>> mStages;
+		std::unique_ptr<Shader> mShader;
+	};
+#endif
+
 	struct Buffer
 	{
 		Buffer() {}
@@ -77,6 +122,42 @@ namespace skygfx
 		size_t stride = 0;
 	};
 
+	// buffers in gpu memory for geometry which does not change, contents are uploaded once
+	// on creation and bound by handle, while a Buffer is uploaded on every set call
+	class VertexBuffer
+	{
+	public:
+		VertexBuffer(const Buffer& buffer);
+		~VertexBuffer();
+
+		operator VertexBufferHandle* () { return mVertexBufferHandle; }
+
+		auto getSize() const { return mSize; }
+		auto getStride() const { return mStride; }
+
+	private:
+		VertexBufferHandle* mVertexBufferHandle = nullptr;
+		size_t mSize = 0;
+		size_t mStride = 0;
+	};
+
+	class IndexBuffer
+	{
+	public:
+		IndexBuffer(const Buffer& buffer); // stride is 2 or 4 bytes
+		~IndexBuffer();
+
+		operator IndexBufferHandle* () { return mIndexBufferHandle; }
+
+		auto getSize() const { return mSize; }
+		auto getStride() const { return mStride; }
+
+	private:
+		IndexBufferHandle* mIndexBufferHandle = nullptr;
+		size_t mSize = 0;
+		size_t mStride = 0;
+	};
+
 	enum class Topology
 	{
 		PointList,
@@ -294,6 +375,56 @@ namespace skygfx
 		MirrorWrap
 	};
 
+	struct FrameStats
+	{
+		uint32_t draw_calls = 0;
+		uint32_t draw_indexed_calls = 0;
+		uint64_t primitives = 0;
+
+		uint64_t vertex_buffer_bytes = 0;
+		uint64_t index_buffer_bytes = 0;
+		uint64_t uniform_buffer_bytes = 0;
+
+		uint32_t topology_changes = 0;
+		uint32_t viewport_changes = 0;
+		uint32_t scissor_changes = 0;
+		uint32_t texture_changes = 0;
+		uint32_t render_target_changes = 0;
+		uint32_t shader_changes = 0;
+		uint32_t vertex_buffer_changes = 0;
+		uint32_t index_buffer_changes = 0;
+		uint32_t uniform_buffer_changes = 0;
+		uint32_t blend_mode_changes = 0;
+		uint32_t depth_mode_changes = 0;
+		uint32_t stencil_mode_changes = 0;
+		uint32_t cull_mode_changes = 0;
+		uint32_t sampler_changes = 0;
+		uint32_t texture_address_changes = 0;
+
+		uint32_t pipelines_created = 0; // vulkan graphics pipelines
+		uint32_t state_objects_created = 0; // d3d11 blend, depth stencil, rasterizer and sampler states
+		uint32_t textures_created = 0;
+		uint32_t render_targets_created = 0;
+		uint32_t shaders_created = 0;
+		uint32_t buffers_created = 0; // vertex and index buffers
+
+		uint64_t backend_time_ns = 0; // cpu time spent inside backend calls, including present, see SetFrameStatsTimingEnabled
+	};
+
+	struct PipelineStatistics
+	{
+		uint64_t vertices = 0;
+		uint64_t primitives = 0;
+		uint64_t fragment_invocations = 0;
+	};
+
+	struct GpuTimer
+	{
+		std::string name;
+		double milliseconds = 0.0;
+		std::optional<PipelineStatistics> statistics; // not every backend supports pipeline statistics
+	};
+
 	class Device
 	{
 	public:
@@ -311,6 +442,8 @@ namespace skygfx
 		void setShader(const Shader& shader);
 		void setVertexBuffer(const Buffer& buffer);
 		void setIndexBuffer(const Buffer& buffer);
+		void setVertexBuffer(const VertexBuffer& buffer);
+		void setIndexBuffer(const IndexBuffer& buffer);
 		
 		void setUniformBuffer(int slot, void* memory, size_t size);
 		
@@ -332,7 +465,22 @@ namespace skygfx
 		void readPixels(const glm::ivec2& pos, const glm::ivec2& size, Texture& dst_texture);
 
 		void present();
+
+		// counters of the last presented frame
+		const FrameStats& getFrameStats() const;
+
+		// gpu time and pipeline statistics of commands between beginTimer and endTimer, timers can not be nested.
+		// queries are resolved without stalling, so getGpuTimers returns timers of the newest frame
+		// which gpu has finished, usually a few frames behind the current one
+		void beginTimer(const std::string& name);
+		void endTimer();
+		const std::vector<GpuTimer>& getGpuTimers() const;
 	};
+
+	// backend_time_ns of FrameStats is measured only while enabled, it costs two clock reads per Device call.
+	// other counters are always collected. disabled by default
+	void SetFrameStatsTimingEnabled(bool value);
+	bool IsFrameStatsTimingEnabled();
 }
 
 SKYGFX_MAKE_HASHABLE(skygfx::BlendMode,
@@ -0,0 +1,105 @@
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+using namespace skygfx;
+
+struct TraceEvent
+{
+	const char* name;
+	uint64_t start; // nanoseconds
+	uint64_t duration;
+	uint64_t thread;
+};
+
+#ifdef SKYGFX_TRACE
+static std::atomic<bool> gTraceEnabled = true;
+#else
+static std::atomic<bool> gTraceEnabled = false;
+#endif
+static std::mutex gTraceMutex;
+static std::vector<TraceEvent> gTraceEvents;
+static size_t gTraceNext = 0; // ring buffer position, events wrap around when full
+
+static uint64_t GetTraceTime()
+{
+	static const auto origin = std::chrono::steady_clock::now();
+	auto duration = std::chrono::steady_clock::now() - origin;
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+void skygfx::SetTraceEnabled(bool value)
+{
+	gTraceEnabled = value;
+}
+
+bool skygfx::IsTraceEnabled()
+{
+	return gTraceEnabled;
+}
+
+void skygfx::ClearTrace()
+{
+	std::lock_guard lock(gTraceMutex);
+	gTraceEvents.clear();
+	gTraceNext = 0;
+}
+
+void skygfx::WriteTrace(std::ostream& stream)
+{
+	std::lock_guard lock(gTraceMutex);
+
+	stream << "{\"traceEvents\":[";
+
+	for (size_t i = 0; i < gTraceEvents.size(); i++)
+	{
+		// oldest event first
+
+		const auto& event = gTraceEvents.at((gTraceNext + i) % gTraceEvents.size());
+
+		if (i > 0)
+			stream << ",";
+
+		stream << "\n{\"name\":\"" << event.name << "\",\"cat\":\"skygfx\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+			<< ",\"ts\":" << event.start / 1000 << "." << event.start % 1000 / 100
+			<< ",\"dur\":" << event.duration / 1000 << "." << event.duration % 1000 / 100 << "}";
+	}
+
+	stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+TraceScope::TraceScope(const char* name) : mName(name), mEnabled(gTraceEnabled)
+{
+	if (mEnabled)
+		mStart = GetTraceTime();
+}
+
+TraceScope::~TraceScope()
+{
+	if (!mEnabled)
+		return;
+
+	auto event = TraceEvent{
+		.name = mName,
+		.start = mStart,
+		.duration = GetTraceTime() - mStart,
+		.thread = std::hash<std::thread::id>()(std::this_thread::get_id()) % 100000
+	};
+
+	std::lock_guard lock(gTraceMutex);
+
+	if (gTraceEvents.size() < TraceCapacity)
+	{
+		gTraceEvents.push_back(event);
+		return;
+	}
+
+	gTraceEvents[gTraceNext] = event;
+	gTraceNext = (gTraceNext + 1) % TraceCapacity;
+}
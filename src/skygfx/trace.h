@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+
+namespace skygfx
+{
+	// spans of expensive internal operations (shader compilation, pipeline creation, uploads, present)
+	// are recorded only when the library is built with SKYGFX_TRACE. recording keeps the last
+	// TraceCapacity spans in a ring buffer, so it can stay enabled in long sessions
+
+	static constexpr uint32_t TraceCapacity = 65536;
+
+	void SetTraceEnabled(bool value);
+	bool IsTraceEnabled();
+	void ClearTrace();
+
+	// writes recorded spans in chrome trace event format, can be opened in chrome://tracing or ui.perfetto.dev
+	void WriteTrace(std::ostream& stream);
+
+	class TraceScope
+	{
+	public:
+		TraceScope(const char* name); // name must be a string literal
+		~TraceScope();
+
+	private:
+		const char* mName;
+		bool mEnabled;
+		uint64_t mStart = 0;
+	};
+}
+
+#define SKYGFX_TRACE_CONCAT_IMPL(a, b) a##b
+#define SKYGFX_TRACE_CONCAT(a, b) SKYGFX_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef SKYGFX_TRACE
+#define SKYGFX_TRACE_SCOPE(name) skygfx::TraceScope SKYGFX_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+#define SKYGFX_TRACE_SCOPE(name)
+#endif
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 #include <glm/glm.hpp>
 
 namespace skygfx::Vertex
@@ -51,7 +52,7 @@ namespace skygfx::Vertex
 	{
 		glm::vec3 pos = { 0.0f, 0.0f, 0.0f };
 
-		static const Layout Layout;
+		static const Vertex::Layout Layout;
 	};
 
 	struct PositionColor
@@ -59,7 +60,7 @@ namespace skygfx::Vertex
 		glm::vec3 pos = { 0.0f, 0.0f, 0.0f };
 		glm::vec4 col = { 0.0f, 0.0f, 0.0f, 0.0f };
 
-		static const Layout Layout;
+		static const Vertex::Layout Layout;
 	};
 
 	struct PositionTexture 
@@ -67,7 +68,7 @@ namespace skygfx::Vertex
 		glm::vec3 pos = { 0.0f, 0.0f, 0.0f };
 		glm::vec2 tex = { 0.0f, 0.0f };
 	
-		static const Layout Layout;
+		static const Vertex::Layout Layout;
 	};
 
 	struct PositionNormal
@@ -75,7 +76,7 @@ namespace skygfx::Vertex
 		glm::vec3 pos = { 0.0f, 0.0f, 0.0f };
 		glm::vec3 normal = { 0.0f, 0.0f, 0.0f };
 
-		static const Layout Layout;
+		static const Vertex::Layout Layout;
 	};
 
 	struct PositionColorNormal
@@ -84,7 +85,7 @@ namespace skygfx::Vertex
 		glm::vec4 col = { 0.0f, 0.0f, 0.0f, 0.0f };
 		glm::vec3 normal = { 0.0f, 0.0f, 0.0f };
 
-		static const Layout Layout;
+		static const Vertex::Layout Layout;
 	};
 
 	struct PositionColorTexture
@@ -93,7 +94,7 @@ namespace skygfx::Vertex
 		glm::vec4 col = { 0.0f, 0.0f, 0.0f, 0.0f };
 		glm::vec2 tex = { 0.0f, 0.0f };
 
-		static const Layout Layout;
+		static const Vertex::Layout Layout;
 	};
 
 	struct PositionTextureNormal
@@ -102,7 +103,7 @@ namespace skygfx::Vertex
 		glm::vec2 tex = { 0.0f, 0.0f };
 		glm::vec3 normal = { 0.0f, 0.0f, 0.0f };
 
-		static const Layout Layout;
+		static const Vertex::Layout Layout;
 	};
 
 	struct PositionColorTextureNormal
@@ -112,6 +113,6 @@ namespace skygfx::Vertex
 		glm::vec2 tex = { 0.0f, 0.0f };
 		glm::vec3 normal = { 0.0f, 0.0f, 0.0f };
 
-		static const Layout Layout;
+		static const Vertex::Layout Layout;
 	};
 }
\ No newline at end of file